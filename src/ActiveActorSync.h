@@ -0,0 +1,237 @@
+/*
+=====================================================================
+
+File Name	  :	ActiveActorSync.h
+
+Description	  : Incremental pose sync from the simulation to the renderer. It uses the active
+				actor list of a scene created with 'PxSceneFlag::eENABLE_ACTIVE_ACTORS'
+				instead of reading every actor each frame.
+
+				'ActiveActorSyncInit()' gives every drawn shape a slot in a persistent
+				structure-of-arrays pose buffer ('PoseArraySoA'). The slots are in the batch
+				order of 'ShapeRenderer.h'. After each 'fetchResults()',
+				'ActiveActorSyncUpdate()' walks only 'PxScene::getActiveActors()'. It rewrites
+				the slots of those actors and marks them dirty. The renderer asks for the dirty
+				slots as sorted, merged ranges and uploads only those, so its cost follows the
+				number of moving bodies rather than the total.
+
+				Sleeping and static actors are never visited. Actors moved by 'setGlobalPose()'
+				appear once the next step has run, because that call wakes them.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+using namespace std;
+using namespace physx;
+
+
+//Shape poses, one component per array
+struct PoseArraySoA
+{
+	vector<PxReal>	px, py, pz;
+	vector<PxReal>	qx, qy, qz, qw;
+
+	void resize(size_t count)
+	{
+		px.resize(count); py.resize(count); pz.resize(count);
+		qx.resize(count); qy.resize(count); qz.resize(count); qw.resize(count);
+	}
+
+	void set(PxU32 i, const PxTransform& pose)
+	{
+		px[i] = pose.p.x; py[i] = pose.p.y; pz[i] = pose.p.z;
+		qx[i] = pose.q.x; qy[i] = pose.q.y; qz[i] = pose.q.z; qw[i] = pose.q.w;
+	}
+
+	PxTransform get(PxU32 i) const
+	{
+		return PxTransform(PxVec3(px[i], py[i], pz[i]), PxQuat(qx[i], qy[i], qz[i], qw[i]));
+	}
+};
+
+
+//Slots [begin, end)
+struct DirtyRange
+{
+	PxU32	begin;
+	PxU32	end;
+};
+
+
+//Slots of one actor's shapes, as a run in 'ActiveActorSync::actorSlots'
+struct ActorSlots
+{
+	PxU32	first;
+	PxU32	count;
+};
+
+
+struct ActiveActorSync
+{
+	bool							enabled;
+	PoseArraySoA					poses;			//Global shape pose per slot
+	vector<PxTransform>				localPoses;		//Shape pose relative to its actor, per slot
+	vector<PxU32>					actorSlots;		//Slot indices grouped by actor
+	unordered_map<PxActor*, ActorSlots>	actors;
+	vector<PxU8>					dirtyFlags;		//Per slot, set until 'ActiveActorSyncClearDirty()'
+	vector<PxU32>					dirtySlots;		//Slots with their flag set, unsorted
+	vector<DirtyRange>				dirtyRanges;	//Built by 'ActiveActorSyncDirtyRanges()'
+};
+
+
+struct ActiveActorSyncStats
+{
+	PxU64	updates;			//'ActiveActorSyncUpdate()' calls, one per step
+	PxU64	activeActors;		//Summed over all updates
+	PxU64	uploads;			//'ActiveActorSyncClearDirty()' calls, one per drawn frame
+	PxU64	uploadedSlots;		//Dirty slots summed over all uploads
+	PxU64	uploadedRanges;		//Dirty ranges summed over all uploads
+};
+
+
+const PxU32 DIRTY_RANGE_MERGE_GAP = 8;	//Clean slots between two ranges that are uploaded anyway, to save calls
+
+ActiveActorSync			gActiveActorSync;
+ActiveActorSyncStats	gActiveActorSyncStats = { 0, 0, 0, 0, 0 };
+
+
+void ActiveActorSyncInit(PxScene& scene, const vector<PxRigidActor*>& actors, const vector<PxShape*>& shapes);
+void ActiveActorSyncUpdate(PxScene& scene);
+const vector<DirtyRange>& ActiveActorSyncDirtyRanges();
+void ActiveActorSyncClearDirty();
+void PrintActiveActorSyncStats();
+
+
+
+void MarkSlotDirty(PxU32 slot)
+{
+	ActiveActorSync& s = gActiveActorSync;
+	if(s.dirtyFlags[slot])
+		return;
+	s.dirtyFlags[slot] = 1;
+	s.dirtySlots.push_back(slot);
+}
+
+
+//Slot i belongs to 'shapes[i]' of 'actors[i]'. Every slot starts out dirty.
+void ActiveActorSyncInit(PxScene& scene, const vector<PxRigidActor*>& actors, const vector<PxShape*>& shapes)
+{
+	ActiveActorSync& s = gActiveActorSync;
+	PxU32 count = PxU32(shapes.size());
+
+	//Mutable flag, switched on here for scenes created without it
+	scene.setFlag(PxSceneFlag::eENABLE_ACTIVE_ACTORS, true);
+
+	s.poses.resize(count);
+	s.localPoses.resize(count);
+	s.dirtyFlags.assign(count, 0);
+	s.dirtySlots.clear();
+	s.dirtySlots.reserve(count);
+	s.actors.clear();
+
+	//Group the slots by actor, an actor's shapes may be spread over several batches
+	unordered_map<PxActor*, vector<PxU32> > slotsOfActor;
+	for(PxU32 i=0; i<count; i++)
+	{
+		s.localPoses[i] = shapes[i]->getLocalPose();
+		s.poses.set(i, actors[i]->getGlobalPose()*s.localPoses[i]);
+		slotsOfActor[actors[i]].push_back(i);
+		MarkSlotDirty(i);
+	}
+
+	s.actorSlots.clear();
+	s.actorSlots.reserve(count);
+	for(unordered_map<PxActor*, vector<PxU32> >::iterator it = slotsOfActor.begin(); it != slotsOfActor.end(); ++it)
+	{
+		ActorSlots run = { PxU32(s.actorSlots.size()), PxU32(it->second.size()) };
+		s.actorSlots.insert(s.actorSlots.end(), it->second.begin(), it->second.end());
+		s.actors[it->first] = run;
+	}
+
+	s.enabled = true;
+}
+
+
+//Call after every 'fetchResults()', before the next 'simulate()'
+void ActiveActorSyncUpdate(PxScene& scene)
+{
+	ActiveActorSync& s = gActiveActorSync;
+
+	PxU32 nbActive = 0;
+	PxActor** active = scene.getActiveActors(nbActive);
+	for(PxU32 i=0; i<nbActive; i++)
+	{
+		unordered_map<PxActor*, ActorSlots>::const_iterator it = s.actors.find(active[i]);
+		if(it == s.actors.end())
+			continue;	//Not drawn
+
+		PxTransform actorPose = static_cast<PxRigidActor*>(active[i])->getGlobalPose();
+		for(PxU32 j=0; j<it->second.count; j++)
+		{
+			PxU32 slot = s.actorSlots[it->second.first + j];
+			s.poses.set(slot, actorPose*s.localPoses[slot]);
+			MarkSlotDirty(slot);
+		}
+	}
+
+	gActiveActorSyncStats.updates++;
+	gActiveActorSyncStats.activeActors += nbActive;
+}
+
+
+//Dirty slots since the last 'ActiveActorSyncClearDirty()', sorted and merged across small gaps
+const vector<DirtyRange>& ActiveActorSyncDirtyRanges()
+{
+	ActiveActorSync& s = gActiveActorSync;
+	s.dirtyRanges.clear();
+	sort(s.dirtySlots.begin(), s.dirtySlots.end());
+
+	for(size_t i=0; i<s.dirtySlots.size(); i++)
+	{
+		PxU32 slot = s.dirtySlots[i];
+		if(!s.dirtyRanges.empty() && slot <= s.dirtyRanges.back().end + DIRTY_RANGE_MERGE_GAP)
+		{
+			s.dirtyRanges.back().end = slot + 1;
+		}
+		else
+		{
+			DirtyRange range = { slot, slot + 1 };
+			s.dirtyRanges.push_back(range);
+		}
+	}
+	return s.dirtyRanges;
+}
+
+
+//Call once the dirty ranges have been uploaded
+void ActiveActorSyncClearDirty()
+{
+	ActiveActorSync& s = gActiveActorSync;
+	for(size_t i=0; i<s.dirtySlots.size(); i++)
+		s.dirtyFlags[s.dirtySlots[i]] = 0;
+
+	gActiveActorSyncStats.uploads++;
+	gActiveActorSyncStats.uploadedSlots	 += s.dirtySlots.size();
+	gActiveActorSyncStats.uploadedRanges += s.dirtyRanges.size();
+	s.dirtySlots.clear();
+}
+
+
+void PrintActiveActorSyncStats()
+{
+	const ActiveActorSyncStats& s = gActiveActorSyncStats;
+	if(!gActiveActorSync.enabled || !s.updates || !s.uploads)
+		return;
+
+	printf("active actor sync: %u slots  active actors per step: %.1f  uploaded per frame: %.1f slots in %.1f ranges\n",
+		PxU32(gActiveActorSync.dirtyFlags.size()), double(s.activeActors)/s.updates,
+		double(s.uploadedSlots)/s.uploads, double(s.uploadedRanges)/s.uploads);
+}
@@ -0,0 +1,200 @@
+/*
+=====================================================================
+
+File Name	  :	AgentQuery.h
+
+Description	  : Local scene queries for characters and AI agents. An agent casts many short
+				rays, sweeps and overlaps within 'reach' of itself, so its queries go
+				through a 'PxVolumeCache' around it instead of through the whole scene's
+				query trees.
+
+				Each agent's cache holds the shapes inside a sphere of radius
+				'reach + margin' around the point where it was last filled.
+				'AgentQueryMove()' refills it only in two cases. One is when the agent's
+				reach no longer fits inside that sphere, i.e. the agent has moved more than
+				'margin'. The other is when 'fill()' reported overflow last time. On
+				overflow, the capacity is doubled before the next fill, so an agent in a
+				dense area stops overflowing after a few frames. A cache also goes out of
+				date whenever actors in the scene move, e.g. a character's own kinematic
+				capsule. PhysX refills such a cache lazily inside its next query, so
+				'AgentQueryMove()' does not refill it for that.
+
+				Queries that do not fit inside the cached sphere, and queries of an invalid
+				cache, are answered by the scene itself. The results are therefore always
+				the same as those of 'PxScene' queries.
+
+				Use these functions while the scene is not being simulated.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include <cstdio>
+#include <vector>
+#include <chrono>
+
+using namespace std;
+using namespace physx;
+
+
+struct QueryAgent
+{
+	PxVolumeCache*	cache;
+	PxVec3			center;			//Where the cache was last filled
+	bool			filled;			//'center' is valid and the last fill fit
+	PxU32			maxStatics;		//Capacity of the cache
+	PxU32			maxDynamics;
+};
+
+
+struct AgentQueryStats
+{
+	PxU64	moves;				//'AgentQueryMove()' calls
+	PxU64	refills;			//'fill()' calls
+	PxU64	leftVolume;			//Refills because the agent moved out of its cached volume
+	PxU64	overflows;			//Fills that returned 'FILL_OVER_MAX_COUNT'
+	PxU64	queries;
+	double	fillMs;				//Time in 'fill()'
+	double	queryMs;			//Time in the agents' queries
+};
+
+
+struct AgentQueries
+{
+	PxScene*			scene;
+	PxReal				reach;		//Distance from the agent its queries cover
+	PxReal				margin;		//Distance it may move before a refill
+	vector<QueryAgent>	agents;
+};
+
+
+const PxU32 AGENT_QUERY_MAX_CAPACITY = 4096;	//Shapes per kind and cache, beyond it the scene answers
+
+AgentQueries	gAgentQueries = { NULL, 0.0f, 0.0f };
+AgentQueryStats	gAgentQueryStats = { 0, 0, 0, 0, 0, 0.0, 0.0 };
+
+
+void AgentQueryInit(PxScene& scene, PxU32 agentCount, PxReal reach, PxReal margin, PxU32 maxStatics = 64, PxU32 maxDynamics = 16);
+void AgentQueryMove(PxU32 agent, const PxVec3& position);
+bool AgentRaycast(PxU32 agent, const PxVec3& origin, const PxVec3& unitDir, PxReal distance, PxRaycastCallback& hits,
+	const PxQueryFilterData& filterData = PxQueryFilterData());
+bool AgentSweep(PxU32 agent, const PxGeometry& geometry, const PxTransform& pose, const PxVec3& unitDir, PxReal distance, PxSweepCallback& hits,
+	const PxQueryFilterData& filterData = PxQueryFilterData());
+bool AgentOverlap(PxU32 agent, const PxGeometry& geometry, const PxTransform& pose, PxOverlapCallback& hits,
+	const PxQueryFilterData& filterData = PxQueryFilterData());
+void AgentQueryRelease();
+void PrintAgentQueryStats();
+
+
+
+double AgentQueryClockMs()
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void AgentQueryInit(PxScene& scene, PxU32 agentCount, PxReal reach, PxReal margin, PxU32 maxStatics, PxU32 maxDynamics)
+{
+	AgentQueries& a = gAgentQueries;
+	a.scene	 = &scene;
+	a.reach	 = reach;
+	a.margin = margin;
+	a.agents.resize(agentCount);
+	for(PxU32 i=0; i<agentCount; i++)
+	{
+		QueryAgent& agent = a.agents[i];
+		agent.cache		  = scene.createVolumeCache(maxStatics, maxDynamics);
+		agent.center	  = PxVec3(0.0f);
+		agent.filled	  = false;
+		agent.maxStatics  = maxStatics;
+		agent.maxDynamics = maxDynamics;
+	}
+}
+
+
+//Call whenever the agent has moved, before its queries
+void AgentQueryMove(PxU32 index, const PxVec3& position)
+{
+	AgentQueries& a = gAgentQueries;
+	QueryAgent& agent = a.agents[index];
+	gAgentQueryStats.moves++;
+
+	bool inside = agent.filled && (position - agent.center).magnitude() <= a.margin;
+	if(inside)
+		return;
+	if(agent.filled)
+		gAgentQueryStats.leftVolume++;
+
+	double start = AgentQueryClockMs();
+	PxVolumeCache::FillStatus status = agent.cache->fill(PxSphereGeometry(a.reach + a.margin), PxTransform(position));
+	gAgentQueryStats.fillMs += AgentQueryClockMs() - start;
+	gAgentQueryStats.refills++;
+
+	agent.center = position;
+	agent.filled = status == PxVolumeCache::FILL_OK;
+	if(status == PxVolumeCache::FILL_OVER_MAX_COUNT)
+	{
+		//The cache stays invalid until the next move, the scene answers meanwhile
+		gAgentQueryStats.overflows++;
+		agent.maxStatics  = PxMin(2*agent.maxStatics, AGENT_QUERY_MAX_CAPACITY);
+		agent.maxDynamics = PxMin(2*agent.maxDynamics, AGENT_QUERY_MAX_CAPACITY);
+		agent.cache->setMaxNbStaticShapes(agent.maxStatics);
+		agent.cache->setMaxNbDynamicShapes(agent.maxDynamics);
+	}
+}
+
+
+bool AgentRaycast(PxU32 agent, const PxVec3& origin, const PxVec3& unitDir, PxReal distance, PxRaycastCallback& hits,
+	const PxQueryFilterData& filterData)
+{
+	double start = AgentQueryClockMs();
+	bool hit = gAgentQueries.agents[agent].cache->raycast(origin, unitDir, distance, hits, PxHitFlag::eDEFAULT, filterData);
+	gAgentQueryStats.queries++;
+	gAgentQueryStats.queryMs += AgentQueryClockMs() - start;
+	return hit;
+}
+
+
+bool AgentSweep(PxU32 agent, const PxGeometry& geometry, const PxTransform& pose, const PxVec3& unitDir, PxReal distance, PxSweepCallback& hits,
+	const PxQueryFilterData& filterData)
+{
+	double start = AgentQueryClockMs();
+	bool hit = gAgentQueries.agents[agent].cache->sweep(geometry, pose, unitDir, distance, hits, PxHitFlag::eDEFAULT, filterData);
+	gAgentQueryStats.queries++;
+	gAgentQueryStats.queryMs += AgentQueryClockMs() - start;
+	return hit;
+}
+
+
+bool AgentOverlap(PxU32 agent, const PxGeometry& geometry, const PxTransform& pose, PxOverlapCallback& hits,
+	const PxQueryFilterData& filterData)
+{
+	double start = AgentQueryClockMs();
+	bool hit = gAgentQueries.agents[agent].cache->overlap(geometry, pose, hits, filterData);
+	gAgentQueryStats.queries++;
+	gAgentQueryStats.queryMs += AgentQueryClockMs() - start;
+	return hit;
+}
+
+
+void AgentQueryRelease()
+{
+	AgentQueries& a = gAgentQueries;
+	for(size_t i=0; i<a.agents.size(); i++)
+		a.agents[i].cache->release();
+	a.agents.clear();
+}
+
+
+void PrintAgentQueryStats()
+{
+	const AgentQueryStats& s = gAgentQueryStats;
+	if(!s.moves)
+		return;
+
+	printf("agent queries: %u agents  refill rate %.1f%% of moves (%llu left the volume, %llu overflows)  fill %.3f ms  %llu queries %.3f ms (%.2f us each)\n",
+		PxU32(gAgentQueries.agents.size()), 100.0*s.refills/s.moves, (unsigned long long)s.leftVolume, (unsigned long long)s.overflows,
+		s.fillMs, (unsigned long long)s.queries, s.queryMs, s.queries ? 1000.0*s.queryMs/s.queries : 0.0);
+}
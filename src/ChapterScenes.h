@@ -0,0 +1,508 @@
+/*
+=====================================================================
+
+File Name	  :	ChapterScenes.h
+
+Description	  : The scenes of the chapters, without any windowing or rendering code, so
+				that the demos and 'physx_bench' build exactly the same scenes.
+
+				Every 'Create...Scene()' creates a scene on the given CPU dispatcher, adds
+				the chapter's actors and returns the ones the chapter drives from its
+				render loop in 'ChapterActors'. Debug visualization, simulation event
+				callbacks and input handling stay with the chapters.
+
+				'gChapterScenes' lists them by the short name used on the command line of
+				'physx_bench' ("ch2" .. "ch9"), together with the per-step game logic of
+				the chapter, if any.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include <iostream>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+using namespace physx;
+
+
+//Actors a chapter keeps a handle to, NULL or empty when the chapter has none
+struct ChapterActors
+{
+	ChapterActors() : box(NULL), connectedBox(NULL), sphere(NULL), particleSystem(NULL),
+					  controllerManager(NULL), capsuleController(NULL), cloth(NULL) {}
+
+	PxRigidDynamic*			box;				//CH2 falling box, CH3 pushed box, CH6 raycast target
+	PxRigidDynamic*			connectedBox;		//CH3, CH5: box spinning on a D6 joint
+	PxRigidDynamic*			sphere;				//CH6 raycast hit marker
+	vector<PxJoint*>		chainJoints;		//CH5 spherical joint chain
+	PxParticleSystem*		particleSystem;		//CH8, NULL if the particles could not be created
+	PxControllerManager*	controllerManager;	//CH7, release before the scene
+	PxCapsuleController*	capsuleController;	//CH7
+	PxCloth*				cloth;				//CH9
+};
+
+
+typedef PxScene* (*CreateChapterSceneFunction)(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors);
+typedef void (*UpdateChapterSceneFunction)(ChapterActors& actors, PxReal dt);
+
+struct ChapterScene
+{
+	const char*					name;		//"ch2" .. "ch9"
+	CreateChapterSceneFunction	create;
+	UpdateChapterSceneFunction	update;		//Per-step game logic, NULL for none
+};
+
+
+PxScene* CreateHelloPhysxScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors);
+PxScene* CreateRigidbodyScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors);
+PxScene* CreateCollisionDetectionScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors);
+PxScene* CreateJointsScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors);
+PxScene* CreateSceneQueriesScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors);
+PxScene* CreateCharControllerScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors);
+PxScene* CreateParticlesScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors);
+PxScene* CreateClothScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors);
+void UpdateRigidbodyScene(ChapterActors& actors, PxReal dt);
+void UpdateJointsScene(ChapterActors& actors, PxReal dt);
+const ChapterScene* FindChapterScene(const char* name);
+
+
+
+//Scene descriptor shared by all chapters
+PxSceneDesc ChapterSceneDesc(PxPhysics& physics, PxCpuDispatcher* dispatcher)
+{
+	PxSceneDesc sceneDesc(physics.getTolerancesScale());	//Descriptor class for scenes
+	sceneDesc.gravity		= PxVec3(0.0f, -9.8f, 0.0f);	//Setting gravity
+	sceneDesc.cpuDispatcher = dispatcher;
+	sceneDesc.filterShader  = PxDefaultSimulationFilterShader;	//Creates default collision filter shader for the scene
+	sceneDesc.flags		   |= PxSceneFlag::eENABLE_ACTIVE_ACTORS;	//List the actors that moved in each step, see 'ActiveActorSync.h'
+	return sceneDesc;
+}
+
+
+//Static plane that acts as ground
+void AddGroundPlane(PxPhysics& physics, PxScene& scene, PxMaterial& material)
+{
+	PxTransform planePos =	PxTransform(PxVec3(0.0f),PxQuat(PxHalfPi, PxVec3(0.0f, 0.0f, 1.0f)));	//Position and orientation(transform) for plane actor
+	PxRigidStatic* plane =  physics.createRigidStatic(planePos);									//Creating rigid static actor
+							plane->createShape(PxPlaneGeometry(), material);						//Defining geometry for plane actor
+							scene.addActor(*plane);													//Adding plane actor to PhysX scene
+}
+
+
+
+//---------CH2: a box falling on a plane---------
+PxScene* CreateHelloPhysxScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors)
+{
+	PxScene* scene = physics.createScene(ChapterSceneDesc(physics, dispatcher));
+	PxMaterial* material = physics.createMaterial(0.5,0.5,0.5);
+
+	AddGroundPlane(physics, *scene, *material);
+
+	PxTransform		boxPos(PxVec3(0.0f, 10.0f, 0.0f));
+	PxBoxGeometry	boxGeometry(PxVec3(2,2,2));
+	actors.box = PxCreateDynamic(physics, boxPos, boxGeometry, *material, 1.0f);
+	scene->addActor(*actors.box);
+
+	return scene;
+}
+
+
+
+//---------CH3: forces, velocities and a box spinning on a D6 joint---------
+PxScene* CreateRigidbodyScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors)
+{
+	PxScene* scene = physics.createScene(ChapterSceneDesc(physics, dispatcher));
+	PxMaterial* material = physics.createMaterial(0.5f,0.5f,0.5f);
+
+	AddGroundPlane(physics, *scene, *material);
+
+	//A force is applied on this actor on every step
+	{
+		PxMaterial* mat = physics.createMaterial(0.2f,0.2f,0.2f);
+		PxTransform		boxPos(PxVec3(0.0f, 10.0f, 30.0f));
+		PxBoxGeometry	boxGeometry(PxVec3(1.5f,1.5f,1.5f));
+		actors.box = PxCreateDynamic(physics, boxPos, boxGeometry, *mat, 1.0f);
+		scene->addActor(*actors.box);
+	}
+
+	//Initial linear velocity pushes this actor upward for a while
+	{
+		PxTransform		boxPos(PxVec3(5.0f, 0.1f, 0.0f));
+		PxBoxGeometry	boxGeometry(PxVec3(1.5f,1.5f,1.5f));
+		PxRigidDynamic* box2 = PxCreateDynamic(physics, boxPos, boxGeometry, *material, 1.0f);
+		box2->setMass(1);							//Setting mass of the actor
+		box2->setLinearVelocity(PxVec3(0,25,0));	//Setting initial linear velocity on the actor
+		scene->addActor(*box2);
+	}
+
+	//A box attached to a static actor, free to rotate around y axis
+	{
+		PxVec3 pos = PxVec3(10,15,25);
+		PxVec3 offset = PxVec3(0,1.5,0);
+		PxRigidActor* staticActor = PxCreateStatic(physics, PxTransform(pos), PxSphereGeometry(0.5f), *material);
+		actors.connectedBox = PxCreateDynamic(physics, PxTransform(PxVec3(0),PxQuat(PxHalfPi,PxVec3(0,0,1))), PxBoxGeometry(0.5,0.5,4), *material, 1.0f);
+		PxD6Joint* d6Joint = PxD6JointCreate(physics, staticActor, PxTransform(-offset), actors.connectedBox, PxTransform(offset));
+				   d6Joint->setConstraintFlag(PxConstraintFlag::eVISUALIZATION, true);
+				   d6Joint->setMotion(PxD6Axis::eSWING1, PxD6Motion::eFREE);
+		scene->addActor(*staticActor);
+		scene->addActor(*actors.connectedBox);
+	}
+
+	return scene;
+}
+
+
+void UpdateRigidbodyScene(ChapterActors& actors, PxReal dt)
+{
+	actors.connectedBox->setAngularVelocity(PxVec3(0,1,0));	//Applying angular velocity to the actor
+	actors.box->addForce(PxVec3(0,0,-180));					//Applying force to the actor
+}
+
+
+
+//---------CH4: trigger and contact reports, CCD---------
+
+//Reports all initial and persisting contacts with per-point data, with CCD
+PxFilterFlags customFilterShader(PxFilterObjectAttributes attributes0, PxFilterData filterData0,
+										PxFilterObjectAttributes attributes1, PxFilterData filterData1,
+										PxPairFlags& pairFlags, const void* constantBlock, PxU32 constantBlockSize)
+{
+	pairFlags = PxPairFlag::eCONTACT_DEFAULT
+			  |	PxPairFlag::eTRIGGER_DEFAULT
+			  | PxPairFlag::eNOTIFY_CONTACT_POINTS
+			  | PxPairFlag::eDETECT_CCD_CONTACT; //Set flag to enable CCD (Continuous Collision Detection)
+
+	return PxFilterFlag::eDEFAULT;
+}
+
+
+//The chapter registers its 'PxSimulationEventCallback' with 'PxScene::setSimulationEventCallback()'
+PxScene* CreateCollisionDetectionScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors)
+{
+	PxSceneDesc sceneDesc = ChapterSceneDesc(physics, dispatcher);
+	sceneDesc.filterShader  = customFilterShader;		//Creates custom user collision filter shader for the scene
+	sceneDesc.flags		   |= PxSceneFlag::eENABLE_CCD;	//Set flag to enable CCD (Continuous Collision Detection)
+	PxScene* scene = physics.createScene(sceneDesc);
+
+	PxMaterial* material = physics.createMaterial(0.5f,0.5f,0.5f);
+	AddGroundPlane(physics, *scene, *material);
+
+	{
+		//A dynamic sphere falling on to a trigger shape, which invokes 'onTrigger()'
+		PxTransform			spherePos(PxVec3(-10.0f, 10.0f, 0.0f));
+		PxRigidDynamic*		sphere = PxCreateDynamic(physics, spherePos, PxSphereGeometry(2), *material, 1.0f);
+		scene->addActor(*sphere);
+
+		//The trigger shape can't collide against any object, thus it is made static
+		PxTransform		boxPos(PxVec3(-10.0f, 2.10f, 0.0f));
+		PxShape*		boxShape =	physics.createShape(PxBoxGeometry(PxVec3(3.0f,2.0f,3.0f)),*material);
+						boxShape->setFlag(PxShapeFlag::eSIMULATION_SHAPE, false);	//flagged to disable shape collision
+						boxShape->setFlag(PxShapeFlag::eTRIGGER_SHAPE, true);		//flagged as trigger shape
+		PxRigidStatic*	triggerBox = PxCreateStatic(physics, boxPos, *boxShape);
+		scene->addActor(*triggerBox);
+	}
+
+	{
+		//A CCD sphere falling on to a dynamic box, which invokes 'onContact()'
+		PxTransform			spherePos(PxVec3(10.0f, 10.0f, 0.0f));
+		PxRigidDynamic*		sphere = PxCreateDynamic(physics, spherePos, PxSphereGeometry(2), *material, 1.0f);
+		sphere->setRigidBodyFlag(PxRigidBodyFlag::eENABLE_CCD, true); //Set flag to enable CCD (Continuous Collision Detection) for the actor
+		scene->addActor(*sphere);
+
+		PxTransform		boxPos(PxVec3(10.0f, 2.0f, 0.0f));
+		PxRigidDynamic* box2 = PxCreateDynamic(physics, boxPos, PxBoxGeometry(PxVec3(3.0f,2.0f,3.0f)), *material, 1.0f);
+		scene->addActor(*box2);
+	}
+
+	return scene;
+}
+
+
+
+//---------CH5: fixed, D6 and spherical joints---------
+PxScene* CreateJointsScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors)
+{
+	PxScene* scene = physics.createScene(ChapterSceneDesc(physics, dispatcher));
+	PxMaterial* material = physics.createMaterial(0.5f,0.5f,0.5f);
+
+	AddGroundPlane(physics, *scene, *material);
+
+	//Fixed joint between two spheres
+	{
+		PxVec3 pos = PxVec3(5,50,10);
+		PxVec3 offset = PxVec3(0,3,0);
+		PxRigidDynamic* actor = PxCreateDynamic(physics, PxTransform(pos), PxSphereGeometry(3.0f), *material, 1.0f);
+		PxRigidDynamic* otherActor = PxCreateDynamic(physics, PxTransform(pos), PxSphereGeometry(3.0f), *material, 1.0f);
+		PxFixedJoint* fixedJoint = PxFixedJointCreate(physics, actor, PxTransform(-offset), otherActor, PxTransform(offset));
+					  fixedJoint->setConstraintFlag(PxConstraintFlag::eVISUALIZATION, true); //setting joint debug-visualization true
+		scene->addActor(*actor);
+		scene->addActor(*otherActor);
+	}
+
+	//D6 joint, the connected box is free to rotate around y axis and spun on every step
+	{
+		PxVec3 pos = PxVec3(10,10,3);
+		PxVec3 offset = PxVec3(0,1.5,0);
+		PxRigidActor* staticActor = PxCreateStatic(physics, PxTransform(pos), PxSphereGeometry(0.5f), *material);
+		actors.connectedBox = PxCreateDynamic(physics, PxTransform(PxVec3(0),PxQuat(PxHalfPi,PxVec3(0,0,1))), PxBoxGeometry(2,2,15), *material, 1.0f);
+		PxD6Joint* d6Joint = PxD6JointCreate(physics, staticActor, PxTransform(-offset), actors.connectedBox, PxTransform(offset));
+				   d6Joint->setConstraintFlag(PxConstraintFlag::eVISUALIZATION, true);
+				   d6Joint->setMotion(PxD6Axis::eSWING1, PxD6Motion::eFREE); //free to rotate around y axis
+		scene->addActor(*staticActor);
+		scene->addActor(*actors.connectedBox);
+	}
+
+	//A series of spheres inter-connected by spherical joints
+	{
+		PxVec3 pos = PxVec3(0,25,0);
+		PxReal radius =1;
+		PxVec3 offset(0,2,0);
+
+		PxRigidActor* prevActor = PxCreateStatic(physics, PxTransform(pos), PxSphereGeometry(radius), *material);
+		scene->addActor(*prevActor);
+
+		for(PxU32 i=1; i<6;i++)
+		{
+			PxTransform transform = PxTransform(PxVec3(0, PxReal(i*radius*1.5), 0));
+			PxRigidDynamic* dynamic = PxCreateDynamic(physics, transform, PxSphereGeometry(radius), *material, 1.0f);
+			scene->addActor(*dynamic);
+
+			PxSphericalJoint* joint = PxSphericalJointCreate(physics, prevActor, PxTransform(-offset), dynamic, PxTransform(offset));
+			joint->setConstraintFlag(PxConstraintFlag::eVISUALIZATION, true);
+			actors.chainJoints.push_back(joint);
+			//joint->setLimitCone(PxJointLimitCone(PxPi/2, PxPi/6, 0.01f)); //Used for limiting the movement of spherical joint.
+
+			prevActor = dynamic;
+		}
+	}
+
+	return scene;
+}
+
+
+void UpdateJointsScene(ChapterActors& actors, PxReal dt)
+{
+	actors.connectedBox->setAngularVelocity(PxVec3(0,1,0)); //Applying angular velocity on the body
+}
+
+
+
+//---------CH6: a box for raycasts and a marker sphere---------
+PxScene* CreateSceneQueriesScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors)
+{
+	PxScene* scene = physics.createScene(ChapterSceneDesc(physics, dispatcher));
+	PxMaterial* material = physics.createMaterial(0.1f,0.1f,0.1f);
+
+	AddGroundPlane(physics, *scene, *material);
+
+	//Box rotated around z axis by the chapter
+	actors.box = PxCreateDynamic(physics, PxTransform(PxVec3(0,8,0)), PxBoxGeometry(2,5,2), *material,1);
+	scene->addActor(*actors.box);
+
+	//Sphere to represent the raycast hit position
+	PxShape* sphereShape = physics.createShape(PxSphereGeometry(1), *material);
+	sphereShape->setFlag(PxShapeFlag::eSCENE_QUERY_SHAPE, false); //Don't consider this shape for hit queries
+	actors.sphere = PxCreateDynamic(physics, PxTransform(PxVec3(0)),*sphereShape,1);
+	scene->addActor(*actors.sphere);
+
+	return scene;
+}
+
+
+
+//---------CH7: a capsule character controller on an inclined box---------
+PxScene* CreateCharControllerScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors)
+{
+	PxScene* scene = physics.createScene(ChapterSceneDesc(physics, dispatcher));
+	PxMaterial* material = physics.createMaterial(0.1f,0.1f,0.1f);
+
+	AddGroundPlane(physics, *scene, *material);
+
+	//Inclined flat box for testing the movement of character controller
+	PxRigidStatic* staticBox  = PxCreateStatic(physics, PxTransform(PxVec3(0.0f, 0, 0.0f),PxQuat(PxPi/10, PxVec3(1,0,0))),PxBoxGeometry(15,1,40),*material);
+	scene->addActor(*staticBox);
+
+	actors.controllerManager = PxCreateControllerManager(*scene);
+	if(actors.controllerManager == NULL)
+	{
+		cerr<<"PxCreateControllerManager failed\n";
+		return scene;
+	}
+
+	//Defining the properties of Capsule Controller descriptor class
+	PxCapsuleControllerDesc capsuleDesc;
+	capsuleDesc.height		= 4; //Height of capsule
+	capsuleDesc.radius		= 2; //Radius of casule
+	capsuleDesc.position	= PxExtendedVec3(0,20,0); //Initial position of capsule
+	capsuleDesc.material	= physics.createMaterial(0.5f, 0.5f, 0.3f); //Material for capsule shape
+	capsuleDesc.density		= 100.0f; //Desity of capsule shape
+	capsuleDesc.contactOffset = 0.05f;
+	capsuleDesc.slopeLimit	= 0.2f;
+	capsuleDesc.stepOffset	= 0.75f;
+
+	if(!capsuleDesc.isValid())
+		cerr<<"Capsule controller descriptor is not valid\n";
+
+	actors.capsuleController = static_cast<PxCapsuleController*>(actors.controllerManager->createController(capsuleDesc));
+	if(actors.capsuleController == NULL)
+		cerr<<"createController failed\n";
+
+	return scene;
+}
+
+
+
+//---------CH8: a block of particles and a sphere---------
+PxScene* CreateParticlesScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors)
+{
+	PxScene* scene = physics.createScene(ChapterSceneDesc(physics, dispatcher));
+	PxMaterial* material = physics.createMaterial(0.5f,0.5f,0.5f);
+
+	AddGroundPlane(physics, *scene, *material);
+
+	PxRigidDynamic* actor = PxCreateDynamic(physics,PxTransform(PxVec3(0,70,0)),PxSphereGeometry(5),*material,1);
+	scene->addActor(*actor);
+
+	PxParticleSystem* ps = physics.createParticleSystem(1000);
+	if(!ps)
+		return scene;
+	scene->addActor(*ps);
+
+	vector<PxVec3>  posBuff;	//Buffer to store positions of all particles
+	vector<PxU32>	indexBuff;	//Buffer to store indices of all particles
+	unsigned sideNum	= 8;
+	int distance		= 1;	//Distance between each particles
+
+	//Creating stack of particles
+	for(unsigned i=0; i<sideNum; i++)
+		for(unsigned j=0; j<sideNum; j++)
+			for(unsigned k=0; k<sideNum; k++)
+			{
+				PxVec3 p = PxVec3(PxReal(i*distance),PxReal(j*distance),PxReal(k*distance)); //Calculating position for each particle
+				posBuff.push_back(p+PxVec3(0,30,0));
+				indexBuff.push_back(PxU32(indexBuff.size()));
+			}
+
+	PxParticleCreationData particleCreationData;
+	particleCreationData.numParticles	= PxU32(indexBuff.size());
+	particleCreationData.indexBuffer	= PxStrideIterator<const PxU32>(&indexBuff[0]);
+	particleCreationData.positionBuffer = PxStrideIterator<const PxVec3>(&posBuff[0]);
+
+	if(ps->createParticles(particleCreationData))
+		actors.particleSystem = ps;
+
+	return scene;
+}
+
+
+
+//---------CH9: a cloth hanging over the ground plane---------
+//Square cloth of resolution x resolution particles and 'size' units, hanging from its last row
+PxCloth* CreateCloth(PxPhysics& physics, const PxTransform& pose, PxU32 resolution, PxReal size)
+{
+	//Regular mesh
+	PxU32 numParticles = resolution*resolution;
+	PxU32 numTriangles = 2*(resolution-1)*(resolution-1);
+
+	//Cloth particles, the last row is fixed
+	vector<PxClothParticle> particles(numParticles);
+	PxVec3 center(0.5f, 0.3f, 0.0f);
+	PxVec3 delta = 1.0f/(resolution-1) * PxVec3(size, size, size);
+	PxClothParticle* pIt = &particles[0];
+	for(PxU32 i=0; i<resolution; ++i)
+	{
+		for(PxU32 j=0; j<resolution; ++j, ++pIt)
+		{
+			pIt->invWeight = j+1<resolution ? 1.0f : 0.0f;
+			pIt->pos = delta.multiply(PxVec3(PxReal(i),
+				PxReal(j), -PxReal(j))) - center;
+		}
+	}
+
+	//Triangles
+	vector<PxU32> triangles(3*numTriangles);
+	PxU32* iIt = &triangles[0];
+	for(PxU32 i=0; i<resolution-1; ++i)
+	{
+		for(PxU32 j=0; j<resolution-1; ++j)
+		{
+			PxU32 odd = j&1u, even = 1-odd;
+			*iIt++ = i*resolution + (j+odd);
+			*iIt++ = (i+odd)*resolution + (j+1);
+			*iIt++ = (i+1)*resolution + (j+even);
+			*iIt++ = (i+1)*resolution + (j+even);
+			*iIt++ = (i+even)*resolution + j;
+			*iIt++ = i*resolution + (j+odd);
+		}
+	}
+
+	//Fabric from mesh
+	PxClothMeshDesc meshDesc;
+	meshDesc.points.count = numParticles;
+	meshDesc.points.stride = sizeof(PxClothParticle);
+	meshDesc.points.data = &particles[0];
+
+	meshDesc.invMasses.count = numParticles;
+	meshDesc.invMasses.stride = sizeof(PxClothParticle);
+	meshDesc.invMasses.data = &particles[0].invWeight;
+
+	meshDesc.triangles.count = numTriangles;
+	meshDesc.triangles.stride = 3*sizeof(PxU32);
+	meshDesc.triangles.data = &triangles[0];
+
+	PxClothFabric* fabric = PxClothFabricCreate(physics, meshDesc, PxVec3(0, 1, 0));
+
+	PxCloth* cloth = physics.createCloth(pose, *fabric, &particles[0], PxClothFlags(0));
+	fabric->release();
+
+	// 240 iterations per/second (4 per-60hz frame)
+	cloth->setSolverFrequency(240.0f);
+	return cloth;
+}
+
+
+PxScene* CreateClothScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, ChapterActors& actors)
+{
+	PxScene* scene = physics.createScene(ChapterSceneDesc(physics, dispatcher));
+	PxMaterial* material = physics.createMaterial(0.5f,0.5f,0.5f);
+
+	AddGroundPlane(physics, *scene, *material);
+
+	actors.cloth = CreateCloth(physics, PxTransform(PxVec3(0,1,0)), 20, 15.0f);
+	scene->addActor(*actors.cloth);
+
+	actors.cloth->addCollisionPlane(PxClothCollisionPlane(PxVec3(0, 1, 0), 0.0f));
+	actors.cloth->addCollisionConvex(1 << 0); // Convex references the first plane
+
+	return scene;
+}
+
+
+
+const ChapterScene gChapterScenes[] =
+{
+	{ "ch2", CreateHelloPhysxScene,			NULL },
+	{ "ch3", CreateRigidbodyScene,			UpdateRigidbodyScene },
+	{ "ch4", CreateCollisionDetectionScene,	NULL },
+	{ "ch5", CreateJointsScene,				UpdateJointsScene },
+	{ "ch6", CreateSceneQueriesScene,		NULL },
+	{ "ch7", CreateCharControllerScene,		NULL },
+	{ "ch8", CreateParticlesScene,			NULL },
+	{ "ch9", CreateClothScene,				NULL },
+};
+
+const PxU32 gChapterSceneCount = sizeof(gChapterScenes)/sizeof(gChapterScenes[0]);
+
+
+//NULL if there is no scene by that name
+const ChapterScene* FindChapterScene(const char* name)
+{
+	for(PxU32 i=0; i<gChapterSceneCount; i++)
+		if(!strcmp(gChapterScenes[i].name, name))
+			return &gChapterScenes[i];
+	return NULL;
+}
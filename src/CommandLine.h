@@ -0,0 +1,55 @@
+/*
+=====================================================================
+
+File Name	  :	CommandLine.h
+
+Description	  : Small helpers for reading '--name' and '--name value' options from the
+				command line of the demos and benchmarks.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <cstring>
+#include <cstdlib>
+
+
+bool HasArgument(int argc, char** argv, const char* name);
+const char* GetStringArgument(int argc, char** argv, const char* name, const char* defaultValue);
+int GetIntArgument(int argc, char** argv, const char* name, int defaultValue);
+float GetFloatArgument(int argc, char** argv, const char* name, float defaultValue);
+
+
+
+bool HasArgument(int argc, char** argv, const char* name)
+{
+	for(int i=1; i<argc; i++)
+		if(!strcmp(argv[i], name))
+			return true;
+	return false;
+}
+
+
+//Returns the word following 'name', or 'defaultValue' when the option is missing
+const char* GetStringArgument(int argc, char** argv, const char* name, const char* defaultValue)
+{
+	for(int i=1; i+1<argc; i++)
+		if(!strcmp(argv[i], name))
+			return argv[i+1];
+	return defaultValue;
+}
+
+
+int GetIntArgument(int argc, char** argv, const char* name, int defaultValue)
+{
+	const char* value = GetStringArgument(argc, argv, name, NULL);
+	return value ? atoi(value) : defaultValue;
+}
+
+
+float GetFloatArgument(int argc, char** argv, const char* name, float defaultValue)
+{
+	const char* value = GetStringArgument(argc, argv, name, NULL);
+	return value ? float(atof(value)) : defaultValue;
+}
@@ -0,0 +1,235 @@
+/*
+=====================================================================
+
+File Name	  :	CpuDispatcher.h
+
+Description	  : Creates the CPU dispatcher of a demo scene from command line options,
+				instead of the single worker thread of 'PxDefaultCpuDispatcherCreate(1)'.
+
+				Command line options (parsed by 'ParseDispatcherOptions()'):
+				  --workers N     Number of PhysX worker threads. Defaults to the hardware
+				                  concurrency minus one, leaving a core for the thread that
+				                  calls 'simulate()'. 0 runs every task inside 'simulate()'.
+				  --affinity      Pin worker i to core i+1; core 0 stays with the main thread.
+				  --priority P    low, below, normal, above or high. The stock dispatcher has
+				                  no priority setting, so the creating thread's priority is
+				                  changed while the workers are spawned and inherited by them.
+				  --dispatcher D  default or stealing. 'stealing' selects the work-stealing
+				                  dispatcher of 'WorkStealingDispatcher.h'.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "CommandLine.h"		//GetIntArgument(), GetStringArgument()
+#include "WorkStealingDispatcher.h"	//WorkStealingDispatcher
+#include <cstring>
+#include <vector>
+#include <thread>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+using namespace physx;
+
+
+enum WorkerPriority
+{
+	eWORKER_PRIORITY_LOW,
+	eWORKER_PRIORITY_BELOW_NORMAL,
+	eWORKER_PRIORITY_NORMAL,
+	eWORKER_PRIORITY_ABOVE_NORMAL,
+	eWORKER_PRIORITY_HIGH
+};
+
+
+enum DispatcherType
+{
+	eDISPATCHER_DEFAULT,		//PxDefaultCpuDispatcher, one shared task queue
+	eDISPATCHER_WORK_STEALING	//WorkStealingDispatcher, one deque per worker
+};
+
+
+struct DispatcherOptions
+{
+	PxU32			workers;		//Worker threads
+	bool			pinWorkers;		//Worker i runs on core i+1 only
+	WorkerPriority	priority;
+	DispatcherType	type;
+};
+
+
+DispatcherOptions	gDispatcherOptions = { 1, false, eWORKER_PRIORITY_NORMAL, eDISPATCHER_DEFAULT };
+PxCpuDispatcher*	gCpuDispatcher	   = NULL;	//Dispatcher created by 'CreateCpuDispatcher()'
+
+
+PxU32 DefaultWorkerCount();
+PxU32 HardwareThreadCount();
+void ParseDispatcherOptions(int argc, char** argv);
+PxDefaultCpuDispatcher* CreateDefaultCpuDispatcher(const DispatcherOptions& options);
+WorkStealingDispatcher* CreateWorkStealingDispatcher(const DispatcherOptions& options);
+PxCpuDispatcher* CreateCpuDispatcher(const DispatcherOptions& options);
+void ReleaseCpuDispatcher(PxCpuDispatcher* dispatcher, const DispatcherOptions& options);
+PxCpuDispatcher* CreateCpuDispatcher();
+void ReleaseCpuDispatcher();
+
+
+
+PxU32 HardwareThreadCount()
+{
+	PxU32 count = thread::hardware_concurrency();
+	return count ? count : 1;	//0 when unknown
+}
+
+
+PxU32 DefaultWorkerCount()
+{
+	return HardwareThreadCount() - 1;
+}
+
+
+void ParseDispatcherOptions(int argc, char** argv)
+{
+	gDispatcherOptions.workers	  = PxU32(PxMax(0, GetIntArgument(argc, argv, "--workers", int(DefaultWorkerCount()))));
+	gDispatcherOptions.pinWorkers = HasArgument(argc, argv, "--affinity");
+
+	const char* priority = GetStringArgument(argc, argv, "--priority", "normal");
+	if(!strcmp(priority, "low"))
+		gDispatcherOptions.priority = eWORKER_PRIORITY_LOW;
+	else if(!strcmp(priority, "below"))
+		gDispatcherOptions.priority = eWORKER_PRIORITY_BELOW_NORMAL;
+	else if(!strcmp(priority, "above"))
+		gDispatcherOptions.priority = eWORKER_PRIORITY_ABOVE_NORMAL;
+	else if(!strcmp(priority, "high"))
+		gDispatcherOptions.priority = eWORKER_PRIORITY_HIGH;
+	else
+		gDispatcherOptions.priority = eWORKER_PRIORITY_NORMAL;
+
+	const char* type = GetStringArgument(argc, argv, "--dispatcher", "default");
+	gDispatcherOptions.type = !strcmp(type, "stealing") ? eDISPATCHER_WORK_STEALING : eDISPATCHER_DEFAULT;
+}
+
+
+//Core masks for '--affinity', empty when the workers are not pinned
+vector<PxU32> WorkerAffinityMasks(const DispatcherOptions& options)
+{
+	vector<PxU32> affinityMasks;
+	if(options.pinWorkers)
+	{
+		PxU32 cores = PxMin(HardwareThreadCount(), 32u);	//One bit per core
+		for(PxU32 i=0; i<options.workers; i++)
+			affinityMasks.push_back(1u << ((i+1) % cores));
+	}
+	return affinityMasks;
+}
+
+
+//Sets the priority of the calling thread and returns the previous one in a platform specific form
+int SetCurrentThreadPriority(WorkerPriority priority)
+{
+#ifdef _WIN32
+	static const int levels[] = { THREAD_PRIORITY_LOWEST, THREAD_PRIORITY_BELOW_NORMAL, THREAD_PRIORITY_NORMAL,
+								  THREAD_PRIORITY_ABOVE_NORMAL, THREAD_PRIORITY_HIGHEST };
+	int previous = GetThreadPriority(GetCurrentThread());
+	SetThreadPriority(GetCurrentThread(), levels[priority]);
+	return previous;
+#else
+	//Spread the levels over the range of the current policy. Under Linux' SCHED_OTHER the
+	//range is empty and this has no effect.
+	int policy;
+	sched_param param;
+	pthread_getschedparam(pthread_self(), &policy, &param);
+	int previous = param.sched_priority;
+
+	int lowest  = sched_get_priority_min(policy);
+	int highest = sched_get_priority_max(policy);
+	param.sched_priority = lowest + (highest - lowest)*int(priority)/int(eWORKER_PRIORITY_HIGH);
+	pthread_setschedparam(pthread_self(), policy, &param);
+	return previous;
+#endif
+}
+
+
+void RestoreCurrentThreadPriority(int previous)
+{
+#ifdef _WIN32
+	SetThreadPriority(GetCurrentThread(), previous);
+#else
+	int policy;
+	sched_param param;
+	pthread_getschedparam(pthread_self(), &policy, &param);
+	param.sched_priority = previous;
+	pthread_setschedparam(pthread_self(), policy, &param);
+#endif
+}
+
+
+//Creates a default dispatcher for 'options'. The dispatcher must outlive every scene using it.
+PxDefaultCpuDispatcher* CreateDefaultCpuDispatcher(const DispatcherOptions& options)
+{
+	vector<PxU32> affinityMasks = WorkerAffinityMasks(options);
+
+	int previousPriority = 0;
+	if(options.priority != eWORKER_PRIORITY_NORMAL)
+		previousPriority = SetCurrentThreadPriority(options.priority);
+
+	PxDefaultCpuDispatcher* dispatcher = PxDefaultCpuDispatcherCreate(options.workers, affinityMasks.empty() ? NULL : &affinityMasks[0]);
+
+	if(options.priority != eWORKER_PRIORITY_NORMAL)
+		RestoreCurrentThreadPriority(previousPriority);
+
+	return dispatcher;
+}
+
+
+//Requires the foundation, the workers are 'shdfnd::Thread's
+WorkStealingDispatcher* CreateWorkStealingDispatcher(const DispatcherOptions& options)
+{
+	vector<PxU32> affinityMasks = WorkerAffinityMasks(options);
+
+	//shdfnd::ThreadPriority counts down from eHIGH
+	shdfnd::ThreadPriority::Enum priority = shdfnd::ThreadPriority::Enum(eWORKER_PRIORITY_HIGH - options.priority);
+
+	return new WorkStealingDispatcher(options.workers, affinityMasks.empty() ? NULL : &affinityMasks[0], priority);
+}
+
+
+PxCpuDispatcher* CreateCpuDispatcher(const DispatcherOptions& options)
+{
+	if(options.type == eDISPATCHER_WORK_STEALING)
+		return CreateWorkStealingDispatcher(options);
+	return CreateDefaultCpuDispatcher(options);
+}
+
+
+//'options' must be the ones the dispatcher was created with
+void ReleaseCpuDispatcher(PxCpuDispatcher* dispatcher, const DispatcherOptions& options)
+{
+	if(options.type == eDISPATCHER_WORK_STEALING)
+		static_cast<WorkStealingDispatcher*>(dispatcher)->release();
+	else
+		static_cast<PxDefaultCpuDispatcher*>(dispatcher)->release();
+}
+
+
+//Dispatcher for 'PxSceneDesc::cpuDispatcher' of a demo, configured by 'gDispatcherOptions'
+PxCpuDispatcher* CreateCpuDispatcher()
+{
+	gCpuDispatcher = CreateCpuDispatcher(gDispatcherOptions);
+	return gCpuDispatcher;
+}
+
+
+//Call after the scene has been released
+void ReleaseCpuDispatcher()
+{
+	if(gCpuDispatcher)
+		ReleaseCpuDispatcher(gCpuDispatcher, gDispatcherOptions);
+	gCpuDispatcher = NULL;
+}
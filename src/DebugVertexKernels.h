@@ -0,0 +1,205 @@
+/*
+=====================================================================
+
+File Name	  :	DebugVertexKernels.h
+
+Description	  : Kernels used by 'RenderBuffer.h' to expand PhysX debug primitives into
+				GPU-ready vertex arrays (3 float position + 4 float RGBA per vertex).
+
+				PxDebugPoint, PxDebugLine and PxDebugTriangle are all made of 16 byte
+				{PxVec3 pos; PxU32 color;} vertices, so one kernel handles every primitive
+				type; it is simply given the number of vertices instead of primitives.
+
+				Scalar, SSE2 and AVX2 versions are provided. The fastest one supported by
+				the CPU is picked once at startup and stored in 'gExpandDebugVertices'.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h> //Single header file to include all features of PhysX API
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	#define DEBUG_KERNELS_X86 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define DEBUG_KERNELS_TARGET_AVX2
+	#else
+		#define DEBUG_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#else
+	#define DEBUG_KERNELS_X86 0
+#endif
+
+using namespace physx;
+
+
+//Expands 'numVerts' {PxVec3 pos; PxU32 color;} vertices into 'pVertList' (3 floats each)
+//and 'pColorList' (4 floats each, alpha forced to 1)
+typedef void (*ExpandDebugVerticesFn)(const void* pSrc, PxU32 numVerts, float* pVertList, float* pColorList);
+
+void ExpandDebugVerticesScalar(const void* pSrc, PxU32 numVerts, float* pVertList, float* pColorList);
+#if DEBUG_KERNELS_X86
+void ExpandDebugVerticesSSE2(const void* pSrc, PxU32 numVerts, float* pVertList, float* pColorList);
+void ExpandDebugVerticesAVX2(const void* pSrc, PxU32 numVerts, float* pVertList, float* pColorList);
+#endif
+bool CpuSupportsAVX2();
+ExpandDebugVerticesFn SelectExpandDebugVertices(const char** pName);
+
+
+const char*				gExpandDebugVerticesName = "";												//Name of the selected kernel
+ExpandDebugVerticesFn	gExpandDebugVertices	 = SelectExpandDebugVertices(&gExpandDebugVerticesName);	//Kernel used by 'RenderData()'
+
+
+void ExpandDebugVerticesScalar(const void* pSrc, PxU32 numVerts, float* pVertList, float* pColorList)
+{
+	const float inv255 = 1.0f/255.0f;
+	const float* pIn = static_cast<const float*>(pSrc);
+
+	for(PxU32 i=0; i<numVerts; i++, pIn+=4)
+	{
+		PxU32 color;
+		memcpy(&color, pIn+3, sizeof(PxU32));
+
+		*pVertList++ = pIn[0];
+		*pVertList++ = pIn[1];
+		*pVertList++ = pIn[2];
+		*pColorList++ = float((color>>16)&0xff)*inv255;
+		*pColorList++ = float((color>>8)&0xff)*inv255;
+		*pColorList++ = float(color&0xff)*inv255;
+		*pColorList++ = 1.0f;
+	}
+}
+
+
+#if DEBUG_KERNELS_X86
+
+//4 vertices per iteration. The colors of the 4 vertices are gathered into one register,
+//widened byte->dword with unpacks and swizzled from B,G,R,A to R,G,B,A.
+void ExpandDebugVerticesSSE2(const void* pSrc, PxU32 numVerts, float* pVertList, float* pColorList)
+{
+	const float* pIn = static_cast<const float*>(pSrc);
+	const __m128  scale		= _mm_set1_ps(1.0f/255.0f);
+	const __m128  rgbMask	= _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+	const __m128  alphaOne	= _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+	const __m128i zero		= _mm_setzero_si128();
+
+	PxU32 i = 0;
+	for(; i+4<=numVerts; i+=4, pIn+=16, pVertList+=12, pColorList+=16)
+	{
+		__m128 v0 = _mm_loadu_ps(pIn);
+		__m128 v1 = _mm_loadu_ps(pIn+4);
+		__m128 v2 = _mm_loadu_ps(pIn+8);
+		__m128 v3 = _mm_loadu_ps(pIn+12);
+
+		//Overlapping stores: the 4th lane of each store is overwritten by the next one
+		_mm_storeu_ps(pVertList,   v0);
+		_mm_storeu_ps(pVertList+3, v1);
+		_mm_storeu_ps(pVertList+6, v2);
+		pVertList[9]  = pIn[12];
+		pVertList[10] = pIn[13];
+		pVertList[11] = pIn[14];
+
+		//[c0 c1 c2 c3]
+		__m128i colors = _mm_castps_si128(_mm_movehl_ps(_mm_unpackhi_ps(v2, v3), _mm_unpackhi_ps(v0, v1)));
+
+		__m128i lo = _mm_unpacklo_epi8(colors, zero);
+		__m128i hi = _mm_unpackhi_epi8(colors, zero);
+		__m128i c[4] = { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+						 _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+
+		for(int k=0; k<4; k++)
+		{
+			__m128 rgba = _mm_mul_ps(_mm_cvtepi32_ps(_mm_shuffle_epi32(c[k], _MM_SHUFFLE(3,0,1,2))), scale);
+			_mm_storeu_ps(pColorList + 4*k, _mm_or_ps(_mm_and_ps(rgba, rgbMask), alphaOne));
+		}
+	}
+
+	ExpandDebugVerticesScalar(pIn, numVerts - i, pVertList, pColorList);
+}
+
+
+//2 vertices per register, 8 per iteration. Each color is broadcast to its 128 bit lane
+//and the channels are extracted with one variable shift.
+DEBUG_KERNELS_TARGET_AVX2
+void ExpandDebugVerticesAVX2(const void* pSrc, PxU32 numVerts, float* pVertList, float* pColorList)
+{
+	const float* pIn = static_cast<const float*>(pSrc);
+	const __m256  scale		= _mm256_set1_ps(1.0f/255.0f);
+	const __m256  one		= _mm256_set1_ps(1.0f);
+	const __m256i shifts	= _mm256_setr_epi32(16, 8, 0, 0, 16, 8, 0, 0);
+	const __m256i byteMask	= _mm256_set1_epi32(0xff);
+
+	PxU32 i = 0;
+	for(; i+8<=numVerts; i+=8, pIn+=32, pVertList+=24, pColorList+=32)
+	{
+		for(int k=0; k<4; k++)
+		{
+			__m256 v = _mm256_loadu_ps(pIn + 8*k);
+
+			if(k<3)
+			{
+				_mm_storeu_ps(pVertList + 6*k,	 _mm256_castps256_ps128(v));
+				_mm_storeu_ps(pVertList + 6*k+3, _mm256_extractf128_ps(v, 1));
+			}
+			else
+			{
+				_mm_storeu_ps(pVertList + 18, _mm256_castps256_ps128(v));
+				pVertList[21] = pIn[28];
+				pVertList[22] = pIn[29];
+				pVertList[23] = pIn[30];
+			}
+
+			__m256i color = _mm256_shuffle_epi32(_mm256_castps_si256(v), _MM_SHUFFLE(3,3,3,3));
+			__m256i rgb   = _mm256_and_si256(_mm256_srlv_epi32(color, shifts), byteMask);
+			__m256  rgba  = _mm256_blend_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(rgb), scale), one, 0x88);
+			_mm256_storeu_ps(pColorList + 8*k, rgba);
+		}
+	}
+
+	ExpandDebugVerticesScalar(pIn, numVerts - i, pVertList, pColorList);
+}
+
+#endif
+
+
+bool CpuSupportsAVX2()
+{
+#if !DEBUG_KERNELS_X86
+	return false;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1<<27)) != 0;
+	bool avx	 = (info[2] & (1<<28)) != 0;
+	if(!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)	//OS must save the YMM registers
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1<<5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+
+//Picks the fastest kernel for the running CPU
+ExpandDebugVerticesFn SelectExpandDebugVertices(const char** pName)
+{
+#if DEBUG_KERNELS_X86
+	if(CpuSupportsAVX2())
+	{
+		*pName = "avx2";
+		return ExpandDebugVerticesAVX2;
+	}
+
+	*pName = "sse2"; //Baseline of every x86-64 CPU
+	return ExpandDebugVerticesSSE2;
+#else
+	*pName = "scalar";
+	return ExpandDebugVerticesScalar;
+#endif
+}
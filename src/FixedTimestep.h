@@ -0,0 +1,267 @@
+/*
+=====================================================================
+
+File Name	  :	FixedTimestep.h
+
+Description	  : Fixed-timestep scheduler for the demos' render loops. Replaces the
+				accumulator loops of 'OnRender()':
+
+				  - The frame's elapsed time is turned into whole steps of 'stepSize'. At
+				    most 'maxStepsPerFrame' steps run per frame; the time of the steps
+				    beyond that is dropped instead of being carried into the next frame,
+				    where it would cost even more steps (the "spiral of death").
+				  - The remaining fraction of a step is 'alpha'. 'InterpolatedShapePoses()'
+				    blends the shape poses of the last two steps by it, so rendering stays
+				    smooth when the frame rate and the step rate differ.
+				  - When the steps of a frame take longer than 'budgetMs' for a while, the
+				    simulation rate is lowered (longer steps, up to 'maxStepScale' times
+				    the base step) and raised again once there is room.
+
+				With --adaptive-quality, 'QualityController.h' first lowers simulation
+				quality when steps run over their budget. The simulation rate waits only
+				while the controller is lowering a knob or letting a lowering settle; in
+				every other frame over 'budgetMs', e.g. when many short steps add up or
+				quality is at its minimum, the rate is lowered as without the controller.
+
+				Steps go through 'StepperStep()', so the blocking and pipelined strategies
+				of 'PhysXStepper.h' both apply. Per-frame and total counters of steps taken
+				and dropped show when the simulation is CPU-bound.
+
+				Command line options (parsed by 'ParseFixedTimestepOptions()'):
+				  --max-steps N     Steps per frame before dropping time (default 4)
+				  --sim-budget MS   Simulation budget per frame (default 8 ms)
+				  --no-interpolate  Render the latest step as is
+				  and the options of 'QualityController.h'
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "CommandLine.h"		//GetIntArgument(), GetFloatArgument()
+#include "PhysXStepper.h"		//StepperStep()
+#include "ShapeRenderer.h"		//ShapeRendererGatherPoses()
+#include "QualityController.h"	//QualityControllerEvaluate()
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+using namespace physx;
+
+
+struct FixedTimestepOptions
+{
+	PxU32		maxStepsPerFrame;	//Steps per frame before time is dropped
+	double		budgetMs;			//Simulation time per frame before the rate is lowered
+	bool		interpolate;		//Blend the shape poses of the last two steps
+};
+
+
+struct FixedTimestep
+{
+	FixedTimestepOptions	options;
+
+	PxReal		baseStepSize;		//Step size at full simulation rate
+	PxReal		stepSize;			//Current step size, raised when over budget
+	PxReal		maxStepScale;		//Upper limit of stepSize/baseStepSize
+
+	PxReal		accumulator;		//Simulated time owed, always below 'stepSize' after a frame
+	PxReal		alpha;				//accumulator/stepSize, blend factor between the last two steps
+	PxU32		overBudgetFrames;	//Consecutive frames over 'budgetMs'
+	PxU32		underBudgetFrames;	//Consecutive frames below half of 'budgetMs'
+
+	vector<PxTransform>	previousPoses;	//Shape poses one step before 'currentPoses'
+	vector<PxTransform>	currentPoses;	//Shape poses after the latest step
+	vector<PxTransform>	blendedPoses;
+};
+
+
+struct FixedTimestepStats
+{
+	PxU32	stepsTaken;			//This frame
+	PxU32	stepsDropped;		//This frame
+	double	simMs;				//This frame
+	PxU64	frames;
+	PxU64	totalStepsTaken;
+	PxU64	totalStepsDropped;
+	PxU64	framesDropping;		//Frames that dropped steps
+	PxU32	rateChanges;		//Times the simulation rate was lowered or raised
+};
+
+
+FixedTimestepOptions	gFixedTimestepOptions = { 4, 8.0, true };
+FixedTimestep			gFixedTimestep;
+FixedTimestepStats		gFixedTimestepStats = { 0, 0, 0.0, 0, 0, 0, 0, 0 };
+
+const PxU32 FIXED_TIMESTEP_DEGRADE_FRAMES = 10;		//Frames over budget before the rate is lowered
+const PxU32 FIXED_TIMESTEP_RECOVER_FRAMES = 120;	//Frames well under budget before it is raised again
+const PxReal FIXED_TIMESTEP_RATE_FACTOR	  = 1.5f;	//Step size change per adjustment
+
+
+void ParseFixedTimestepOptions(int argc, char** argv);
+void FixedTimestepInit(PxReal stepSize);
+PxU32 AdvanceFixedTimestep(PxReal frameSeconds);
+const PxTransform* InterpolatedShapePoses();
+void PrintFixedTimestepStats();
+
+
+
+void ParseFixedTimestepOptions(int argc, char** argv)
+{
+	gFixedTimestepOptions.maxStepsPerFrame	= PxU32(PxMax(1, GetIntArgument(argc, argv, "--max-steps", 4)));
+	gFixedTimestepOptions.budgetMs			= GetFloatArgument(argc, argv, "--sim-budget", 8.0f);
+	gFixedTimestepOptions.interpolate		= !HasArgument(argc, argv, "--no-interpolate");
+	ParseQualityOptions(argc, argv);		//--adaptive-quality, --step-budget MS, ...
+}
+
+
+//Call after 'StepperInit()' and 'ShapeRendererInit()'
+void FixedTimestepInit(PxReal stepSize)
+{
+	FixedTimestep& f = gFixedTimestep;
+	f.options			= gFixedTimestepOptions;
+	f.baseStepSize		= stepSize;
+	f.stepSize			= stepSize;
+	f.maxStepScale		= 4.0f;
+	f.accumulator		= 0.0f;
+	f.alpha				= 0.0f;
+	f.overBudgetFrames	= 0;
+	f.underBudgetFrames = 0;
+
+	ShapeRendererGatherPoses(f.currentPoses);
+	f.previousPoses = f.currentPoses;
+
+	QualityControllerInit(*gStepper.scene);	//Current settings are the upper bounds
+}
+
+
+//Lowers the simulation rate after a run of frames over budget, raises it after a run well under.
+//'quality' is the frame's answer of 'QualityControllerEvaluate()'.
+void AdjustSimulationRate(double frameSimMs, int quality)
+{
+	FixedTimestep& f = gFixedTimestep;
+
+	if(frameSimMs > f.options.budgetMs)
+	{
+		f.underBudgetFrames = 0;
+		if(quality < 0 || QualityControllerLowering())
+			f.overBudgetFrames = 0;		//Quality goes first, while the controller is actually lowering it
+		else if(++f.overBudgetFrames >= FIXED_TIMESTEP_DEGRADE_FRAMES && f.stepSize < f.baseStepSize*f.maxStepScale)
+		{
+			f.stepSize = PxMin(f.stepSize*FIXED_TIMESTEP_RATE_FACTOR, f.baseStepSize*f.maxStepScale);
+			f.overBudgetFrames = 0;
+			gFixedTimestepStats.rateChanges++;
+			printf("Simulation over budget (%.2f ms), rate lowered to %.0f Hz\n", frameSimMs, 1.0f/f.stepSize);
+		}
+	}
+	else if(frameSimMs < 0.5*f.options.budgetMs)
+	{
+		f.overBudgetFrames = 0;
+		if(++f.underBudgetFrames >= FIXED_TIMESTEP_RECOVER_FRAMES && f.stepSize > f.baseStepSize)
+		{
+			f.stepSize = PxMax(f.stepSize/FIXED_TIMESTEP_RATE_FACTOR, f.baseStepSize);
+			f.underBudgetFrames = 0;
+			gFixedTimestepStats.rateChanges++;
+			printf("Simulation back under budget, rate raised to %.0f Hz\n", 1.0f/f.stepSize);
+		}
+	}
+	else
+	{
+		f.overBudgetFrames = f.underBudgetFrames = 0;
+	}
+}
+
+
+//Runs the steps owed for 'frameSeconds' of wall time and returns how many ran
+PxU32 AdvanceFixedTimestep(PxReal frameSeconds)
+{
+	FixedTimestep& f = gFixedTimestep;
+	FixedTimestepStats& s = gFixedTimestepStats;
+
+	//The previous frame's quality change. It is applied here rather than right after its evaluation
+	//so that '--replay' can substitute the recorded one, see 'InputRecorder.h'. Quality changes
+	//modify the scene, which must not be simulating.
+	if(gQuality.pending)
+	{
+		StepperFinish();
+		QualityControllerAdjust(gQuality.pending);
+		gQuality.pending = 0;
+	}
+
+	f.accumulator += frameSeconds;
+	PxU32 steps	  = PxU32(f.accumulator/f.stepSize);
+	PxU32 dropped = 0;
+	if(steps > f.options.maxStepsPerFrame)
+	{
+		dropped = steps - f.options.maxStepsPerFrame;
+		steps	= f.options.maxStepsPerFrame;
+		f.accumulator -= dropped*f.stepSize;	//That time is never simulated
+	}
+
+	double start = StepperClockMs();
+	for(PxU32 i=0; i<steps; i++)
+	{
+		f.accumulator -= f.stepSize;
+		StepperStep(f.stepSize);
+
+		//Only the poses around the last step are needed for blending
+		if(f.options.interpolate && i+2 >= steps)
+		{
+			f.previousPoses.swap(f.currentPoses);
+			ShapeRendererGatherPoses(f.currentPoses);
+		}
+	}
+	double simMs = StepperClockMs() - start;
+
+	f.accumulator = PxClamp(f.accumulator, 0.0f, f.stepSize);
+	f.alpha		  = f.accumulator/f.stepSize;
+
+	s.stepsTaken		 = steps;
+	s.stepsDropped		 = dropped;
+	s.simMs				 = simMs;
+	s.frames++;
+	s.totalStepsTaken	+= steps;
+	s.totalStepsDropped += dropped;
+	if(dropped)
+		s.framesDropping++;
+
+	int quality = steps ? QualityControllerEvaluate(simMs/steps) : 0;
+	gQuality.pending = quality;		//Applied before the next frame's steps
+
+	AdjustSimulationRate(simMs, quality);
+	return steps;
+}
+
+
+//Shape poses for 'ShapeRendererDraw()' blended between the last two steps by 'alpha',
+//or NULL to draw the current poses of the scene
+const PxTransform* InterpolatedShapePoses()
+{
+	FixedTimestep& f = gFixedTimestep;
+	if(!f.options.interpolate || f.currentPoses.empty() || f.previousPoses.size() != f.currentPoses.size())
+		return NULL;
+
+	f.blendedPoses.resize(f.currentPoses.size());
+	for(size_t i=0; i<f.currentPoses.size(); i++)
+	{
+		const PxTransform& a = f.previousPoses[i];
+		const PxTransform& b = f.currentPoses[i];
+
+		//Normalized lerp, the rotation between two steps is small
+		PxQuat qb = a.q.dot(b.q) < 0.0f ? -b.q : b.q;
+		PxQuat q  = a.q*(1.0f - f.alpha) + qb*f.alpha;
+		f.blendedPoses[i] = PxTransform(a.p + (b.p - a.p)*f.alpha, q.getNormalized());
+	}
+	return &f.blendedPoses[0];
+}
+
+
+void PrintFixedTimestepStats()
+{
+	const FixedTimestepStats& s = gFixedTimestepStats;
+	printf("fixed timestep: %llu frames  steps taken: %llu  dropped: %llu in %llu frames  rate changes: %u  final rate: %.0f Hz\n",
+		(unsigned long long)s.frames, (unsigned long long)s.totalStepsTaken, (unsigned long long)s.totalStepsDropped,
+		(unsigned long long)s.framesDropping, s.rateChanges, 1.0f/gFixedTimestep.stepSize);
+	PrintQualityStats();
+}
@@ -0,0 +1,431 @@
+/*
+=====================================================================
+
+File Name	  :	GameplaySpatialIndex.h
+
+Description	  : Spatial database for gameplay objects that are not PhysX actors, like
+				pickups, spawn points and audio emitters. Each entry is an axis aligned box
+				with a category mask and a user pointer, kept in a 'PxSpatialIndex' of its
+				own, apart from any 'PxScene'.
+
+				Entries are addressed by handles. Handles of removed entries are reused by
+				later inserts. 'PxSpatialIndex' has no batch calls, so the bulk functions
+				loop over single inserts, updates and removes. They keep the index's
+				deferred work together, and the time they take is counted in the stats.
+
+				Updates leave the tree loose. 'GameplaySpatialIndexFrame()' runs
+				'rebuildStep()' a few times each frame, and the index swaps in a rebuilt
+				tree after about 'rebuildRate' steps. The frame call also flushes the
+				index, after which queries may run on several threads until the next write.
+				Their counters in the stats are atomic for that reason.
+
+				Raycasts and sweeps hit the entries' boxes. A sweep moves a box, whose
+				half extents are added to each entry before its ray test. Overlaps take a
+				box or a sphere. Every query skips entries whose categories do not
+				intersect the query's mask.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include <cstdio>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <atomic>
+
+using namespace std;
+using namespace physx;
+
+
+typedef PxU32 GameplayHandle;
+
+const GameplayHandle GAMEPLAY_INVALID_HANDLE		= 0xffffffff;
+const PxU32			 GAMEPLAY_ALL_CATEGORIES		= 0xffffffff;
+const PxU32			 GAMEPLAY_DEFAULT_REBUILD_RATE	= 100;		//Steps per full tree rebuild, as 'PxScene::setDynamicTreeRebuildRateHint()'
+
+
+//An entry as the index sees it; lives in a deque, so its address is stable
+struct GameplayItem : PxSpatialIndexItem
+{
+	PxBounds3				bounds;
+	PxU32					categories;
+	void*					userData;
+	PxSpatialIndexItemId	id;			//PX_SPATIAL_INDEX_INVALID_ITEM_ID while the handle is free
+	GameplayHandle			handle;
+};
+
+
+struct GameplayHit
+{
+	GameplayHandle	handle;		//GAMEPLAY_INVALID_HANDLE for misses
+	PxReal			distance;
+	void*			userData;
+};
+
+
+enum GameplayHitMode
+{
+	eGAMEPLAY_CLOSEST,	//The nearest hit
+	eGAMEPLAY_ANY,		//The first hit found, the query stops there
+	eGAMEPLAY_ALL		//Every hit within the distance, unsorted
+};
+
+
+struct GameplaySpatialIndexStats
+{
+	PxU64	inserts;
+	PxU64	updates;
+	PxU64	removes;
+	PxU64	frames;
+	PxU64	rebuildSteps;
+	double	writeMs;			//Time in inserts, updates and removes
+	double	rebuildMs;			//Time in 'rebuildStep()' and 'flush()'
+
+	atomic<PxU64>	queries;	//Added to by every querying thread
+	atomic<PxU64>	hits;
+	atomic<PxU64>	queryNs;	//Summed over the querying threads
+};
+
+
+struct GameplaySpatialIndex
+{
+	PxSpatialIndex*			index;
+	PxU32					rebuildRate;
+	PxU32					stepsPerFrame;
+	deque<GameplayItem>		items;
+	vector<GameplayHandle>	freeHandles;
+	PxU32					live;				//Entries currently in the index
+};
+
+
+GameplaySpatialIndex		gGameplayIndex = { NULL, GAMEPLAY_DEFAULT_REBUILD_RATE, 1 };
+GameplaySpatialIndexStats	gGameplayIndexStats;		//Zero at startup, as a global
+
+
+void GameplaySpatialIndexInit(PxU32 rebuildRate = GAMEPLAY_DEFAULT_REBUILD_RATE, PxU32 stepsPerFrame = 1);
+void GameplayInsert(const PxBounds3* bounds, const PxU32* categories, void* const* userData, PxU32 count, GameplayHandle* handles);
+void GameplayUpdate(const GameplayHandle* handles, const PxBounds3* bounds, PxU32 count);
+void GameplayRemove(const GameplayHandle* handles, PxU32 count);
+void GameplaySpatialIndexFrame();
+void GameplaySpatialIndexRebuildFull();
+bool GameplayRaycast(const PxVec3& origin, const PxVec3& unitDir, PxReal maxDistance, GameplayHitMode mode, vector<GameplayHit>& hits,
+	PxU32 categories = GAMEPLAY_ALL_CATEGORIES);
+bool GameplaySweep(const PxBounds3& box, const PxVec3& unitDir, PxReal maxDistance, GameplayHitMode mode, vector<GameplayHit>& hits,
+	PxU32 categories = GAMEPLAY_ALL_CATEGORIES);
+PxU32 GameplayOverlap(const PxBounds3& box, vector<GameplayHandle>& handles, PxU32 categories = GAMEPLAY_ALL_CATEGORIES);
+PxU32 GameplayOverlapSphere(const PxVec3& center, PxReal radius, vector<GameplayHandle>& handles, PxU32 categories = GAMEPLAY_ALL_CATEGORIES);
+bool GameplayRayBoxDistance(const PxVec3& origin, const PxVec3& unitDir, const PxBounds3& bounds, PxReal maxDistance, PxReal& distance);
+PxReal GameplayPointBoxDistanceSquared(const PxVec3& point, const PxBounds3& bounds);
+void GameplaySpatialIndexRelease();
+void PrintGameplaySpatialIndexStats();
+
+
+
+double GameplayIndexClockMs()
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+//Safe from several querying threads at once
+void CountGameplayQuery(double start, size_t hits)
+{
+	GameplaySpatialIndexStats& s = gGameplayIndexStats;
+	s.queries.fetch_add(1, memory_order_relaxed);
+	s.hits.fetch_add(hits, memory_order_relaxed);
+	s.queryNs.fetch_add(PxU64(1e6*(GameplayIndexClockMs() - start)), memory_order_relaxed);
+}
+
+
+void GameplaySpatialIndexInit(PxU32 rebuildRate, PxU32 stepsPerFrame)
+{
+	GameplaySpatialIndex& g = gGameplayIndex;
+	g.index			= PxCreateSpatialIndex();
+	g.rebuildRate	= PxMax(rebuildRate, 4u);	//PhysX clamps lower rates
+	g.stepsPerFrame = stepsPerFrame;
+	g.live			= 0;
+	g.index->setIncrementalRebuildRate(g.rebuildRate);
+}
+
+
+//'categories' and 'userData' may be NULL for all categories and no user data
+void GameplayInsert(const PxBounds3* bounds, const PxU32* categories, void* const* userData, PxU32 count, GameplayHandle* handles)
+{
+	GameplaySpatialIndex& g = gGameplayIndex;
+	double start = GameplayIndexClockMs();
+	for(PxU32 i=0; i<count; i++)
+	{
+		GameplayHandle handle;
+		if(g.freeHandles.empty())
+		{
+			handle = GameplayHandle(g.items.size());
+			g.items.push_back(GameplayItem());
+		}
+		else
+		{
+			handle = g.freeHandles.back();
+			g.freeHandles.pop_back();
+		}
+
+		GameplayItem& item = g.items[handle];
+		item.bounds		= bounds[i];
+		item.categories = categories ? categories[i] : GAMEPLAY_ALL_CATEGORIES;
+		item.userData	= userData ? userData[i] : NULL;
+		item.handle		= handle;
+		item.id			= g.index->insert(item, bounds[i]);
+		handles[i] = handle;
+	}
+	g.live += count;
+	gGameplayIndexStats.inserts += count;
+	gGameplayIndexStats.writeMs += GameplayIndexClockMs() - start;
+}
+
+
+void GameplayUpdate(const GameplayHandle* handles, const PxBounds3* bounds, PxU32 count)
+{
+	GameplaySpatialIndex& g = gGameplayIndex;
+	double start = GameplayIndexClockMs();
+	for(PxU32 i=0; i<count; i++)
+	{
+		GameplayItem& item = g.items[handles[i]];
+		if(item.id == PX_SPATIAL_INDEX_INVALID_ITEM_ID)
+			continue;			//Removed, as in 'GameplayRemove()'
+		item.bounds = bounds[i];
+		g.index->update(item.id, bounds[i]);
+		gGameplayIndexStats.updates++;
+	}
+	gGameplayIndexStats.writeMs += GameplayIndexClockMs() - start;
+}
+
+
+void GameplayRemove(const GameplayHandle* handles, PxU32 count)
+{
+	GameplaySpatialIndex& g = gGameplayIndex;
+	double start = GameplayIndexClockMs();
+	for(PxU32 i=0; i<count; i++)
+	{
+		GameplayItem& item = g.items[handles[i]];
+		if(item.id == PX_SPATIAL_INDEX_INVALID_ITEM_ID)
+			continue;			//Removed twice
+		g.index->remove(item.id);
+		item.id = PX_SPATIAL_INDEX_INVALID_ITEM_ID;
+		g.freeHandles.push_back(handles[i]);
+		g.live--;
+		gGameplayIndexStats.removes++;
+	}
+	gGameplayIndexStats.writeMs += GameplayIndexClockMs() - start;
+}
+
+
+//Call once per frame, after the frame's writes and before its queries
+void GameplaySpatialIndexFrame()
+{
+	GameplaySpatialIndex& g = gGameplayIndex;
+	double start = GameplayIndexClockMs();
+	for(PxU32 i=0; i<g.stepsPerFrame; i++)
+		g.index->rebuildStep();
+	g.index->flush();
+	gGameplayIndexStats.frames++;
+	gGameplayIndexStats.rebuildSteps += g.stepsPerFrame;
+	gGameplayIndexStats.rebuildMs += GameplayIndexClockMs() - start;
+}
+
+
+//After a level load, instead of waiting for the incremental rebuild
+void GameplaySpatialIndexRebuildFull()
+{
+	double start = GameplayIndexClockMs();
+	gGameplayIndex.index->rebuildFull();
+	gGameplayIndex.index->flush();
+	gGameplayIndexStats.rebuildMs += GameplayIndexClockMs() - start;
+}
+
+
+//Slab test; a ray starting inside the box hits it at distance 0
+bool GameplayRayBoxDistance(const PxVec3& origin, const PxVec3& unitDir, const PxBounds3& bounds, PxReal maxDistance, PxReal& distance)
+{
+	PxReal tMin = 0.0f, tMax = maxDistance;
+	for(PxU32 axis=0; axis<3; axis++)
+	{
+		if(PxAbs(unitDir[axis]) < 1e-9f)
+		{
+			if(origin[axis] < bounds.minimum[axis] || origin[axis] > bounds.maximum[axis])
+				return false;
+			continue;
+		}
+		PxReal inv = 1.0f/unitDir[axis];
+		PxReal t0 = (bounds.minimum[axis] - origin[axis])*inv;
+		PxReal t1 = (bounds.maximum[axis] - origin[axis])*inv;
+		tMin = PxMax(tMin, PxMin(t0, t1));
+		tMax = PxMin(tMax, PxMax(t0, t1));
+		if(tMin > tMax)
+			return false;
+	}
+	distance = tMin;
+	return true;
+}
+
+
+PxReal GameplayPointBoxDistanceSquared(const PxVec3& point, const PxBounds3& bounds)
+{
+	PxVec3 closest = point.maximum(bounds.minimum).minimum(bounds.maximum);
+	return (closest - point).magnitudeSquared();
+}
+
+
+//The index passes the current query length, not a hit distance, so each box is tested
+//here. Closest queries shrink the length to every new hit, which prunes the rest of the tree.
+struct GameplayLocationCallback : PxSpatialLocationCallback
+{
+	PxVec3					origin;
+	PxVec3					unitDir;
+	PxVec3					inflate;		//Half extents of a swept box
+	PxU32					categories;
+	GameplayHitMode			mode;
+	vector<GameplayHit>*	hits;
+	GameplayHit				closest;
+
+	PxAgain onHit(PxSpatialIndexItem& indexItem, PxReal distance, PxReal& shrunkDistance)
+	{
+		GameplayItem& item = static_cast<GameplayItem&>(indexItem);
+		if(!(item.categories & categories))
+			return true;
+
+		PxBounds3 bounds(item.bounds.minimum - inflate, item.bounds.maximum + inflate);
+		PxReal hitDistance;
+		if(!GameplayRayBoxDistance(origin, unitDir, bounds, distance, hitDistance))
+			return true;
+
+		GameplayHit hit = { item.handle, hitDistance, item.userData };
+		if(mode == eGAMEPLAY_ALL)
+		{
+			hits->push_back(hit);
+			return true;
+		}
+		closest = hit;
+		shrunkDistance = hitDistance;
+		return mode == eGAMEPLAY_CLOSEST;
+	}
+};
+
+
+struct GameplayOverlapCallback : PxSpatialOverlapCallback
+{
+	PxU32					categories;
+	bool					sphere;
+	PxVec3					center;
+	PxReal					radius;
+	vector<GameplayHandle>*	handles;
+
+	PxAgain onHit(PxSpatialIndexItem& indexItem)
+	{
+		GameplayItem& item = static_cast<GameplayItem&>(indexItem);
+		if(!(item.categories & categories))
+			return true;
+		if(sphere && GameplayPointBoxDistanceSquared(center, item.bounds) > radius*radius)
+			return true;
+		handles->push_back(item.handle);
+		return true;
+	}
+};
+
+
+bool GameplayLocationQuery(const PxBounds3* box, const PxVec3& origin, const PxVec3& unitDir, PxReal maxDistance, GameplayHitMode mode,
+	vector<GameplayHit>& hits, PxU32 categories)
+{
+	double start = GameplayIndexClockMs();
+	GameplayLocationCallback callback;
+	callback.origin		= origin;
+	callback.unitDir	= unitDir;
+	callback.inflate	= box ? box->getExtents() : PxVec3(0.0f);
+	callback.categories = categories;
+	callback.mode		= mode;
+	callback.hits		= &hits;
+	callback.closest.handle = GAMEPLAY_INVALID_HANDLE;
+
+	hits.clear();
+	if(box)
+		gGameplayIndex.index->sweep(*box, unitDir, maxDistance, callback);
+	else
+		gGameplayIndex.index->raycast(origin, unitDir, maxDistance, callback);
+	if(mode != eGAMEPLAY_ALL && callback.closest.handle != GAMEPLAY_INVALID_HANDLE)
+		hits.push_back(callback.closest);
+
+	CountGameplayQuery(start, hits.size());
+	return !hits.empty();
+}
+
+
+//'hits' holds one hit for eGAMEPLAY_CLOSEST and eGAMEPLAY_ANY, all of them for eGAMEPLAY_ALL
+bool GameplayRaycast(const PxVec3& origin, const PxVec3& unitDir, PxReal maxDistance, GameplayHitMode mode, vector<GameplayHit>& hits,
+	PxU32 categories)
+{
+	return GameplayLocationQuery(NULL, origin, unitDir, maxDistance, mode, hits, categories);
+}
+
+
+//Distances are those of the box's center
+bool GameplaySweep(const PxBounds3& box, const PxVec3& unitDir, PxReal maxDistance, GameplayHitMode mode, vector<GameplayHit>& hits,
+	PxU32 categories)
+{
+	return GameplayLocationQuery(&box, box.getCenter(), unitDir, maxDistance, mode, hits, categories);
+}
+
+
+PxU32 GameplayOverlapQuery(const PxBounds3& box, bool sphere, const PxVec3& center, PxReal radius, vector<GameplayHandle>& handles,
+	PxU32 categories)
+{
+	double start = GameplayIndexClockMs();
+	GameplayOverlapCallback callback;
+	callback.categories = categories;
+	callback.sphere		= sphere;
+	callback.center		= center;
+	callback.radius		= radius;
+	callback.handles	= &handles;
+
+	handles.clear();
+	gGameplayIndex.index->overlap(box, callback);
+
+	CountGameplayQuery(start, handles.size());
+	return PxU32(handles.size());
+}
+
+
+PxU32 GameplayOverlap(const PxBounds3& box, vector<GameplayHandle>& handles, PxU32 categories)
+{
+	return GameplayOverlapQuery(box, false, PxVec3(0.0f), 0.0f, handles, categories);
+}
+
+
+PxU32 GameplayOverlapSphere(const PxVec3& center, PxReal radius, vector<GameplayHandle>& handles, PxU32 categories)
+{
+	return GameplayOverlapQuery(PxBounds3::centerExtents(center, PxVec3(radius)), true, center, radius, handles, categories);
+}
+
+
+void GameplaySpatialIndexRelease()
+{
+	GameplaySpatialIndex& g = gGameplayIndex;
+	if(g.index)
+		g.index->release();
+	g.index = NULL;
+	g.items.clear();
+	g.freeHandles.clear();
+	g.live = 0;
+}
+
+
+void PrintGameplaySpatialIndexStats()
+{
+	const GameplaySpatialIndexStats& s = gGameplayIndexStats;
+	PxU64 queries  = s.queries;
+	PxU64 hits	   = s.hits;
+	double queryMs = s.queryNs*1e-6;
+	printf("gameplay index: %u entries  %llu inserts %llu updates %llu removes %.3f ms  %llu rebuild steps %.3f ms (%.3f ms/frame)  %llu queries %.3f ms (%.2f us each, %.2f hits)\n",
+		gGameplayIndex.live, (unsigned long long)s.inserts, (unsigned long long)s.updates, (unsigned long long)s.removes, s.writeMs,
+		(unsigned long long)s.rebuildSteps, s.rebuildMs, s.frames ? s.rebuildMs/s.frames : 0.0,
+		(unsigned long long)queries, queryMs, queries ? 1000.0*queryMs/queries : 0.0, queries ? double(hits)/queries : 0.0);
+}
@@ -0,0 +1,284 @@
+/*
+=====================================================================
+
+File Name	  :	InputRecorder.h
+
+Description	  : Records the per-frame inputs of a demo to a compact binary file and
+				replays them, so that runs are reproducible and comparable.
+
+				A frame record holds everything that differs between two runs of the
+				same demo: the frame's elapsed time, the step size chosen by the fixed
+				timestep scheduler, the quality change of '--adaptive-quality' applied
+				before the frame's steps and the player's move direction. It also holds a hash
+				of the simulation state at the start of the frame, before the frame's
+				input is applied.
+
+				On replay the recorded inputs replace the live ones (keyboard, clock)
+				and the state hash is compared with the recorded one. The first
+				diverging frame is reported; 'InputRecorderClose()' returns a non-zero
+				exit code if any frame diverged.
+
+				The hash is FNV-1a over the bit patterns of the pose and velocities of
+				every rigid dynamic actor, in scene order. Identical results are only
+				expected with the same build, scene and number of workers, so the
+				worker count is stored in the file and a mismatch is reported.
+
+				File layout, native byte order:
+				  InputRecordHeader, then one InputRecord per frame
+
+				Command line options (parsed by 'ParseInputRecordOptions()'):
+				  --record FILE   Write the inputs of this run to FILE
+				  --replay FILE   Drive the run from FILE and check its state hashes
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "CommandLine.h"		//GetStringArgument()
+#include "CpuDispatcher.h"		//gDispatcherOptions
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+using namespace physx;
+
+
+enum InputRecordMode
+{
+	eINPUT_LIVE,		//Inputs come from the keyboard and clock
+	eINPUT_RECORD,		//Live inputs, written to the file
+	eINPUT_REPLAY		//Inputs read from the file
+};
+
+
+//Inputs of one frame, filled in by the demo and replaced on replay
+struct InputFrame
+{
+	PxReal	dt;				//Elapsed time of the frame
+	PxReal	stepSize;		//Simulation step size used by the frame
+	PxVec3	direction;		//Move direction of the player
+	PxI32	quality;		//Quality change applied before the frame's steps, see 'QualityController.h'
+};
+
+
+struct InputRecordHeader
+{
+	char	magic[4];		//"PXIR"
+	PxU32	version;
+	char	scene[16];		//Name of the demo that recorded the file
+	PxU32	workers;		//Worker threads of the recording run
+	PxU32	reserved;
+};
+
+
+struct InputRecord
+{
+	PxReal	dt;
+	PxReal	stepSize;
+	PxReal	direction[3];
+	PxI32	quality;		//0 in recordings made before it was stored
+	PxU64	stateHash;		//State at the start of the frame
+};
+
+
+struct InputRecorder
+{
+	InputRecordMode	mode;
+	const char*		path;
+	FILE*			file;
+
+	PxU64			frames;				//Frames recorded or replayed
+	PxU64			divergentFrames;	//Replayed frames whose state hash differed
+	PxU64			firstDivergence;	//Index of the first of them
+	PxU64			lastHash;
+	bool			finished;			//Replay reached the end of the file
+};
+
+
+const PxU32 INPUT_RECORD_VERSION = 1;
+const PxU64 FNV_OFFSET_BASIS	 = 14695981039346656037ULL;
+const PxU64 FNV_PRIME			 = 1099511628211ULL;
+
+InputRecorder gInputRecorder = { eINPUT_LIVE, NULL, NULL, 0, 0, 0, 0, false };
+
+
+void ParseInputRecordOptions(int argc, char** argv);
+bool InputRecorderOpen(const char* sceneName);
+bool InputRecorderFrame(PxScene& scene, InputFrame& frame);
+int InputRecorderClose();
+PxU64 SceneStateHash(PxScene& scene);
+
+
+
+void ParseInputRecordOptions(int argc, char** argv)
+{
+	const char* record = GetStringArgument(argc, argv, "--record", NULL);
+	const char* replay = GetStringArgument(argc, argv, "--replay", NULL);
+
+	gInputRecorder.mode = replay ? eINPUT_REPLAY : record ? eINPUT_RECORD : eINPUT_LIVE;
+	gInputRecorder.path = replay ? replay : record;
+}
+
+
+PxU64 HashBytes(PxU64 hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for(size_t i=0; i<size; i++)
+		hash = (hash ^ bytes[i])*FNV_PRIME;
+	return hash;
+}
+
+
+//Bitwise hash of every rigid dynamic actor's pose and velocities. The scene must not be simulating.
+PxU64 SceneStateHash(PxScene& scene)
+{
+	static vector<PxActor*> actors;
+	actors.resize(scene.getNbActors(PxActorTypeFlag::eRIGID_DYNAMIC));
+	if(actors.empty())
+		return FNV_OFFSET_BASIS;
+	scene.getActors(PxActorTypeFlag::eRIGID_DYNAMIC, &actors[0], PxU32(actors.size()));
+
+	PxU64 hash = FNV_OFFSET_BASIS;
+	for(size_t i=0; i<actors.size(); i++)
+	{
+		PxRigidDynamic* body = static_cast<PxRigidDynamic*>(actors[i]);
+		PxTransform pose	 = body->getGlobalPose();
+		PxVec3 linear		 = body->getLinearVelocity();
+		PxVec3 angular		 = body->getAngularVelocity();
+
+		hash = HashBytes(hash, &pose, sizeof(pose));
+		hash = HashBytes(hash, &linear, sizeof(linear));
+		hash = HashBytes(hash, &angular, sizeof(angular));
+	}
+	return hash;
+}
+
+
+//Call once the scene is created. Returns false, after printing why, if the file cannot be used.
+bool InputRecorderOpen(const char* sceneName)
+{
+	InputRecorder& r = gInputRecorder;
+	if(r.mode == eINPUT_LIVE)
+		return true;
+
+	InputRecordHeader header;
+	if(r.mode == eINPUT_RECORD)
+	{
+		r.file = fopen(r.path, "wb");
+		if(!r.file)
+		{
+			fprintf(stderr, "Cannot create input recording '%s'\n", r.path);
+			r.mode = eINPUT_LIVE;
+			return false;
+		}
+
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "PXIR", 4);
+		header.version = INPUT_RECORD_VERSION;
+		strncpy(header.scene, sceneName, sizeof(header.scene) - 1);
+		header.workers = gDispatcherOptions.workers;
+		fwrite(&header, sizeof(header), 1, r.file);
+		printf("Recording inputs to '%s'\n", r.path);
+		return true;
+	}
+
+	r.file = fopen(r.path, "rb");
+	if(!r.file || fread(&header, sizeof(header), 1, r.file) != 1 || memcmp(header.magic, "PXIR", 4) || header.version != INPUT_RECORD_VERSION)
+	{
+		fprintf(stderr, "Cannot read input recording '%s'\n", r.path);
+		if(r.file)
+			fclose(r.file);
+		r.file = NULL;
+		r.mode = eINPUT_LIVE;
+		return false;
+	}
+
+	header.scene[sizeof(header.scene) - 1] = 0;
+	if(strcmp(header.scene, sceneName))
+		fprintf(stderr, "Input recording '%s' is of '%s', not '%s'\n", r.path, header.scene, sceneName);
+	if(header.workers != gDispatcherOptions.workers)
+		fprintf(stderr, "Input recording made with %u workers, replaying with %u; state hashes may differ\n",
+			header.workers, gDispatcherOptions.workers);
+	printf("Replaying inputs from '%s'\n", r.path);
+	return true;
+}
+
+
+//Call at the start of every frame, once the scene has stopped simulating and before the
+//frame's input is applied. Records 'frame', or replaces it with the recorded one. Returns
+//false when a replay has run out of frames.
+bool InputRecorderFrame(PxScene& scene, InputFrame& frame)
+{
+	InputRecorder& r = gInputRecorder;
+	if(r.mode == eINPUT_LIVE)
+		return true;
+	if(r.finished)
+		return false;
+
+	r.lastHash = SceneStateHash(scene);
+
+	InputRecord record;
+	if(r.mode == eINPUT_RECORD)
+	{
+		record.dt			= frame.dt;
+		record.stepSize		= frame.stepSize;
+		record.direction[0] = frame.direction.x;
+		record.direction[1] = frame.direction.y;
+		record.direction[2] = frame.direction.z;
+		record.quality		= frame.quality;
+		record.stateHash	= r.lastHash;
+		fwrite(&record, sizeof(record), 1, r.file);
+		r.frames++;
+		return true;
+	}
+
+	if(fread(&record, sizeof(record), 1, r.file) != 1)
+	{
+		r.finished = true;
+		return false;
+	}
+
+	if(record.stateHash != r.lastHash && r.divergentFrames++ == 0)
+	{
+		r.firstDivergence = r.frames;
+		fprintf(stderr, "Replay diverged at frame %llu: state hash %016llx, recorded %016llx\n",
+			(unsigned long long)r.frames, (unsigned long long)r.lastHash, (unsigned long long)record.stateHash);
+	}
+
+	frame.dt		= record.dt;
+	frame.stepSize	= record.stepSize;
+	frame.direction = PxVec3(record.direction[0], record.direction[1], record.direction[2]);
+	frame.quality	= record.quality;
+	r.frames++;
+	return true;
+}
+
+
+//Prints a summary and returns the process exit code: failure if a replay diverged
+int InputRecorderClose()
+{
+	InputRecorder& r = gInputRecorder;
+	if(!r.file)
+		return EXIT_SUCCESS;
+
+	fclose(r.file);
+	r.file = NULL;
+
+	if(r.mode == eINPUT_RECORD)
+	{
+		printf("input recording: %llu frames written to '%s', last state hash %016llx\n",
+			(unsigned long long)r.frames, r.path, (unsigned long long)r.lastHash);
+		return EXIT_SUCCESS;
+	}
+
+	if(r.divergentFrames)
+		printf("input replay: %llu frames, %llu diverged, first at frame %llu\n", (unsigned long long)r.frames,
+			(unsigned long long)r.divergentFrames, (unsigned long long)r.firstDivergence);
+	else
+		printf("input replay: %llu frames, all state hashes match, last %016llx\n",
+			(unsigned long long)r.frames, (unsigned long long)r.lastHash);
+	return r.divergentFrames ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,241 @@
+/*
+=====================================================================
+
+File Name	  :	LevelPruning.h
+
+Description	  : Static level geometry saved with a precomputed 'PxPruningStructure', so a
+				level loads without the scene query tree being rebuilt for its actors.
+
+				Offline, 'LevelBuildPruningStructure()' builds the AABB tree of the level's
+				static actors. 'LevelSave()' then writes the structure to a binary
+				'PxCollection' file. A pruning structure in a collection brings in its
+				actors, their shapes and the shapes' materials. A 'LevelFileHeader' in
+				front of the collection holds a key chosen by the caller to describe what
+				the level was built from; 'LevelLoad()' returns it in 'PrunedLevel::key',
+				so the caller can tell a stale file from a current one.
+
+				At load time, 'LevelLoad()' deserializes the collection in place into a
+				128 byte aligned block. The objects live in that block, so it stays allocated until
+				'LevelRelease()'. 'LevelAddToScene()' merges the whole tree into the
+				scene's static query tree with one 'PxScene::addActors()' call. The
+				structure is released right after, as PhysX requires before any of its
+				actors are released.
+
+				A pruning structure goes stale when its actors' shapes or bounds change
+				before it is added, so build it from actors that are not in any scene.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include <extensions/PxCollectionExt.h>	//PxCollectionExt::releaseObjects(), not in PxPhysicsAPI.h
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <chrono>
+
+using namespace std;
+using namespace physx;
+
+
+struct PrunedLevel
+{
+	void*				block;			//Allocation holding the deserialized objects
+	PxCollection*		collection;
+	PxPruningStructure*	pruning;		//NULL once added to a scene
+	PxU32				actors;
+	PxU64				key;			//As given to 'LevelSave()'
+};
+
+
+//Precedes the collection in a level file
+struct LevelFileHeader
+{
+	char	magic[4];		//"PXLV"
+	PxU32	version;
+	PxU64	key;
+};
+
+
+struct LevelPruningStats
+{
+	PxU64	bytes;				//Size of the last file saved or loaded
+	double	buildMs;			//'createPruningStructure()'
+	double	serializeMs;		//Collection completion and binary serialization
+	double	readMs;				//File to memory
+	double	deserializeMs;		//'createCollectionFromBinary()'
+	double	addMs;				//'addActors()'
+};
+
+
+const PxU32 LEVEL_FILE_VERSION = 1;
+
+LevelPruningStats gLevelPruningStats = { 0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+
+
+PxPruningStructure* LevelBuildPruningStructure(PxPhysics& physics, PxRigidActor*const* actors, PxU32 count);
+bool LevelSave(PxPhysics& physics, PxPruningStructure& pruning, const char* path, PxU64 key);
+bool LevelLoad(PxPhysics& physics, const char* path, PrunedLevel& level);
+void LevelAddToScene(PxScene& scene, PrunedLevel& level);
+void LevelRelease(PrunedLevel& level);
+void PrintLevelPruningStats();
+
+
+
+double LevelPruningClockMs()
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+//The offline step; the actors must not be in a scene. Returns NULL, after PhysX reports why, on failure.
+PxPruningStructure* LevelBuildPruningStructure(PxPhysics& physics, PxRigidActor*const* actors, PxU32 count)
+{
+	double start = LevelPruningClockMs();
+	PxPruningStructure* pruning = physics.createPruningStructure(actors, count);
+	gLevelPruningStats.buildMs = LevelPruningClockMs() - start;
+	return pruning;
+}
+
+
+//'key' describes what the level was built from, in any encoding the caller likes
+bool LevelSave(PxPhysics& physics, PxPruningStructure& pruning, const char* path, PxU64 key)
+{
+	double start = LevelPruningClockMs();
+	PxSerializationRegistry* registry = PxSerialization::createSerializationRegistry(physics);
+	PxCollection* collection = PxCreateCollection();
+	collection->add(pruning);
+	PxSerialization::complete(*collection, *registry);	//Actors, shapes and materials
+
+	PxDefaultMemoryOutputStream stream;
+	bool serialized = PxSerialization::serializeCollectionToBinary(stream, *collection, *registry);
+	collection->release();
+	registry->release();
+	gLevelPruningStats.serializeMs = LevelPruningClockMs() - start;
+
+	LevelFileHeader header;
+	memcpy(header.magic, "PXLV", 4);
+	header.version = LEVEL_FILE_VERSION;
+	header.key	   = key;
+
+	FILE* file = serialized ? fopen(path, "wb") : NULL;
+	bool written = file && fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(stream.getData(), 1, stream.getSize(), file) == stream.getSize();
+	if(file)
+		fclose(file);
+	if(!written)
+	{
+		fprintf(stderr, "Cannot write level '%s'\n", path);
+		return false;
+	}
+	gLevelPruningStats.bytes = sizeof(header) + stream.getSize();
+	return true;
+}
+
+
+//Returns false, after printing why, if the file cannot be used
+bool LevelLoad(PxPhysics& physics, const char* path, PrunedLevel& level)
+{
+	level.block		 = NULL;
+	level.collection = NULL;
+	level.pruning	 = NULL;
+	level.actors	 = 0;
+	level.key		 = 0;
+
+	double start = LevelPruningClockMs();
+	FILE* file = fopen(path, "rb");
+	if(!file)
+	{
+		fprintf(stderr, "Cannot open level '%s'\n", path);
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file) - long(sizeof(LevelFileHeader));
+	fseek(file, 0, SEEK_SET);
+
+	LevelFileHeader header;
+	if(size <= 0 || fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "PXLV", 4) || header.version != LEVEL_FILE_VERSION)
+	{
+		fprintf(stderr, "'%s' is not a level file of this version\n", path);
+		fclose(file);
+		return false;
+	}
+	level.key = header.key;
+
+	level.block = malloc(size_t(size) + PX_SERIAL_FILE_ALIGN - 1);
+	void* aligned = level.block ? (void*)((size_t(level.block) + PX_SERIAL_FILE_ALIGN - 1) & ~size_t(PX_SERIAL_FILE_ALIGN - 1)) : NULL;
+	bool read = aligned && fread(aligned, 1, size_t(size), file) == size_t(size);
+	fclose(file);
+	gLevelPruningStats.readMs = LevelPruningClockMs() - start;
+	if(!read)
+	{
+		fprintf(stderr, "Cannot read level '%s'\n", path);
+		LevelRelease(level);
+		return false;
+	}
+
+	start = LevelPruningClockMs();
+	PxSerializationRegistry* registry = PxSerialization::createSerializationRegistry(physics);
+	level.collection = PxSerialization::createCollectionFromBinary(aligned, *registry);
+	registry->release();
+	gLevelPruningStats.deserializeMs = LevelPruningClockMs() - start;
+	gLevelPruningStats.bytes = sizeof(header) + PxU64(size);
+
+	for(PxU32 i=0; level.collection && i<level.collection->getNbObjects(); i++)
+	{
+		PxBase& object = level.collection->getObject(i);
+		if(object.getConcreteType() == PxConcreteType::ePRUNING_STRUCTURE)
+			level.pruning = static_cast<PxPruningStructure*>(&object);
+	}
+	if(!level.pruning)
+	{
+		fprintf(stderr, "Level '%s' holds no pruning structure, or was saved by another PhysX build\n", path);
+		LevelRelease(level);
+		return false;
+	}
+	level.actors = level.pruning->getNbRigidActors();
+	return true;
+}
+
+
+void LevelAddToScene(PxScene& scene, PrunedLevel& level)
+{
+	double start = LevelPruningClockMs();
+	scene.addActors(*level.pruning);
+	gLevelPruningStats.addMs = LevelPruningClockMs() - start;
+
+	level.collection->remove(*level.pruning);	//So 'LevelRelease()' does not release it again
+	level.pruning->release();
+	level.pruning = NULL;
+}
+
+
+//Call after the scene holding the level's actors is released
+void LevelRelease(PrunedLevel& level)
+{
+	if(level.collection)
+	{
+		if(level.pruning)
+		{
+			level.collection->remove(*level.pruning);
+			level.pruning->release();		//Before its actors
+		}
+		PxCollectionExt::releaseObjects(*level.collection);
+		level.collection->release();
+	}
+	free(level.block);
+	level.block		 = NULL;
+	level.collection = NULL;
+	level.pruning	 = NULL;
+}
+
+
+void PrintLevelPruningStats()
+{
+	const LevelPruningStats& s = gLevelPruningStats;
+	printf("level pruning: %.1f KB  build %.3f ms  serialize %.3f ms  read %.3f ms  deserialize %.3f ms  addActors %.3f ms\n",
+		s.bytes/1024.0, s.buildMs, s.serializeMs, s.readMs, s.deserializeMs, s.addMs);
+}
@@ -0,0 +1,570 @@
+/*
+=====================================================================
+
+File Name	  :	PacketBVH.h
+
+Description	  : An application-side bounding volume hierarchy over the static shapes of a
+				scene, for visibility and sensor rays. These rays need only the distance
+				to the closest static shape and come in coherent bundles, such as camera
+				tiles or sensor fans.
+
+				'PacketBVHBuild()' collects the world bounds of every static query shape
+				and builds a 4-wide or 8-wide tree top-down, splitting at the centroid
+				median of the widest axis. The bounds of a node's children are stored as
+				one structure of arrays, so one slab test checks a ray against all of them
+				at once. 4-wide nodes are tested with 'PsVecMath', which maps to SSE2 on
+				x86 and NEON on ARM. 8-wide nodes are tested with AVX2 and need the same
+				runtime CPU check as 'DebugVertexKernels.h'; 'PacketBVHMaxWidth()' tells
+				whether the running CPU has it, and a build asked for 8 falls back to 4.
+
+				'PacketBVHRaycast()' traverses packets of up to 'PACKET_BVH_MAX_PACKET' rays
+				together. Every stack entry carries a bit mask of the rays that reached it,
+				so each node is fetched once per packet instead of once per ray. Children
+				are visited nearest first for the packet's first active ray. Leaf shapes
+				are tested with 'PxGeometryQuery::raycast()', so the distances are those
+				of 'PxScene::raycast()'. Planes have no bounds. Every ray tests them
+				before the traversal, which also shortens its search.
+
+				The tree is a snapshot. Rebuild it when static actors are added, removed or
+				moved.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "PsVecMath.h"			//Vec4V, the SIMD layer of the PhysX foundation
+#include "DebugVertexKernels.h"	//CpuSupportsAVX2(), DEBUG_KERNELS_TARGET_AVX2
+#include <cstdio>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#if defined(_MSC_VER)
+	#include <intrin.h>		//_BitScanForward()
+#endif
+
+using namespace std;
+using namespace physx;
+
+
+//WIDTH children; a child is an inner node, a leaf run of primitives or empty
+template<PxU32 WIDTH>
+struct PacketBVHNodeN
+{
+	PxF32	minX[WIDTH], minY[WIDTH], minZ[WIDTH];
+	PxF32	maxX[WIDTH], maxY[WIDTH], maxZ[WIDTH];
+	PxU32	child[WIDTH];	//Node index of an inner child, first primitive of a leaf
+	PxU32	count[WIDTH];	//Primitives of a leaf, 0 for inner and empty children
+	PxU32	used;			//Bit per child that is not empty
+};
+
+typedef PacketBVHNodeN<4> PacketBVHNode;
+typedef PacketBVHNodeN<8> PacketBVHNode8;
+
+
+struct PacketBVHPrimitive
+{
+	PxBounds3			bounds;
+	PxGeometryHolder	geometry;
+	PxTransform			pose;		//Global pose of the shape
+	PxShape*			shape;
+};
+
+
+struct PacketBVH
+{
+	PxU32						width;			//Children per node, 4 or 8
+	vector<PacketBVHNode>		nodes;			//Root first, at width 4
+	vector<PacketBVHNode8>		nodes8;			//Root first, at width 8
+	vector<PacketBVHPrimitive>	primitives;		//In leaf order
+	vector<PacketBVHPrimitive>	planes;			//Unbounded, tested by every ray
+	PxU32						depth;
+	double						buildMs;
+};
+
+
+struct PacketBVHStats
+{
+	PxU64	rays;
+	PxU64	packets;
+	PxU64	nodeVisits;			//Nodes fetched, once per packet
+	PxU64	rayNodeTests;		//Slab tests of all of a node's children, one per ray and node
+	PxU64	shapeTests;			//'PxGeometryQuery::raycast()' calls
+};
+
+
+const PxU32 PACKET_BVH_LEAF_SIZE	= 4;
+const PxU32 PACKET_BVH_MAX_PACKET	= 32;		//One bit per ray in the traversal masks
+const PxU32 PACKET_BVH_STACK_SIZE	= 256;
+
+PacketBVHStats	gPacketBVHStats = { 0, 0, 0, 0, 0 };
+
+
+PxU32 PacketBVHMaxWidth();
+void PacketBVHBuild(PxScene& scene, PacketBVH& bvh, PxU32 width = 4);
+void PacketBVHRaycast(const PacketBVH& bvh, const PxVec3* origins, const PxVec3* unitDirs, PxU32 count, PxReal maxDistance,
+	PxU32 packetSize, PxReal* distances, PxShape** shapes);
+void PrintPacketBVHStats(const PacketBVH& bvh);
+
+
+
+//Orders primitives by the centroid of their bounds along one axis
+struct PacketBVHCentroidLess
+{
+	PxU32 axis;
+
+	bool operator()(const PacketBVHPrimitive& a, const PacketBVHPrimitive& b) const
+	{
+		return a.bounds.minimum[axis] + a.bounds.maximum[axis] < b.bounds.minimum[axis] + b.bounds.maximum[axis];
+	}
+};
+
+
+PxBounds3 PacketBVHRangeBounds(const PacketBVH& bvh, PxU32 first, PxU32 count)
+{
+	PxBounds3 bounds = PxBounds3::empty();
+	for(PxU32 i=first; i<first+count; i++)
+		bounds.include(bvh.primitives[i].bounds);
+	return bounds;
+}
+
+
+//Splits [first, first+count) at the centroid median of its widest axis
+PxU32 SplitPacketBVHRange(PacketBVH& bvh, PxU32 first, PxU32 count)
+{
+	PxBounds3 centroids = PxBounds3::empty();
+	for(PxU32 i=first; i<first+count; i++)
+		centroids.include(bvh.primitives[i].bounds.getCenter());
+
+	PxVec3 extent = centroids.getDimensions();
+	PacketBVHCentroidLess less;
+	less.axis = extent.x >= extent.y && extent.x >= extent.z ? 0u : (extent.y >= extent.z ? 1u : 2u);
+
+	PxU32 half = count/2;
+	vector<PacketBVHPrimitive>::iterator begin = bvh.primitives.begin() + first;
+	nth_element(begin, begin + half, begin + count, less);
+	return half;
+}
+
+
+template<PxU32 WIDTH>
+PxU32 BuildPacketBVHNode(PacketBVH& bvh, vector<PacketBVHNodeN<WIDTH> >& nodes, PxU32 first, PxU32 count, PxU32 depth)
+{
+	PxU32 nodeIndex = PxU32(nodes.size());
+	nodes.push_back(PacketBVHNodeN<WIDTH>());
+	bvh.depth = PxMax(bvh.depth, depth);
+
+	//Up to WIDTH ranges, always splitting the largest one that is not a leaf yet
+	PxU32 rangeFirst[WIDTH] = { first }, rangeCount[WIDTH] = { count };
+	PxU32 nbRanges = 1;
+	while(nbRanges < WIDTH)
+	{
+		PxU32 largest = 0;
+		for(PxU32 r=1; r<nbRanges; r++)
+			if(rangeCount[r] > rangeCount[largest])
+				largest = r;
+		if(rangeCount[largest] <= PACKET_BVH_LEAF_SIZE)
+			break;
+
+		PxU32 half = SplitPacketBVHRange(bvh, rangeFirst[largest], rangeCount[largest]);
+		rangeFirst[nbRanges] = rangeFirst[largest] + half;
+		rangeCount[nbRanges] = rangeCount[largest] - half;
+		rangeCount[largest]	 = half;
+		nbRanges++;
+	}
+
+	for(PxU32 c=0; c<WIDTH; c++)
+	{
+		PxBounds3 bounds(PxVec3(0.0f), PxVec3(0.0f));	//Masked out by 'used'
+		PxU32 child = 0, leafCount = 0;
+		if(c < nbRanges)
+		{
+			bounds = PacketBVHRangeBounds(bvh, rangeFirst[c], rangeCount[c]);
+			if(rangeCount[c] <= PACKET_BVH_LEAF_SIZE)
+			{
+				child	  = rangeFirst[c];
+				leafCount = rangeCount[c];
+			}
+			else
+				child = BuildPacketBVHNode(bvh, nodes, rangeFirst[c], rangeCount[c], depth + 1);
+		}
+
+		PacketBVHNodeN<WIDTH>& node = nodes[nodeIndex];	//The recursion may have moved it
+		node.minX[c] = bounds.minimum.x;	node.minY[c] = bounds.minimum.y;	node.minZ[c] = bounds.minimum.z;
+		node.maxX[c] = bounds.maximum.x;	node.maxY[c] = bounds.maximum.y;	node.maxZ[c] = bounds.maximum.z;
+		node.child[c] = child;
+		node.count[c] = leafCount;
+	}
+	nodes[nodeIndex].used = (1u << nbRanges) - 1;
+	return nodeIndex;
+}
+
+
+//8 when the running CPU can traverse 8-wide nodes, otherwise 4
+PxU32 PacketBVHMaxWidth()
+{
+#if DEBUG_KERNELS_X86
+	static const PxU32 width = CpuSupportsAVX2() ? 8u : 4u;
+	return width;
+#else
+	return 4;
+#endif
+}
+
+
+//'width' is 4 or 8; 8 falls back to 4 on CPUs without AVX2
+void PacketBVHBuild(PxScene& scene, PacketBVH& bvh, PxU32 width)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	bvh.width = width >= 8 && PacketBVHMaxWidth() >= 8 ? 8u : 4u;
+	bvh.nodes.clear();
+	bvh.nodes8.clear();
+	bvh.primitives.clear();
+	bvh.planes.clear();
+	bvh.depth = 0;
+
+	vector<PxActor*> actors(scene.getNbActors(PxActorTypeFlag::eRIGID_STATIC));
+	if(!actors.empty())
+		scene.getActors(PxActorTypeFlag::eRIGID_STATIC, &actors[0], PxU32(actors.size()));
+
+	vector<PxShape*> shapes;
+	for(size_t i=0; i<actors.size(); i++)
+	{
+		PxRigidActor* actor = actors[i]->is<PxRigidActor>();
+		shapes.resize(actor->getNbShapes());
+		if(shapes.empty())
+			continue;
+		actor->getShapes(&shapes[0], PxU32(shapes.size()));
+		for(size_t j=0; j<shapes.size(); j++)
+		{
+			if(!(shapes[j]->getFlags() & PxShapeFlag::eSCENE_QUERY_SHAPE))
+				continue;
+
+			PacketBVHPrimitive primitive;
+			primitive.geometry = shapes[j]->getGeometry();
+			primitive.pose	   = PxShapeExt::getGlobalPose(*shapes[j], *actor);
+			primitive.shape	   = shapes[j];
+			if(primitive.geometry.getType() == PxGeometryType::ePLANE)
+			{
+				primitive.bounds = PxBounds3::empty();
+				bvh.planes.push_back(primitive);
+			}
+			else
+			{
+				primitive.bounds = PxShapeExt::getWorldBounds(*shapes[j], *actor);
+				bvh.primitives.push_back(primitive);
+			}
+		}
+	}
+
+	if(!bvh.primitives.empty() && bvh.width == 8)
+		BuildPacketBVHNode(bvh, bvh.nodes8, 0, PxU32(bvh.primitives.size()), 1);
+	else if(!bvh.primitives.empty())
+		BuildPacketBVHNode(bvh, bvh.nodes, 0, PxU32(bvh.primitives.size()), 1);
+	bvh.buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+
+//Ray of a packet, with its direction inverted and everything splatted for the four-child tests
+struct PacketBVHRay
+{
+	shdfnd::aos::Vec4V	ox, oy, oz;
+	shdfnd::aos::Vec4V	ix, iy, iz;
+};
+
+
+PxU32 PacketBVHLowestBit(PxU32 mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return PxU32(index);
+#else
+	return PxU32(__builtin_ctz(mask));
+#endif
+}
+
+
+//Large finite inverse for axis-parallel rays, so that 0 times it is never NaN
+PxReal PacketBVHInverse(PxReal d)
+{
+	return 1.0f/(PxAbs(d) > 1e-12f ? d : (d < 0.0f ? -1e-12f : 1e-12f));
+}
+
+
+//Scalar slab test of one ray against one primitive's bounds, up to 'maxDistance'
+bool PacketBVHRayHitsBounds(const PxVec3& origin, const PxVec3& inverse, const PxBounds3& bounds, PxReal maxDistance)
+{
+	PxReal t0 = 0.0f, t1 = maxDistance;
+	for(PxU32 axis=0; axis<3; axis++)
+	{
+		PxReal ta = (bounds.minimum[axis] - origin[axis])*inverse[axis];
+		PxReal tb = (bounds.maximum[axis] - origin[axis])*inverse[axis];
+		t0 = PxMax(t0, PxMin(ta, tb));
+		t1 = PxMin(t1, PxMax(ta, tb));
+	}
+	return t0 <= t1;
+}
+
+
+//Closest hit of one shape for one ray, kept if it beats the ray's best so far
+void PacketBVHTestShape(const PacketBVHPrimitive& primitive, const PxVec3& origin, const PxVec3& unitDir, PxReal& distance, PxShape*& shape)
+{
+	PxRaycastHit hit;
+	gPacketBVHStats.shapeTests++;
+	if(PxGeometryQuery::raycast(origin, unitDir, primitive.geometry.any(), primitive.pose, distance, PxHitFlag::eDISTANCE, 1, &hit)
+		&& hit.distance < distance)
+	{
+		distance = hit.distance;
+		shape	 = primitive.shape;
+	}
+}
+
+
+//Scalar state of the rays of one packet, shared by the traversals of both widths
+struct PacketBVHPacket
+{
+	const PxVec3*	origins;
+	const PxVec3*	unitDirs;
+	PxVec3			inverses[PACKET_BVH_MAX_PACKET];
+	PxReal*			distances;		//Each ray's length, shortened by its hits
+	PxShape**		shapes;
+	PxU32			count;
+};
+
+
+struct PacketBVHStackEntry
+{
+	PxU32	node;
+	PxU32	rays;		//Mask of the rays that reached the node
+};
+
+
+//Tests the leaf children against their rays at once, so their hits shorten the rays before the inner
+//children are tested. Then pushes the inner children, farthest first so the nearest is popped next.
+//The stack holds at most (WIDTH-1)*depth+1 entries.
+template<PxU32 WIDTH>
+void PacketBVHVisitChildren(const PacketBVH& bvh, const PacketBVHNodeN<WIDTH>& node, const PxU32* childRays, const PxF32* nearest,
+	PacketBVHPacket& packet, PacketBVHStackEntry* stack, PxU32& stackSize)
+{
+	PxU32 inner[WIDTH], nbInner = 0;
+	for(PxU32 c=0; c<WIDTH; c++)
+	{
+		if(!childRays[c])
+			continue;
+		if(!node.count[c])
+		{
+			inner[nbInner++] = c;
+			continue;
+		}
+
+		for(PxU32 p=node.child[c]; p<node.child[c] + node.count[c]; p++)
+		{
+			const PacketBVHPrimitive& primitive = bvh.primitives[p];
+			for(PxU32 mask=childRays[c]; mask; mask&=mask-1)
+			{
+				PxU32 r = PacketBVHLowestBit(mask);
+				if(PacketBVHRayHitsBounds(packet.origins[r], packet.inverses[r], primitive.bounds, packet.distances[r]))
+					PacketBVHTestShape(primitive, packet.origins[r], packet.unitDirs[r], packet.distances[r], packet.shapes[r]);
+			}
+		}
+	}
+
+	for(PxU32 i=1; i<nbInner; i++)
+		for(PxU32 j=i; j>0 && nearest[inner[j]] > nearest[inner[j-1]]; j--)
+			swap(inner[j], inner[j-1]);
+	PX_ASSERT(stackSize + nbInner <= PACKET_BVH_STACK_SIZE);
+	for(PxU32 i=0; i<nbInner; i++)
+	{
+		PacketBVHStackEntry child = { node.child[inner[i]], childRays[inner[i]] };
+		stack[stackSize++] = child;
+	}
+}
+
+
+void TraversePacketBVH4(const PacketBVH& bvh, PacketBVHPacket& packet, PacketBVHStackEntry root)
+{
+	using namespace shdfnd::aos;
+
+	PacketBVHRay rays[PACKET_BVH_MAX_PACKET];
+	for(PxU32 r=0; r<packet.count; r++)
+	{
+		rays[r].ox = V4Load(packet.origins[r].x);	rays[r].oy = V4Load(packet.origins[r].y);	rays[r].oz = V4Load(packet.origins[r].z);
+		rays[r].ix = V4Load(packet.inverses[r].x);	rays[r].iy = V4Load(packet.inverses[r].y);	rays[r].iz = V4Load(packet.inverses[r].z);
+	}
+
+	PacketBVHStackEntry stack[PACKET_BVH_STACK_SIZE];
+	PxU32 stackSize = 0;
+	stack[stackSize++] = root;
+
+	const Vec4V zero = V4Zero();
+	while(stackSize)
+	{
+		PacketBVHStackEntry entry = stack[--stackSize];
+		const PacketBVHNode& node = bvh.nodes[entry.node];
+		gPacketBVHStats.nodeVisits++;
+
+		Vec4V minX = V4LoadU(node.minX), minY = V4LoadU(node.minY), minZ = V4LoadU(node.minZ);
+		Vec4V maxX = V4LoadU(node.maxX), maxY = V4LoadU(node.maxY), maxZ = V4LoadU(node.maxZ);
+
+		//Four children against every ray of the entry
+		PxU32 childRays[4] = { 0, 0, 0, 0 };
+		PX_ALIGN(16, PxF32 nearest[4]) = { 0.0f, 0.0f, 0.0f, 0.0f };	//Entry distances of the first ray, for the visiting order
+		bool firstRay = true;
+		for(PxU32 mask=entry.rays; mask; mask&=mask-1)
+		{
+			PxU32 r = PacketBVHLowestBit(mask);
+			const PacketBVHRay& ray = rays[r];
+			gPacketBVHStats.rayNodeTests++;
+
+			Vec4V tx0 = V4Mul(V4Sub(minX, ray.ox), ray.ix), tx1 = V4Mul(V4Sub(maxX, ray.ox), ray.ix);
+			Vec4V ty0 = V4Mul(V4Sub(minY, ray.oy), ray.iy), ty1 = V4Mul(V4Sub(maxY, ray.oy), ray.iy);
+			Vec4V tz0 = V4Mul(V4Sub(minZ, ray.oz), ray.iz), tz1 = V4Mul(V4Sub(maxZ, ray.oz), ray.iz);
+			Vec4V tNear = V4Max(V4Max(V4Min(tx0, tx1), V4Min(ty0, ty1)), V4Max(V4Min(tz0, tz1), zero));
+			Vec4V tFar	= V4Min(V4Min(V4Max(tx0, tx1), V4Max(ty0, ty1)), V4Min(V4Max(tz0, tz1), V4Load(packet.distances[r])));
+
+			PxU32 hits = BGetBitMask(V4IsGrtrOrEq(tFar, tNear)) & node.used;
+			for(PxU32 c=0; c<4; c++)
+				childRays[c] |= ((hits >> c) & 1u) << r;
+
+			if(firstRay && hits)
+			{
+				V4StoreA(tNear, nearest);
+				firstRay = false;
+			}
+		}
+
+		PacketBVHVisitChildren(bvh, node, childRays, nearest, packet, stack, stackSize);
+	}
+}
+
+
+#if DEBUG_KERNELS_X86
+
+//Same as 'TraversePacketBVH4()' with the eight children of a node in one AVX register
+DEBUG_KERNELS_TARGET_AVX2
+void TraversePacketBVH8(const PacketBVH& bvh, PacketBVHPacket& packet, PacketBVHStackEntry root)
+{
+	__m256 ox[PACKET_BVH_MAX_PACKET], oy[PACKET_BVH_MAX_PACKET], oz[PACKET_BVH_MAX_PACKET];
+	__m256 ix[PACKET_BVH_MAX_PACKET], iy[PACKET_BVH_MAX_PACKET], iz[PACKET_BVH_MAX_PACKET];
+	for(PxU32 r=0; r<packet.count; r++)
+	{
+		ox[r] = _mm256_set1_ps(packet.origins[r].x);	oy[r] = _mm256_set1_ps(packet.origins[r].y);	oz[r] = _mm256_set1_ps(packet.origins[r].z);
+		ix[r] = _mm256_set1_ps(packet.inverses[r].x);	iy[r] = _mm256_set1_ps(packet.inverses[r].y);	iz[r] = _mm256_set1_ps(packet.inverses[r].z);
+	}
+
+	PacketBVHStackEntry stack[PACKET_BVH_STACK_SIZE];
+	PxU32 stackSize = 0;
+	stack[stackSize++] = root;
+
+	const __m256 zero = _mm256_setzero_ps();
+	while(stackSize)
+	{
+		PacketBVHStackEntry entry = stack[--stackSize];
+		const PacketBVHNode8& node = bvh.nodes8[entry.node];
+		gPacketBVHStats.nodeVisits++;
+
+		__m256 minX = _mm256_loadu_ps(node.minX), minY = _mm256_loadu_ps(node.minY), minZ = _mm256_loadu_ps(node.minZ);
+		__m256 maxX = _mm256_loadu_ps(node.maxX), maxY = _mm256_loadu_ps(node.maxY), maxZ = _mm256_loadu_ps(node.maxZ);
+
+		PxU32 childRays[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+		PX_ALIGN(32, PxF32 nearest[8]) = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		bool firstRay = true;
+		for(PxU32 mask=entry.rays; mask; mask&=mask-1)
+		{
+			PxU32 r = PacketBVHLowestBit(mask);
+			gPacketBVHStats.rayNodeTests++;
+
+			__m256 tx0 = _mm256_mul_ps(_mm256_sub_ps(minX, ox[r]), ix[r]), tx1 = _mm256_mul_ps(_mm256_sub_ps(maxX, ox[r]), ix[r]);
+			__m256 ty0 = _mm256_mul_ps(_mm256_sub_ps(minY, oy[r]), iy[r]), ty1 = _mm256_mul_ps(_mm256_sub_ps(maxY, oy[r]), iy[r]);
+			__m256 tz0 = _mm256_mul_ps(_mm256_sub_ps(minZ, oz[r]), iz[r]), tz1 = _mm256_mul_ps(_mm256_sub_ps(maxZ, oz[r]), iz[r]);
+			__m256 tNear = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(tx0, tx1), _mm256_min_ps(ty0, ty1)), _mm256_max_ps(_mm256_min_ps(tz0, tz1), zero));
+			__m256 tFar	 = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(tx0, tx1), _mm256_max_ps(ty0, ty1)),
+				_mm256_min_ps(_mm256_max_ps(tz0, tz1), _mm256_set1_ps(packet.distances[r])));
+
+			PxU32 hits = PxU32(_mm256_movemask_ps(_mm256_cmp_ps(tFar, tNear, _CMP_GE_OQ))) & node.used;
+			for(PxU32 c=0; c<8; c++)
+				childRays[c] |= ((hits >> c) & 1u) << r;
+
+			if(firstRay && hits)
+			{
+				_mm256_store_ps(nearest, tNear);
+				firstRay = false;
+			}
+		}
+
+		PacketBVHVisitChildren(bvh, node, childRays, nearest, packet, stack, stackSize);
+	}
+}
+
+#endif
+
+
+//At most 'PACKET_BVH_MAX_PACKET' rays; 'distances' must hold each ray's length and gets its hit distance
+void RaycastPacketBVHPacket(const PacketBVH& bvh, const PxVec3* origins, const PxVec3* unitDirs, PxU32 count,
+	PxReal* distances, PxShape** shapes)
+{
+	PacketBVHPacket packet;
+	packet.origins	 = origins;
+	packet.unitDirs	 = unitDirs;
+	packet.distances = distances;
+	packet.shapes	 = shapes;
+	packet.count	 = count;
+	for(PxU32 r=0; r<count; r++)
+	{
+		packet.inverses[r] = PxVec3(PacketBVHInverse(unitDirs[r].x), PacketBVHInverse(unitDirs[r].y), PacketBVHInverse(unitDirs[r].z));
+
+		for(size_t p=0; p<bvh.planes.size(); p++)
+			PacketBVHTestShape(bvh.planes[p], origins[r], unitDirs[r], distances[r], shapes[r]);
+	}
+	gPacketBVHStats.rays += count;
+	gPacketBVHStats.packets++;
+
+	PX_COMPILE_TIME_ASSERT(PACKET_BVH_MAX_PACKET <= 32);
+	PacketBVHStackEntry root = { 0, count == 32 ? 0xffffffffu : (1u << count) - 1 };
+#if DEBUG_KERNELS_X86
+	if(bvh.width == 8)
+	{
+		if(!bvh.nodes8.empty())
+			TraversePacketBVH8(bvh, packet, root);
+		return;
+	}
+#endif
+	if(!bvh.nodes.empty())
+		TraversePacketBVH4(bvh, packet, root);
+}
+
+
+//Rays are grouped into packets in the given order, so coherent rays should be adjacent.
+//'distances' gets PX_MAX_F32 and 'shapes' NULL for misses.
+void PacketBVHRaycast(const PacketBVH& bvh, const PxVec3* origins, const PxVec3* unitDirs, PxU32 count, PxReal maxDistance,
+	PxU32 packetSize, PxReal* distances, PxShape** shapes)
+{
+	packetSize = PxClamp(packetSize, 1u, PACKET_BVH_MAX_PACKET);
+	for(PxU32 i=0; i<count; i++)
+	{
+		distances[i] = maxDistance;
+		shapes[i]	 = NULL;
+	}
+
+	for(PxU32 first=0; first<count; first+=packetSize)
+		RaycastPacketBVHPacket(bvh, origins + first, unitDirs + first, PxMin(packetSize, count - first), distances + first, shapes + first);
+
+	for(PxU32 i=0; i<count; i++)
+		if(!shapes[i])
+			distances[i] = PX_MAX_F32;
+}
+
+
+void PrintPacketBVHStats(const PacketBVH& bvh)
+{
+	const PacketBVHStats& s = gPacketBVHStats;
+	printf("packet bvh: %u-wide  %u shapes  %u planes  %u nodes  depth %u  built in %.3f ms\n", bvh.width,
+		PxU32(bvh.primitives.size()), PxU32(bvh.planes.size()), PxU32(bvh.width == 8 ? bvh.nodes8.size() : bvh.nodes.size()), bvh.depth, bvh.buildMs);
+	if(!s.rays)
+		return;
+
+	printf("packet bvh traversal: %.1f rays per packet  %.1f node visits per packet  %.1f node tests and %.1f shape tests per ray\n",
+		double(s.rays)/s.packets, double(s.nodeVisits)/s.packets, double(s.rayNodeTests)/s.rays, double(s.shapeTests)/s.rays);
+}
@@ -0,0 +1,364 @@
+/*
+=====================================================================
+
+File Name	  :	ParallelQuery.h
+
+Description	  : Runs batches of raycasts, sweeps and overlaps on several threads. Without it,
+				scene queries run one after another on the calling thread.
+
+				Requests are queued with 'ParallelQueryAddRaycast()', 'ParallelQueryAddSweep()'
+				and 'ParallelQueryAddOverlap()'. 'ParallelQueryExecute()' then submits
+				'threads - 1' tasks to the scene's own 'PxCpuDispatcher' and runs one
+				more share on the calling thread. The dispatcher is idle between steps, so
+				its workers are free for queries. Every task holds a 'PxSceneReadLock' and
+				claims 'chunkSize' requests at a time from a shared cursor, so fast threads
+				take more chunks.
+
+				The merge is deterministic. A request's closest hit is written to its own
+				slot, and its overlap touches go to its own fixed run of 'maxTouches'
+				hits. Once all tasks are done, the touch runs are compacted in request
+				order. The results are therefore the same for any thread count, and for any
+				split of the chunks between the threads.
+
+				Execute only while the scene is not being simulated. The read locks keep
+				out writers that take 'PxSceneWriteLock', but 'simulate()' does not take it.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include <cstdio>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+using namespace physx;
+
+
+enum ParallelQueryType
+{
+	ePARALLEL_RAYCAST,
+	ePARALLEL_SWEEP,
+	ePARALLEL_OVERLAP
+};
+
+
+struct ParallelQueryRequest
+{
+	ParallelQueryType	type;
+	PxGeometryHolder	geometry;	//Sweeps and overlaps
+	PxTransform			pose;		//Ray origin in 'pose.p', sweep start or overlap pose
+	PxVec3				unitDir;	//Raycasts and sweeps
+	PxReal				distance;	//Raycasts and sweeps
+};
+
+
+//Closest blocking hit of a raycast or sweep; actor is NULL for misses and for overlaps
+struct ParallelQueryHit
+{
+	PxRigidActor*	actor;
+	PxShape*		shape;
+	PxReal			distance;
+	PxVec3			position;
+	PxVec3			normal;
+};
+
+
+struct ParallelQueryResults
+{
+	vector<ParallelQueryHit>	closest;		//Per request
+	vector<PxU32>				touchFirst;		//Per request, first of its overlap hits in 'touches'
+	vector<PxU32>				touchCount;		//Per request, 0 for raycasts and sweeps
+	vector<PxOverlapHit>		touches;		//Overlap hits of all requests, in request order
+};
+
+
+struct ParallelQueryStats
+{
+	PxU64	requests;
+	PxU64	executes;
+	PxU64	overflows;		//Overlaps that filled all 'maxTouches' slots, further touches are dropped
+	double	executeMs;		//Time in 'ParallelQueryExecute()'
+};
+
+
+class ParallelQueryTask : public PxBaseTask
+{
+public:
+	virtual void run();
+	virtual const char* getName() const { return "ParallelQueryTask"; }
+	virtual void addReference() {}
+	virtual void removeReference() {}
+	virtual int32_t getReference() const { return 1; }
+	virtual void release();
+};
+
+
+struct ParallelQuery
+{
+	PxScene*						scene;
+	PxU32							threads;		//Including the calling thread
+	PxU32							chunkSize;		//Requests claimed by a task at a time
+	PxU32							maxTouches;		//Overlap hits kept per request
+	PxHitFlags						hitFlags;
+
+	vector<ParallelQueryRequest>	requests;
+	ParallelQueryResults			results;
+	vector<PxOverlapHit>			touchSlots;		//'maxTouches' per request, filled by the tasks
+	vector<PxU8>					overflowed;		//Per request, the overlap filled its slots
+
+	vector<ParallelQueryTask>		tasks;			//'threads - 1', run by the dispatcher's workers
+	atomic<PxU32>					nextRequest;	//First request not yet claimed
+	atomic<PxU32>					pendingTasks;	//Submitted tasks not yet released
+};
+
+
+const PxU32 PARALLEL_QUERY_DEFAULT_CHUNK   = 64;
+const PxU32 PARALLEL_QUERY_DEFAULT_TOUCHES = 32;
+
+ParallelQuery		gParallelQuery;
+ParallelQueryStats	gParallelQueryStats = { 0, 0, 0, 0.0 };
+
+
+void ParallelQueryInit(PxScene& scene, PxU32 threads, PxU32 chunkSize = PARALLEL_QUERY_DEFAULT_CHUNK, PxU32 maxTouches = PARALLEL_QUERY_DEFAULT_TOUCHES);
+void ParallelQuerySetThreads(PxU32 threads);
+PxU32 ParallelQueryAddRaycast(const PxVec3& origin, const PxVec3& unitDir, PxReal distance);
+PxU32 ParallelQueryAddSweep(const PxGeometry& geometry, const PxTransform& pose, const PxVec3& unitDir, PxReal distance);
+PxU32 ParallelQueryAddOverlap(const PxGeometry& geometry, const PxTransform& pose);
+void ParallelQueryExecute();
+void ParallelQueryClear();
+void ParallelQueryRelease();
+void PrintParallelQueryStats();
+
+
+
+//'threads' is clamped to the dispatcher's workers plus the calling thread
+void ParallelQueryInit(PxScene& scene, PxU32 threads, PxU32 chunkSize, PxU32 maxTouches)
+{
+	ParallelQuery& q = gParallelQuery;
+	q.scene		 = &scene;
+	q.chunkSize	 = PxMax(1u, chunkSize);
+	q.maxTouches = PxMax(1u, maxTouches);
+	q.hitFlags	 = PxHitFlag::ePOSITION | PxHitFlag::eNORMAL | PxHitFlag::eDISTANCE;
+	ParallelQuerySetThreads(threads);
+	ParallelQueryClear();
+}
+
+
+void ParallelQuerySetThreads(PxU32 threads)
+{
+	ParallelQuery& q = gParallelQuery;
+	PxCpuDispatcher* dispatcher = q.scene->getCpuDispatcher();
+	PxU32 workers = dispatcher ? dispatcher->getWorkerCount() : 0;
+	q.threads = PxClamp(threads, 1u, workers + 1);
+	q.tasks.resize(q.threads - 1);
+}
+
+
+PxU32 AddParallelQueryRequest(ParallelQueryType type, const PxGeometry* geometry, const PxTransform& pose, const PxVec3& unitDir, PxReal distance)
+{
+	ParallelQuery& q = gParallelQuery;
+	ParallelQueryRequest request;
+	request.type = type;
+	if(geometry)
+		request.geometry.storeAny(*geometry);
+	request.pose	 = pose;
+	request.unitDir	 = unitDir;
+	request.distance = distance;
+	q.requests.push_back(request);
+	return PxU32(q.requests.size() - 1);
+}
+
+
+//These return the index of the request's results
+PxU32 ParallelQueryAddRaycast(const PxVec3& origin, const PxVec3& unitDir, PxReal distance)
+{
+	return AddParallelQueryRequest(ePARALLEL_RAYCAST, NULL, PxTransform(origin), unitDir, distance);
+}
+
+
+PxU32 ParallelQueryAddSweep(const PxGeometry& geometry, const PxTransform& pose, const PxVec3& unitDir, PxReal distance)
+{
+	return AddParallelQueryRequest(ePARALLEL_SWEEP, &geometry, pose, unitDir, distance);
+}
+
+
+PxU32 ParallelQueryAddOverlap(const PxGeometry& geometry, const PxTransform& pose)
+{
+	return AddParallelQueryRequest(ePARALLEL_OVERLAP, &geometry, pose, PxVec3(0.0f), 0.0f);
+}
+
+
+template<class HitType>
+void StoreClosestHit(const PxHitBuffer<HitType>& buffer, ParallelQueryHit& hit)
+{
+	if(buffer.hasBlock)
+	{
+		hit.actor	 = buffer.block.actor;
+		hit.shape	 = buffer.block.shape;
+		hit.distance = buffer.block.distance;
+		hit.position = buffer.block.position;
+		hit.normal	 = buffer.block.normal;
+	}
+	else
+	{
+		hit.actor	 = NULL;
+		hit.shape	 = NULL;
+		hit.distance = PX_MAX_F32;
+		hit.position = hit.normal = PxVec3(0.0f);
+	}
+}
+
+
+//Writes only to the slots of request 'i', so any thread may run it
+void RunParallelQueryRequest(PxU32 i)
+{
+	ParallelQuery& q = gParallelQuery;
+	const ParallelQueryRequest& request = q.requests[i];
+	ParallelQueryHit& closest = q.results.closest[i];
+
+	switch(request.type)
+	{
+	case ePARALLEL_RAYCAST:
+		{
+			PxRaycastBuffer buffer;
+			q.scene->raycast(request.pose.p, request.unitDir, request.distance, buffer, q.hitFlags);
+			StoreClosestHit(buffer, closest);
+			q.results.touchCount[i] = 0;
+		}
+		break;
+
+	case ePARALLEL_SWEEP:
+		{
+			PxSweepBuffer buffer;
+			q.scene->sweep(request.geometry.any(), request.pose, request.unitDir, request.distance, buffer, q.hitFlags);
+			StoreClosestHit(buffer, closest);
+			q.results.touchCount[i] = 0;
+		}
+		break;
+
+	case ePARALLEL_OVERLAP:
+		{
+			//Every shape touches, so all of them land in the request's own run of slots
+			PxOverlapBuffer buffer(&q.touchSlots[size_t(i)*q.maxTouches], q.maxTouches);
+			PxQueryFilterData filter(PxQueryFlag::eSTATIC | PxQueryFlag::eDYNAMIC | PxQueryFlag::eNO_BLOCK);
+			q.scene->overlap(request.geometry.any(), request.pose, buffer, filter);
+			closest.actor	 = NULL;
+			closest.shape	 = NULL;
+			closest.distance = PX_MAX_F32;
+			q.results.touchCount[i] = buffer.nbTouches;
+			q.overflowed[i] = buffer.nbTouches == q.maxTouches;
+		}
+		break;
+	}
+}
+
+
+//Claims chunks of requests until none are left
+void RunParallelQueryChunks()
+{
+	ParallelQuery& q = gParallelQuery;
+	PxU32 count = PxU32(q.requests.size());
+	PxSceneReadLock lock(*q.scene, __FILE__, __LINE__);
+
+	for(;;)
+	{
+		PxU32 first = q.nextRequest.fetch_add(q.chunkSize);
+		if(first >= count)
+			break;
+		PxU32 end = PxMin(first + q.chunkSize, count);
+		for(PxU32 i=first; i<end; i++)
+			RunParallelQueryRequest(i);
+	}
+}
+
+
+void ParallelQueryTask::run()
+{
+	RunParallelQueryChunks();
+}
+
+
+void ParallelQueryTask::release()
+{
+	gParallelQuery.pendingTasks.fetch_sub(1);
+}
+
+
+void ParallelQueryExecute()
+{
+	ParallelQuery& q = gParallelQuery;
+	ParallelQueryResults& out = q.results;
+	PxU32 count = PxU32(q.requests.size());
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	out.closest.resize(count);
+	out.touchFirst.resize(count);
+	out.touchCount.resize(count);
+	if(q.touchSlots.size() < size_t(count)*q.maxTouches)
+		q.touchSlots.resize(size_t(count)*q.maxTouches);
+	q.overflowed.assign(count, 0);
+
+	//Pending tree updates are applied by the first query, do it here instead of racing for it in the tasks
+	q.scene->flushQueryUpdates();
+
+	q.nextRequest = 0;
+	q.pendingTasks = PxU32(q.tasks.size());
+	for(size_t i=0; i<q.tasks.size(); i++)
+		q.scene->getCpuDispatcher()->submitTask(q.tasks[i]);
+	RunParallelQueryChunks();
+	while(q.pendingTasks.load() > 0)
+		this_thread::yield();
+
+	//Merge: compact the touch runs in request order
+	PxU32 touches = 0;
+	for(PxU32 i=0; i<count; i++)
+	{
+		out.touchFirst[i] = touches;
+		touches += out.touchCount[i];
+		gParallelQueryStats.overflows += q.overflowed[i];
+	}
+	out.touches.resize(touches);
+	for(PxU32 i=0; i<count; i++)
+	{
+		const PxOverlapHit* run = &q.touchSlots[size_t(i)*q.maxTouches];
+		for(PxU32 j=0; j<out.touchCount[i]; j++)
+			out.touches[out.touchFirst[i] + j] = run[j];
+	}
+
+	gParallelQueryStats.requests  += count;
+	gParallelQueryStats.executes++;
+	gParallelQueryStats.executeMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+
+//Drops the requests, keeping the memory
+void ParallelQueryClear()
+{
+	gParallelQuery.requests.clear();
+}
+
+
+void ParallelQueryRelease()
+{
+	ParallelQuery& q = gParallelQuery;
+	ParallelQueryClear();
+	q.tasks.clear();
+	q.scene = NULL;
+}
+
+
+void PrintParallelQueryStats()
+{
+	const ParallelQueryStats& s = gParallelQueryStats;
+	if(!s.executes)
+		return;
+
+	printf("parallel query: %llu requests in %llu batches on %u threads  %.3f ms  %.2f Mqueries/s  %llu full overlaps\n",
+		(unsigned long long)s.requests, (unsigned long long)s.executes, gParallelQuery.threads, s.executeMs,
+		s.executeMs > 0.0 ? s.requests/(s.executeMs*1000.0) : 0.0, (unsigned long long)s.overflows);
+}
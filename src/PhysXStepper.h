@@ -0,0 +1,270 @@
+/*
+=====================================================================
+
+File Name	  :	PhysXStepper.h
+
+Description	  : Stepping strategies shared by the demos. 'StepPhysX()' of every chapter
+				calls 'StepperStep()', the strategy is picked on the command line:
+
+				  (default)     Blocking: 'simulate()' is followed by 'fetchResults(true)',
+				                the main thread idles while the workers simulate.
+				  --pipelined   'simulate()' for step N+1 is kicked and returns at once; the
+				                frame is rendered from the results of step N while the workers
+				                run, and step N+1 is collected by the next 'StepperStep()' or
+				                as soon as 'StepperPoll()' finds it complete.
+
+				In pipelined mode the scene is simulating while the frame renders. PhysX
+				double buffers the API for this: reads return the state of the last fetched
+				step and writes are buffered until 'fetchResults()'. The render buffer is not
+				buffered, so it is copied when a step completes and must be read through
+				'StepperRenderBuffer()'. Per-step scene changes belong in the 'preStep'
+				callback, which runs between fetching a step and kicking the next one.
+
+				Orthogonal to the strategy, each step can be split and subdivided:
+
+				  --split       'collide()' + 'fetchCollision()' + 'advance()' instead of
+				                'simulate()'. The 'midStep' callback runs between the collision
+				                phase (broadphase, narrowphase) and the solver phase.
+				  --substeps N  Every 'StepperStep(dt)' runs N simulation steps of dt/N, for
+				                stiff joint chains. All but the last are blocking; in pipelined
+				                mode the last one overlaps rendering as before.
+
+				'gStepperStats' separates the time the main thread spends blocked on the
+				simulation from the time the simulation ran hidden behind other work, and
+				with --split the time of the collision phase from that of the solver.
+
+				Each completed step feeds its active actors to 'ActiveActorSync.h' and
+				closes a step of the awake set counters of 'SimulationEvents.h'.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "CommandLine.h"		//HasArgument(), GetIntArgument()
+#include "RenderBuffer.h"		//DebugRenderBuffer
+#include "ActiveActorSync.h"	//ActiveActorSyncUpdate()
+#include "SimulationEvents.h"	//AwakeSetStepCompleted()
+#include "RaycastCache.h"		//RaycastCacheUpdate()
+#include <cstdio>
+#include <chrono>
+
+using namespace std;
+using namespace physx;
+
+
+enum SteppingMode
+{
+	eSTEP_BLOCKING,		//simulate() + fetchResults(true)
+	eSTEP_PIPELINED		//simulate() now, fetchResults() on the next step
+};
+
+
+struct StepperStats
+{
+	PxU64	steps;			//Completed steps
+	PxU64	readyOnFetch;	//Steps that were already complete when fetched, i.e. fully hidden
+	double	simulateMs;		//Main thread time inside 'simulate()'
+	double	waitMs;			//Main thread time blocked in 'fetchResults(true)'
+	double	inFlightMs;		//Wall time from 'simulate()' until the results were fetched
+	double	collisionMs;	//--split: wall time from 'collide()' until 'fetchCollision()' returned
+	double	midStepMs;		//--split: time in the 'midStep' callback
+};
+
+
+struct PhysXStepper
+{
+	PxScene*			scene;
+	SteppingMode		mode;
+	void				(*preStep)(PxReal);	//Called before each 'simulate()', while the scene is not simulating
+	void				(*midStep)(PxReal);	//--split: called between 'fetchCollision()' and 'advance()'
+	PxU32				substeps;			//Simulation steps per 'StepperStep()'
+	bool				split;				//collide()/advance() instead of simulate()
+	bool				inFlight;			//'simulate()' was called and the results are not fetched yet
+	double				kickMs;				//'StepperClockMs()' of the last 'simulate()'
+	DebugRenderBuffer	debug;				//Render buffer of the last completed step, pipelined mode only
+};
+
+
+PhysXStepper	gStepper	  = { NULL, eSTEP_BLOCKING, NULL, NULL, 1, false, false, 0.0 };
+StepperStats	gStepperStats = { 0, 0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+
+
+double StepperClockMs();
+SteppingMode ParseSteppingMode(int argc, char** argv);
+void StepperInit(PxScene* scene, SteppingMode mode, void (*preStep)(PxReal) = NULL);
+void StepperSetSubstepping(int argc, char** argv, void (*midStep)(PxReal) = NULL);
+void StepperStep(PxReal dt);
+bool StepperPoll();
+void StepperFinish();
+const PxRenderBuffer& StepperRenderBuffer();
+void PrintStepperStats();
+
+
+
+double StepperClockMs()
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+SteppingMode ParseSteppingMode(int argc, char** argv)
+{
+	return HasArgument(argc, argv, "--pipelined") ? eSTEP_PIPELINED : eSTEP_BLOCKING;
+}
+
+
+void StepperInit(PxScene* scene, SteppingMode mode, void (*preStep)(PxReal))
+{
+	gStepper.scene	  = scene;
+	gStepper.mode	  = mode;
+	gStepper.preStep  = preStep;
+	gStepper.midStep  = NULL;
+	gStepper.substeps = 1;
+	gStepper.split	  = false;
+	gStepper.inFlight = false;
+	gStepper.debug.clear();
+}
+
+
+//--split and --substeps N, call after 'StepperInit()'
+void StepperSetSubstepping(int argc, char** argv, void (*midStep)(PxReal))
+{
+	gStepper.midStep  = midStep;
+	gStepper.substeps = PxU32(PxMax(1, GetIntArgument(argc, argv, "--substeps", 1)));
+	gStepper.split	  = HasArgument(argc, argv, "--split");
+}
+
+
+//Bookkeeping once the results of the step in flight have been fetched
+void StepperCompleteStep(double waitMs)
+{
+	gStepper.inFlight = false;
+
+	gStepperStats.steps++;
+	gStepperStats.waitMs	 += waitMs;
+	gStepperStats.inFlightMs += StepperClockMs() - gStepper.kickMs;
+
+	//Poses of the actors that moved in this step, for the renderer
+	if(gActiveActorSync.enabled)
+		ActiveActorSyncUpdate(*gStepper.scene);
+	AwakeSetStepCompleted();	//Awake and asleep body counters
+	if(gRaycastCache.enabled)
+		RaycastCacheUpdate(*gStepper.scene);	//Drop cached rays crossed by moving actors
+
+	//The next 'simulate()' invalidates the scene's render buffer while the frame still needs it
+	if(gStepper.mode == eSTEP_PIPELINED)
+	{
+		gStepper.debug.clear();
+		if(gStepper.scene->getVisualizationParameter(PxVisualizationParameter::eSCALE) > 0.0f)
+			gStepper.debug.append(gStepper.scene->getRenderBuffer());
+	}
+}
+
+
+void StepperKick(PxReal dt)
+{
+	if(gStepper.preStep)
+		gStepper.preStep(dt);
+
+	if(gStepper.split)
+	{
+		double start = StepperClockMs();
+		gStepper.scene->collide(dt);			//Broadphase and narrowphase only
+		gStepper.scene->fetchCollision(true);	//Block until the collision phase is completed
+		double collided = StepperClockMs();
+
+		if(gStepper.midStep)
+			gStepper.midStep(dt);
+
+		gStepperStats.collisionMs += collided - start;
+		gStepperStats.midStepMs	  += StepperClockMs() - collided;
+	}
+
+	gStepper.kickMs = StepperClockMs();
+	if(gStepper.split)
+		gStepper.scene->advance();		//Solver and integration over the 'dt' given to collide()
+	else
+		gStepper.scene->simulate(dt);	//Advances the simulation by 'dt' time
+	gStepperStats.simulateMs += StepperClockMs() - gStepper.kickMs;
+	gStepper.inFlight = true;
+}
+
+
+//Replaces 'simulate()' + 'fetchResults(true)'. In pipelined mode it collects the previous step
+//and returns while the new one is still running.
+void StepperStep(PxReal dt)
+{
+	PxReal substep = dt/gStepper.substeps;
+	for(PxU32 i=0; i<gStepper.substeps; i++)
+	{
+		StepperFinish();
+		StepperKick(substep);
+	}
+
+	if(gStepper.mode == eSTEP_BLOCKING)
+		StepperFinish();
+}
+
+
+//Fetches the step in flight if it is complete, without blocking. Call it from the idle callback.
+bool StepperPoll()
+{
+	if(!gStepper.inFlight || !gStepper.scene->checkResults(false))
+		return false;
+
+	gStepper.scene->fetchResults(true);	//Returns at once, the results are ready
+	gStepperStats.readyOnFetch++;
+	StepperCompleteStep(0.0);
+	return true;
+}
+
+
+//Blocks until the step in flight, if any, is fetched. The scene may be modified freely afterwards.
+void StepperFinish()
+{
+	if(!gStepper.inFlight)
+		return;
+
+	if(StepperPoll())
+		return;
+
+	double start = StepperClockMs();
+	gStepper.scene->fetchResults(true);	//Block until the simulation run is completed
+	StepperCompleteStep(StepperClockMs() - start);
+}
+
+
+//Debug render data of the last completed step
+const PxRenderBuffer& StepperRenderBuffer()
+{
+	if(gStepper.mode == eSTEP_PIPELINED)
+		return gStepper.debug;
+
+	return gStepper.scene->getRenderBuffer();
+}
+
+
+void PrintStepperStats()
+{
+	const StepperStats& s = gStepperStats;
+	if(!s.steps)
+		return;
+
+	double hiddenMs = s.inFlightMs - s.waitMs;
+	printf("stepping: %s  steps: %llu  simulate(): %.3f ms  in flight: %.3f ms  waited: %.3f ms  hidden: %.3f ms (%.0f%%)  ready on fetch: %llu\n",
+		gStepper.mode == eSTEP_PIPELINED ? "pipelined" : "blocking", (unsigned long long)s.steps,
+		s.simulateMs/s.steps, s.inFlightMs/s.steps, s.waitMs/s.steps, hiddenMs/s.steps,
+		s.inFlightMs > 0.0 ? 100.0*hiddenMs/s.inFlightMs : 0.0, (unsigned long long)s.readyOnFetch);
+
+	//Per simulation step; a frame step costs 'substeps' times as much
+	if(gStepper.split || gStepper.substeps > 1)
+		printf("substeps: %u  split: %s  collision: %.3f ms  mid-step: %.3f ms  %s: %.3f ms  per step: %.3f ms\n",
+			gStepper.substeps, gStepper.split ? "yes" : "no", s.collisionMs/s.steps, s.midStepMs/s.steps,
+			gStepper.split ? "solver" : "simulate", s.inFlightMs/s.steps,
+			(s.collisionMs + s.midStepMs + s.inFlightMs)/s.steps);
+
+	PrintActiveActorSyncStats();
+	PrintAwakeSetStats();
+}
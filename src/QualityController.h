@@ -0,0 +1,369 @@
+/*
+=====================================================================
+
+File Name	  :	QualityController.h
+
+Description	  : Trades simulation quality for step time when a step runs over its budget.
+
+				The controller keeps a moving average of the measured step time. When it
+				stays above 'budgetMs', one knob is lowered by one notch. When it stays well
+				below the budget for a while, the knob lowered last is raised again. Every
+				change is logged with the step time that caused it.
+
+				Knobs, lowered in this order and raised in the reverse order:
+				  visualization      Debug visualization parameters, full or off
+				  particles          Share of each particle system's particles kept alive,
+				                     in quarters; the removed ones are respawned later
+				  cloth frequency    'PxCloth::setSolverFrequency()', in steps of 60 Hz
+				  solver iterations  Position iterations of every rigid dynamic, one at a time
+
+				Each knob's maximum is the scene's setting at 'QualityControllerInit()', and
+				a knob whose maximum is at or below its minimum is never touched.
+
+				Command line options (parsed by 'ParseQualityOptions()'):
+				  --adaptive-quality         Enable the controller
+				  --step-budget MS           Target time of one simulation step (default 4 ms)
+				  --min-iterations N         Lowest position iteration count (default 1)
+				  --min-cloth-frequency HZ   Lowest cloth solver frequency (default 60)
+				  --min-particles F          Lowest share of particles kept, 0..1 (default 0.25)
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "CommandLine.h"		//HasArgument(), GetFloatArgument()
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+using namespace physx;
+
+
+struct QualityOptions
+{
+	bool	enabled;
+	double	budgetMs;				//Target time of one step
+	PxU32	minIterations;
+	PxReal	minClothFrequency;
+	PxReal	minParticleFraction;
+};
+
+
+struct QualityKnob
+{
+	const char*	name;
+	PxReal		value;
+	PxReal		minValue;
+	PxReal		maxValue;
+	PxReal		notch;				//Change per adjustment
+	void		(*apply)(PxReal value);
+};
+
+
+//Particles of one particle system as created, so that removed ones can be respawned
+struct QualityParticles
+{
+	PxParticleSystem*	system;
+	vector<PxVec3>		spawnPositions;		//By particle index
+	PxU32				alive;				//Particles 0 .. alive-1 exist
+};
+
+
+struct QualityController
+{
+	QualityOptions				options;
+	vector<QualityKnob>			knobs;			//In the order they are lowered
+	double						averageStepMs;	//Exponential moving average
+	PxU32						cooldownFrames;	//Frames left before the next adjustment
+	PxU32						underBudgetFrames;
+	PxU32						adjustments;
+	int							lastDirection;	//Of the latest adjustment
+	int							pending;		//Answer of the latest evaluation, not applied yet
+
+	PxScene*					scene;
+	vector<PxRigidDynamic*>		bodies;
+	vector<PxU32>				positionIterations;	//Of 'bodies' at init
+	vector<PxU32>				velocityIterations;
+	vector<PxCloth*>			cloths;
+	vector<QualityParticles>	particles;
+	vector<PxReal>				visualization;		//Parameters at init, by 'PxVisualizationParameter'
+};
+
+
+const PxReal QUALITY_AVERAGE_WEIGHT			 = 0.1f;	//Weight of the newest step time in the average
+const PxU32	 QUALITY_COOLDOWN_FRAMES		 = 30;		//Frames for an adjustment to show in the average
+const PxU32	 QUALITY_RECOVER_FRAMES			 = 120;		//Frames well under budget before quality is raised
+const PxReal QUALITY_CLOTH_FREQUENCY_NOTCH	 = 60.0f;
+const PxReal QUALITY_PARTICLE_FRACTION_NOTCH = 0.25f;
+
+QualityOptions		gQualityOptions = { false, 4.0, 1, 60.0f, 0.25f };
+QualityController	gQuality;
+
+
+void ParseQualityOptions(int argc, char** argv);
+void QualityControllerInit(PxScene& scene);
+int QualityControllerEvaluate(double stepMs);
+void QualityControllerAdjust(int direction);
+bool QualityControllerLowering();
+void PrintQualityStats();
+
+
+
+void ParseQualityOptions(int argc, char** argv)
+{
+	gQualityOptions.enabled				= HasArgument(argc, argv, "--adaptive-quality");
+	gQualityOptions.budgetMs			= GetFloatArgument(argc, argv, "--step-budget", 4.0f);
+	gQualityOptions.minIterations		= PxU32(PxMax(1, GetIntArgument(argc, argv, "--min-iterations", 1)));
+	gQualityOptions.minClothFrequency	= GetFloatArgument(argc, argv, "--min-cloth-frequency", 60.0f);
+	gQualityOptions.minParticleFraction	= PxClamp(GetFloatArgument(argc, argv, "--min-particles", 0.25f), 0.0f, 1.0f);
+}
+
+
+
+//-----------Knobs------------//
+
+void ApplyVisualization(PxReal value)
+{
+	for(PxU32 i=PxVisualizationParameter::eSCALE+1; i<gQuality.visualization.size(); i++)
+		gQuality.scene->setVisualizationParameter(PxVisualizationParameter::Enum(i), gQuality.visualization[i]*value);
+}
+
+
+//Keeps the first 'value' share of each system's particles, respawning missing ones where they started
+void ApplyParticleFraction(PxReal value)
+{
+	for(size_t i=0; i<gQuality.particles.size(); i++)
+	{
+		QualityParticles& p = gQuality.particles[i];
+		PxU32 target = PxU32(value*p.spawnPositions.size() + 0.5f);
+		if(target == p.alive)
+			continue;
+
+		vector<PxU32> indices;
+		for(PxU32 j=PxMin(target, p.alive); j<PxMax(target, p.alive); j++)
+			indices.push_back(j);
+
+		if(target < p.alive)
+		{
+			p.system->releaseParticles(PxU32(indices.size()), PxStrideIterator<const PxU32>(&indices[0]));
+		}
+		else
+		{
+			PxParticleCreationData creationData;
+			creationData.numParticles	= PxU32(indices.size());
+			creationData.indexBuffer	= PxStrideIterator<const PxU32>(&indices[0]);
+			creationData.positionBuffer = PxStrideIterator<const PxVec3>(&p.spawnPositions[indices[0]]);
+			p.system->createParticles(creationData);
+		}
+		p.alive = target;
+	}
+}
+
+
+void ApplyClothFrequency(PxReal value)
+{
+	for(size_t i=0; i<gQuality.cloths.size(); i++)
+		gQuality.cloths[i]->setSolverFrequency(value);
+}
+
+
+//Caps every body's position iterations at 'value', never above its own setting
+void ApplySolverIterations(PxReal value)
+{
+	for(size_t i=0; i<gQuality.bodies.size(); i++)
+		gQuality.bodies[i]->setSolverIterationCounts(PxMin(PxU32(value), gQuality.positionIterations[i]), gQuality.velocityIterations[i]);
+}
+
+
+void AddQualityKnob(const char* name, PxReal maxValue, PxReal minValue, PxReal notch, void (*apply)(PxReal))
+{
+	if(maxValue <= minValue)
+		return;
+
+	QualityKnob knob = { name, maxValue, minValue, maxValue, notch, apply };
+	gQuality.knobs.push_back(knob);
+}
+
+
+
+//-----------Controller------------//
+
+//Records the scene's current settings as the upper bounds. Call once the actors are created.
+void QualityControllerInit(PxScene& scene)
+{
+	QualityController& q = gQuality;
+	q.options			= gQualityOptions;
+	q.scene				= &scene;
+	q.knobs.clear();
+	q.averageStepMs		= 0.0;
+	q.cooldownFrames	= QUALITY_COOLDOWN_FRAMES;
+	q.underBudgetFrames = 0;
+	q.adjustments		= 0;
+	q.lastDirection		= 0;
+	q.pending			= 0;
+	if(!q.options.enabled)
+		return;
+
+	//Visualization
+	q.visualization.resize(PxVisualizationParameter::eNUM_VALUES);
+	bool visualizing = false;
+	for(PxU32 i=0; i<q.visualization.size(); i++)
+	{
+		q.visualization[i] = scene.getVisualizationParameter(PxVisualizationParameter::Enum(i));
+		visualizing |= i != PxVisualizationParameter::eSCALE && q.visualization[i] > 0.0f;
+	}
+	AddQualityKnob("visualization", visualizing ? 1.0f : 0.0f, 0.0f, 1.0f, ApplyVisualization);
+
+	//Particles
+	vector<PxActor*> actors(scene.getNbActors(PxActorTypeFlag::ePARTICLE_SYSTEM));
+	if(!actors.empty())
+		scene.getActors(PxActorTypeFlag::ePARTICLE_SYSTEM, &actors[0], PxU32(actors.size()));
+	q.particles.clear();
+	for(size_t i=0; i<actors.size(); i++)
+	{
+		QualityParticles p;
+		p.system = static_cast<PxParticleSystem*>(actors[i]);
+		p.alive	 = 0;
+
+		PxParticleReadData* readData = p.system->lockParticleReadData(PxDataAccessFlag::eREADABLE);
+		if(readData)
+		{
+			//Indices are dense from 0, as the demos create them
+			p.spawnPositions.resize(readData->validParticleRange);
+			PxStrideIterator<const PxVec3> position(readData->positionBuffer);
+			for(PxU32 j=0; j<readData->validParticleRange; j++, ++position)
+				p.spawnPositions[j] = *position;
+			p.alive = readData->validParticleRange;
+			readData->unlock();
+		}
+		if(p.alive)
+			q.particles.push_back(p);
+	}
+	AddQualityKnob("particles", q.particles.empty() ? 0.0f : 1.0f, q.options.minParticleFraction, QUALITY_PARTICLE_FRACTION_NOTCH, ApplyParticleFraction);
+
+	//Cloth
+	actors.resize(scene.getNbActors(PxActorTypeFlag::eCLOTH));
+	if(!actors.empty())
+		scene.getActors(PxActorTypeFlag::eCLOTH, &actors[0], PxU32(actors.size()));
+	q.cloths.clear();
+	PxReal clothFrequency = 0.0f;
+	for(size_t i=0; i<actors.size(); i++)
+	{
+		q.cloths.push_back(static_cast<PxCloth*>(actors[i]));
+		clothFrequency = PxMax(clothFrequency, q.cloths.back()->getSolverFrequency());
+	}
+	AddQualityKnob("cloth frequency", clothFrequency, q.options.minClothFrequency, QUALITY_CLOTH_FREQUENCY_NOTCH, ApplyClothFrequency);
+
+	//Solver iterations
+	actors.resize(scene.getNbActors(PxActorTypeFlag::eRIGID_DYNAMIC));
+	if(!actors.empty())
+		scene.getActors(PxActorTypeFlag::eRIGID_DYNAMIC, &actors[0], PxU32(actors.size()));
+	q.bodies.clear();
+	q.positionIterations.clear();
+	q.velocityIterations.clear();
+	PxU32 maxIterations = 0;
+	for(size_t i=0; i<actors.size(); i++)
+	{
+		PxU32 positionIterations, velocityIterations;
+		PxRigidDynamic* body = static_cast<PxRigidDynamic*>(actors[i]);
+		body->getSolverIterationCounts(positionIterations, velocityIterations);
+
+		q.bodies.push_back(body);
+		q.positionIterations.push_back(positionIterations);
+		q.velocityIterations.push_back(velocityIterations);
+		maxIterations = PxMax(maxIterations, positionIterations);
+	}
+	AddQualityKnob("solver iterations", PxReal(maxIterations), PxReal(q.options.minIterations), 1.0f, ApplySolverIterations);
+
+	printf("Adaptive quality: step budget %.2f ms, %u knobs\n", q.options.budgetMs, PxU32(q.knobs.size()));
+}
+
+
+//Feeds the average step time of a frame. Returns -1 to lower quality, 1 to raise it, 0 to keep it.
+//Apply the answer with 'QualityControllerAdjust()' while the scene is not simulating. Callers that
+//record their runs keep it in 'pending' until the next frame, so that a replay can substitute it.
+int QualityControllerEvaluate(double stepMs)
+{
+	QualityController& q = gQuality;
+	if(!q.options.enabled || q.knobs.empty())
+		return 0;
+
+	q.averageStepMs = q.averageStepMs > 0.0 ? q.averageStepMs + QUALITY_AVERAGE_WEIGHT*(stepMs - q.averageStepMs) : stepMs;
+	if(q.cooldownFrames)
+	{
+		q.cooldownFrames--;
+		return 0;
+	}
+
+	if(q.averageStepMs > q.options.budgetMs)
+	{
+		q.underBudgetFrames = 0;
+		for(size_t i=0; i<q.knobs.size(); i++)
+			if(q.knobs[i].value > q.knobs[i].minValue)
+				return -1;
+		return 0;
+	}
+
+	if(q.averageStepMs < 0.5*q.options.budgetMs && ++q.underBudgetFrames >= QUALITY_RECOVER_FRAMES)
+	{
+		q.underBudgetFrames = 0;
+		for(size_t i=0; i<q.knobs.size(); i++)
+			if(q.knobs[i].value < q.knobs[i].maxValue)
+				return 1;
+	}
+	return 0;
+}
+
+
+//Lowers the first knob above its minimum, or raises the last knob below its maximum, and logs it
+void QualityControllerAdjust(int direction)
+{
+	QualityController& q = gQuality;
+	QualityKnob* knob = NULL;
+	if(direction < 0)
+	{
+		for(size_t i=0; i<q.knobs.size() && !knob; i++)
+			if(q.knobs[i].value > q.knobs[i].minValue)
+				knob = &q.knobs[i];
+	}
+	else if(direction > 0)
+	{
+		for(size_t i=q.knobs.size(); i>0 && !knob; i--)
+			if(q.knobs[i-1].value < q.knobs[i-1].maxValue)
+				knob = &q.knobs[i-1];
+	}
+	if(!knob)
+		return;
+
+	PxReal previous = knob->value;
+	knob->value = PxClamp(knob->value + direction*knob->notch, knob->minValue, knob->maxValue);
+	knob->apply(knob->value);
+
+	q.adjustments++;
+	q.lastDirection	 = direction;
+	q.cooldownFrames = QUALITY_COOLDOWN_FRAMES;
+	printf("quality: %s %s %g -> %g (step %.2f ms, budget %.2f ms)\n", direction < 0 ? "lowered" : "raised",
+		knob->name, previous, knob->value, q.averageStepMs, q.options.budgetMs);
+}
+
+
+//A lowering is still settling: its cooldown has not run out, so the average does not show its effect yet
+bool QualityControllerLowering()
+{
+	const QualityController& q = gQuality;
+	return q.options.enabled && q.lastDirection < 0 && q.cooldownFrames > 0;
+}
+
+
+void PrintQualityStats()
+{
+	const QualityController& q = gQuality;
+	if(!q.options.enabled)
+		return;
+
+	printf("adaptive quality: %u adjustments  average step: %.2f ms  budget: %.2f ms\n", q.adjustments, q.averageStepMs, q.options.budgetMs);
+	for(size_t i=0; i<q.knobs.size(); i++)
+		printf("  %-18s %g (range %g .. %g)\n", q.knobs[i].name, q.knobs[i].value, q.knobs[i].minValue, q.knobs[i].maxValue);
+}
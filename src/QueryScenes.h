@@ -0,0 +1,261 @@
+/*
+=====================================================================
+
+File Name	  :	QueryScenes.h
+
+Description	  : Scenes and query sets for the scene query benchmarks.
+
+				'CreateQueryScene()' scatters static and dynamic actors of one shape kind,
+				or of all kinds mixed, through a cube of half size 'extent'. Dynamic actors
+				ignore gravity and start asleep, so the scene stays as built when stepped
+				until something wakes them. 'CreateQueryActors()' makes the same actors
+				without adding them to a scene. 'QuerySceneExtent()' sizes the cube for
+				a given shape density, and 'ParseQuerySceneOptions()' reads the options
+				that the benchmarks share.
+				'GenerateQueryRays()' makes rays from random points in that cube in
+				random directions. Everything is drawn from 'QueryRandom' with a fixed
+				seed, so every run and every method sees the same scene and the same rays.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "ChapterScenes.h"		//ChapterSceneDesc()
+#include "CommandLine.h"		//GetIntArgument(), GetStringArgument()
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <chrono>
+
+using namespace std;
+using namespace physx;
+
+
+enum QueryShapeMix
+{
+	eQUERY_SHAPES_BOXES,
+	eQUERY_SHAPES_SPHERES,
+	eQUERY_SHAPES_CAPSULES,
+	eQUERY_SHAPES_MIXED		//Boxes, spheres and capsules in turn
+};
+
+
+struct QuerySceneDesc
+{
+	PxU32			statics;
+	PxU32			dynamics;
+	QueryShapeMix	shapes;
+	PxReal			extent;		//Half size of the cube the actors are scattered in
+	PxU32			seed;
+};
+
+
+//Linear congruential generator; the benchmarks need the same numbers on every platform
+struct QueryRandom
+{
+	PxU32 state;
+
+	explicit QueryRandom(PxU32 seed) : state(seed ? seed : 1) {}
+
+	PxU32 next()
+	{
+		state = state*1664525u + 1013904223u;
+		return state;
+	}
+
+	//Uniform in [0, 1)
+	PxReal unit()
+	{
+		return PxReal(next() >> 8)*(1.0f/16777216.0f);
+	}
+
+	//Uniform in [-1, 1)
+	PxReal symmetric()
+	{
+		return 2.0f*unit() - 1.0f;
+	}
+
+	PxVec3 inCube(PxReal extent)
+	{
+		PxReal x = symmetric(), y = symmetric(), z = symmetric();
+		return PxVec3(x, y, z)*extent;
+	}
+
+	PxVec3 direction()
+	{
+		for(;;)
+		{
+			PxReal x = symmetric(), y = symmetric(), z = symmetric();
+			PxVec3 d(x, y, z);
+			PxReal m = d.magnitudeSquared();
+			if(m > 1e-4f && m <= 1.0f)
+				return d*(1.0f/PxSqrt(m));
+		}
+	}
+
+	PxQuat rotation()
+	{
+		PxReal x = symmetric(), y = symmetric(), z = symmetric(), w = symmetric();
+		PxQuat q(x, y, z, w);
+		return q.magnitudeSquared() > 1e-4f ? q.getNormalized() : PxQuat(PxIdentity);
+	}
+};
+
+
+//Rays as parallel arrays, as the query services consume them
+struct QueryRays
+{
+	vector<PxVec3>	origins;
+	vector<PxVec3>	directions;		//Unit length
+	PxReal			maxDistance;
+};
+
+
+const char* QueryShapeMixName(QueryShapeMix mix);
+bool ParseQueryShapeMix(const char* name, QueryShapeMix& mix);
+PxReal QuerySceneExtent(PxU32 count, PxReal density);
+bool ParseQuerySceneOptions(int argc, char** argv, PxU32 defaultStatics, QuerySceneDesc& desc);
+double QueryElapsedMs(chrono::steady_clock::time_point start);
+void CreateQueryActors(PxPhysics& physics, const QuerySceneDesc& desc, vector<PxRigidActor*>& actors);
+PxScene* CreateQueryScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, const QuerySceneDesc& desc);
+void GenerateQueryRays(const QuerySceneDesc& desc, PxU32 count, PxReal maxDistance, PxU32 seed, QueryRays& rays);
+
+
+
+const char* QueryShapeMixName(QueryShapeMix mix)
+{
+	switch(mix)
+	{
+	case eQUERY_SHAPES_BOXES:		return "boxes";
+	case eQUERY_SHAPES_SPHERES:		return "spheres";
+	case eQUERY_SHAPES_CAPSULES:	return "capsules";
+	default:						return "mixed";
+	}
+}
+
+
+bool ParseQueryShapeMix(const char* name, QueryShapeMix& mix)
+{
+	for(int i=eQUERY_SHAPES_BOXES; i<=eQUERY_SHAPES_MIXED; i++)
+	{
+		if(!strcmp(name, QueryShapeMixName(QueryShapeMix(i))))
+		{
+			mix = QueryShapeMix(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+
+//Half size of the cube that holds 'count' shapes at 'density' shapes per 8 cubic units, i.e. per 2x2x2 cell.
+//The cube's volume is (2*extent)^3 = 8*count/density.
+PxReal QuerySceneExtent(PxU32 count, PxReal density)
+{
+	return PxPow(PxReal(count)/density, 1.0f/3.0f);
+}
+
+
+//'--statics N' and '--shapes S'; no dynamics, one static shape per 8 cubic units, seed 1.
+//Returns false, after printing the accepted shape mixes, for an unknown one.
+bool ParseQuerySceneOptions(int argc, char** argv, PxU32 defaultStatics, QuerySceneDesc& desc)
+{
+	desc.statics  = PxU32(PxMax(1, GetIntArgument(argc, argv, "--statics", int(defaultStatics))));
+	desc.dynamics = 0;
+	desc.shapes	  = eQUERY_SHAPES_MIXED;
+	desc.extent	  = QuerySceneExtent(desc.statics, 1.0f);
+	desc.seed	  = 1;
+	if(ParseQueryShapeMix(GetStringArgument(argc, argv, "--shapes", "mixed"), desc.shapes))
+		return true;
+
+	fprintf(stderr, "Expected --shapes boxes|spheres|capsules|mixed\n");
+	return false;
+}
+
+
+//Milliseconds since 'start', for the benchmarks' timings
+double QueryElapsedMs(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+
+//Shape of actor 'i': sizes between 0.5 and 1.5, and so are the capsules' half heights
+PxShape* CreateQueryShape(PxPhysics& physics, PxMaterial& material, QueryShapeMix mix, PxU32 i, QueryRandom& random)
+{
+	QueryShapeMix kind = mix == eQUERY_SHAPES_MIXED ? QueryShapeMix(i % 3) : mix;
+	PxReal a = 0.5f + random.unit(), b = 0.5f + random.unit(), c = 0.5f + random.unit();
+
+	switch(kind)
+	{
+	case eQUERY_SHAPES_BOXES:	return physics.createShape(PxBoxGeometry(a, b, c), material, true);
+	case eQUERY_SHAPES_SPHERES:	return physics.createShape(PxSphereGeometry(a), material, true);
+	default:					return physics.createShape(PxCapsuleGeometry(0.5f*a, b), material, true);
+	}
+}
+
+
+//The actors of the scene described by 'desc', statics first, not yet in any scene
+void CreateQueryActors(PxPhysics& physics, const QuerySceneDesc& desc, vector<PxRigidActor*>& actors)
+{
+	PxMaterial* material = physics.createMaterial(0.5f,0.5f,0.1f);
+	QueryRandom random(desc.seed);
+
+	for(PxU32 i=0; i<desc.statics + desc.dynamics; i++)
+	{
+		PxVec3 position = random.inCube(desc.extent);	//Separate statements fix the order of the draws
+		PxTransform pose(position, random.rotation());
+		PxShape* shape = CreateQueryShape(physics, *material, desc.shapes, i, random);
+
+		if(i < desc.statics)
+		{
+			PxRigidStatic* actor = physics.createRigidStatic(pose);
+			actor->attachShape(*shape);
+			actors.push_back(actor);
+		}
+		else
+		{
+			PxRigidDynamic* actor = physics.createRigidDynamic(pose);
+			actor->attachShape(*shape);
+			actor->setActorFlag(PxActorFlag::eDISABLE_GRAVITY, true);	//Stays where it was put
+			PxRigidBodyExt::updateMassAndInertia(*actor, 1.0f);
+			actors.push_back(actor);
+		}
+		shape->release();	//The actor holds the only reference now
+	}
+}
+
+
+PxScene* CreateQueryScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, const QuerySceneDesc& desc)
+{
+	PxSceneDesc sceneDesc = ChapterSceneDesc(physics, dispatcher);
+	PxScene* scene = physics.createScene(sceneDesc);
+	vector<PxRigidActor*> actors;
+	CreateQueryActors(physics, desc, actors);
+
+	//One at a time, as the demos add their actors
+	for(size_t i=0; i<actors.size(); i++)
+	{
+		scene->addActor(*actors[i]);
+		if(PxRigidDynamic* dynamic = actors[i]->is<PxRigidDynamic>())
+			dynamic->putToSleep();
+	}
+	return scene;
+}
+
+
+//'count' rays from random points of the scene's cube in random directions
+void GenerateQueryRays(const QuerySceneDesc& desc, PxU32 count, PxReal maxDistance, PxU32 seed, QueryRays& rays)
+{
+	QueryRandom random(seed);
+	rays.origins.resize(count);
+	rays.directions.resize(count);
+	rays.maxDistance = maxDistance;
+	for(PxU32 i=0; i<count; i++)
+	{
+		rays.origins[i]	   = random.inCube(desc.extent);
+		rays.directions[i] = random.direction();
+	}
+}
@@ -0,0 +1,243 @@
+/*
+=====================================================================
+
+File Name	  :	RayService.h
+
+Description	  : Batched raycasts for game code that needs thousands of rays per step (AI
+				line of sight, sensors), instead of one blocking 'PxScene::raycast()' each.
+
+				Requests are queued with 'RayServiceAdd()' into parallel arrays, then
+				'RayServiceExecute()' runs them through a 'PxBatchQuery' in chunks of
+				'batchSize'. The query's result memory ('PxBatchQueryMemory') is allocated
+				once by 'RayServiceInit()' and reused, so executing allocates nothing once
+				the request and result arrays have grown to their working size.
+
+				Results are the closest blocking hit per ray. They are written to the flat
+				structure-of-arrays 'RayResults', indexed like the requests. They stay
+				valid until the next 'RayServiceClear()'.
+
+				With the raycast cache of 'RaycastCache.h' enabled, requests found in it
+				are answered from there. Only the others go into the batch query, and
+				their results are added to the cache.
+
+				Execute while the scene is not being simulated or modified.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "RaycastCache.h"		//RaycastCacheLookup()
+#include <cstdio>
+#include <vector>
+#include <chrono>
+
+using namespace std;
+using namespace physx;
+
+
+//Closest hit per ray; distance is PX_MAX_F32 and actor NULL for misses
+struct RayResults
+{
+	vector<PxU8>			hit;
+	vector<PxReal>			distance;
+	vector<PxReal>			px, py, pz;		//Hit position
+	vector<PxReal>			nx, ny, nz;		//Hit normal
+	vector<PxRigidActor*>	actor;
+	vector<PxShape*>		shape;
+
+	void resize(size_t count)
+	{
+		hit.resize(count); distance.resize(count);
+		px.resize(count); py.resize(count); pz.resize(count);
+		nx.resize(count); ny.resize(count); nz.resize(count);
+		actor.resize(count); shape.resize(count);
+	}
+};
+
+
+struct RayServiceStats
+{
+	PxU64	rays;
+	PxU64	hits;
+	PxU64	executes;		//'PxBatchQuery::execute()' calls
+	double	executeMs;		//Time in 'RayServiceExecute()'
+};
+
+
+struct RayService
+{
+	PxBatchQuery*					batch;
+	PxU32							batchSize;		//Raycasts per 'execute()'
+	vector<PxRaycastQueryResult>	queryResults;	//'PxBatchQueryMemory' of 'batch', 'batchSize' entries
+
+	//Queued requests
+	vector<PxVec3>					origins;
+	vector<PxVec3>					directions;
+	vector<PxReal>					maxDistances;
+
+	RayResults						results;
+	PxU32							resultCount;	//Requests with results in 'results'
+	vector<PxU32>					pending;		//Requests not found in the raycast cache
+	PxHitFlags						hitFlags;
+};
+
+
+const PxU32 RAY_SERVICE_DEFAULT_BATCH = 4096;
+
+RayService		gRayService = { NULL, 0 };
+RayServiceStats	gRayServiceStats = { 0, 0, 0, 0.0 };
+
+
+void RayServiceInit(PxScene& scene, PxU32 batchSize = RAY_SERVICE_DEFAULT_BATCH, PxU32 expectedRays = 0);
+PxU32 RayServiceAdd(const PxVec3& origin, const PxVec3& unitDir, PxReal maxDistance);
+void RayServiceExecute();
+void RayServiceClear();
+void RayServiceRelease();
+void PrintRayServiceStats();
+
+
+
+//'expectedRays' reserves the request and result arrays up front
+void RayServiceInit(PxScene& scene, PxU32 batchSize, PxU32 expectedRays)
+{
+	RayService& r = gRayService;
+	r.batchSize = PxMax(1u, batchSize);
+	r.queryResults.resize(r.batchSize);
+	r.hitFlags = PxHitFlag::ePOSITION | PxHitFlag::eNORMAL | PxHitFlag::eDISTANCE;
+
+	//Closest hit only: every hit blocks and lands in the result itself, no touch buffer is needed
+	PxBatchQueryDesc desc(r.batchSize, 0, 0);
+	desc.queryMemory.userRaycastResultBuffer = &r.queryResults[0];
+	r.batch = scene.createBatchQuery(desc);
+
+	r.origins.reserve(expectedRays);
+	r.directions.reserve(expectedRays);
+	r.maxDistances.reserve(expectedRays);
+	r.pending.reserve(expectedRays);
+	r.results.resize(expectedRays);
+	r.resultCount = 0;
+}
+
+
+//Returns the index of the request's results
+PxU32 RayServiceAdd(const PxVec3& origin, const PxVec3& unitDir, PxReal maxDistance)
+{
+	RayService& r = gRayService;
+	r.origins.push_back(origin);
+	r.directions.push_back(unitDir);
+	r.maxDistances.push_back(maxDistance);
+	return PxU32(r.origins.size() - 1);
+}
+
+
+void WriteRayResult(PxU32 k, const RaycastCacheHit& hit)
+{
+	RayResults& out = gRayService.results;
+	out.hit[k]		= hit.actor != NULL;
+	out.distance[k] = hit.distance;
+	out.px[k] = hit.position.x;	out.py[k] = hit.position.y;	out.pz[k] = hit.position.z;
+	out.nx[k] = hit.normal.x;	out.ny[k] = hit.normal.y;	out.nz[k] = hit.normal.z;
+	out.actor[k]	= hit.actor;
+	out.shape[k]	= hit.shape;
+	gRayServiceStats.hits += out.hit[k];
+}
+
+
+//Runs the queued requests that have no results yet
+void RayServiceExecute()
+{
+	RayService& r = gRayService;
+	PxU32 count = PxU32(r.origins.size());
+	if(r.results.hit.size() < count)
+		r.results.resize(count);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	r.pending.clear();
+	for(PxU32 k=r.resultCount; k<count; k++)
+	{
+		RaycastCacheHit cached;
+		if(gRaycastCache.enabled && RaycastCacheLookup(r.origins[k], r.directions[k], r.maxDistances[k], cached))
+			WriteRayResult(k, cached);
+		else
+			r.pending.push_back(k);
+	}
+
+	chrono::steady_clock::time_point queryStart = chrono::steady_clock::now();
+	PxU32 pending = PxU32(r.pending.size());
+	for(PxU32 first=0; first<pending; first+=r.batchSize)
+	{
+		PxU32 n = PxMin(r.batchSize, pending - first);
+		for(PxU32 i=0; i<n; i++)
+		{
+			PxU32 k = r.pending[first+i];
+			r.batch->raycast(r.origins[k], r.directions[k], r.maxDistances[k], 0, r.hitFlags);
+		}
+		r.batch->execute();
+		gRayServiceStats.executes++;
+
+		for(PxU32 i=0; i<n; i++)
+		{
+			const PxRaycastQueryResult& result = r.queryResults[i];
+			PxU32 k = r.pending[first+i];
+			RaycastCacheHit hit = { NULL, NULL, PX_MAX_F32, PxVec3(0.0f), PxVec3(0.0f) };
+			if(result.queryStatus == PxBatchQueryStatus::eSUCCESS && result.hasBlock)
+			{
+				hit.actor	 = result.block.actor;
+				hit.shape	 = result.block.shape;
+				hit.distance = result.block.distance;
+				hit.position = result.block.position;
+				hit.normal	 = result.block.normal;
+			}
+			WriteRayResult(k, hit);
+			if(gRaycastCache.enabled)
+				RaycastCacheStore(r.origins[k], r.directions[k], r.maxDistances[k], hit);
+		}
+	}
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+	//The batch's cost per ray is what the cache hits saved
+	if(gRaycastCache.enabled)
+	{
+		gRaycastCacheStats.queries += pending;
+		gRaycastCacheStats.queryMs += chrono::duration<double, milli>(end - queryStart).count();
+	}
+
+	gRayServiceStats.rays	   += count - r.resultCount;
+	gRayServiceStats.executeMs += chrono::duration<double, milli>(end - start).count();
+	r.resultCount = count;
+}
+
+
+//Drops the requests and their results, keeping the memory
+void RayServiceClear()
+{
+	RayService& r = gRayService;
+	r.origins.clear();
+	r.directions.clear();
+	r.maxDistances.clear();
+	r.resultCount = 0;
+}
+
+
+void RayServiceRelease()
+{
+	RayService& r = gRayService;
+	if(r.batch)
+		r.batch->release();
+	r.batch = NULL;
+	RayServiceClear();
+}
+
+
+void PrintRayServiceStats()
+{
+	const RayServiceStats& s = gRayServiceStats;
+	if(!s.rays)
+		return;
+
+	printf("ray service: %llu rays  %llu hits  %llu batches of up to %u  %.3f ms  %.2f Mrays/s\n",
+		(unsigned long long)s.rays, (unsigned long long)s.hits, (unsigned long long)s.executes, gRayService.batchSize,
+		s.executeMs, s.executeMs > 0.0 ? s.rays/(s.executeMs*1000.0) : 0.0);
+}
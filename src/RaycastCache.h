@@ -0,0 +1,392 @@
+/*
+=====================================================================
+
+File Name	  :	RaycastCache.h
+
+Description	  : Reuses raycast results across frames for rays that are cast again and
+				again, like the CH6 ray from (0,15,0) straight down.
+
+				A ray's key is its origin, direction and length, quantized to
+				'RAYCAST_CACHE_POSITION_STEP' and 'RAYCAST_CACHE_DIRECTION_STEP'. Rays that
+				fall into the same cell share one entry, and the first ray's result is
+				returned for all of them. An entry stores the closest hit and the bounds of
+				the segment that decided it. That segment runs from the origin to the hit,
+				or to the full length for a miss. Lengths beyond the range of the cells,
+				like PX_MAX_F32 for an unbounded ray, all share the last cell. Rays whose
+				origins lie beyond it, about 2.1e7 units out, bypass the cache.
+
+				'RaycastCacheUpdate()' runs after every 'fetchResults()' and walks only the
+				active actors of the step. An entry is dropped when the actor it hit has
+				moved. It is also dropped when the bounds of a moving actor with query
+				shapes cross its segment. Nothing else can change a closest hit, so every
+				other entry stays valid. Poses set with 'setGlobalPose()' become visible
+				only after the next step, so call 'RaycastCacheInvalidateActor()' before
+				and after such a move. Call 'RaycastCacheClear()' after actors are added or
+				removed.
+
+				An update tests every active actor against every entry, so it is meant for
+				the few hundred to few thousand repeated rays of game code.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include <cstdio>
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+
+using namespace std;
+using namespace physx;
+
+
+//Closest hit of a ray; 'actor' is NULL for misses
+struct RaycastCacheHit
+{
+	PxRigidActor*	actor;
+	PxShape*		shape;
+	PxReal			distance;
+	PxVec3			position;
+	PxVec3			normal;
+};
+
+
+struct RaycastCacheKey
+{
+	PxI32	cells[7];	//Origin, direction and length in quantization steps
+
+	bool operator==(const RaycastCacheKey& other) const
+	{
+		for(int i=0; i<7; i++)
+			if(cells[i] != other.cells[i])
+				return false;
+		return true;
+	}
+};
+
+
+//FNV-1a over the cells
+struct RaycastCacheKeyHash
+{
+	size_t operator()(const RaycastCacheKey& key) const
+	{
+		PxU64 hash = 14695981039346656037ull;
+		for(int i=0; i<7; i++)
+		{
+			hash ^= PxU32(key.cells[i]);
+			hash *= 1099511628211ull;
+		}
+		return size_t(hash);
+	}
+};
+
+
+struct RaycastCacheEntry
+{
+	RaycastCacheKey		key;
+	bool				valid;
+	PxVec3				origin;
+	PxVec3				unitDir;
+	PxReal				length;		//Hit distance, or the ray's length for a miss
+	PxBounds3			bounds;		//Of the segment, grown by one quantization step
+	RaycastCacheHit		hit;
+};
+
+
+struct RaycastCacheStats
+{
+	PxU64	lookups;
+	PxU64	hits;				//Lookups answered from the cache
+	PxU64	queries;			//Raycasts run by 'RaycastCacheRaycast()' on misses
+	PxU64	invalidations;		//Entries dropped
+	double	lookupMs;			//Time in lookups
+	double	queryMs;			//Time in the raycasts of misses
+	double	updateMs;			//Time in 'RaycastCacheUpdate()' and 'RaycastCacheInvalidateActor()'
+};
+
+
+struct RaycastCache
+{
+	bool											enabled;
+	PxU32											capacity;	//Rays beyond it are not cached
+	vector<RaycastCacheEntry>						entries;
+	vector<PxU32>									freeEntries;
+	unordered_map<RaycastCacheKey, PxU32, RaycastCacheKeyHash>	index;		//Key to entry
+};
+
+
+const PxReal RAYCAST_CACHE_POSITION_STEP  = 0.01f;			//Origins and lengths, in distance units
+const PxReal RAYCAST_CACHE_DIRECTION_STEP = 1.0f/4096.0f;	//Direction components
+const PxU32	 RAYCAST_CACHE_DEFAULT_CAPACITY = 65536;
+const PxReal RAYCAST_CACHE_MAX_CELL		 = 2147483520.0f;	//Largest float below 2^31, so that a cell fits a PxI32
+
+RaycastCache		gRaycastCache;
+RaycastCacheStats	gRaycastCacheStats = { 0, 0, 0, 0, 0.0, 0.0, 0.0 };
+
+
+void RaycastCacheInit(PxU32 capacity = RAYCAST_CACHE_DEFAULT_CAPACITY);
+bool RaycastCacheLookup(const PxVec3& origin, const PxVec3& unitDir, PxReal maxDistance, RaycastCacheHit& hit);
+void RaycastCacheStore(const PxVec3& origin, const PxVec3& unitDir, PxReal maxDistance, const RaycastCacheHit& hit);
+bool RaycastCacheRaycast(PxScene& scene, const PxVec3& origin, const PxVec3& unitDir, PxReal maxDistance, RaycastCacheHit& hit);
+void RaycastCacheUpdate(PxScene& scene);
+void RaycastCacheInvalidateActor(PxRigidActor& actor);
+void RaycastCacheClear();
+void PrintRaycastCacheStats();
+
+
+
+double RaycastCacheClockMs()
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+//Clamped before the conversion, which is undefined outside the PxI32 range
+PxI32 QuantizeRaycastValue(PxReal value, PxReal step)
+{
+	return PxI32(PxClamp(PxFloor(value/step + 0.5f), -RAYCAST_CACHE_MAX_CELL, RAYCAST_CACHE_MAX_CELL));
+}
+
+
+//False for origins whose cells would be clamped, and so be shared by distant rays
+bool RaycastCacheCovers(const PxVec3& origin)
+{
+	PxReal limit = RAYCAST_CACHE_MAX_CELL*RAYCAST_CACHE_POSITION_STEP;
+	return PxAbs(origin.x) < limit && PxAbs(origin.y) < limit && PxAbs(origin.z) < limit;
+}
+
+
+RaycastCacheKey MakeRaycastCacheKey(const PxVec3& origin, const PxVec3& unitDir, PxReal maxDistance)
+{
+	RaycastCacheKey key;
+	key.cells[0] = QuantizeRaycastValue(origin.x, RAYCAST_CACHE_POSITION_STEP);
+	key.cells[1] = QuantizeRaycastValue(origin.y, RAYCAST_CACHE_POSITION_STEP);
+	key.cells[2] = QuantizeRaycastValue(origin.z, RAYCAST_CACHE_POSITION_STEP);
+	key.cells[3] = QuantizeRaycastValue(unitDir.x, RAYCAST_CACHE_DIRECTION_STEP);
+	key.cells[4] = QuantizeRaycastValue(unitDir.y, RAYCAST_CACHE_DIRECTION_STEP);
+	key.cells[5] = QuantizeRaycastValue(unitDir.z, RAYCAST_CACHE_DIRECTION_STEP);
+	key.cells[6] = QuantizeRaycastValue(maxDistance, RAYCAST_CACHE_POSITION_STEP);
+	return key;
+}
+
+
+void RaycastCacheInit(PxU32 capacity)
+{
+	RaycastCache& c = gRaycastCache;
+	c.capacity = capacity;
+	c.entries.reserve(capacity);
+	c.index.reserve(capacity);
+	RaycastCacheClear();
+	c.enabled = true;
+}
+
+
+//True with the cached result in 'hit', false when the ray has to be cast
+bool RaycastCacheLookup(const PxVec3& origin, const PxVec3& unitDir, PxReal maxDistance, RaycastCacheHit& hit)
+{
+	double start = RaycastCacheClockMs();
+	RaycastCache& c = gRaycastCache;
+	bool found = false;
+	unordered_map<RaycastCacheKey, PxU32, RaycastCacheKeyHash>::const_iterator it;
+	if(RaycastCacheCovers(origin))
+	{
+		it	  = c.index.find(MakeRaycastCacheKey(origin, unitDir, maxDistance));
+		found = it != c.index.end();
+	}
+	if(found)
+		hit = c.entries[it->second].hit;
+
+	gRaycastCacheStats.lookups++;
+	gRaycastCacheStats.hits += found;
+	gRaycastCacheStats.lookupMs += RaycastCacheClockMs() - start;
+	return found;
+}
+
+
+//Caches the result of a ray that missed the cache
+void RaycastCacheStore(const PxVec3& origin, const PxVec3& unitDir, PxReal maxDistance, const RaycastCacheHit& hit)
+{
+	RaycastCache& c = gRaycastCache;
+	if(!RaycastCacheCovers(origin))
+		return;
+	RaycastCacheKey key = MakeRaycastCacheKey(origin, unitDir, maxDistance);
+	if(c.index.count(key))
+		return;
+
+	PxU32 slot;
+	if(!c.freeEntries.empty())
+	{
+		slot = c.freeEntries.back();
+		c.freeEntries.pop_back();
+	}
+	else if(c.entries.size() < c.capacity)
+	{
+		slot = PxU32(c.entries.size());
+		c.entries.push_back(RaycastCacheEntry());
+	}
+	else
+		return;		//Full
+
+	RaycastCacheEntry& entry = c.entries[slot];
+	entry.key	  = key;
+	entry.valid	  = true;
+	entry.origin  = origin;
+	entry.unitDir = unitDir;
+	entry.length  = hit.actor ? hit.distance : maxDistance;
+	entry.hit	  = hit;
+
+	PxVec3 end = origin + unitDir*entry.length;
+	entry.bounds = PxBounds3(origin.minimum(end), origin.maximum(end));
+	entry.bounds.fattenFast(RAYCAST_CACHE_POSITION_STEP);
+	c.index[key] = slot;
+}
+
+
+//Cached result, or a 'PxScene::raycast()' whose result is cached. Returns true for a hit.
+bool RaycastCacheRaycast(PxScene& scene, const PxVec3& origin, const PxVec3& unitDir, PxReal maxDistance, RaycastCacheHit& hit)
+{
+	if(RaycastCacheLookup(origin, unitDir, maxDistance, hit))
+		return hit.actor != NULL;
+
+	double start = RaycastCacheClockMs();
+	PxRaycastBuffer buffer;
+	if(scene.raycast(origin, unitDir, maxDistance, buffer))
+	{
+		hit.actor	 = buffer.block.actor;
+		hit.shape	 = buffer.block.shape;
+		hit.distance = buffer.block.distance;
+		hit.position = buffer.block.position;
+		hit.normal	 = buffer.block.normal;
+	}
+	else
+	{
+		hit.actor	 = NULL;
+		hit.shape	 = NULL;
+		hit.distance = PX_MAX_F32;
+		hit.position = hit.normal = PxVec3(0.0f);
+	}
+	gRaycastCacheStats.queries++;
+	gRaycastCacheStats.queryMs += RaycastCacheClockMs() - start;
+
+	RaycastCacheStore(origin, unitDir, maxDistance, hit);
+	return hit.actor != NULL;
+}
+
+
+void DropRaycastCacheEntry(PxU32 slot)
+{
+	RaycastCache& c = gRaycastCache;
+	RaycastCacheEntry& entry = c.entries[slot];
+	entry.valid = false;
+	c.index.erase(entry.key);
+	c.freeEntries.push_back(slot);
+	gRaycastCacheStats.invalidations++;
+}
+
+
+//Slab test of the segment of 'entry' against 'bounds'
+bool RaycastCacheSegmentOverlaps(const RaycastCacheEntry& entry, const PxBounds3& bounds)
+{
+	PxReal t0 = 0.0f, t1 = entry.length;
+	for(PxU32 axis=0; axis<3; axis++)
+	{
+		PxReal o = entry.origin[axis], d = entry.unitDir[axis];
+		if(PxAbs(d) < 1e-8f)
+		{
+			if(o < bounds.minimum[axis] || o > bounds.maximum[axis])
+				return false;
+			continue;
+		}
+		PxReal ta = (bounds.minimum[axis] - o)/d, tb = (bounds.maximum[axis] - o)/d;
+		t0 = PxMax(t0, PxMin(ta, tb));
+		t1 = PxMin(t1, PxMax(ta, tb));
+		if(t0 > t1)
+			return false;
+	}
+	return true;
+}
+
+
+//Drops the entries that hit 'actor' or whose segment crosses its bounds
+void InvalidateRaycastCacheEntries(PxRigidActor& actor)
+{
+	RaycastCache& c = gRaycastCache;
+
+	//Actors without query shapes can neither be hit nor block a ray
+	bool queryShapes = false;
+	PxShape* shapes[8];
+	for(PxU32 first=0; !queryShapes && first<actor.getNbShapes(); first+=8)
+	{
+		PxU32 count = actor.getShapes(shapes, 8, first);
+		for(PxU32 i=0; i<count; i++)
+			queryShapes = queryShapes || (shapes[i]->getFlags() & PxShapeFlag::eSCENE_QUERY_SHAPE);
+	}
+	if(!queryShapes)
+		return;
+
+	PxBounds3 bounds = actor.getWorldBounds();
+	bounds.fattenFast(RAYCAST_CACHE_POSITION_STEP);
+	for(PxU32 slot=0; slot<c.entries.size(); slot++)
+	{
+		const RaycastCacheEntry& entry = c.entries[slot];
+		if(!entry.valid)
+			continue;
+		if(entry.hit.actor == &actor || (entry.bounds.intersects(bounds) && RaycastCacheSegmentOverlaps(entry, bounds)))
+			DropRaycastCacheEntry(slot);
+	}
+}
+
+
+//Call after every 'fetchResults()', before the next 'simulate()'
+void RaycastCacheUpdate(PxScene& scene)
+{
+	RaycastCache& c = gRaycastCache;
+	if(c.index.empty())
+		return;
+
+	double start = RaycastCacheClockMs();
+	PxU32 nbActive = 0;
+	PxActor** active = scene.getActiveActors(nbActive);
+	for(PxU32 i=0; i<nbActive; i++)
+	{
+		PxRigidActor* actor = active[i]->is<PxRigidActor>();
+		if(actor)
+			InvalidateRaycastCacheEntries(*actor);
+	}
+	gRaycastCacheStats.updateMs += RaycastCacheClockMs() - start;
+}
+
+
+//For actors moved with 'setGlobalPose()': call before the move for the old bounds and after it for the new ones
+void RaycastCacheInvalidateActor(PxRigidActor& actor)
+{
+	double start = RaycastCacheClockMs();
+	InvalidateRaycastCacheEntries(actor);
+	gRaycastCacheStats.updateMs += RaycastCacheClockMs() - start;
+}
+
+
+void RaycastCacheClear()
+{
+	RaycastCache& c = gRaycastCache;
+	c.entries.clear();
+	c.freeEntries.clear();
+	c.index.clear();
+}
+
+
+//Saved time: the average raycast cost of a miss times the cache hits, less the cost of the cache itself
+void PrintRaycastCacheStats()
+{
+	const RaycastCacheStats& s = gRaycastCacheStats;
+	if(!gRaycastCache.enabled || !s.lookups)
+		return;
+
+	double perQueryMs = s.queries ? s.queryMs/s.queries : 0.0;
+	double savedMs = s.hits*perQueryMs - s.lookupMs - s.updateMs;
+	printf("raycast cache: %llu lookups  hit rate %.1f%%  %llu invalidations  %u entries  saved %.3f ms (%.3f ms lookups, %.3f ms invalidation)\n",
+		(unsigned long long)s.lookups, 100.0*s.hits/s.lookups, (unsigned long long)s.invalidations,
+		PxU32(gRaycastCache.index.size()), savedMs, s.lookupMs, s.updateMs);
+}
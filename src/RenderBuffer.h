@@ -7,31 +7,227 @@ Description	  : Functions in this header file are used for rendering the PhysX s
 				It mainly renders primitives like- points, lines and triangles returned by
 				the function 'PxScene::getRenderBuffer()'.
 
+				Vertex data is streamed through a small ring of GL buffer objects that keep
+				their capacity across frames. A buffer is orphaned (re-specified with NULL data)
+				when it is reused, so the driver never has to wait for the GPU to finish reading
+				the previous frame. 'gRenderStats' reports the upload cost of the last frame.
+
+				In 'eRENDER_DIRECT' mode the vertex arrays point straight at the PhysX debug
+				primitives, which are already interleaved position + packed color, so no
+				conversion loop runs at all. 'eRENDER_CONVERTED' keeps the float RGBA path,
+				expanded by the SIMD kernel selected in 'DebugVertexKernels.h'.
+
 =====================================================================
 */
 
-#pragma once  
+#pragma once
+
+#include <PxPhysicsAPI.h> //Single header file to include all features of PhysX API
+#include <GL/freeglut.h>  //OpenGL window tool kit
+#include <vector>
+#include "DebugVertexKernels.h" //SIMD expansion of debug primitives for 'eRENDER_CONVERTED'
+
+using namespace physx;
+
+
+//Per-frame counters of the streaming vertex buffers
+struct RenderStats
+{
+	PxU32 bytesUploaded;	//Bytes copied to GL buffer objects during the frame
+	PxU32 reallocations;	//Number of times a buffer had to grow during the frame
+	PxU32 orphans;			//Number of times a buffer was orphaned for reuse during the frame
+	PxU32 drawCalls;		//Number of glDrawArrays calls issued during the frame
+};
+
+RenderStats gRenderStats = {0, 0, 0, 0}; //Counters of the last frame drawn by 'RenderData()'
+
+
+//How 'RenderData()' feeds the debug primitives to OpenGL
+enum RenderMode
+{
+	eRENDER_CONVERTED,	//Expand to float positions + float RGBA and stream through 'gStreamBuffer'
+	eRENDER_DIRECT		//Point vertex arrays at the PhysX buffers, colors read as packed BGRA bytes
+};
+
+RenderMode gRenderMode = eRENDER_DIRECT;
 
-#include <PxPhysicsAPI.h> //Single header file to include all features of PhysX API 
-#include <GL/freeglut.h>  //OpenGL window tool kit 
 
-using namespace physx; 
+//Every debug primitive is a sequence of {PxVec3 pos; PxU32 color;} vertices,
+//which is what lets the direct path draw them with a single 16 byte stride.
+static const int DEBUG_VERTEX_STRIDE = sizeof(PxVec3) + sizeof(PxU32);
 
+static_assert(sizeof(PxDebugPoint)		== 1*DEBUG_VERTEX_STRIDE, "Unexpected PxDebugPoint layout");
+static_assert(sizeof(PxDebugLine)		== 2*DEBUG_VERTEX_STRIDE, "Unexpected PxDebugLine layout");
+static_assert(sizeof(PxDebugTriangle)	== 3*DEBUG_VERTEX_STRIDE, "Unexpected PxDebugTriangle layout");
+
+
+//Render buffer owned by the application, e.g. for synthetic data or copies of the scene's buffer
+class DebugRenderBuffer : public PxRenderBuffer
+{
+public:
+	PxU32					getNbPoints()		const	{ return PxU32(mPoints.size());		}
+	const PxDebugPoint*		getPoints()			const	{ return mPoints.empty() ? NULL : &mPoints[0];		}
+	PxU32					getNbLines()		const	{ return PxU32(mLines.size());		}
+	const PxDebugLine*		getLines()			const	{ return mLines.empty() ? NULL : &mLines[0];		}
+	PxU32					getNbTriangles()	const	{ return PxU32(mTriangles.size());	}
+	const PxDebugTriangle*	getTriangles()		const	{ return mTriangles.empty() ? NULL : &mTriangles[0];	}
+	PxU32					getNbTexts()		const	{ return 0;		}
+	const PxDebugText*		getTexts()			const	{ return NULL;	}
+
+	void append(const PxRenderBuffer& other)
+	{
+		mPoints.insert(mPoints.end(), other.getPoints(), other.getPoints() + other.getNbPoints());
+		mLines.insert(mLines.end(), other.getLines(), other.getLines() + other.getNbLines());
+		mTriangles.insert(mTriangles.end(), other.getTriangles(), other.getTriangles() + other.getNbTriangles());
+	}
+
+	void clear()
+	{
+		mPoints.clear();
+		mLines.clear();
+		mTriangles.clear();
+	}
+
+	std::vector<PxDebugPoint>		mPoints;
+	std::vector<PxDebugLine>		mLines;
+	std::vector<PxDebugTriangle>	mTriangles;
+};
+
+
+//Growable ring of GL buffer objects used for streaming vertex data to the GPU
+struct StreamBuffer
+{
+	static const int RING_SIZE = 3;			//Number of buffers in flight
 
-void RenderBuffer(float* pVertList, float* pColorList, int type, int num);
+	GLuint		buffers[RING_SIZE];			//GL buffer object names
+	GLsizeiptr	capacity[RING_SIZE];		//Allocated size of each buffer in bytes
+	GLsizeiptr	cursor;						//Write offset into the current buffer
+	int			current;					//Buffer used by the current frame
+	bool		initialized;
+};
+
+StreamBuffer gStreamBuffer = {{0}, {0}, 0, 0, false}; //Stream buffer shared by all render calls
+
+
+//Persistent CPU staging array, kept across frames to avoid per-frame allocations.
+//Positions (3 floats per vertex) are followed by colors (4 floats per vertex),
+//so a whole batch is uploaded with a single call.
+float*		gStaging			= NULL;
+PxU32		gStagingCapacity	= 0;	//Capacity in vertices
+
+
+void StreamBufferBeginFrame(StreamBuffer& stream);
+GLsizeiptr StreamBufferUpload(StreamBuffer& stream, const void* data, GLsizeiptr size);
+void ReserveStaging(PxU32 numVerts);
+void RenderBuffer(GLsizeiptr vertOffset, GLsizeiptr colorOffset, int type, int num);
+void RenderBufferDirect(const void* pVertices, int type, int num);
+void RenderDataDirect(const PxRenderBuffer & data);
+void RenderDataConverted(const PxRenderBuffer & data);
 void RenderData(const PxRenderBuffer & data);
 
 
-void RenderBuffer(float* pVertList, float* pColorList, int type, int num)
+//Moves to the next buffer of the ring and orphans it, so writes never stall on the GPU
+void StreamBufferBeginFrame(StreamBuffer& stream)
+{
+	if(!stream.initialized)
+	{
+		glGenBuffers(StreamBuffer::RING_SIZE, stream.buffers);
+		stream.initialized = true;
+	}
+
+	stream.current = (stream.current + 1) % StreamBuffer::RING_SIZE;
+	stream.cursor  = 0;
+
+	glBindBuffer(GL_ARRAY_BUFFER, stream.buffers[stream.current]);
+	if(stream.capacity[stream.current])
+	{
+		glBufferData(GL_ARRAY_BUFFER, stream.capacity[stream.current], NULL, GL_STREAM_DRAW);
+		gRenderStats.orphans++;
+	}
+}
+
+
+//Copies 'size' bytes into the current buffer and returns their offset inside it.
+//The current buffer must be bound to GL_ARRAY_BUFFER.
+GLsizeiptr StreamBufferUpload(StreamBuffer& stream, const void* data, GLsizeiptr size)
+{
+	GLsizeiptr& capacity = stream.capacity[stream.current];
+
+	if(stream.cursor + size > capacity)
+	{
+		//Grow geometrically. Draws already issued this frame keep reading the old
+		//storage, because re-specifying the buffer orphans it instead of overwriting it.
+		GLsizeiptr newCapacity = capacity ? capacity : 64*1024;
+		while(newCapacity < size)
+			newCapacity *= 2;
+
+		glBufferData(GL_ARRAY_BUFFER, newCapacity, NULL, GL_STREAM_DRAW);
+		stream.cursor = 0;
+
+		if(newCapacity != capacity)
+			gRenderStats.reallocations++;
+		else
+			gRenderStats.orphans++;
+		capacity = newCapacity;
+	}
+
+	GLsizeiptr offset = stream.cursor;
+	glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+	stream.cursor += size;
+	gRenderStats.bytesUploaded += PxU32(size);
+
+	return offset;
+}
+
+
+//Makes sure the staging array can hold 'numVerts' vertices
+void ReserveStaging(PxU32 numVerts)
+{
+	if(numVerts <= gStagingCapacity)
+		return;
+
+	PxU32 newCapacity = gStagingCapacity ? gStagingCapacity : 1024;
+	while(newCapacity < numVerts)
+		newCapacity *= 2;
+
+	delete[] gStaging;
+	gStaging		 = new float[newCapacity*7];
+	gStagingCapacity = newCapacity;
+}
+
+
+//Draws 'num' vertices whose positions and colors were uploaded to the bound stream buffer
+void RenderBuffer(GLsizeiptr vertOffset, GLsizeiptr colorOffset, int type, int num)
+{
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3,GL_FLOAT, 0, (const GLvoid*)vertOffset);
+
+	glEnableClientState(GL_COLOR_ARRAY);
+	glColorPointer(4, GL_FLOAT, 0, (const GLvoid*)colorOffset);
+
+	glDrawArrays(type, 0, num);
+	gRenderStats.drawCalls++;
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+
+//Draws 'num' vertices laid out as {PxVec3 pos; PxU32 color;} directly from client memory
+void RenderBufferDirect(const void* pVertices, int type, int num)
 {
+	const GLubyte* pBase = static_cast<const GLubyte*>(pVertices);
+
 	glEnableClientState(GL_VERTEX_ARRAY);
-	glVertexPointer(3,GL_FLOAT, 0, pVertList);
-	
+	glVertexPointer(3, GL_FLOAT, DEBUG_VERTEX_STRIDE, pBase);
+
+	//0xAARRGGBB stored little-endian is B,G,R,A in memory
 	glEnableClientState(GL_COLOR_ARRAY);
-	glColorPointer(4, GL_FLOAT, 0, pColorList);
-	
+	glColorPointer(GL_BGRA, GL_UNSIGNED_BYTE, DEBUG_VERTEX_STRIDE, pBase + sizeof(PxVec3));
+
 	glDrawArrays(type, 0, num);
-	
+	gRenderStats.drawCalls++;
+
 	glDisableClientState(GL_COLOR_ARRAY);
 	glDisableClientState(GL_VERTEX_ARRAY);
 }
@@ -42,113 +238,64 @@ void RenderData(const PxRenderBuffer & data)
 	glLineWidth(1.0f);
 	glDisable(GL_LIGHTING);
 
-	//----------Render Points------------------
-	unsigned int NbPoints = data.getNbPoints();
-	if(NbPoints)
-	{
-		float* pVertList = new float[NbPoints*3];
-		float* pColorList = new float[NbPoints*4];
-		int vertIndex = 0;
-		int colorIndex = 0;
-		const PxDebugPoint* Points = data.getPoints();
-		while(NbPoints--)
-		{
-			pVertList[vertIndex++] = Points->pos.x;
-			pVertList[vertIndex++] = Points->pos.y;
-			pVertList[vertIndex++] = Points->pos.z;
-			pColorList[colorIndex++] = (float)((Points->color>>16)&0xff)/255.0f;
-			pColorList[colorIndex++] = (float)((Points->color>>8)&0xff)/255.0f;
-			pColorList[colorIndex++] = (float)(Points->color&0xff)/255.0f;
-			pColorList[colorIndex++] = 1.0f;
-			Points++;
-		}
-
-		RenderBuffer(pVertList, pColorList, GL_POINTS, data.getNbPoints());
-
-		delete[] pVertList;
-		delete[] pColorList;
-	}
+	gRenderStats.bytesUploaded	= 0;
+	gRenderStats.reallocations	= 0;
+	gRenderStats.orphans		= 0;
+	gRenderStats.drawCalls		= 0;
 
+	if(gRenderMode == eRENDER_DIRECT)
+		RenderDataDirect(data);
+	else
+		RenderDataConverted(data);
 
-	//----------Render Lines------------------
-	unsigned int NbLines = data.getNbLines();
-	if(NbLines)
-	{
-		float* pVertList = new float[NbLines*3*2];
-		float* pColorList = new float[NbLines*4*2];
-		int vertIndex = 0;
-		int colorIndex = 0;
-		const PxDebugLine* Lines = data.getLines();
-		while(NbLines--)
-		{
-			pVertList[vertIndex++] = Lines->pos0.x;
-			pVertList[vertIndex++] = Lines->pos0.y;
-			pVertList[vertIndex++] = Lines->pos0.z;
-			pColorList[colorIndex++] = (float)((Lines->color0>>16)&0xff)/255.0f;
-			pColorList[colorIndex++] = (float)((Lines->color0>>8)&0xff)/255.0f;
-			pColorList[colorIndex++] = (float)(Lines->color0&0xff)/255.0f;
-			pColorList[colorIndex++] = 1.0f;
-
-			pVertList[vertIndex++] = Lines->pos1.x;
-			pVertList[vertIndex++] = Lines->pos1.y;
-			pVertList[vertIndex++] = Lines->pos1.z;
-			pColorList[colorIndex++] = (float)((Lines->color0>>16)&0xff)/255.0f;
-			pColorList[colorIndex++] = (float)((Lines->color0>>8)&0xff)/255.0f;
-			pColorList[colorIndex++] = (float)(Lines->color0&0xff)/255.0f;
-			pColorList[colorIndex++] = 1.0f;
-
-			Lines++;
-		}
-
-		RenderBuffer(pVertList, pColorList, GL_LINES, data.getNbLines()*2);
-
-		delete[] pVertList;
-		delete[] pColorList;
-	}
+	glEnable(GL_LIGHTING);
+	glColor4f(1.0f,1.0f,1.0f,1.0f);
+}
 
 
-	//----------Render Triangles------------------
-	unsigned int NbTris = data.getNbTriangles();
-	if(NbTris)
+void RenderDataDirect(const PxRenderBuffer & data)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if(data.getNbPoints())
+		RenderBufferDirect(data.getPoints(), GL_POINTS, data.getNbPoints());
+
+	if(data.getNbLines())
+		RenderBufferDirect(data.getLines(), GL_LINES, data.getNbLines()*2);
+
+	if(data.getNbTriangles())
+		RenderBufferDirect(data.getTriangles(), GL_TRIANGLES, data.getNbTriangles()*3);
+}
+
+
+void RenderDataConverted(const PxRenderBuffer & data)
+{
+	StreamBufferBeginFrame(gStreamBuffer);
+
+	//Points, lines and triangles are all 16 byte vertices, see 'DebugVertexKernels.h'
+	const void*	pSources[3]	= { data.getPoints(), data.getLines(), data.getTriangles() };
+	PxU32		numVerts[3]	= { data.getNbPoints(), data.getNbLines()*2, data.getNbTriangles()*3 };
+	int			types[3]	= { GL_POINTS, GL_LINES, GL_TRIANGLES };
+
+	for(int i=0; i<3; i++)
 	{
-		float* pVertList = new float[NbTris*3*3];
-		float* pColorList = new float[NbTris*4*3];
-		int vertIndex = 0;
-		int colorIndex = 0;
-		const PxDebugTriangle* Triangles = data.getTriangles();
-		while(NbTris--)
-		{
-			pVertList[vertIndex++] = Triangles->pos0.x;
-			pVertList[vertIndex++] = Triangles->pos0.y;
-			pVertList[vertIndex++] = Triangles->pos0.z;
-
-			pVertList[vertIndex++] = Triangles->pos1.x;
-			pVertList[vertIndex++] = Triangles->pos1.y;
-			pVertList[vertIndex++] = Triangles->pos1.z;
-
-			pVertList[vertIndex++] = Triangles->pos2.x;
-			pVertList[vertIndex++] = Triangles->pos2.y;
-			pVertList[vertIndex++] = Triangles->pos2.z;
-
-			for(int i=0;i<3;i++)
-			{
-				pColorList[colorIndex++] = (float)((Triangles->color0>>16)&0xff)/255.0f;
-				pColorList[colorIndex++] = (float)((Triangles->color0>>8)&0xff)/255.0f;
-				pColorList[colorIndex++] = (float)(Triangles->color0&0xff)/255.0f;
-				pColorList[colorIndex++] = 1.0f;
-			}
-
-			Triangles++;
-		}
-
-		RenderBuffer(pVertList, pColorList, GL_TRIANGLES, data.getNbTriangles()*3);
-
-		delete[] pVertList;
-		delete[] pColorList;
+		if(!numVerts[i])
+			continue;
+
+		ReserveStaging(numVerts[i]);
+		float* pVertList  = gStaging;
+		float* pColorList = gStaging + numVerts[i]*3;
+
+		gExpandDebugVertices(pSources[i], numVerts[i], pVertList, pColorList);
+
+		GLsizeiptr vertOffset  = StreamBufferUpload(gStreamBuffer, pVertList, numVerts[i]*7*sizeof(float));
+		GLsizeiptr colorOffset = vertOffset + numVerts[i]*3*sizeof(float);
+		RenderBuffer(vertOffset, colorOffset, types[i], numVerts[i]);
 	}
-	glEnable(GL_LIGHTING);
-	glColor4f(1.0f,1.0f,1.0f,1.0f);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 
 
+
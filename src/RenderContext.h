@@ -0,0 +1,266 @@
+/*
+=====================================================================
+
+File Name	  :	RenderContext.h
+
+Description	  : Creates the OpenGL context of a demo and optionally runs it as a fixed-length,
+				window-less benchmark.
+
+				Command line options (parsed by 'ParseRenderOptions()'):
+				  --headless   Render with OSMesa instead of a GLUT window. Requires the
+				               PHYSX_OPENGL_OSMESA CMake option, otherwise a hidden GLUT
+				               window is used as a fallback.
+				  --frames N   Render N frames into an offscreen framebuffer object, print
+				               the frame times and exit. Elapsed time advances by exactly
+				               1/60 s per frame, so runs are repeatable.
+				  --capture    With --frames, write every frame as capture_NNNNN.ppm. Pixels
+				               are read back asynchronously through two pixel buffer objects,
+				               so frame N is written while frame N+1 renders.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h> //Single header file to include all features of PhysX API
+#include <GL/freeglut.h>  //OpenGL window tool kit
+#include "CommandLine.h"  //HasArgument(), GetIntArgument()
+#ifdef __APPLE__
+#include <OpenGL/glext.h> //EXT_framebuffer_object entry points
+#endif
+#ifdef USE_OSMESA
+#include <GL/osmesa.h>	  //Off-screen Mesa software renderer
+#endif
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+
+using namespace std;
+using namespace physx;
+
+
+struct RenderOptions
+{
+	bool	headless;	//No window, render with OSMesa
+	int		frames;		//Number of frames to render before exiting, 0 for the interactive loop
+	bool	capture;	//Write every rendered frame to disk
+};
+
+RenderOptions gRenderOptions = { false, 0, false };
+
+
+//State of the offscreen target used in '--frames' mode
+struct OffscreenTarget
+{
+	int				width;
+	int				height;
+	GLuint			fbo;
+	GLuint			colorRb;
+	GLuint			depthRb;
+	GLuint			pbo[2];			//Readback ring
+	int				pendingFrame[2];	//Frame number held by each PBO, -1 when empty
+	int				frameIndex;
+#ifdef USE_OSMESA
+	OSMesaContext	osmesa;
+	vector<GLubyte>	osmesaBuffer;
+#endif
+};
+
+OffscreenTarget gOffscreen;
+
+
+void ParseRenderOptions(int argc, char** argv);
+void CreateRenderContext(int* argc, char** argv, const char* title, int width, int height);
+void RunFrames(void (*display)(), void (*reshape)(int, int));
+void PresentFrame();
+int GetElapsedTimeMs();
+
+
+
+void ParseRenderOptions(int argc, char** argv)
+{
+	gRenderOptions.headless = HasArgument(argc, argv, "--headless");
+	gRenderOptions.frames	= PxMax(0, GetIntArgument(argc, argv, "--frames", 0));
+	gRenderOptions.capture	= HasArgument(argc, argv, "--capture");
+
+	//Without a window there is nothing to run but a fixed number of frames
+	if(gRenderOptions.headless && !gRenderOptions.frames)
+		gRenderOptions.frames = 300;
+}
+
+
+//Creates either a GLUT window or an OSMesa context, depending on '--headless'
+void CreateRenderContext(int* argc, char** argv, const char* title, int width, int height)
+{
+	gOffscreen.width  = width;
+	gOffscreen.height = height;
+
+#ifdef USE_OSMESA
+	if(gRenderOptions.headless)
+	{
+		gOffscreen.osmesa = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, NULL);
+		gOffscreen.osmesaBuffer.resize(width*height*4);
+		if(!gOffscreen.osmesa || !OSMesaMakeCurrent(gOffscreen.osmesa, &gOffscreen.osmesaBuffer[0], GL_UNSIGNED_BYTE, width, height))
+		{
+			cerr<<"Error creating OSMesa context, Exiting..."<<endl;
+			exit(1);
+		}
+		return;
+	}
+#else
+	if(gRenderOptions.headless)
+		cerr<<"Built without OSMesa (PHYSX_OPENGL_OSMESA), using a hidden GLUT window instead\n";
+#endif
+
+	glutInit(argc, argv);										//Initialize GLUT
+	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);	//Enable double buffering and depth buffer
+	glutSetOption(GLUT_MULTISAMPLE, 16);
+	glutInitWindowSize(width, height);							//Set window's initial width & height
+
+	glutCreateWindow(title);									//Create a window with the given title
+
+	if(gRenderOptions.headless)
+		glutHideWindow();
+}
+
+
+void CreateOffscreenTarget()
+{
+	OffscreenTarget& t = gOffscreen;
+
+	glGenFramebuffersEXT(1, &t.fbo);
+	glGenRenderbuffersEXT(1, &t.colorRb);
+	glGenRenderbuffersEXT(1, &t.depthRb);
+
+	glBindRenderbufferEXT(GL_RENDERBUFFER_EXT, t.colorRb);
+	glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT, GL_RGBA8, t.width, t.height);
+	glBindRenderbufferEXT(GL_RENDERBUFFER_EXT, t.depthRb);
+	glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT, GL_DEPTH_COMPONENT24, t.width, t.height);
+
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, t.fbo);
+	glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_RENDERBUFFER_EXT, t.colorRb);
+	glFramebufferRenderbufferEXT(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, t.depthRb);
+
+	if(glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT) != GL_FRAMEBUFFER_COMPLETE_EXT)
+	{
+		cerr<<"Error creating offscreen framebuffer, Exiting..."<<endl;
+		exit(1);
+	}
+
+	glGenBuffers(2, t.pbo);
+	for(int i=0; i<2; i++)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, t.pbo[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, t.width*t.height*4, NULL, GL_STREAM_READ);
+		t.pendingFrame[i] = -1;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+
+//Maps the PBO holding an earlier frame and writes it as a binary PPM
+void WritePendingCapture(int slot)
+{
+	OffscreenTarget& t = gOffscreen;
+	if(t.pendingFrame[slot] < 0)
+		return;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, t.pbo[slot]);
+	const GLubyte* pixels = static_cast<const GLubyte*>(glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+	if(pixels)
+	{
+		char name[64];
+		sprintf(name, "capture_%05d.ppm", t.pendingFrame[slot]);
+		FILE* file = fopen(name, "wb");
+		if(file)
+		{
+			fprintf(file, "P6\n%d %d\n255\n", t.width, t.height);
+			for(int y=t.height-1; y>=0; y--)	//GL rows are bottom-up
+			{
+				const GLubyte* row = pixels + y*t.width*4;
+				for(int x=0; x<t.width; x++)
+					fwrite(row + x*4, 1, 3, file);
+			}
+			fclose(file);
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	t.pendingFrame[slot] = -1;
+}
+
+
+//Replaces 'glutSwapBuffers()' at the end of a demo's display callback
+void PresentFrame()
+{
+	if(!gRenderOptions.frames)
+	{
+		glutSwapBuffers();
+		return;
+	}
+
+	OffscreenTarget& t = gOffscreen;
+	if(gRenderOptions.capture)
+	{
+		//Queue this frame's readback; the copy into the PBO happens asynchronously.
+		//The other PBO holds the previous frame, which is finished by now.
+		int slot = t.frameIndex & 1;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, t.pbo[slot]);
+		glReadPixels(0, 0, t.width, t.height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		t.pendingFrame[slot] = t.frameIndex;
+
+		WritePendingCapture(slot ^ 1);
+	}
+	t.frameIndex++;
+}
+
+
+//Replaces 'glutGet(GLUT_ELAPSED_TIME)'. In '--frames' mode time advances 1/60 s per frame.
+int GetElapsedTimeMs()
+{
+	if(gRenderOptions.frames)
+		return gOffscreen.frameIndex*1000/60;
+
+	return glutGet(GLUT_ELAPSED_TIME);
+}
+
+
+//Renders 'gRenderOptions.frames' frames into the offscreen target and prints frame times
+void RunFrames(void (*display)(), void (*reshape)(int, int))
+{
+	CreateOffscreenTarget();
+	reshape(gOffscreen.width, gOffscreen.height);
+
+	vector<double> frameMs;
+	frameMs.reserve(gRenderOptions.frames);
+
+	chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+	for(int i=0; i<gRenderOptions.frames; i++)
+	{
+		chrono::high_resolution_clock::time_point frameStart = chrono::high_resolution_clock::now();
+		display();
+		frameMs.push_back(chrono::duration<double, milli>(chrono::high_resolution_clock::now() - frameStart).count());
+	}
+
+	WritePendingCapture(0);
+	WritePendingCapture(1);
+	glFinish();
+	double totalMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+	if(frameMs.empty())
+		return;
+
+	double minMs = frameMs[0], maxMs = frameMs[0];
+	for(size_t i=1; i<frameMs.size(); i++)
+	{
+		minMs = PxMin(minMs, frameMs[i]);
+		maxMs = PxMax(maxMs, frameMs[i]);
+	}
+
+	printf("frames: %d  total: %.1f ms  avg: %.3f ms/frame  min: %.3f  max: %.3f%s\n",
+		gRenderOptions.frames, totalMs, totalMs/gRenderOptions.frames, minMs, maxMs,
+		gRenderOptions.capture ? "  (with capture)" : "");
+}
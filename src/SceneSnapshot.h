@@ -0,0 +1,213 @@
+/*
+=====================================================================
+
+File Name	  :	SceneSnapshot.h
+
+Description	  : Runs the PhysX simulation on its own thread and hands the results to the
+				render thread as immutable snapshots, so a frame costs max(sim, render)
+				instead of sim + render.
+
+				After every step the simulation thread copies the shape poses (in the batch
+				order of 'ShapeRenderer.h') and, when enabled, the debug render buffer into
+				the back slot of a lock-free triple buffer and publishes it. The render
+				thread only ever reads the most recently published slot and never touches
+				the scene, so the two threads never wait on each other.
+
+				Everything that modifies the scene (forces, velocities, poses) must run in
+				the 'gameLogic' callback, which is called on the simulation thread before
+				each step.
+
+				'gSnapshotStats' exposes the snapshot age seen by the renderer and how many
+				published snapshots were never rendered.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "RenderBuffer.h"		//DebugRenderBuffer
+#include "ShapeRenderer.h"		//ShapeRendererGatherPoses()
+#include <cstdio>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+using namespace physx;
+
+
+//Everything the renderer needs from one simulation step
+struct SceneSnapshot
+{
+	DebugRenderBuffer	debug;			//Copy of 'PxScene::getRenderBuffer()', empty when visualization is off
+	vector<PxTransform>	shapePoses;		//Shape poses for 'ShapeRendererDraw()'
+	PxU64				stepIndex;		//Number of steps simulated when the snapshot was taken
+	double				publishTimeMs;	//'SnapshotClockMs()' at publication
+	double				simMs;			//Duration of the step that produced the snapshot
+};
+
+
+//Single producer / single consumer triple buffer. The 'middle' slot index carries a flag
+//telling the reader whether it holds a snapshot the reader has not seen yet.
+struct SnapshotTripleBuffer
+{
+	static const int FRESH = 4;
+
+	SceneSnapshot	slots[3];
+	int				back;		//Owned by the simulation thread
+	int				front;		//Owned by the render thread
+	atomic<int>		middle;		//Exchanged between the two
+};
+
+
+//Render side metrics, updated by 'AcquireLatestSnapshot()'
+struct SnapshotStats
+{
+	double	ageMs;			//Time between publication and acquisition of the current snapshot
+	double	avgAgeMs;		//Exponential moving average of 'ageMs'
+	double	simMs;			//Step duration of the current snapshot
+	PxU64	stepIndex;		//Step of the current snapshot
+	PxU64	skipped;		//Published snapshots that were replaced before being rendered
+	PxU64	reused;			//Frames that rendered the same snapshot as the frame before
+};
+
+
+SnapshotTripleBuffer	gSnapshots;
+SnapshotStats			gSnapshotStats = {0, 0, 0, 0, 0, 0};
+
+thread					gSimulationThread;
+atomic<bool>			gSimulationRunning(false);
+atomic<bool>			gSnapshotDebugVisualization(true);	//Applied to the scene by the simulation thread
+
+
+double SnapshotClockMs();
+void StartSimulationThread(PxScene* scene, PxReal timeStep, void (*gameLogic)(PxReal));
+void StopSimulationThread();
+const SceneSnapshot& AcquireLatestSnapshot();
+void RequestDebugVisualization(bool enable);
+void PrintSnapshotStats();
+
+
+
+double SnapshotClockMs()
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void SimulationThreadLoop(PxScene* scene, PxReal timeStep, void (*gameLogic)(PxReal))
+{
+	PxU64 stepIndex = 0;
+	chrono::steady_clock::time_point nextStep = chrono::steady_clock::now();
+	const chrono::steady_clock::duration stepDuration =
+		chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(timeStep));
+
+	while(gSimulationRunning)
+	{
+		bool debugVisualization = gSnapshotDebugVisualization;
+		scene->setVisualizationParameter(PxVisualizationParameter::eSCALE, debugVisualization ? 1.0f : 0.0f);
+
+		double start = SnapshotClockMs();
+
+		if(gameLogic)
+			gameLogic(timeStep);
+
+		scene->simulate(timeStep);		//Advances the simulation by 'timeStep' time
+		scene->fetchResults(true);		//Block until the simulation run is completed
+		AwakeSetStepCompleted();		//Awake and asleep body counters
+
+		SceneSnapshot& snapshot = gSnapshots.slots[gSnapshots.back];
+		snapshot.debug.clear();
+		if(debugVisualization)
+			snapshot.debug.append(scene->getRenderBuffer());
+		ShapeRendererGatherPoses(snapshot.shapePoses);
+		snapshot.stepIndex		= ++stepIndex;
+		snapshot.simMs			= SnapshotClockMs() - start;
+		snapshot.publishTimeMs	= SnapshotClockMs();
+
+		//Publish: our slot becomes the middle one, the old middle one becomes our new back slot
+		gSnapshots.back = gSnapshots.middle.exchange(gSnapshots.back | SnapshotTripleBuffer::FRESH) & ~SnapshotTripleBuffer::FRESH;
+
+		//Keep simulated time in step with wall time; do not try to catch up after a long stall
+		nextStep += stepDuration;
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		if(nextStep < now - stepDuration)
+			nextStep = now;
+		this_thread::sleep_until(nextStep);
+	}
+}
+
+
+//Starts stepping 'scene' by 'timeStep' in real time on a new thread.
+//'ShapeRendererInit()' must have been called, the scene must not be touched by other threads afterwards.
+void StartSimulationThread(PxScene* scene, PxReal timeStep, void (*gameLogic)(PxReal))
+{
+	gSnapshots.back  = 0;
+	gSnapshots.middle = 1;
+	gSnapshots.front = 2;
+	for(int i=0; i<3; i++)
+	{
+		gSnapshots.slots[i].stepIndex	  = 0;
+		gSnapshots.slots[i].publishTimeMs = SnapshotClockMs();
+		gSnapshots.slots[i].simMs		  = 0.0;
+		ShapeRendererGatherPoses(gSnapshots.slots[i].shapePoses);
+	}
+
+	gSnapshotDebugVisualization = gDebugVisualization;
+	gSimulationRunning = true;
+	gSimulationThread = thread(SimulationThreadLoop, scene, timeStep, gameLogic);
+}
+
+
+void StopSimulationThread()
+{
+	if(!gSimulationRunning)
+		return;
+
+	gSimulationRunning = false;
+	gSimulationThread.join();
+}
+
+
+//Returns the newest published snapshot. It stays valid until the next call.
+const SceneSnapshot& AcquireLatestSnapshot()
+{
+	if(gSnapshots.middle.load() & SnapshotTripleBuffer::FRESH)
+	{
+		gSnapshots.front = gSnapshots.middle.exchange(gSnapshots.front) & ~SnapshotTripleBuffer::FRESH;
+
+		const SceneSnapshot& snapshot = gSnapshots.slots[gSnapshots.front];
+		if(gSnapshotStats.stepIndex && snapshot.stepIndex > gSnapshotStats.stepIndex+1)
+			gSnapshotStats.skipped += snapshot.stepIndex - gSnapshotStats.stepIndex - 1;
+		gSnapshotStats.stepIndex = snapshot.stepIndex;
+		gSnapshotStats.simMs	 = snapshot.simMs;
+	}
+	else
+	{
+		gSnapshotStats.reused++;
+	}
+
+	const SceneSnapshot& snapshot = gSnapshots.slots[gSnapshots.front];
+	gSnapshotStats.ageMs	= SnapshotClockMs() - snapshot.publishTimeMs;
+	gSnapshotStats.avgAgeMs = gSnapshotStats.avgAgeMs*0.95 + gSnapshotStats.ageMs*0.05;
+
+	return snapshot;
+}
+
+
+//Thread-safe replacement of 'SetDebugVisualization()' while the simulation thread runs
+void RequestDebugVisualization(bool enable)
+{
+	gDebugVisualization = enable;
+	gSnapshotDebugVisualization = enable;
+}
+
+
+void PrintSnapshotStats()
+{
+	printf("snapshots: step %llu  age: %.2f ms (avg %.2f)  sim: %.3f ms/step  skipped: %llu  reused: %llu\n",
+		(unsigned long long)gSnapshotStats.stepIndex, gSnapshotStats.ageMs, gSnapshotStats.avgAgeMs,
+		gSnapshotStats.simMs, (unsigned long long)gSnapshotStats.skipped, (unsigned long long)gSnapshotStats.reused);
+}
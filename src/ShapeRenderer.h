@@ -0,0 +1,573 @@
+/*
+=====================================================================
+
+File Name	  :	ShapeRenderer.h
+
+Description	  : Draws the rigid actors of a PhysX scene as shaded meshes with instanced draw
+				calls, instead of asking PhysX to tessellate every shape into debug lines.
+
+				'ShapeRendererInit()' walks the scene's rigid actors once and groups their box,
+				sphere, capsule and plane shapes into batches; one mesh is built and cached per
+				geometry type and size. Every frame 'ShapeRendererDraw()' only gathers the shape
+				poses into a per-batch instance array and issues one instanced draw per batch.
+
+				When drawing the live poses, the instance buffers persist and only the
+				instances that 'ActiveActorSync.h' reports as moved are re-uploaded.
+
+				'ShapeRendererGatherPoses()' keeps the poses of the last call and skips the
+				bodies that the awake set of 'SimulationEvents.h' reports as settled.
+
+				Debug visualization becomes optional: 'SetDebugVisualization()' turns the
+				scene's visualization off completely, which also removes its simulation cost.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h> //Single header file to include all features of PhysX API
+#include <GL/freeglut.h>  //OpenGL window tool kit
+#include "ActiveActorSync.h" //Poses of the actors that moved
+#include "SimulationEvents.h" //IsSettled()
+#ifdef __APPLE__
+#include <OpenGL/glext.h> //ARB_draw_instanced & ARB_instanced_arrays entry points
+#endif
+#include <iostream>
+#include <vector>
+#include <map>
+
+using namespace std;
+using namespace physx;
+
+
+//Geometry type and size; every distinct key gets its own cached mesh
+struct ShapeKey
+{
+	PxGeometryType::Enum	type;
+	PxVec3					dims;	//Box half extents, sphere (radius,0,0), capsule (radius,halfHeight,0)
+
+	bool operator<(const ShapeKey& other) const
+	{
+		if(type != other.type)		return type < other.type;
+		if(dims.x != other.dims.x)	return dims.x < other.dims.x;
+		if(dims.y != other.dims.y)	return dims.y < other.dims.y;
+		return dims.z < other.dims.z;
+	}
+};
+
+
+//All shapes sharing one mesh
+struct ShapeBatch
+{
+	GLuint					meshVbo;		//Interleaved position + normal
+	GLsizei					numVerts;
+	GLuint					instanceVbo;	//Per instance: 4x4 matrix + RGBA color
+	GLsizei					uploadedInstances;	//Instances in 'instanceVbo' kept up to date by the active actor sync, 0 when stale
+	vector<PxRigidActor*>	actors;
+	vector<PxShape*>		shapes;
+	vector<float>			instanceData;
+};
+
+
+//Counters of the last 'ShapeRendererDraw()'
+struct ShapeRenderStats
+{
+	PxU32 batches;
+	PxU32 instances;
+	PxU32 drawCalls;
+	PxU32 uploadedInstances;	//Instances whose data was sent to GL
+};
+
+
+static const int SHAPE_INSTANCE_FLOATS = 20;		//16 matrix + 4 color
+static const PxReal SHAPE_PLANE_EXTENT = 200.0f;	//Half size of the quad drawn for planes
+
+map<ShapeKey, ShapeBatch>	gShapeBatches;
+vector<PxTransform>			gShapePoseCache;	//Poses of the last 'ShapeRendererGatherPoses()', batch order
+GLuint						gShapeProgram = 0;
+ShapeRenderStats			gShapeRenderStats = {0, 0, 0, 0};
+bool						gDebugVisualization = true;	//Whether 'PxScene::getRenderBuffer()' is filled and drawn
+
+
+void ShapeRendererInit(PxScene& scene);
+void ShapeRendererGatherPoses(vector<PxTransform>& shapePoses);
+void ShapeRendererDraw(const PxTransform* shapePoses = NULL);
+void ShapeRendererRelease();
+void SetDebugVisualization(PxScene& scene, bool enable);
+
+
+
+//-----------Mesh generation------------//
+
+void AppendVertex(vector<float>& verts, const PxVec3& p, const PxVec3& n)
+{
+	verts.push_back(p.x); verts.push_back(p.y); verts.push_back(p.z);
+	verts.push_back(n.x); verts.push_back(n.y); verts.push_back(n.z);
+}
+
+
+void BuildBoxMesh(const PxVec3& h, vector<float>& verts)
+{
+	for(int axis=0; axis<3; axis++)
+	{
+		for(int sign=-1; sign<=1; sign+=2)
+		{
+			PxVec3 n(0.0f);	n[axis] = PxReal(sign);
+			PxVec3 u(0.0f);	u[(axis+1)%3] = h[(axis+1)%3];
+			PxVec3 v(0.0f);	v[(axis+2)%3] = h[(axis+2)%3] * PxReal(sign);
+			PxVec3 c = n.multiply(h);
+
+			AppendVertex(verts, c-u-v, n);	AppendVertex(verts, c+u-v, n);	AppendVertex(verts, c+u+v, n);
+			AppendVertex(verts, c-u-v, n);	AppendVertex(verts, c+u+v, n);	AppendVertex(verts, c-u+v, n);
+		}
+	}
+}
+
+
+//Sphere around the x axis. With 'halfHeight' > 0 the two hemispheres are pushed apart
+//along x and the duplicated equator ring turns into the cylinder of a PhysX capsule.
+void BuildCapsuleMesh(PxReal radius, PxReal halfHeight, vector<float>& verts)
+{
+	const int rings = 12, slices = 16;
+
+	vector<PxReal> angles, offsets;
+	for(int i=0; i<=rings; i++)
+	{
+		PxReal theta = PxPi*PxReal(i)/rings;
+		if(i == rings/2)
+		{
+			angles.push_back(theta); offsets.push_back(halfHeight);
+			angles.push_back(theta); offsets.push_back(-halfHeight);
+		}
+		else
+		{
+			angles.push_back(theta); offsets.push_back(i < rings/2 ? halfHeight : -halfHeight);
+		}
+	}
+
+	for(size_t i=0; i+1<angles.size(); i++)
+	{
+		for(int j=0; j<slices; j++)
+		{
+			PxVec3 n[4], p[4];
+			for(int k=0; k<4; k++)
+			{
+				size_t ring = i + (k==2 || k==3);
+				PxReal phi  = 2.0f*PxPi*PxReal(j + (k==1 || k==2))/slices;
+				n[k] = PxVec3(PxCos(angles[ring]), PxSin(angles[ring])*PxCos(phi), PxSin(angles[ring])*PxSin(phi));
+				p[k] = n[k]*radius + PxVec3(offsets[ring], 0, 0);
+			}
+
+			AppendVertex(verts, p[0], n[0]);	AppendVertex(verts, p[2], n[2]);	AppendVertex(verts, p[1], n[1]);
+			AppendVertex(verts, p[0], n[0]);	AppendVertex(verts, p[3], n[3]);	AppendVertex(verts, p[2], n[2]);
+		}
+	}
+}
+
+
+//PhysX planes are x = 0 in shape space, with the normal along +x
+void BuildPlaneMesh(vector<float>& verts)
+{
+	const PxReal s = SHAPE_PLANE_EXTENT;
+	PxVec3 n(1,0,0);
+
+	AppendVertex(verts, PxVec3(0,-s,-s), n);	AppendVertex(verts, PxVec3(0, s,-s), n);	AppendVertex(verts, PxVec3(0, s, s), n);
+	AppendVertex(verts, PxVec3(0,-s,-s), n);	AppendVertex(verts, PxVec3(0, s, s), n);	AppendVertex(verts, PxVec3(0,-s, s), n);
+}
+
+
+//Returns false for geometry types this renderer does not draw (convex, meshes, height fields)
+bool GetShapeKey(const PxShape& shape, ShapeKey& key)
+{
+	key.type = shape.getGeometryType();
+	key.dims = PxVec3(0.0f);
+
+	switch(key.type)
+	{
+	case PxGeometryType::eBOX:
+		{
+			PxBoxGeometry box;
+			shape.getBoxGeometry(box);
+			key.dims = box.halfExtents;
+			return true;
+		}
+	case PxGeometryType::eSPHERE:
+		{
+			PxSphereGeometry sphere;
+			shape.getSphereGeometry(sphere);
+			key.dims.x = sphere.radius;
+			return true;
+		}
+	case PxGeometryType::eCAPSULE:
+		{
+			PxCapsuleGeometry capsule;
+			shape.getCapsuleGeometry(capsule);
+			key.dims.x = capsule.radius;
+			key.dims.y = capsule.halfHeight;
+			return true;
+		}
+	case PxGeometryType::ePLANE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+
+void BuildShapeMesh(const ShapeKey& key, ShapeBatch& batch)
+{
+	vector<float> verts;
+	switch(key.type)
+	{
+	case PxGeometryType::eBOX:		BuildBoxMesh(key.dims, verts);					break;
+	case PxGeometryType::eSPHERE:	BuildCapsuleMesh(key.dims.x, 0.0f, verts);		break;
+	case PxGeometryType::eCAPSULE:	BuildCapsuleMesh(key.dims.x, key.dims.y, verts);	break;
+	default:						BuildPlaneMesh(verts);							break;
+	}
+
+	glGenBuffers(1, &batch.meshVbo);
+	glBindBuffer(GL_ARRAY_BUFFER, batch.meshVbo);
+	glBufferData(GL_ARRAY_BUFFER, verts.size()*sizeof(float), &verts[0], GL_STATIC_DRAW);
+	glGenBuffers(1, &batch.instanceVbo);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	batch.numVerts = GLsizei(verts.size()/6);
+}
+
+
+
+//-----------Shader------------//
+
+//Generic attribute locations shared by the shader and 'ShapeRendererDraw()'
+enum ShapeAttrib
+{
+	eATTRIB_POSITION	= 0,
+	eATTRIB_NORMAL		= 1,
+	eATTRIB_MODEL		= 2,	//4 consecutive locations, one per matrix column
+	eATTRIB_COLOR		= 6
+};
+
+
+GLuint CompileShapeShader(GLenum type, const char* source)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+
+	GLint status = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if(!status)
+	{
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		cerr<<"Shape shader compile error: "<<log<<endl;
+	}
+	return shader;
+}
+
+
+GLuint CreateShapeProgram()
+{
+	const char* vertexSource =
+		"#version 120\n"
+		"attribute vec3 position;\n"
+		"attribute vec3 normal;\n"
+		"attribute vec4 model0, model1, model2, model3;\n"
+		"attribute vec4 color;\n"
+		"varying vec3 vNormal;\n"
+		"varying vec4 vColor;\n"
+		"void main()\n"
+		"{\n"
+		"	mat4 model = mat4(model0, model1, model2, model3);\n"
+		"	vNormal = gl_NormalMatrix * (mat3(model0.xyz, model1.xyz, model2.xyz) * normal);\n"
+		"	vColor = color;\n"
+		"	gl_Position = gl_ModelViewProjectionMatrix * model * vec4(position, 1.0);\n"
+		"}\n";
+
+	const char* fragmentSource =
+		"#version 120\n"
+		"varying vec3 vNormal;\n"
+		"varying vec4 vColor;\n"
+		"void main()\n"
+		"{\n"
+		"	float diffuse = abs(dot(normalize(vNormal), normalize(vec3(0.3, 0.8, 0.5))));\n"
+		"	gl_FragColor = vec4(vColor.rgb * (0.3 + 0.7*diffuse), vColor.a);\n"
+		"}\n";
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, CompileShapeShader(GL_VERTEX_SHADER, vertexSource));
+	glAttachShader(program, CompileShapeShader(GL_FRAGMENT_SHADER, fragmentSource));
+
+	glBindAttribLocation(program, eATTRIB_POSITION,	"position");
+	glBindAttribLocation(program, eATTRIB_NORMAL,	"normal");
+	glBindAttribLocation(program, eATTRIB_MODEL+0,	"model0");
+	glBindAttribLocation(program, eATTRIB_MODEL+1,	"model1");
+	glBindAttribLocation(program, eATTRIB_MODEL+2,	"model2");
+	glBindAttribLocation(program, eATTRIB_MODEL+3,	"model3");
+	glBindAttribLocation(program, eATTRIB_COLOR,	"color");
+	glLinkProgram(program);
+
+	GLint status = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if(!status)
+	{
+		char log[1024];
+		glGetProgramInfoLog(program, sizeof(log), NULL, log);
+		cerr<<"Shape shader link error: "<<log<<endl;
+	}
+	return program;
+}
+
+
+
+//-----------Renderer------------//
+
+//Walks the rigid actors of 'scene' and groups their shapes into batches, and gives
+//each shape its slot in the active actor sync. Call again after adding or removing actors.
+void ShapeRendererInit(PxScene& scene)
+{
+	if(!gShapeProgram)
+		gShapeProgram = CreateShapeProgram();
+
+	for(map<ShapeKey, ShapeBatch>::iterator it = gShapeBatches.begin(); it != gShapeBatches.end(); ++it)
+	{
+		it->second.actors.clear();
+		it->second.shapes.clear();
+		it->second.uploadedInstances = 0;
+	}
+	gShapePoseCache.clear();
+
+	PxActorTypeFlags types = PxActorTypeFlag::eRIGID_STATIC | PxActorTypeFlag::eRIGID_DYNAMIC;
+	vector<PxActor*> actors(scene.getNbActors(types));
+	if(actors.empty())
+		return;
+	scene.getActors(types, &actors[0], PxU32(actors.size()));
+
+	for(size_t i=0; i<actors.size(); i++)
+	{
+		PxRigidActor* actor = actors[i]->is<PxRigidActor>();
+
+		vector<PxShape*> shapes(actor->getNbShapes());
+		if(shapes.empty())
+			continue;
+		actor->getShapes(&shapes[0], PxU32(shapes.size()));
+
+		for(size_t j=0; j<shapes.size(); j++)
+		{
+			//Trigger shapes are invisible volumes
+			if(shapes[j]->getFlags() & PxShapeFlag::eTRIGGER_SHAPE)
+				continue;
+
+			ShapeKey key;
+			if(!GetShapeKey(*shapes[j], key))
+				continue;
+
+			map<ShapeKey, ShapeBatch>::iterator it = gShapeBatches.find(key);
+			if(it == gShapeBatches.end())
+			{
+				it = gShapeBatches.insert(make_pair(key, ShapeBatch())).first;
+				BuildShapeMesh(key, it->second);
+				it->second.uploadedInstances = 0;
+			}
+
+			it->second.actors.push_back(actor);
+			it->second.shapes.push_back(shapes[j]);
+		}
+	}
+
+	//Slots in batch order, as the draw loop walks them
+	vector<PxRigidActor*> slotActors;
+	vector<PxShape*> slotShapes;
+	for(map<ShapeKey, ShapeBatch>::iterator it = gShapeBatches.begin(); it != gShapeBatches.end(); ++it)
+	{
+		slotActors.insert(slotActors.end(), it->second.actors.begin(), it->second.actors.end());
+		slotShapes.insert(slotShapes.end(), it->second.shapes.begin(), it->second.shapes.end());
+	}
+	ActiveActorSyncInit(scene, slotActors, slotShapes);
+}
+
+
+//Copies the global pose of every drawn shape, in batch order, e.g. into a scene snapshot.
+//Shapes of bodies that stayed asleep since the previous call keep their cached pose.
+//Call from the thread that fetches the results, the awake set changes in 'fetchResults()'.
+void ShapeRendererGatherPoses(vector<PxTransform>& shapePoses)
+{
+	size_t count = 0;
+	for(map<ShapeKey, ShapeBatch>::iterator it = gShapeBatches.begin(); it != gShapeBatches.end(); ++it)
+		count += it->second.shapes.size();
+
+	bool refreshAll = gShapePoseCache.size() != count;
+	gShapePoseCache.resize(count);
+
+	size_t slot = 0;
+	for(map<ShapeKey, ShapeBatch>::iterator it = gShapeBatches.begin(); it != gShapeBatches.end(); ++it)
+	{
+		ShapeBatch& batch = it->second;
+		for(size_t i=0; i<batch.shapes.size(); i++, slot++)
+			if(refreshAll || !IsSettled(batch.actors[i]))
+				gShapePoseCache[slot] = PxShapeExt::getGlobalPose(*batch.shapes[i], *batch.actors[i]);
+	}
+	AwakeSetClearChanged();
+
+	shapePoses.assign(gShapePoseCache.begin(), gShapePoseCache.end());
+}
+
+
+void WriteShapeInstance(ShapeBatch& batch, size_t i, const PxTransform& pose)
+{
+	const float staticColor[4]	= { 0.55f, 0.55f, 0.55f, 1.0f };
+	const float dynamicColor[4]	= { 0.90f, 0.55f, 0.20f, 1.0f };
+
+	float* pOut = &batch.instanceData[i*SHAPE_INSTANCE_FLOATS];
+	PxMat44 model(pose);
+	memcpy(pOut, model.front(), 16*sizeof(float));	//Column major, as GL expects
+
+	const float* color = batch.actors[i]->is<PxRigidDynamic>() ? dynamicColor : staticColor;
+	memcpy(pOut+16, color, 4*sizeof(float));
+}
+
+
+//Fills the instance array of 'batch' from 'shapePoses', or from the live actor poses when NULL
+void GatherShapeInstances(ShapeBatch& batch, const PxTransform* shapePoses)
+{
+	batch.instanceData.resize(batch.shapes.size()*SHAPE_INSTANCE_FLOATS);
+	for(size_t i=0; i<batch.shapes.size(); i++)
+		WriteShapeInstance(batch, i, shapePoses ? shapePoses[i] : PxShapeExt::getGlobalPose(*batch.shapes[i], *batch.actors[i]));
+}
+
+
+//Brings the bound instance buffer of 'batch', whose slots start at 'firstSlot', up to date with
+//the sync's pose array. Only the dirty ranges are uploaded once the buffer holds every instance.
+void UploadSyncedInstances(ShapeBatch& batch, PxU32 firstSlot, const vector<DirtyRange>& ranges)
+{
+	const PoseArraySoA& poses = gActiveActorSync.poses;
+	GLsizei count = GLsizei(batch.shapes.size());
+
+	if(batch.uploadedInstances != count)
+	{
+		batch.instanceData.resize(count*SHAPE_INSTANCE_FLOATS);
+		for(GLsizei i=0; i<count; i++)
+			WriteShapeInstance(batch, i, poses.get(firstSlot + i));
+		glBufferData(GL_ARRAY_BUFFER, batch.instanceData.size()*sizeof(float), &batch.instanceData[0], GL_DYNAMIC_DRAW);
+
+		batch.uploadedInstances = count;
+		gShapeRenderStats.uploadedInstances += count;
+		return;
+	}
+
+	for(size_t r=0; r<ranges.size(); r++)
+	{
+		PxU32 begin = PxMax(ranges[r].begin, firstSlot);
+		PxU32 end	= PxMin(ranges[r].end, firstSlot + PxU32(count));
+		if(begin >= end)
+			continue;
+
+		for(PxU32 slot=begin; slot<end; slot++)
+			WriteShapeInstance(batch, slot - firstSlot, poses.get(slot));
+
+		size_t offset = (begin - firstSlot)*SHAPE_INSTANCE_FLOATS;
+		glBufferSubData(GL_ARRAY_BUFFER, offset*sizeof(float), (end - begin)*SHAPE_INSTANCE_FLOATS*sizeof(float), &batch.instanceData[offset]);
+		gShapeRenderStats.uploadedInstances += end - begin;
+	}
+}
+
+
+//'shapePoses' is an array filled by 'ShapeRendererGatherPoses()'; when NULL the poses of the
+//active actor sync are drawn, or, without it, read from the actors while the scene is not simulating.
+void ShapeRendererDraw(const PxTransform* shapePoses)
+{
+	gShapeRenderStats.batches	= 0;
+	gShapeRenderStats.instances = 0;
+	gShapeRenderStats.drawCalls = 0;
+	gShapeRenderStats.uploadedInstances = 0;
+
+	bool synced = !shapePoses && gActiveActorSync.enabled;
+	const vector<DirtyRange>* dirtyRanges = synced ? &ActiveActorSyncDirtyRanges() : NULL;
+	PxU32 firstSlot = 0;
+
+	glEnable(GL_DEPTH_TEST);
+	glUseProgram(gShapeProgram);
+
+	for(map<ShapeKey, ShapeBatch>::iterator it = gShapeBatches.begin(); it != gShapeBatches.end(); ++it)
+	{
+		ShapeBatch& batch = it->second;
+		if(batch.shapes.empty())
+			continue;
+
+		//Per-vertex data
+		glBindBuffer(GL_ARRAY_BUFFER, batch.meshVbo);
+		glEnableVertexAttribArray(eATTRIB_POSITION);
+		glVertexAttribPointer(eATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (const GLvoid*)0);
+		glEnableVertexAttribArray(eATTRIB_NORMAL);
+		glVertexAttribPointer(eATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (const GLvoid*)(3*sizeof(float)));
+
+		//Per-instance data. Synced, the buffer persists and takes the moved instances only;
+		//otherwise it is refilled and orphaned every frame.
+		glBindBuffer(GL_ARRAY_BUFFER, batch.instanceVbo);
+		if(synced)
+		{
+			UploadSyncedInstances(batch, firstSlot, *dirtyRanges);
+		}
+		else
+		{
+			GatherShapeInstances(batch, shapePoses);
+			glBufferData(GL_ARRAY_BUFFER, batch.instanceData.size()*sizeof(float), &batch.instanceData[0], GL_STREAM_DRAW);
+			batch.uploadedInstances = 0;
+			gShapeRenderStats.uploadedInstances += PxU32(batch.shapes.size());
+		}
+		firstSlot += PxU32(batch.shapes.size());
+		if(shapePoses)
+			shapePoses += batch.shapes.size();
+		for(int c=0; c<5; c++)
+		{
+			GLuint location = c<4 ? eATTRIB_MODEL+c : eATTRIB_COLOR;
+			glEnableVertexAttribArray(location);
+			glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, SHAPE_INSTANCE_FLOATS*sizeof(float), (const GLvoid*)(c*4*sizeof(float)));
+			glVertexAttribDivisorARB(location, 1);
+		}
+
+		glDrawArraysInstancedARB(GL_TRIANGLES, 0, batch.numVerts, GLsizei(batch.shapes.size()));
+
+		for(int c=0; c<5; c++)
+		{
+			GLuint location = c<4 ? eATTRIB_MODEL+c : eATTRIB_COLOR;
+			glVertexAttribDivisorARB(location, 0);
+			glDisableVertexAttribArray(location);
+		}
+		glDisableVertexAttribArray(eATTRIB_NORMAL);
+		glDisableVertexAttribArray(eATTRIB_POSITION);
+
+		gShapeRenderStats.batches++;
+		gShapeRenderStats.instances += PxU32(batch.shapes.size());
+		gShapeRenderStats.drawCalls++;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glUseProgram(0);
+
+	if(synced)
+		ActiveActorSyncClearDirty();
+}
+
+
+void ShapeRendererRelease()
+{
+	for(map<ShapeKey, ShapeBatch>::iterator it = gShapeBatches.begin(); it != gShapeBatches.end(); ++it)
+	{
+		glDeleteBuffers(1, &it->second.meshVbo);
+		glDeleteBuffers(1, &it->second.instanceVbo);
+	}
+	gShapeBatches.clear();
+
+	if(gShapeProgram)
+		glDeleteProgram(gShapeProgram);
+	gShapeProgram = 0;
+}
+
+
+//Global visualization scale 0 makes PhysX skip filling the render buffer altogether
+void SetDebugVisualization(PxScene& scene, bool enable)
+{
+	gDebugVisualization = enable;
+	scene.setVisualizationParameter(PxVisualizationParameter::eSCALE, enable ? 1.0f : 0.0f);
+}
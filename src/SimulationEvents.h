@@ -1,11 +1,182 @@
 
 
+#pragma once
+
 #include <iostream> 
+#include <cstdio>
+#include <vector>
 #include <PxPhysicsAPI.h> //Single header file to include all features of PhysX API 
 
 using namespace std;
 using namespace physx; 
 
+
+//Awake state of the dynamic bodies of a scene, kept by 'onWake()' and 'onSleep()' below so that
+//game logic and rendering can skip sleeping bodies without asking PhysX. A tracked body stores
+//its index + 1 in 'userData'; untracked actors count as awake.
+struct AwakeSet
+{
+	vector<PxRigidDynamic*>	bodies;			//Tracked bodies by index
+	vector<PxU32>			awake;			//Bit per body, set while it is awake
+	vector<PxU32>			changed;		//Bit per body, set when it woke or slept since 'AwakeSetClearChanged()'
+	PxU32					awakeCount;
+	PxU32					wokenThisStep;
+	PxU32					sleptThisStep;
+};
+
+
+struct AwakeSetStats
+{
+	PxU64	steps;				//'AwakeSetStepCompleted()' calls
+	PxU64	awakeBodySteps;		//Awake bodies summed over all steps
+	PxU64	asleepBodySteps;	//Sleeping bodies summed over all steps
+	PxU64	wakes;
+	PxU64	sleeps;
+};
+
+
+AwakeSet		gAwakeSet;
+AwakeSetStats	gAwakeSetStats = { 0, 0, 0, 0, 0 };
+
+
+void AwakeSetTrack(PxScene& scene);
+int AwakeSetIndex(const PxActor* actor);
+bool IsAwake(const PxActor* actor);
+bool IsSettled(const PxActor* actor);
+void AwakeSetClearChanged();
+void AwakeSetStepCompleted();
+void PrintAwakeSetStats();
+
+
+//Tracks every non-kinematic rigid dynamic of 'scene' whose 'userData' is free, replacing the previous scene's bodies.
+//Register a 'SimulationEvents' with 'PxScene::setSimulationEventCallback()' for the set to follow the simulation.
+void AwakeSetTrack(PxScene& scene)
+{
+	AwakeSet& a = gAwakeSet;
+
+	vector<PxActor*> actors(scene.getNbActors(PxActorTypeFlag::eRIGID_DYNAMIC));
+	if(!actors.empty())
+		scene.getActors(PxActorTypeFlag::eRIGID_DYNAMIC, &actors[0], PxU32(actors.size()));
+
+	//Bodies tracked before keep no index; those of released scenes are never dereferenced
+	for(size_t i=0; i<actors.size(); i++)
+		if(AwakeSetIndex(actors[i]) >= 0)
+			actors[i]->userData = NULL;
+	a.bodies.clear();
+
+	for(size_t i=0; i<actors.size(); i++)
+	{
+		PxRigidDynamic* body = static_cast<PxRigidDynamic*>(actors[i]);
+		if(body->userData || (body->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC))
+			continue;	//Owned by someone else, e.g. a character controller
+
+		body->setActorFlag(PxActorFlag::eSEND_SLEEP_NOTIFIES, true);	//onWake() and onSleep() are only sent for flagged actors
+		body->userData = (void*)(a.bodies.size() + 1);
+		a.bodies.push_back(body);
+	}
+
+	PxU32 words = PxU32(a.bodies.size() + 31)/32;
+	a.awake.assign(words, 0);
+	a.changed.assign(words, 0);
+	a.awakeCount = a.wokenThisStep = a.sleptThisStep = 0;
+	for(PxU32 i=0; i<a.bodies.size(); i++)
+	{
+		if(a.bodies[i]->isSleeping())
+			continue;
+		a.awake[i >> 5] |= 1u << (i & 31);
+		a.awakeCount++;
+	}
+}
+
+
+//Index into 'gAwakeSet.bodies', or -1 for untracked actors
+int AwakeSetIndex(const PxActor* actor)
+{
+	size_t index = size_t(actor->userData);
+	if(!index || index > gAwakeSet.bodies.size() || gAwakeSet.bodies[index - 1] != actor)
+		return -1;
+	return int(index - 1);
+}
+
+
+bool IsAwake(const PxActor* actor)
+{
+	int i = AwakeSetIndex(actor);
+	return i < 0 || (gAwakeSet.awake[i >> 5] >> (i & 31)) & 1;
+}
+
+
+//Whether 'actor' is asleep and has not changed state since the last 'AwakeSetClearChanged()',
+//i.e. its pose is the one seen then
+bool IsSettled(const PxActor* actor)
+{
+	int i = AwakeSetIndex(actor);
+	return i >= 0 && !(((gAwakeSet.awake[i >> 5] | gAwakeSet.changed[i >> 5]) >> (i & 31)) & 1);
+}
+
+
+void SetAwake(PxActor** actors, PxU32 count, bool awake)
+{
+	AwakeSet& a = gAwakeSet;
+	for(PxU32 j=0; j<count; j++)
+	{
+		int i = AwakeSetIndex(actors[j]);
+		if(i < 0)
+			continue;
+
+		PxU32 bit = 1u << (i & 31);
+		a.changed[i >> 5] |= bit;
+		if(bool(a.awake[i >> 5] & bit) == awake)
+			continue;
+
+		if(awake)
+		{
+			a.awake[i >> 5] |= bit;
+			a.awakeCount++;
+			a.wokenThisStep++;
+		}
+		else
+		{
+			a.awake[i >> 5] &= ~bit;
+			a.awakeCount--;
+			a.sleptThisStep++;
+		}
+	}
+}
+
+
+void AwakeSetClearChanged()
+{
+	gAwakeSet.changed.assign(gAwakeSet.changed.size(), 0);
+}
+
+
+//Call after every 'fetchResults()'
+void AwakeSetStepCompleted()
+{
+	AwakeSet& a = gAwakeSet;
+	AwakeSetStats& s = gAwakeSetStats;
+	s.steps++;
+	s.awakeBodySteps  += a.awakeCount;
+	s.asleepBodySteps += a.bodies.size() - a.awakeCount;
+	s.wakes			  += a.wokenThisStep;
+	s.sleeps		  += a.sleptThisStep;
+	a.wokenThisStep = a.sleptThisStep = 0;
+}
+
+
+void PrintAwakeSetStats()
+{
+	const AwakeSetStats& s = gAwakeSetStats;
+	if(!s.steps || gAwakeSet.bodies.empty())
+		return;
+
+	printf("awake set: %u bodies  awake per step: %.1f  asleep per step: %.1f  wakes: %llu  sleeps: %llu  now awake: %u\n",
+		PxU32(gAwakeSet.bodies.size()), double(s.awakeBodySteps)/s.steps, double(s.asleepBodySteps)/s.steps,
+		(unsigned long long)s.wakes, (unsigned long long)s.sleeps, gAwakeSet.awakeCount);
+}
+
+
 class SimulationEvents: public PxSimulationEventCallback
 {
 	
@@ -16,11 +187,13 @@ class SimulationEvents: public PxSimulationEventCallback
 	
 	void onWake(PxActor** actors, PxU32 count)	//This is called during PxScene::fetchResults with the actors which have just been woken up.						
 	{  
+		SetAwake(actors, count, true);
 	}
 	
 	
 	void onSleep(PxActor** actors, PxU32 count)	//This is called during PxScene::fetchResults with the actors which have just been put to sleep.
 	{  
+		SetAwake(actors, count, false);
 	}
 
 	void onAdvance(const PxRigidBody*const* bodyBuffer, const PxTransform* poseBuffer, const PxU32 count)
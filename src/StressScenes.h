@@ -0,0 +1,280 @@
+/*
+=====================================================================
+
+File Name	  :	StressScenes.h
+
+Description	  : Generator of large scenes for scaling measurements, built with the same
+				actor creation calls as the chapters ('PxCreateDynamic()', joints,
+				'createParticleSystem()', 'CreateCloth()' of 'ChapterScenes.h').
+
+				  pyramids    Box pyramids of 20 levels on a grid
+				  spheres     Piles of spheres dropped in columns
+				  chains      Hanging chains of 50 spheres linked by spherical joints
+				  ragdolls    A crowd of 11-capsule ragdolls with limited spherical joints
+				  particles   One particle volume
+				  cloth       32x32 cloth grids hanging side by side
+
+				'bodies' is the number of rigid bodies, particles or cloth particles to
+				create; the generators round it to whole pyramids, chains, ragdolls or
+				grids and return the number actually created.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "ChapterScenes.h"		//ChapterSceneDesc(), AddGroundPlane(), CreateCloth()
+#include <cstring>
+#include <vector>
+
+using namespace std;
+using namespace physx;
+
+
+typedef PxU32 (*AddStressActorsFunction)(PxPhysics& physics, PxScene& scene, PxMaterial& material, PxU32 bodies);
+
+struct StressScene
+{
+	const char*				name;
+	AddStressActorsFunction	add;
+	const char*				unit;		//What 'bodies' counts
+};
+
+
+PxU32 AddPyramids(PxPhysics& physics, PxScene& scene, PxMaterial& material, PxU32 bodies);
+PxU32 AddSpherePiles(PxPhysics& physics, PxScene& scene, PxMaterial& material, PxU32 bodies);
+PxU32 AddChains(PxPhysics& physics, PxScene& scene, PxMaterial& material, PxU32 bodies);
+PxU32 AddRagdolls(PxPhysics& physics, PxScene& scene, PxMaterial& material, PxU32 bodies);
+PxU32 AddParticleVolume(PxPhysics& physics, PxScene& scene, PxMaterial& material, PxU32 bodies);
+PxU32 AddClothGrids(PxPhysics& physics, PxScene& scene, PxMaterial& material, PxU32 bodies);
+const StressScene* FindStressScene(const char* name);
+PxScene* CreateStressScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, const StressScene& stress, PxU32 bodies, PxU32& created);
+
+
+const PxU32 STRESS_PYRAMID_LEVELS	= 20;	//210 boxes per pyramid
+const PxU32 STRESS_CHAIN_LINKS		= 50;
+const PxU32 STRESS_RAGDOLL_BODIES	= 11;
+const PxU32 STRESS_CLOTH_RESOLUTION = 32;	//1024 particles per grid
+
+
+
+//Square grid position of item 'i' out of 'count', 'spacing' apart and centered on the origin
+PxVec3 StressGridPosition(PxU32 i, PxU32 count, PxReal spacing)
+{
+	PxU32 side = PxU32(PxCeil(PxSqrt(PxReal(count))));
+	PxReal offset = 0.5f*(side - 1)*spacing;
+	return PxVec3(PxReal(i % side)*spacing - offset, 0.0f, PxReal(i / side)*spacing - offset);
+}
+
+
+PxU32 AddPyramids(PxPhysics& physics, PxScene& scene, PxMaterial& material, PxU32 bodies)
+{
+	const PxU32 perPyramid = STRESS_PYRAMID_LEVELS*(STRESS_PYRAMID_LEVELS+1)/2;
+	PxU32 pyramids = PxMax(1u, (bodies + perPyramid/2)/perPyramid);
+
+	PxBoxGeometry box(0.5f, 0.5f, 0.5f);
+	for(PxU32 p=0; p<pyramids; p++)
+	{
+		PxVec3 base = StressGridPosition(p, pyramids, STRESS_PYRAMID_LEVELS + 4.0f) + PxVec3(-0.5f*STRESS_PYRAMID_LEVELS, 0.5f, 0.0f);
+		for(PxU32 level=0; level<STRESS_PYRAMID_LEVELS; level++)
+			for(PxU32 i=0; i<STRESS_PYRAMID_LEVELS-level; i++)
+			{
+				PxVec3 pos = base + PxVec3(i + level*0.5f, PxReal(level), 0);
+				scene.addActor(*PxCreateDynamic(physics, PxTransform(pos), box, material, 1.0f));
+			}
+	}
+	return pyramids*perPyramid;
+}
+
+
+//Columns of 20 spheres, slightly offset so they topple into piles
+PxU32 AddSpherePiles(PxPhysics& physics, PxScene& scene, PxMaterial& material, PxU32 bodies)
+{
+	const PxU32 perColumn = 20;
+	PxU32 columns = PxMax(1u, (bodies + perColumn/2)/perColumn);
+
+	PxSphereGeometry sphere(0.5f);
+	for(PxU32 c=0; c<columns; c++)
+	{
+		PxVec3 base = StressGridPosition(c, columns, 1.5f);
+		for(PxU32 i=0; i<perColumn; i++)
+		{
+			PxReal jitter = 0.05f*PxReal((c*7 + i*13) % 5) - 0.1f;	//Deterministic, the runs must be comparable
+			PxVec3 pos = base + PxVec3(jitter, 0.5f + 1.05f*i, -jitter);
+			scene.addActor(*PxCreateDynamic(physics, PxTransform(pos), sphere, material, 1.0f));
+		}
+	}
+	return columns*perColumn;
+}
+
+
+//Chains like the one of CH5, started horizontally so they swing
+PxU32 AddChains(PxPhysics& physics, PxScene& scene, PxMaterial& material, PxU32 bodies)
+{
+	PxU32 chains = PxMax(1u, (bodies + STRESS_CHAIN_LINKS/2)/STRESS_CHAIN_LINKS);
+	PxReal radius = 0.5f;
+	PxVec3 offset(radius*1.5f, 0, 0);
+	PxReal height = 2.0f*STRESS_CHAIN_LINKS*offset.x + 5.0f;
+
+	for(PxU32 c=0; c<chains; c++)
+	{
+		PxVec3 pos = StressGridPosition(c, chains, 4.0f) + PxVec3(0, height, 0);
+
+		PxRigidActor* prevActor = PxCreateStatic(physics, PxTransform(pos), PxSphereGeometry(radius), material);
+		scene.addActor(*prevActor);
+
+		for(PxU32 i=1; i<=STRESS_CHAIN_LINKS; i++)
+		{
+			PxRigidDynamic* dynamic = PxCreateDynamic(physics, PxTransform(pos + 2.0f*offset*PxReal(i)), PxSphereGeometry(radius), material, 1.0f);
+			scene.addActor(*dynamic);
+			PxSphericalJointCreate(physics, prevActor, PxTransform(offset), dynamic, PxTransform(-offset));
+			prevActor = dynamic;
+		}
+	}
+	return chains*STRESS_CHAIN_LINKS;
+}
+
+
+//Links 'child' to 'parent' at the world position 'anchor' with a spherical joint limited to 'cone' radians
+void AddRagdollJoint(PxPhysics& physics, PxRigidActor* parent, PxRigidActor* child, const PxVec3& anchor, PxReal cone)
+{
+	PxTransform frame(anchor);
+	PxSphericalJoint* joint = PxSphericalJointCreate(physics, parent, parent->getGlobalPose().transformInv(frame),
+															child, child->getGlobalPose().transformInv(frame));
+	joint->setLimitCone(PxJointLimitCone(cone, cone, 0.05f));
+	joint->setSphericalJointFlag(PxSphericalJointFlag::eLIMIT_ENABLED, true);
+}
+
+
+PxRigidDynamic* AddRagdollPart(PxPhysics& physics, PxScene& scene, PxMaterial& material, const PxVec3& pos, PxReal radius, PxReal halfHeight, bool vertical)
+{
+	//Capsules extend along x, turned upright for limbs and torso
+	PxQuat rotation = vertical ? PxQuat(PxHalfPi, PxVec3(0,0,1)) : PxQuat(PxIdentity);
+	PxRigidDynamic* part = PxCreateDynamic(physics, PxTransform(pos, rotation), PxCapsuleGeometry(radius, halfHeight), material, 1.0f);
+	part->setSolverIterationCounts(8, 2);
+	scene.addActor(*part);
+	return part;
+}
+
+
+//Ragdolls standing in a crowd, each falls over on its own
+PxU32 AddRagdolls(PxPhysics& physics, PxScene& scene, PxMaterial& material, PxU32 bodies)
+{
+	PxU32 ragdolls = PxMax(1u, (bodies + STRESS_RAGDOLL_BODIES/2)/STRESS_RAGDOLL_BODIES);
+
+	for(PxU32 r=0; r<ragdolls; r++)
+	{
+		PxVec3 base = StressGridPosition(r, ragdolls, 2.5f);
+
+		PxRigidDynamic* pelvis	  = AddRagdollPart(physics, scene, material, base + PxVec3(0.00f, 2.00f, 0), 0.15f, 0.15f, false);
+		PxRigidDynamic* torso	  = AddRagdollPart(physics, scene, material, base + PxVec3(0.00f, 2.55f, 0), 0.18f, 0.20f, true);
+		PxRigidDynamic* head	  = AddRagdollPart(physics, scene, material, base + PxVec3(0.00f, 3.15f, 0), 0.15f, 0.01f, true);
+		PxRigidDynamic* upperArmL = AddRagdollPart(physics, scene, material, base + PxVec3(-0.45f, 2.75f, 0), 0.07f, 0.15f, false);
+		PxRigidDynamic* lowerArmL = AddRagdollPart(physics, scene, material, base + PxVec3(-0.90f, 2.75f, 0), 0.06f, 0.15f, false);
+		PxRigidDynamic* upperArmR = AddRagdollPart(physics, scene, material, base + PxVec3( 0.45f, 2.75f, 0), 0.07f, 0.15f, false);
+		PxRigidDynamic* lowerArmR = AddRagdollPart(physics, scene, material, base + PxVec3( 0.90f, 2.75f, 0), 0.06f, 0.15f, false);
+		PxRigidDynamic* thighL	  = AddRagdollPart(physics, scene, material, base + PxVec3(-0.15f, 1.45f, 0), 0.09f, 0.22f, true);
+		PxRigidDynamic* shinL	  = AddRagdollPart(physics, scene, material, base + PxVec3(-0.15f, 0.65f, 0), 0.08f, 0.22f, true);
+		PxRigidDynamic* thighR	  = AddRagdollPart(physics, scene, material, base + PxVec3( 0.15f, 1.45f, 0), 0.09f, 0.22f, true);
+		PxRigidDynamic* shinR	  = AddRagdollPart(physics, scene, material, base + PxVec3( 0.15f, 0.65f, 0), 0.08f, 0.22f, true);
+
+		AddRagdollJoint(physics, pelvis, torso, base + PxVec3(0.00f, 2.15f, 0), PxPi/6);
+		AddRagdollJoint(physics, torso, head, base + PxVec3(0.00f, 2.95f, 0), PxPi/4);
+		AddRagdollJoint(physics, torso, upperArmL, base + PxVec3(-0.25f, 2.75f, 0), PxPi/2);
+		AddRagdollJoint(physics, upperArmL, lowerArmL, base + PxVec3(-0.68f, 2.75f, 0), PxPi/3);
+		AddRagdollJoint(physics, torso, upperArmR, base + PxVec3( 0.25f, 2.75f, 0), PxPi/2);
+		AddRagdollJoint(physics, upperArmR, lowerArmR, base + PxVec3( 0.68f, 2.75f, 0), PxPi/3);
+		AddRagdollJoint(physics, pelvis, thighL, base + PxVec3(-0.15f, 1.80f, 0), PxPi/4);
+		AddRagdollJoint(physics, thighL, shinL, base + PxVec3(-0.15f, 1.05f, 0), PxPi/4);
+		AddRagdollJoint(physics, pelvis, thighR, base + PxVec3( 0.15f, 1.80f, 0), PxPi/4);
+		AddRagdollJoint(physics, thighR, shinR, base + PxVec3( 0.15f, 1.05f, 0), PxPi/4);
+
+		torso->addForce(PxVec3(PxReal(r % 3) - 1.0f, 0, PxReal(r % 5)*0.5f - 1.0f), PxForceMode::eVELOCITY_CHANGE);	//Deterministic push
+	}
+	return ragdolls*STRESS_RAGDOLL_BODIES;
+}
+
+
+//A cube of particles, as in CH8 at a larger size
+PxU32 AddParticleVolume(PxPhysics& physics, PxScene& scene, PxMaterial& material, PxU32 bodies)
+{
+	PxParticleSystem* ps = physics.createParticleSystem(bodies);
+	if(!ps)
+		return 0;
+	scene.addActor(*ps);
+
+	PxU32 side = PxU32(PxCeil(PxPow(PxReal(bodies), 1.0f/3.0f)));
+	vector<PxVec3> positions;
+	vector<PxU32>  indices;
+	positions.reserve(bodies);
+	indices.reserve(bodies);
+	for(PxU32 i=0; i<side && positions.size()<bodies; i++)
+		for(PxU32 j=0; j<side && positions.size()<bodies; j++)
+			for(PxU32 k=0; k<side && positions.size()<bodies; k++)
+			{
+				positions.push_back(PxVec3(PxReal(i), PxReal(j) + 5.0f, PxReal(k)) - PxVec3(0.5f*side, 0, 0.5f*side));
+				indices.push_back(PxU32(indices.size()));
+			}
+
+	PxParticleCreationData particleCreationData;
+	particleCreationData.numParticles	= PxU32(indices.size());
+	particleCreationData.indexBuffer	= PxStrideIterator<const PxU32>(&indices[0]);
+	particleCreationData.positionBuffer = PxStrideIterator<const PxVec3>(&positions[0]);
+
+	return ps->createParticles(particleCreationData) ? PxU32(indices.size()) : 0;
+}
+
+
+//Cloth grids of CH9, side by side
+PxU32 AddClothGrids(PxPhysics& physics, PxScene& scene, PxMaterial& material, PxU32 bodies)
+{
+	const PxU32 perCloth = STRESS_CLOTH_RESOLUTION*STRESS_CLOTH_RESOLUTION;
+	PxU32 cloths = PxMax(1u, (bodies + perCloth/2)/perCloth);
+
+	for(PxU32 c=0; c<cloths; c++)
+	{
+		PxVec3 pos = StressGridPosition(c, cloths, 12.0f) + PxVec3(0, 1, 0);
+		PxCloth* cloth = CreateCloth(physics, PxTransform(pos), STRESS_CLOTH_RESOLUTION, 10.0f);
+		scene.addActor(*cloth);
+		cloth->addCollisionPlane(PxClothCollisionPlane(PxVec3(0, 1, 0), pos.y));		//The ground, in cloth space
+		cloth->addCollisionConvex(1 << 0);
+	}
+	return cloths*perCloth;
+}
+
+
+
+const StressScene gStressScenes[] =
+{
+	{ "pyramids",	AddPyramids,		"boxes" },
+	{ "spheres",	AddSpherePiles,		"spheres" },
+	{ "chains",		AddChains,			"links" },
+	{ "ragdolls",	AddRagdolls,		"bodies" },
+	{ "particles",	AddParticleVolume,	"particles" },
+	{ "cloth",		AddClothGrids,		"cloth particles" },
+};
+
+const PxU32 gStressSceneCount = sizeof(gStressScenes)/sizeof(gStressScenes[0]);
+
+
+//NULL if there is no generator by that name
+const StressScene* FindStressScene(const char* name)
+{
+	for(PxU32 i=0; i<gStressSceneCount; i++)
+		if(!strcmp(gStressScenes[i].name, name))
+			return &gStressScenes[i];
+	return NULL;
+}
+
+
+//A scene with a ground plane and about 'bodies' of the given kind; 'created' is the exact count
+PxScene* CreateStressScene(PxPhysics& physics, PxCpuDispatcher* dispatcher, const StressScene& stress, PxU32 bodies, PxU32& created)
+{
+	PxScene* scene = physics.createScene(ChapterSceneDesc(physics, dispatcher));
+	PxMaterial* material = physics.createMaterial(0.5f,0.5f,0.1f);
+
+	AddGroundPlane(physics, *scene, *material);
+	created = stress.add(physics, *scene, *material, bodies);
+	return scene;
+}
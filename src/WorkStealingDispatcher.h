@@ -0,0 +1,361 @@
+/*
+=====================================================================
+
+File Name	  :	WorkStealingDispatcher.h
+
+Description	  : A 'PxCpuDispatcher' with one Chase-Lev deque per worker thread, for
+				'PxSceneDesc::cpuDispatcher'.
+
+				The stock dispatcher keeps every task in one shared queue. Here a task
+				submitted from a worker is pushed to the bottom of that worker's own deque
+				and popped from there again (LIFO, cache warm); tasks submitted from other
+				threads, i.e. 'simulate()', go to a locked injection queue. A worker without
+				work takes from the injection queue, then steals from the top of the other
+				workers' deques. It keeps looking with an exponential spin backoff and a few
+				yields before it parks on a condition variable until new work is submitted.
+
+				Workers are 'shdfnd::Thread's and can be pinned to cores with an affinity
+				mask per worker, as for 'PxDefaultCpuDispatcherCreate()'.
+
+=====================================================================
+*/
+
+#pragma once
+
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include <PsThread.h>			//shdfnd::Thread, from PxShared/src/foundation/include
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <thread>
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>			//_mm_pause()
+#endif
+
+using namespace std;
+using namespace physx;
+
+
+//Fixed size Chase-Lev work-stealing deque. Only the owner calls 'push()' and 'pop()',
+//any thread may call 'steal()'. Memory orders follow Le et al., "Correct and Efficient
+//Work-Stealing for Weak Memory Models" (PPoPP 2013).
+class TaskDeque
+{
+public:
+	static const int64_t CAPACITY = 1 << 12;
+
+	TaskDeque() : mTop(0), mBottom(0)
+	{
+		for(int64_t i=0; i<CAPACITY; i++)
+			mTasks[i].store(NULL, memory_order_relaxed);
+	}
+
+	//Returns false when the deque is full
+	bool push(PxBaseTask* task)
+	{
+		int64_t bottom = mBottom.load(memory_order_relaxed);
+		int64_t top	   = mTop.load(memory_order_acquire);
+		if(bottom - top >= CAPACITY)
+			return false;
+
+		mTasks[bottom & (CAPACITY-1)].store(task, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+		mBottom.store(bottom + 1, memory_order_relaxed);
+		return true;
+	}
+
+	PxBaseTask* pop()
+	{
+		int64_t bottom = mBottom.load(memory_order_relaxed) - 1;
+		mBottom.store(bottom, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+		int64_t top = mTop.load(memory_order_relaxed);
+
+		if(top > bottom)	//Empty
+		{
+			mBottom.store(bottom + 1, memory_order_relaxed);
+			return NULL;
+		}
+
+		PxBaseTask* task = mTasks[bottom & (CAPACITY-1)].load(memory_order_relaxed);
+		if(top == bottom)	//Last task, race the thieves for it
+		{
+			if(!mTop.compare_exchange_strong(top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+				task = NULL;
+			mBottom.store(bottom + 1, memory_order_relaxed);
+		}
+		return task;
+	}
+
+	PxBaseTask* steal()
+	{
+		int64_t top = mTop.load(memory_order_acquire);
+		atomic_thread_fence(memory_order_seq_cst);
+		int64_t bottom = mBottom.load(memory_order_acquire);
+		if(top >= bottom)
+			return NULL;
+
+		PxBaseTask* task = mTasks[top & (CAPACITY-1)].load(memory_order_relaxed);
+		if(!mTop.compare_exchange_strong(top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+			return NULL;	//Lost to the owner or another thief
+		return task;
+	}
+
+private:
+	//Top and bottom on their own cache lines, thieves and the owner write them concurrently
+	atomic<int64_t>		mTop;		//Thieves take from here
+	char				mPadTop[64 - sizeof(atomic<int64_t>)];
+	atomic<int64_t>		mBottom;	//The owner pushes and pops here
+	char				mPadBottom[64 - sizeof(atomic<int64_t>)];
+	atomic<PxBaseTask*>	mTasks[CAPACITY];
+};
+
+
+struct WorkStealingStats
+{
+	PxU64	tasks;		//Tasks run
+	PxU64	steals;		//Tasks taken from another worker's deque
+	PxU64	parks;		//Times a worker went to sleep for lack of work
+};
+
+
+class WorkStealingDispatcher : public PxCpuDispatcher
+{
+public:
+	//'affinityMasks' holds one mask per worker or is NULL, as for 'PxDefaultCpuDispatcherCreate()'
+	WorkStealingDispatcher(PxU32 numWorkers, const PxU32* affinityMasks = NULL,
+						   shdfnd::ThreadPriority::Enum priority = shdfnd::ThreadPriority::eNORMAL);
+	virtual ~WorkStealingDispatcher();
+
+	virtual void submitTask(PxBaseTask& task);
+	virtual uint32_t getWorkerCount() const { return PxU32(mWorkers.size()); }
+
+	void release() { delete this; }
+
+	WorkStealingStats getStats() const;
+
+private:
+	class Worker : public shdfnd::Thread
+	{
+	public:
+		Worker(WorkStealingDispatcher& owner, PxU32 index) : mOwner(owner), mIndex(index), mTasks(0), mSteals(0), mParks(0) {}
+		virtual void execute();
+
+		WorkStealingDispatcher&	mOwner;
+		PxU32					mIndex;
+		TaskDeque				mDeque;
+		atomic<PxU64>			mTasks;		//Counters for 'getStats()', written by this worker only
+		atomic<PxU64>			mSteals;
+		atomic<PxU64>			mParks;
+	};
+
+	static void	Increment(atomic<PxU64>& counter) { counter.store(counter.load(memory_order_relaxed) + 1, memory_order_relaxed); }
+
+	PxBaseTask*	findTask(Worker& worker);
+	void		runTask(Worker& worker, PxBaseTask& task);
+	void		workerLoop(Worker& worker);
+
+	vector<Worker*>			mWorkers;
+
+	mutex					mInjectionLock;
+	std::deque<PxBaseTask*>	mInjection;		//Tasks submitted by non-worker threads, or by workers with a full deque
+
+	atomic<int>				mPending;		//Submitted tasks not yet taken
+	atomic<int>				mSleepers;		//Parked workers
+	atomic<bool>			mQuit;
+	mutex					mParkLock;
+	condition_variable		mParkSignal;
+
+	static thread_local Worker*	tCurrentWorker;	//Worker running on this thread, NULL elsewhere
+};
+
+
+thread_local WorkStealingDispatcher::Worker* WorkStealingDispatcher::tCurrentWorker = NULL;
+
+
+//Spin iterations before a worker gives up its time slice, and yields before it parks
+const int WORK_STEALING_SPIN_ROUNDS  = 8;
+const int WORK_STEALING_YIELD_ROUNDS = 16;
+
+
+
+WorkStealingDispatcher::WorkStealingDispatcher(PxU32 numWorkers, const PxU32* affinityMasks, shdfnd::ThreadPriority::Enum priority)
+	: mPending(0), mSleepers(0), mQuit(false)
+{
+	for(PxU32 i=0; i<numWorkers; i++)
+		mWorkers.push_back(PX_NEW(Worker)(*this, i));	//shdfnd::Thread allocates through the foundation
+
+	for(PxU32 i=0; i<numWorkers; i++)
+	{
+		Worker& worker = *mWorkers[i];
+		if(affinityMasks)
+			worker.setAffinityMask(affinityMasks[i]);	//Applied when the thread starts
+		worker.start(shdfnd::Thread::getDefaultStackSize());
+		worker.setPriority(priority);
+		worker.setName("PxWorkStealingWorker");
+	}
+}
+
+
+WorkStealingDispatcher::~WorkStealingDispatcher()
+{
+	mQuit = true;
+	for(size_t i=0; i<mWorkers.size(); i++)
+		mWorkers[i]->signalQuit();
+	{
+		lock_guard<mutex> lock(mParkLock);
+		mParkSignal.notify_all();
+	}
+
+	//Every worker must have stopped before any deque goes away, idle workers steal from all of them
+	for(size_t i=0; i<mWorkers.size(); i++)
+		mWorkers[i]->waitForQuit();
+	for(size_t i=0; i<mWorkers.size(); i++)
+		PX_DELETE(mWorkers[i]);
+}
+
+
+void WorkStealingDispatcher::submitTask(PxBaseTask& task)
+{
+	//Without workers, tasks run inside 'simulate()' like with the default dispatcher
+	if(mWorkers.empty())
+	{
+		task.run();
+		task.release();
+		return;
+	}
+
+	Worker* worker = tCurrentWorker;
+	if(!worker || &worker->mOwner != this || !worker->mDeque.push(&task))
+	{
+		lock_guard<mutex> lock(mInjectionLock);
+		mInjection.push_back(&task);
+	}
+
+	//The increment must be visible before 'mSleepers' is read, see 'workerLoop()'
+	mPending.fetch_add(1);
+	if(mSleepers.load() > 0)
+	{
+		lock_guard<mutex> lock(mParkLock);
+		mParkSignal.notify_one();
+	}
+}
+
+
+PxBaseTask* WorkStealingDispatcher::findTask(Worker& worker)
+{
+	PxBaseTask* task = worker.mDeque.pop();
+	if(task)
+		return task;
+
+	{
+		lock_guard<mutex> lock(mInjectionLock);
+		if(!mInjection.empty())
+		{
+			task = mInjection.front();
+			mInjection.pop_front();
+			return task;
+		}
+	}
+
+	//Steal, starting after ourselves so thieves spread over the victims
+	PxU32 count = PxU32(mWorkers.size());
+	for(PxU32 i=1; i<count; i++)
+	{
+		task = mWorkers[(worker.mIndex + i) % count]->mDeque.steal();
+		if(task)
+		{
+			Increment(worker.mSteals);
+			return task;
+		}
+	}
+	return NULL;
+}
+
+
+void WorkStealingDispatcher::runTask(Worker& worker, PxBaseTask& task)
+{
+	mPending.fetch_sub(1);
+	task.run();
+	task.release();
+	Increment(worker.mTasks);
+}
+
+
+void WorkStealingDispatcher::workerLoop(Worker& worker)
+{
+	tCurrentWorker = &worker;
+
+	while(!mQuit)
+	{
+		PxBaseTask* task = findTask(worker);
+		if(task)
+		{
+			runTask(worker, *task);
+			continue;
+		}
+
+		//Nothing found: spin with exponential backoff, then yield, then park
+		for(int round=0; !task && round<WORK_STEALING_SPIN_ROUNDS+WORK_STEALING_YIELD_ROUNDS && !mQuit; round++)
+		{
+			if(round < WORK_STEALING_SPIN_ROUNDS)
+			{
+				for(int i=0; i < (1 << round); i++)
+				{
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+					_mm_pause();
+#endif
+				}
+			}
+			else
+			{
+				this_thread::yield();
+			}
+
+			if(mPending.load(memory_order_relaxed) > 0)
+				task = findTask(worker);
+		}
+
+		if(task)
+		{
+			runTask(worker, *task);
+			continue;
+		}
+
+		//Announce the sleeper before checking 'mPending' so a concurrent submit either
+		//sees the sleeper and notifies, or its task is seen here
+		unique_lock<mutex> lock(mParkLock);
+		mSleepers.fetch_add(1);
+		if(mPending.load() == 0 && !mQuit)
+		{
+			Increment(worker.mParks);
+			mParkSignal.wait(lock);
+		}
+		mSleepers.fetch_sub(1);
+	}
+
+	tCurrentWorker = NULL;
+}
+
+
+void WorkStealingDispatcher::Worker::execute()
+{
+	mOwner.workerLoop(*this);
+	quit();
+}
+
+
+//Totals over all workers, exact while the dispatcher is idle
+WorkStealingStats WorkStealingDispatcher::getStats() const
+{
+	WorkStealingStats stats = { 0, 0, 0 };
+	for(size_t i=0; i<mWorkers.size(); i++)
+	{
+		stats.tasks	 += mWorkers[i]->mTasks.load(memory_order_relaxed);
+		stats.steals += mWorkers[i]->mSteals.load(memory_order_relaxed);
+		stats.parks	 += mWorkers[i]->mParks.load(memory_order_relaxed);
+	}
+	return stats;
+}
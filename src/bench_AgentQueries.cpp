@@ -0,0 +1,235 @@
+/*
+=====================================================================
+
+File Name	  :	bench_AgentQueries.cpp
+
+Description	  : Agents walking through a scene of scattered static shapes ('QueryScenes.h')
+				query their neighborhood every frame with short raycasts, sphere sweeps
+				and sphere overlaps. The same queries run once against the 'PxScene' and
+				once through the per agent 'PxVolumeCache' of 'AgentQuery.h'. The time
+				per frame of each, the speedup, the cache refill rate and the agreement
+				of the results are printed.
+				No GL context is needed.
+
+				Command line options:
+				  --statics N    Static actors in the scene (default 50000)
+				  --shapes S     boxes, spheres, capsules or mixed (default mixed)
+				  --agents N     Walking agents (default 64)
+				  --frames N     Frames to walk (default 300)
+				  --rays N       Raycasts per agent and frame (default 16)
+				  --sweeps N     Sphere sweeps per agent and frame (default 2)
+				  --overlaps N   Sphere overlaps per agent and frame (default 2)
+				  --reach R      Length of the agents' queries (default 4)
+				  --margin M     Distance an agent walks before its cache is refilled (default 2)
+				  --speed V      Walking speed in units per second (default 3)
+
+=====================================================================
+*/
+
+#define _DEBUG 1
+
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "CpuDispatcher.h"		//CreateCpuDispatcher()
+#include "QueryScenes.h"		//CreateQueryScene(), QueryRandom
+#include "AgentQuery.h"			//AgentQueryMove(), AgentRaycast()
+
+
+
+using namespace std;
+using namespace physx;
+
+
+static PxDefaultErrorCallback	gDefaultErrorCallback;		//Instance of default implementation of the error callback
+static PxDefaultAllocator		gDefaultAllocatorCallback;	//Instance of default implementation of the allocator interface required by the SDK
+
+PxFoundation*	gFoundation	= NULL;
+PxPhysics*		gPhysicsSDK	= NULL;
+
+const PxReal	gFrameTime		= 1.0f/60.0f;
+const PxReal	gSweepRadius	= 0.3f;
+const PxU32		gMaxTouches		= 256;
+
+
+//One frame's queries of one agent, drawn up front so both methods run the same ones
+struct AgentFrameQueries
+{
+	vector<PxVec3>	rayDirections;
+	vector<PxVec3>	sweepDirections;
+	vector<PxVec3>	overlapOffsets;
+};
+
+
+//What is compared between the methods: closest actor of rays and sweeps, touch count of overlaps
+struct AgentQueryResults
+{
+	vector<PxRigidActor*>	closest;
+	vector<PxU32>			touches;
+};
+
+
+//Random walk, turning now and then and bouncing off the sides of the scene's cube
+void WalkAgents(vector<PxVec3>& positions, vector<PxVec3>& headings, PxReal speed, PxReal extent, QueryRandom& random)
+{
+	for(size_t i=0; i<positions.size(); i++)
+	{
+		if(random.unit() < 0.02f)
+			headings[i] = random.direction();
+		positions[i] += headings[i]*speed*gFrameTime;
+		for(PxU32 axis=0; axis<3; axis++)
+		{
+			if(PxAbs(positions[i][axis]) > extent)
+			{
+				headings[i][axis] = -headings[i][axis];
+				positions[i][axis] = PxClamp(positions[i][axis], -extent, extent);
+			}
+		}
+	}
+}
+
+
+//Runs one agent's queries directly against the scene, or through its volume cache
+void RunAgentQueries(PxScene& scene, PxU32 agent, bool cached, const PxVec3& position, const AgentFrameQueries& q,
+	PxReal reach, AgentQueryResults& out)
+{
+	PxSphereGeometry sweepSphere(gSweepRadius), overlapSphere(0.5f*reach);
+	PxOverlapHit touches[gMaxTouches];
+	PxQueryFilterData allTouch(PxQueryFlag::eSTATIC | PxQueryFlag::eDYNAMIC | PxQueryFlag::eNO_BLOCK);
+
+	for(size_t i=0; i<q.rayDirections.size(); i++)
+	{
+		PxRaycastBuffer buffer;
+		if(cached)
+			AgentRaycast(agent, position, q.rayDirections[i], reach, buffer);
+		else
+			scene.raycast(position, q.rayDirections[i], reach, buffer);
+		out.closest.push_back(buffer.hasBlock ? buffer.block.actor : NULL);
+	}
+
+	//Sweeps stay inside the reach
+	for(size_t i=0; i<q.sweepDirections.size(); i++)
+	{
+		PxSweepBuffer buffer;
+		PxReal distance = reach - gSweepRadius;
+		if(cached)
+			AgentSweep(agent, sweepSphere, PxTransform(position), q.sweepDirections[i], distance, buffer);
+		else
+			scene.sweep(sweepSphere, PxTransform(position), q.sweepDirections[i], distance, buffer);
+		out.closest.push_back(buffer.hasBlock ? buffer.block.actor : NULL);
+	}
+
+	for(size_t i=0; i<q.overlapOffsets.size(); i++)
+	{
+		PxOverlapBuffer buffer(touches, gMaxTouches);
+		PxTransform pose(position + q.overlapOffsets[i]);
+		if(cached)
+			AgentOverlap(agent, overlapSphere, pose, buffer, allTouch);
+		else
+			scene.overlap(overlapSphere, pose, buffer, allTouch);
+		out.touches.push_back(buffer.nbTouches);
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	ParseDispatcherOptions(argc, argv);	//--workers N, --affinity, --priority P, --dispatcher D
+
+	QuerySceneDesc desc;
+	if(!ParseQuerySceneOptions(argc, argv, 50000, desc))	//--statics N, --shapes S
+		return EXIT_FAILURE;
+
+	PxU32 agentCount = PxU32(PxMax(1, GetIntArgument(argc, argv, "--agents", 64)));
+	PxU32 frames	 = PxU32(PxMax(1, GetIntArgument(argc, argv, "--frames", 300)));
+	PxU32 rays		 = PxU32(PxMax(0, GetIntArgument(argc, argv, "--rays", 16)));
+	PxU32 sweeps	 = PxU32(PxMax(0, GetIntArgument(argc, argv, "--sweeps", 2)));
+	PxU32 overlaps	 = PxU32(PxMax(0, GetIntArgument(argc, argv, "--overlaps", 2)));
+	PxReal reach	 = PxMax(0.5f, GetFloatArgument(argc, argv, "--reach", 4.0f));
+	PxReal margin	 = PxMax(0.0f, GetFloatArgument(argc, argv, "--margin", 2.0f));
+	PxReal speed	 = GetFloatArgument(argc, argv, "--speed", 3.0f);
+
+	gFoundation = PxCreateFoundation(PX_FOUNDATION_VERSION, gDefaultAllocatorCallback, gDefaultErrorCallback);
+	gPhysicsSDK = PxCreatePhysics(PX_PHYSICS_VERSION, *gFoundation, PxTolerancesScale());
+	if(gPhysicsSDK == NULL)
+	{
+		cerr<<"Error creating PhysX3 device, Exiting..."<<endl;
+		exit(1);
+	}
+
+	PxScene* scene = CreateQueryScene(*gPhysicsSDK, CreateCpuDispatcher(), desc);
+	scene->simulate(gFrameTime);		//Builds the query trees of the new actors
+	scene->fetchResults(true);
+	AgentQueryInit(*scene, agentCount, reach, margin);
+
+	QueryRandom random(2);
+	vector<PxVec3> positions(agentCount), headings(agentCount);
+	for(PxU32 i=0; i<agentCount; i++)
+	{
+		positions[i] = random.inCube(desc.extent);
+		headings[i]	 = random.direction();
+	}
+
+	AgentFrameQueries queries;
+	queries.rayDirections.resize(rays);
+	queries.sweepDirections.resize(sweeps);
+	queries.overlapOffsets.resize(overlaps);
+
+	AgentQueryResults direct, cached;
+	double directMs = 0.0, cachedMs = 0.0;
+	PxU32 mismatches = 0;
+	for(PxU32 frame=0; frame<frames; frame++)
+	{
+		WalkAgents(positions, headings, speed, desc.extent, random);
+
+		for(PxU32 agent=0; agent<agentCount; agent++)
+		{
+			for(PxU32 i=0; i<rays; i++)
+				queries.rayDirections[i] = random.direction();
+			for(PxU32 i=0; i<sweeps; i++)
+				queries.sweepDirections[i] = random.direction();
+			for(PxU32 i=0; i<overlaps; i++)
+			{
+				PxVec3 direction = random.direction();	//Separate statements fix the order of the draws
+				queries.overlapOffsets[i] = direction*(0.5f*reach*random.unit());	//Overlap spheres stay inside the reach
+			}
+
+			direct.closest.clear();	direct.touches.clear();
+			cached.closest.clear();	cached.touches.clear();
+
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			RunAgentQueries(*scene, agent, false, positions[agent], queries, reach, direct);
+			directMs += QueryElapsedMs(start);
+
+			start = chrono::steady_clock::now();
+			AgentQueryMove(agent, positions[agent]);
+			RunAgentQueries(*scene, agent, true, positions[agent], queries, reach, cached);
+			cachedMs += QueryElapsedMs(start);
+
+			for(size_t i=0; i<direct.closest.size(); i++)
+				mismatches += direct.closest[i] != cached.closest[i];
+			for(size_t i=0; i<direct.touches.size(); i++)
+				mismatches += direct.touches[i] != cached.touches[i];
+		}
+	}
+
+	const AgentQueryStats& s = gAgentQueryStats;
+	printf("statics: %u (%s)  agents: %u  frames: %u  per agent and frame: %u rays, %u sweeps, %u overlaps  reach: %g  margin: %g\n\n",
+		desc.statics, QueryShapeMixName(desc.shapes), agentCount, frames, rays, sweeps, overlaps, reach, margin);
+	printf("%-16s %10s %10s %12s\n", "method", "ms/frame", "speedup", "refill rate");
+	printf("%-16s %10.3f %9.2fx %12s\n", "scene queries", directMs/frames, 1.0, "-");
+	printf("%-16s %10.3f %9.2fx %11.1f%%\n", "volume cache", cachedMs/frames, cachedMs > 0.0 ? directMs/cachedMs : 0.0,
+		100.0*s.refills/s.moves);
+	printf("\n");
+	PrintAgentQueryStats();
+	printf("mismatched results: %u\n", mismatches);
+
+	AgentQueryRelease();
+	scene->release();
+	gPhysicsSDK->release();
+	ReleaseCpuDispatcher();			//Worker threads outlive the scene
+	gFoundation->release();
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
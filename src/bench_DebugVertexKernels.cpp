@@ -0,0 +1,99 @@
+/*
+=====================================================================
+
+File Name	  :	bench_DebugVertexKernels.cpp
+
+Description	  : Microbenchmark of the debug vertex expansion kernels in 'DebugVertexKernels.h'.
+				Every kernel available on this CPU expands the same 1M vertices (500k lines),
+				its output is checked against the scalar kernel and the throughput is printed.
+				No GL context is needed.
+
+=====================================================================
+*/
+
+#define _DEBUG 1
+
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <PxPhysicsAPI.h>			//Single header file to include all features of PhysX API
+#include "DebugVertexKernels.h"		//Kernels under test
+
+
+
+using namespace std;
+using namespace physx;
+
+
+const PxU32	gNumLines	= 500000;	//Each line is two vertices
+const int	gIterations	= 50;
+
+
+//Returns average milliseconds per call of 'kernel'
+double Measure(ExpandDebugVerticesFn kernel, const vector<PxDebugLine>& lines, vector<float>& verts, vector<float>& colors)
+{
+	PxU32 numVerts = PxU32(lines.size())*2;
+	kernel(&lines[0], numVerts, &verts[0], &colors[0]); //Warm up
+
+	chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+	for(int i=0; i<gIterations; i++)
+		kernel(&lines[0], numVerts, &verts[0], &colors[0]);
+	chrono::high_resolution_clock::time_point end = chrono::high_resolution_clock::now();
+
+	return chrono::duration<double, milli>(end - start).count() / gIterations;
+}
+
+
+int main()
+{
+	//Odd count so the scalar tail of the SIMD kernels is exercised as well
+	vector<PxDebugLine> lines;
+	lines.reserve(gNumLines+1);
+	PxU32 seed = 12345;
+	for(PxU32 i=0; i<gNumLines+1; i++)
+	{
+		seed = seed*1664525u + 1013904223u;
+		PxVec3 p(PxReal(seed&0xffff), PxReal(i), -PxReal(seed>>16));
+		lines.push_back(PxDebugLine(p, p + PxVec3(1,2,3), seed | 0xff000000));
+		lines.back().color1 = seed*31u;
+	}
+
+	PxU32 numVerts = PxU32(lines.size())*2;
+	vector<float> refVerts(numVerts*3), refColors(numVerts*4);
+	vector<float> verts(numVerts*3), colors(numVerts*4);
+
+	struct Kernel { const char* name; ExpandDebugVerticesFn fn; bool supported; };
+	Kernel kernels[] =
+	{
+		{ "scalar", ExpandDebugVerticesScalar, true },
+#if DEBUG_KERNELS_X86
+		{ "sse2",	ExpandDebugVerticesSSE2,   true },
+		{ "avx2",	ExpandDebugVerticesAVX2,   CpuSupportsAVX2() },
+#endif
+	};
+
+	printf("Selected kernel: %s\n", gExpandDebugVerticesName);
+	printf("%-8s %12s %14s %10s %8s\n", "kernel", "ms/call", "Mverts/s", "speedup", "match");
+
+	ExpandDebugVerticesScalar(&lines[0], numVerts, &refVerts[0], &refColors[0]);
+	double scalarMs = 0.0;
+
+	for(size_t k=0; k<sizeof(kernels)/sizeof(kernels[0]); k++)
+	{
+		if(!kernels[k].supported)
+		{
+			printf("%-8s %12s\n", kernels[k].name, "n/a");
+			continue;
+		}
+
+		double ms = Measure(kernels[k].fn, lines, verts, colors);
+		if(k == 0)
+			scalarMs = ms;
+
+		bool match = verts == refVerts && colors == refColors;
+		printf("%-8s %12.3f %14.1f %9.2fx %8s\n", kernels[k].name, ms, numVerts/(ms*1000.0), scalarMs/ms, match ? "yes" : "NO");
+	}
+
+	return EXIT_SUCCESS;
+}
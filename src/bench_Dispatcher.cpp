@@ -0,0 +1,164 @@
+/*
+=====================================================================
+
+File Name	  :	bench_Dispatcher.cpp
+
+Description	  : Task throughput of the work-stealing dispatcher ('WorkStealingDispatcher.h')
+				against 'PxDefaultCpuDispatcher', without a scene, so only scheduling is
+				measured. Two patterns are run, each with empty and with small tasks:
+
+				  flat    The main thread submits every task, as 'simulate()' does
+				  tree    Every task submits two children until a depth is reached, so
+				          most tasks are submitted from the workers themselves
+
+				Command line options:
+				  --workers N   Worker threads (default: hardware threads minus one, at least 1)
+				  --rounds N    Repetitions of each pattern (default 20)
+				  --affinity, --priority P   As for the demos
+
+=====================================================================
+*/
+
+#define _DEBUG 1
+
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "CpuDispatcher.h"		//CreateCpuDispatcher(), WorkStealingDispatcher
+
+
+
+using namespace std;
+using namespace physx;
+
+
+static PxDefaultErrorCallback	gDefaultErrorCallback;		//Instance of default implementation of the error callback
+static PxDefaultAllocator		gDefaultAllocatorCallback;	//Instance of default implementation of the allocator interface required by the SDK
+
+const PxU32		gFlatTasks	= 1 << 15;
+const int		gTreeDepth	= 14;		//2^15-1 tasks per tree
+const PxU32		gTreeRoots	= 1;
+
+
+class BenchTask;
+
+atomic<PxU32>		gNextTask(0);		//Next free entry of 'gTaskPool'
+atomic<PxU32>		gOutstanding(0);	//Submitted tasks not yet released
+vector<BenchTask>	gTaskPool;
+PxCpuDispatcher*	gDispatcher = NULL;
+int					gGrain		= 0;	//Busy work per task
+
+
+class BenchTask : public PxBaseTask
+{
+public:
+	BenchTask() : mDepth(0), mResult(0.0f) {}
+
+	virtual void run()
+	{
+		float x = mResult;
+		for(int i=0; i<gGrain; i++)
+			x = x*0.999f + 1.0f;
+		mResult = x;
+
+		for(int c=0; mDepth > 0 && c<2; c++)
+			Submit(mDepth - 1);
+	}
+
+	virtual const char* getName() const { return "BenchTask"; }
+	virtual void addReference() {}
+	virtual void removeReference() {}
+	virtual int32_t getReference() const { return 1; }
+	virtual void release() { gOutstanding.fetch_sub(1); }
+
+	static void Submit(int depth)
+	{
+		BenchTask& task = gTaskPool[gNextTask.fetch_add(1)];
+		task.mDepth = depth;
+		gOutstanding.fetch_add(1);
+		gDispatcher->submitTask(task);
+	}
+
+	int		mDepth;
+	float	mResult;
+};
+
+
+//Submits 'roots' tasks of the given depth and waits until all of them, and their children, are done
+void RunRound(PxU32 roots, int depth)
+{
+	gNextTask = 0;
+	for(PxU32 i=0; i<roots; i++)
+		BenchTask::Submit(depth);
+
+	while(gOutstanding.load() > 0)
+		this_thread::yield();
+}
+
+
+//Returns millions of tasks per second
+double Measure(PxCpuDispatcher* dispatcher, bool tree, int rounds)
+{
+	gDispatcher = dispatcher;
+	PxU32 roots = tree ? gTreeRoots : gFlatTasks;
+	int depth	= tree ? gTreeDepth : 0;
+	PxU32 tasksPerRound = roots*((1u << (depth+1)) - 1);
+
+	RunRound(roots, depth);	//Warm up
+
+	chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+	for(int i=0; i<rounds; i++)
+		RunRound(roots, depth);
+	chrono::high_resolution_clock::time_point end = chrono::high_resolution_clock::now();
+
+	double seconds = chrono::duration<double>(end - start).count();
+	return tasksPerRound*double(rounds)/seconds/1.0e6;
+}
+
+
+int main(int argc, char** argv)
+{
+	ParseDispatcherOptions(argc, argv);
+	int rounds = GetIntArgument(argc, argv, "--rounds", 20);
+	if(!gDispatcherOptions.workers)
+		gDispatcherOptions.workers = 1;
+
+	//Both dispatchers allocate their threads through the foundation
+	PxFoundation* foundation = PxCreateFoundation(PX_FOUNDATION_VERSION, gDefaultAllocatorCallback, gDefaultErrorCallback);
+
+	gTaskPool.resize(PxMax(gFlatTasks, gTreeRoots*((1u << (gTreeDepth+1)) - 1)));
+
+	DispatcherOptions defaultOptions  = gDispatcherOptions;
+	DispatcherOptions stealingOptions = gDispatcherOptions;
+	defaultOptions.type	 = eDISPATCHER_DEFAULT;
+	stealingOptions.type = eDISPATCHER_WORK_STEALING;
+
+	PxCpuDispatcher* defaultDispatcher	= CreateCpuDispatcher(defaultOptions);
+	PxCpuDispatcher* stealingDispatcher = CreateCpuDispatcher(stealingOptions);
+
+	printf("workers: %u  rounds: %d\n", gDispatcherOptions.workers, rounds);
+	printf("%-8s %8s %16s %16s %10s\n", "pattern", "grain", "default Mt/s", "stealing Mt/s", "speedup");
+
+	const int grains[] = { 0, 200 };
+	for(int pattern=0; pattern<2; pattern++)
+		for(size_t g=0; g<sizeof(grains)/sizeof(grains[0]); g++)
+		{
+			gGrain = grains[g];
+			double defaultRate  = Measure(defaultDispatcher, pattern == 1, rounds);
+			double stealingRate = Measure(stealingDispatcher, pattern == 1, rounds);
+			printf("%-8s %8d %16.2f %16.2f %9.2fx\n", pattern ? "tree" : "flat", gGrain, defaultRate, stealingRate, stealingRate/defaultRate);
+		}
+
+	WorkStealingStats stats = static_cast<WorkStealingDispatcher*>(stealingDispatcher)->getStats();
+	printf("work stealing: %llu tasks, %llu steals, %llu parks\n",
+		(unsigned long long)stats.tasks, (unsigned long long)stats.steals, (unsigned long long)stats.parks);
+
+	ReleaseCpuDispatcher(defaultDispatcher, defaultOptions);
+	ReleaseCpuDispatcher(stealingDispatcher, stealingOptions);
+	foundation->release();
+	return EXIT_SUCCESS;
+}
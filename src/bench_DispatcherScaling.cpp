@@ -0,0 +1,137 @@
+/*
+=====================================================================
+
+File Name	  :	bench_DispatcherScaling.cpp
+
+Description	  : Scaling report for the CPU dispatcher. The same scene of box pyramids is
+				built and stepped with 1..N worker threads ('CpuDispatcher.h'), and the
+				average step time and the speedup over one worker are printed.
+				No GL context is needed.
+
+				Command line options:
+				  --max-workers N   Highest worker count, defaults to the hardware concurrency
+				  --steps N         Measured steps per run (default 300)
+				  --pyramids N      Pyramids in the scene (default 16, 20 levels each)
+				  --affinity, --priority P, --dispatcher D   As for the demos
+
+=====================================================================
+*/
+
+#define _DEBUG 1
+
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "CpuDispatcher.h"		//CreateCpuDispatcher()
+
+
+
+using namespace std;
+using namespace physx;
+
+
+static PxDefaultErrorCallback	gDefaultErrorCallback;		//Instance of default implementation of the error callback
+static PxDefaultAllocator		gDefaultAllocatorCallback;	//Instance of default implementation of the allocator interface required by the SDK
+
+PxFoundation*	gFoundation	= NULL;
+PxPhysics*		gPhysicsSDK	= NULL;
+PxMaterial*		gMaterial	= NULL;
+PxReal			gTimeStep	= 1.0f/60.0f;
+
+const int		gWarmupSteps	= 60;	//Let the pyramids settle into contact before measuring
+const int		gPyramidLevels	= 20;
+
+
+PxScene* CreateScene(PxCpuDispatcher* dispatcher, int pyramids)
+{
+	PxSceneDesc sceneDesc(gPhysicsSDK->getTolerancesScale());
+	sceneDesc.gravity		= PxVec3(0.0f, -9.8f, 0.0f);
+	sceneDesc.cpuDispatcher = dispatcher;
+	sceneDesc.filterShader  = PxDefaultSimulationFilterShader;
+	PxScene* scene = gPhysicsSDK->createScene(sceneDesc);
+
+	scene->addActor(*PxCreatePlane(*gPhysicsSDK, PxPlane(0,1,0,0), *gMaterial));
+
+	//Pyramids on a grid, far enough apart not to touch
+	int side = int(PxCeil(PxSqrt(PxReal(pyramids))));
+	PxBoxGeometry box(0.5f, 0.5f, 0.5f);
+	for(int p=0; p<pyramids; p++)
+	{
+		PxVec3 base(PxReal(p%side)*(gPyramidLevels+4), 0.5f, PxReal(p/side)*8.0f);
+		for(int level=0; level<gPyramidLevels; level++)
+			for(int i=0; i<gPyramidLevels-level; i++)
+			{
+				PxVec3 pos = base + PxVec3(i + level*0.5f, PxReal(level), 0);
+				scene->addActor(*PxCreateDynamic(*gPhysicsSDK, PxTransform(pos), box, *gMaterial, 1.0f));
+			}
+	}
+
+	return scene;
+}
+
+
+//Returns average milliseconds per step
+double MeasureSteps(PxScene* scene, int steps)
+{
+	for(int i=0; i<gWarmupSteps; i++)
+	{
+		scene->simulate(gTimeStep);
+		scene->fetchResults(true);
+	}
+
+	chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+	for(int i=0; i<steps; i++)
+	{
+		scene->simulate(gTimeStep);
+		scene->fetchResults(true);
+	}
+	chrono::high_resolution_clock::time_point end = chrono::high_resolution_clock::now();
+
+	return chrono::duration<double, milli>(end - start).count() / steps;
+}
+
+
+int main(int argc, char** argv)
+{
+	ParseDispatcherOptions(argc, argv);	//Affinity and priority, the worker count is swept
+	int maxWorkers = GetIntArgument(argc, argv, "--max-workers", int(HardwareThreadCount()));
+	int steps	   = GetIntArgument(argc, argv, "--steps", 300);
+	int pyramids   = GetIntArgument(argc, argv, "--pyramids", 16);
+
+	gFoundation = PxCreateFoundation(PX_FOUNDATION_VERSION, gDefaultAllocatorCallback, gDefaultErrorCallback);
+	gPhysicsSDK = PxCreatePhysics(PX_PHYSICS_VERSION, *gFoundation, PxTolerancesScale());
+	if(gPhysicsSDK == NULL)
+	{
+		cerr<<"Error creating PhysX3 device, Exiting..."<<endl;
+		exit(1);
+	}
+	gMaterial = gPhysicsSDK->createMaterial(0.5f,0.5f,0.1f);
+
+	printf("%d boxes, %d steps per run, hardware threads: %u\n",
+		pyramids*gPyramidLevels*(gPyramidLevels+1)/2, steps, HardwareThreadCount());
+	printf("%8s %12s %10s %12s\n", "workers", "ms/step", "speedup", "efficiency");
+
+	double oneWorkerMs = 0.0;
+	for(int workers=1; workers<=maxWorkers; workers++)
+	{
+		DispatcherOptions options = gDispatcherOptions;
+		options.workers = PxU32(workers);
+
+		PxCpuDispatcher* dispatcher = CreateCpuDispatcher(options);
+		PxScene* scene = CreateScene(dispatcher, pyramids);
+
+		double ms = MeasureSteps(scene, steps);
+		if(workers == 1)
+			oneWorkerMs = ms;
+
+		printf("%8d %12.3f %9.2fx %11.0f%%\n", workers, ms, oneWorkerMs/ms, 100.0*oneWorkerMs/(ms*workers));
+
+		scene->release();
+		ReleaseCpuDispatcher(dispatcher, options);
+	}
+
+	gPhysicsSDK->release();
+	gFoundation->release();
+	return EXIT_SUCCESS;
+}
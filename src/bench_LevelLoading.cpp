@@ -0,0 +1,271 @@
+/*
+=====================================================================
+
+File Name	  :	bench_LevelLoading.cpp
+
+Description	  : Load time and first query latency of a static level ('QueryScenes.h')
+				loaded three ways, each into a new scene:
+
+				  per actor       the actors are created in code and added with one
+				                  'PxScene::addActor()' each, as the demos do
+				  built at load   the actors are created in code, a 'PxPruningStructure'
+				                  is built from them and added with 'addActors()'
+				  saved level     the level file of 'LevelPruning.h' is deserialized and
+				                  its pruning structure added with 'addActors()'
+
+				The level file is written by the offline step when it does not exist yet,
+				or with '--rebuild'. It records the statics, shape mix and seed it was
+				built from; a file built from others is rejected with a request for
+				'--rebuild'. After each load one raycast is timed alone, then the
+				remaining rays, then all rays again after one simulation step. The hit
+				distances of every method must match those of the per actor load.
+				No GL context is needed.
+
+				Command line options:
+				  --statics N    Static actors in the level (default 50000)
+				  --shapes S     boxes, spheres, capsules or mixed (default mixed)
+				  --level F      Level file (default query_level.bin)
+				  --rebuild      Run the offline step even if the level file exists
+				  --rays N       Rays cast after each load (default 1000)
+				  --repeat N     Loads per method, the best is reported (default 3)
+
+=====================================================================
+*/
+
+#define _DEBUG 1
+
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "CpuDispatcher.h"		//CreateCpuDispatcher()
+#include "QueryScenes.h"		//CreateQueryActors(), GenerateQueryRays()
+#include "LevelPruning.h"		//LevelSave(), LevelLoad(), LevelAddToScene()
+
+
+
+using namespace std;
+using namespace physx;
+
+
+static PxDefaultErrorCallback	gDefaultErrorCallback;		//Instance of default implementation of the error callback
+static PxDefaultAllocator		gDefaultAllocatorCallback;	//Instance of default implementation of the allocator interface required by the SDK
+
+PxFoundation*	gFoundation	= NULL;
+PxPhysics*		gPhysicsSDK	= NULL;
+
+
+enum LoadMethod
+{
+	eLOAD_PER_ACTOR,
+	eLOAD_BUILT_AT_LOAD,
+	eLOAD_SAVED_LEVEL
+};
+
+const char* gLoadMethodNames[] = { "per actor", "built at load", "saved level" };
+
+
+//Times of one load; the best of the repeats is kept per column
+struct LoadTiming
+{
+	double	createMs;		//Actors made in code, or the level file read and deserialized
+	double	addMs;			//Actors or pruning structure added to the scene
+	double	firstQueryMs;	//The first raycast after the load
+	double	nextRayUs;		//Each of the remaining rays
+	double	steppedRayUs;	//Each ray after one simulation step
+};
+
+
+//Closest hit distance of a ray; PX_MAX_F32 for misses
+PxReal CastRay(PxScene& scene, const QueryRays& rays, PxU32 i)
+{
+	PxRaycastBuffer buffer;
+	scene.raycast(rays.origins[i], rays.directions[i], rays.maxDistance, buffer, PxHitFlag::eDISTANCE);
+	return buffer.hasBlock ? buffer.block.distance : PX_MAX_F32;
+}
+
+
+//Statics, shape mix and seed of the level, the key of its file
+PxU64 LevelKey(const QuerySceneDesc& desc)
+{
+	return PxU64(desc.statics) | PxU64(desc.shapes) << 32 | PxU64(desc.seed) << 40;
+}
+
+
+void PrintLevelKey(PxU64 key)
+{
+	fprintf(stderr, "%u statics (%s), seed %u", PxU32(key), QueryShapeMixName(QueryShapeMix((key >> 32) & 0xff)), PxU32(key >> 40));
+}
+
+
+//The offline step: the level's actors, their pruning structure and the file
+bool BuildLevelFile(const QuerySceneDesc& desc, const char* path)
+{
+	vector<PxRigidActor*> actors;
+	CreateQueryActors(*gPhysicsSDK, desc, actors);
+	PxPruningStructure* pruning = LevelBuildPruningStructure(*gPhysicsSDK, &actors[0], PxU32(actors.size()));
+	bool saved = pruning && LevelSave(*gPhysicsSDK, *pruning, path, LevelKey(desc));
+	if(pruning)
+		pruning->release();
+	for(size_t i=0; i<actors.size(); i++)
+		actors[i]->release();
+	return saved;
+}
+
+
+//Loads the level one way into a new scene, times it and its first queries, and releases it again
+bool LoadAndQuery(LoadMethod method, const QuerySceneDesc& desc, const char* path, const QueryRays& rays,
+	LoadTiming& timing, vector<PxReal>& distances)
+{
+	PxScene* scene = gPhysicsSDK->createScene(ChapterSceneDesc(*gPhysicsSDK, gCpuDispatcher));
+	vector<PxRigidActor*> actors;
+	PrunedLevel level;
+	level.collection = NULL;
+	level.block		 = NULL;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	if(method == eLOAD_SAVED_LEVEL)
+	{
+		if(!LevelLoad(*gPhysicsSDK, path, level) || level.key != LevelKey(desc))
+		{
+			if(level.collection)
+			{
+				fprintf(stderr, "Level '%s' was built from ", path);
+				PrintLevelKey(level.key);
+				fprintf(stderr, ", not ");
+				PrintLevelKey(LevelKey(desc));
+				fprintf(stderr, "\n");
+			}
+			fprintf(stderr, "Run with --rebuild to write the level file again\n");
+			LevelRelease(level);
+			scene->release();
+			return false;
+		}
+	}
+	else
+		CreateQueryActors(*gPhysicsSDK, desc, actors);
+	timing.createMs = QueryElapsedMs(start);
+
+	start = chrono::steady_clock::now();
+	if(method == eLOAD_PER_ACTOR)
+	{
+		for(size_t i=0; i<actors.size(); i++)
+			scene->addActor(*actors[i]);
+	}
+	else if(method == eLOAD_BUILT_AT_LOAD)
+	{
+		PxPruningStructure* pruning = LevelBuildPruningStructure(*gPhysicsSDK, &actors[0], PxU32(actors.size()));
+		scene->addActors(*pruning);
+		pruning->release();
+	}
+	else
+		LevelAddToScene(*scene, level);
+	timing.addMs = QueryElapsedMs(start);
+
+	PxU32 count = PxU32(rays.origins.size());
+	distances.resize(count);
+	start = chrono::steady_clock::now();
+	distances[0] = CastRay(*scene, rays, 0);
+	timing.firstQueryMs = QueryElapsedMs(start);
+
+	start = chrono::steady_clock::now();
+	for(PxU32 i=1; i<count; i++)
+		distances[i] = CastRay(*scene, rays, i);
+	timing.nextRayUs = count > 1 ? 1000.0*QueryElapsedMs(start)/(count - 1) : 0.0;
+
+	scene->simulate(1.0f/60.0f);
+	scene->fetchResults(true);
+	PxReal checksum = 0.0f;
+	start = chrono::steady_clock::now();
+	for(PxU32 i=0; i<count; i++)
+		checksum += CastRay(*scene, rays, i);
+	timing.steppedRayUs = 1000.0*QueryElapsedMs(start)/count;
+	PX_UNUSED(checksum);
+
+	scene->release();
+	if(method == eLOAD_SAVED_LEVEL)
+		LevelRelease(level);
+	for(size_t i=0; i<actors.size(); i++)
+		actors[i]->release();
+	return true;
+}
+
+
+int main(int argc, char** argv)
+{
+	ParseDispatcherOptions(argc, argv);	//--workers N, --affinity, --priority P, --dispatcher D
+
+	QuerySceneDesc desc;
+	if(!ParseQuerySceneOptions(argc, argv, 50000, desc))	//--statics N, --shapes S
+		return EXIT_FAILURE;
+
+	const char* path = GetStringArgument(argc, argv, "--level", "query_level.bin");
+	bool rebuild	 = HasArgument(argc, argv, "--rebuild");
+	PxU32 rayCount	 = PxU32(PxMax(1, GetIntArgument(argc, argv, "--rays", 1000)));
+	int repeat		 = PxMax(1, GetIntArgument(argc, argv, "--repeat", 3));
+
+	gFoundation = PxCreateFoundation(PX_FOUNDATION_VERSION, gDefaultAllocatorCallback, gDefaultErrorCallback);
+	gPhysicsSDK = PxCreatePhysics(PX_PHYSICS_VERSION, *gFoundation, PxTolerancesScale());
+	if(gPhysicsSDK == NULL)
+	{
+		cerr<<"Error creating PhysX3 device, Exiting..."<<endl;
+		exit(1);
+	}
+	CreateCpuDispatcher();
+
+	FILE* existing = rebuild ? NULL : fopen(path, "rb");
+	if(existing)
+		fclose(existing);
+	else
+	{
+		if(!BuildLevelFile(desc, path))
+			return EXIT_FAILURE;
+		printf("offline step: pruning structure of %u statics built in %.3f ms, serialized in %.3f ms, %.1f KB written to '%s'\n",
+			desc.statics, gLevelPruningStats.buildMs, gLevelPruningStats.serializeMs, gLevelPruningStats.bytes/1024.0, path);
+	}
+
+	QueryRays rays;
+	GenerateQueryRays(desc, rayCount, 1000.0f, 7, rays);
+
+	printf("statics: %u (%s)  level: '%s'  rays: %u  best of %d loads\n\n",
+		desc.statics, QueryShapeMixName(desc.shapes), path, rayCount, repeat);
+	printf("%-14s %10s %10s %10s %12s %12s %12s %11s\n",
+		"method", "create ms", "add ms", "load ms", "1st query ms", "next us/ray", "stepped us", "mismatches");
+
+	vector<PxReal> reference;
+	PxU32 mismatches = 0;
+	for(int m=eLOAD_PER_ACTOR; m<=eLOAD_SAVED_LEVEL; m++)
+	{
+		LoadTiming best = { 1e30, 1e30, 1e30, 1e30, 1e30 };
+		vector<PxReal> distances;
+		for(int run=0; run<repeat; run++)
+		{
+			LoadTiming timing;
+			if(!LoadAndQuery(LoadMethod(m), desc, path, rays, timing, distances))
+				return EXIT_FAILURE;
+			best.createMs	  = PxMin(best.createMs, timing.createMs);
+			best.addMs		  = PxMin(best.addMs, timing.addMs);
+			best.firstQueryMs = PxMin(best.firstQueryMs, timing.firstQueryMs);
+			best.nextRayUs	  = PxMin(best.nextRayUs, timing.nextRayUs);
+			best.steppedRayUs = PxMin(best.steppedRayUs, timing.steppedRayUs);
+		}
+
+		if(m == eLOAD_PER_ACTOR)
+			reference = distances;
+		PxU32 methodMismatches = 0;
+		for(PxU32 i=0; i<rayCount; i++)
+			methodMismatches += PxAbs(reference[i] - distances[i]) > 1e-4f*(1.0f + PxAbs(reference[i]));
+		mismatches += methodMismatches;
+
+		printf("%-14s %10.3f %10.3f %10.3f %12.3f %12.3f %12.3f %11u\n", gLoadMethodNames[m],
+			best.createMs, best.addMs, best.createMs + best.addMs, best.firstQueryMs, best.nextRayUs, best.steppedRayUs, methodMismatches);
+	}
+	printf("\n");
+	PrintLevelPruningStats();
+
+	gPhysicsSDK->release();
+	ReleaseCpuDispatcher();
+	gFoundation->release();
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
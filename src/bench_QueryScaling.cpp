@@ -0,0 +1,178 @@
+/*
+=====================================================================
+
+File Name	  :	bench_QueryScaling.cpp
+
+Description	  : Scaling report for the parallel query executor of 'ParallelQuery.h'. One
+				scene of scattered static shapes ('QueryScenes.h') is built, and the same
+				mix of raycasts, sweeps and overlaps is executed on 1..N threads. Queries
+				per second, the speedup and the efficiency over one thread are printed. The
+				results of every thread count are checked against those of one thread.
+				No GL context is needed.
+
+				Command line options:
+				  --statics N       Static actors in the scene (default 50000)
+				  --shapes S        boxes, spheres, capsules or mixed (default mixed)
+				  --rays N          Raycasts per batch (default 100000)
+				  --sweeps N        Sphere sweeps per batch (default 20000)
+				  --overlaps N      Sphere overlaps per batch (default 20000)
+				  --distance D      Ray and sweep length (default 100)
+				  --max-threads N   Highest thread count, defaults to the hardware concurrency
+				  --chunk N         Requests a thread claims at a time (default 64)
+				  --repeat N        Runs per thread count, the best is reported (default 3)
+				  --affinity, --priority P, --dispatcher D   As for the demos
+
+=====================================================================
+*/
+
+#define _DEBUG 1
+
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "CpuDispatcher.h"		//CreateCpuDispatcher()
+#include "QueryScenes.h"		//CreateQueryScene(), GenerateQueryRays()
+#include "ParallelQuery.h"		//ParallelQueryExecute()
+
+
+
+using namespace std;
+using namespace physx;
+
+
+static PxDefaultErrorCallback	gDefaultErrorCallback;		//Instance of default implementation of the error callback
+static PxDefaultAllocator		gDefaultAllocatorCallback;	//Instance of default implementation of the allocator interface required by the SDK
+
+PxFoundation*	gFoundation	= NULL;
+PxPhysics*		gPhysicsSDK	= NULL;
+
+const PxReal	gSweepRadius	= 0.25f;
+const PxReal	gOverlapRadius	= 2.0f;
+
+
+//Raycasts, then sweeps, then overlaps, all starting at the generated ray origins
+void QueueRequests(const QueryRays& rays, PxU32 raycasts, PxU32 sweeps, PxU32 overlaps)
+{
+	ParallelQueryClear();
+	PxSphereGeometry sweepSphere(gSweepRadius), overlapSphere(gOverlapRadius);
+	PxU32 k = 0;
+	for(PxU32 i=0; i<raycasts; i++, k++)
+		ParallelQueryAddRaycast(rays.origins[k], rays.directions[k], rays.maxDistance);
+	for(PxU32 i=0; i<sweeps; i++, k++)
+		ParallelQueryAddSweep(sweepSphere, PxTransform(rays.origins[k]), rays.directions[k], rays.maxDistance);
+	for(PxU32 i=0; i<overlaps; i++, k++)
+		ParallelQueryAddOverlap(overlapSphere, PxTransform(rays.origins[k]));
+}
+
+
+//Number of requests whose results differ from 'reference'
+PxU32 CountMismatches(const ParallelQueryResults& reference, const ParallelQueryResults& results)
+{
+	PxU32 mismatches = 0;
+	for(size_t i=0; i<reference.closest.size(); i++)
+	{
+		bool same = reference.closest[i].actor == results.closest[i].actor
+				 && reference.closest[i].distance == results.closest[i].distance
+				 && reference.touchFirst[i] == results.touchFirst[i]
+				 && reference.touchCount[i] == results.touchCount[i];
+		for(PxU32 j=0; same && j<reference.touchCount[i]; j++)
+			same = reference.touches[reference.touchFirst[i] + j].shape == results.touches[results.touchFirst[i] + j].shape;
+		mismatches += !same;
+	}
+	return mismatches;
+}
+
+
+int main(int argc, char** argv)
+{
+	ParseDispatcherOptions(argc, argv);	//Affinity and priority, the thread count is swept
+
+	QuerySceneDesc desc;
+	if(!ParseQuerySceneOptions(argc, argv, 50000, desc))	//--statics N, --shapes S
+		return EXIT_FAILURE;
+
+	PxU32 raycasts	 = PxU32(PxMax(0, GetIntArgument(argc, argv, "--rays", 100000)));
+	PxU32 sweeps	 = PxU32(PxMax(0, GetIntArgument(argc, argv, "--sweeps", 20000)));
+	PxU32 overlaps	 = PxU32(PxMax(0, GetIntArgument(argc, argv, "--overlaps", 20000)));
+	PxReal distance	 = GetFloatArgument(argc, argv, "--distance", 100.0f);
+	PxU32 maxThreads = PxU32(PxMax(1, GetIntArgument(argc, argv, "--max-threads", int(HardwareThreadCount()))));
+	PxU32 chunk		 = PxU32(PxMax(1, GetIntArgument(argc, argv, "--chunk", int(PARALLEL_QUERY_DEFAULT_CHUNK))));
+	int repeat		 = PxMax(1, GetIntArgument(argc, argv, "--repeat", 3));
+	PxU32 requests	 = raycasts + sweeps + overlaps;
+	if(!requests)
+	{
+		cerr<<"Nothing to query"<<endl;
+		return EXIT_FAILURE;
+	}
+
+	gFoundation = PxCreateFoundation(PX_FOUNDATION_VERSION, gDefaultAllocatorCallback, gDefaultErrorCallback);
+	gPhysicsSDK = PxCreatePhysics(PX_PHYSICS_VERSION, *gFoundation, PxTolerancesScale());
+	if(gPhysicsSDK == NULL)
+	{
+		cerr<<"Error creating PhysX3 device, Exiting..."<<endl;
+		exit(1);
+	}
+
+	//The calling thread is one of the query threads, the dispatcher provides the others
+	DispatcherOptions options = gDispatcherOptions;
+	options.workers = maxThreads - 1;
+	PxCpuDispatcher* dispatcher = CreateCpuDispatcher(options);
+
+	PxScene* scene = CreateQueryScene(*gPhysicsSDK, dispatcher, desc);
+	scene->simulate(1.0f/60.0f);		//Builds the query trees of the new actors
+	scene->fetchResults(true);
+
+	QueryRays rays;
+	GenerateQueryRays(desc, requests, distance, 2, rays);
+	ParallelQueryInit(*scene, 1, chunk);
+	QueueRequests(rays, raycasts, sweeps, overlaps);
+
+	printf("statics: %u (%s)  raycasts: %u  sweeps: %u  overlaps: %u  chunk: %u  best of %d runs  hardware threads: %u\n\n",
+		desc.statics, QueryShapeMixName(desc.shapes), raycasts, sweeps, overlaps, chunk, repeat, HardwareThreadCount());
+	printf("%8s %10s %12s %10s %12s %12s\n", "threads", "ms", "Mqueries/s", "speedup", "efficiency", "mismatches");
+
+	ParallelQueryResults reference;
+	double oneThreadMs = 0.0;
+	PxU32 totalMismatches = 0;
+	for(PxU32 threads=1; threads<=maxThreads; threads++)
+	{
+		ParallelQuerySetThreads(threads);
+
+		double bestMs = 1e30;
+		for(int run=0; run<repeat; run++)
+		{
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			ParallelQueryExecute();
+			bestMs = PxMin(bestMs, QueryElapsedMs(start));
+		}
+
+		if(threads == 1)
+		{
+			reference = gParallelQuery.results;
+			oneThreadMs = bestMs;
+		}
+		PxU32 mismatches = CountMismatches(reference, gParallelQuery.results);
+		totalMismatches += mismatches;
+
+		printf("%8u %10.3f %12.3f %9.2fx %11.0f%% %12u\n", threads, bestMs, requests/(bestMs*1000.0),
+			oneThreadMs/bestMs, 100.0*oneThreadMs/(bestMs*threads), mismatches);
+	}
+
+	const ParallelQueryResults& r = gParallelQuery.results;
+	PxU32 hits = 0, full = 0;
+	for(PxU32 i=0; i<requests; i++)
+	{
+		hits += r.closest[i].actor != NULL;
+		full += gParallelQuery.overflowed[i];
+	}
+	printf("\nraycast and sweep hits: %u  overlap touches: %u  full overlaps: %u\n", hits, PxU32(r.touches.size()), full);
+
+	ParallelQueryRelease();
+	scene->release();
+	ReleaseCpuDispatcher(dispatcher, options);
+	gPhysicsSDK->release();
+	gFoundation->release();
+	return totalMismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
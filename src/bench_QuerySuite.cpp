@@ -0,0 +1,342 @@
+/*
+=====================================================================
+
+File Name	  :	bench_QuerySuite.cpp
+
+Description	  : Throughput and latency of every kind of scene query, over a grid of
+				synthetic scenes ('QueryScenes.h') for capacity planning.
+
+				The scenes vary in density, shape mix and static/dynamic ratio, and all
+				have the same number of actors. Density is in shapes per 8 cubic units
+				and sets the size of the cube. Dynamic actors sleep, so they stay where
+				they were put but are kept in the scene's dynamic tree.
+
+				Each scene runs the same number of each query kind from random points:
+				raycasts for the closest hit, any hit and all hits; closest sphere,
+				capsule and box sweeps; and sphere and box overlaps collecting all
+				touches. Each query is timed alone, which adds the cost of two clock
+				reads to it. The table gives queries per second of the summed times, the
+				mean, median and 99th percentile latency, the hits per query and the
+				PhysX allocations per query. The allocations are counted by the
+				allocator callback of the foundation.
+				No GL context is needed.
+
+				Command line options:
+				  --actors N         Actors in every scene (default 20000)
+				  --densities L      Comma separated densities (default 0.25,1,4)
+				  --shapes L         Comma separated shape mixes of boxes, spheres,
+				                     capsules and mixed, or all (default mixed)
+				  --dynamic L        Comma separated fractions of dynamic actors (default 0,0.5)
+				  --queries N        Queries of each kind per scene (default 20000)
+				  --distance D       Length of raycasts and sweeps (default 20)
+				  --csv FILE         Append "actors,density,shapes,dynamic,query,queries_per_s,
+				                     mean_us,p50_us,p99_us,hits_per_query,allocs_per_query"
+				                     lines to FILE
+
+=====================================================================
+*/
+
+#define _DEBUG 1
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <string>
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "CpuDispatcher.h"		//CreateCpuDispatcher()
+#include "QueryScenes.h"		//CreateQueryScene(), QuerySceneExtent(), QueryRandom
+
+
+
+using namespace std;
+using namespace physx;
+
+
+//Counts every PhysX allocation, from any thread
+class CountingAllocator : public PxAllocatorCallback
+{
+public:
+	atomic<PxU64>		allocations;
+	PxDefaultAllocator	allocator;
+
+	CountingAllocator() : allocations(0) {}
+
+	void* allocate(size_t size, const char* typeName, const char* filename, int line)
+	{
+		allocations++;
+		return allocator.allocate(size, typeName, filename, line);
+	}
+
+	void deallocate(void* ptr)
+	{
+		allocator.deallocate(ptr);
+	}
+};
+
+
+static PxDefaultErrorCallback	gDefaultErrorCallback;		//Instance of default implementation of the error callback
+static CountingAllocator		gCountingAllocator;			//Default allocator with a count of the allocations
+
+PxFoundation*	gFoundation	= NULL;
+PxPhysics*		gPhysicsSDK	= NULL;
+
+const PxU32		gMaxTouches		= 256;
+const PxU32		gWarmupQueries	= 100;
+
+
+enum SuiteQuery
+{
+	eSUITE_RAYCAST_CLOSEST,
+	eSUITE_RAYCAST_ANY,
+	eSUITE_RAYCAST_MULTIPLE,
+	eSUITE_SWEEP_SPHERE,
+	eSUITE_SWEEP_CAPSULE,
+	eSUITE_SWEEP_BOX,
+	eSUITE_OVERLAP_SPHERE,
+	eSUITE_OVERLAP_BOX,
+	eSUITE_QUERY_COUNT
+};
+
+const char* gSuiteQueryNames[eSUITE_QUERY_COUNT] =
+{
+	"raycast closest", "raycast any", "raycast multiple",
+	"sweep sphere", "sweep capsule", "sweep box",
+	"overlap sphere", "overlap box"
+};
+
+
+//Query origins, directions and orientations, shared by all kinds
+struct SuiteQueries
+{
+	vector<PxVec3>	origins;
+	vector<PxVec3>	directions;
+	vector<PxQuat>	rotations;
+	PxReal			distance;
+};
+
+
+struct SuiteResult
+{
+	double	queriesPerSecond;
+	double	meanUs;
+	double	p50Us;
+	double	p99Us;
+	double	hitsPerQuery;
+	double	allocsPerQuery;
+};
+
+
+vector<PxReal> ParseFloats(const char* list)
+{
+	vector<PxReal> values;
+	while(list && *list)
+	{
+		char* end;
+		double value = strtod(list, &end);
+		if(end == list)
+			break;
+		values.push_back(PxReal(value));
+		list = *end == ',' ? end + 1 : end;
+	}
+	return values;
+}
+
+
+//Shape mixes named in a comma separated list, or all of them
+bool ParseShapeMixes(const char* list, vector<QueryShapeMix>& mixes)
+{
+	if(!strcmp(list, "all"))
+	{
+		for(int i=eQUERY_SHAPES_BOXES; i<=eQUERY_SHAPES_MIXED; i++)
+			mixes.push_back(QueryShapeMix(i));
+		return true;
+	}
+	while(*list)
+	{
+		const char* end = strchr(list, ',');
+		string name(list, end ? size_t(end - list) : strlen(list));
+		QueryShapeMix mix;
+		if(!ParseQueryShapeMix(name.c_str(), mix))
+			return false;
+		mixes.push_back(mix);
+		list = end ? end + 1 : list + name.size();
+	}
+	return !mixes.empty();
+}
+
+
+void GenerateSuiteQueries(PxReal extent, PxU32 count, PxReal distance, SuiteQueries& q)
+{
+	QueryRandom random(5);
+	q.origins.resize(count);
+	q.directions.resize(count);
+	q.rotations.resize(count);
+	q.distance = distance;
+	for(PxU32 i=0; i<count; i++)
+	{
+		q.origins[i]	= random.inCube(extent);
+		q.directions[i] = random.direction();
+		q.rotations[i]	= random.rotation();
+	}
+}
+
+
+//Runs query 'i' of one kind; returns its hits
+PxU32 RunSuiteQuery(PxScene& scene, SuiteQuery kind, const SuiteQueries& q, PxU32 i)
+{
+	static PxRaycastHit	rayTouches[gMaxTouches];
+	static PxOverlapHit	overlapTouches[gMaxTouches];
+	const PxQueryFilterData anyHit(PxQueryFlag::eSTATIC | PxQueryFlag::eDYNAMIC | PxQueryFlag::eANY_HIT);
+	const PxQueryFilterData allTouch(PxQueryFlag::eSTATIC | PxQueryFlag::eDYNAMIC | PxQueryFlag::eNO_BLOCK);
+	PxTransform pose(q.origins[i], q.rotations[i]);
+
+	switch(kind)
+	{
+	case eSUITE_RAYCAST_CLOSEST:
+	case eSUITE_RAYCAST_ANY:
+	{
+		PxRaycastBuffer buffer;
+		scene.raycast(q.origins[i], q.directions[i], q.distance, buffer, PxHitFlag::eDEFAULT,
+			kind == eSUITE_RAYCAST_ANY ? anyHit : PxQueryFilterData());
+		return buffer.hasBlock;
+	}
+	case eSUITE_RAYCAST_MULTIPLE:
+	{
+		PxRaycastBuffer buffer(rayTouches, gMaxTouches);
+		scene.raycast(q.origins[i], q.directions[i], q.distance, buffer, PxHitFlag::eDEFAULT, allTouch);
+		return buffer.nbTouches;
+	}
+	case eSUITE_SWEEP_SPHERE:
+	case eSUITE_SWEEP_CAPSULE:
+	case eSUITE_SWEEP_BOX:
+	{
+		PxSweepBuffer buffer;
+		if(kind == eSUITE_SWEEP_SPHERE)
+			scene.sweep(PxSphereGeometry(0.5f), pose, q.directions[i], q.distance, buffer);
+		else if(kind == eSUITE_SWEEP_CAPSULE)
+			scene.sweep(PxCapsuleGeometry(0.3f, 0.5f), pose, q.directions[i], q.distance, buffer);
+		else
+			scene.sweep(PxBoxGeometry(0.4f, 0.4f, 0.4f), pose, q.directions[i], q.distance, buffer);
+		return buffer.hasBlock;
+	}
+	default:
+	{
+		PxOverlapBuffer buffer(overlapTouches, gMaxTouches);
+		if(kind == eSUITE_OVERLAP_SPHERE)
+			scene.overlap(PxSphereGeometry(2.0f), pose, buffer, allTouch);
+		else
+			scene.overlap(PxBoxGeometry(1.5f, 1.5f, 1.5f), pose, buffer, allTouch);
+		return buffer.nbTouches;
+	}
+	}
+}
+
+
+SuiteResult MeasureSuiteQuery(PxScene& scene, SuiteQuery kind, const SuiteQueries& q, vector<double>& latencies)
+{
+	PxU32 count = PxU32(q.origins.size());
+	for(PxU32 i=0; i<PxMin(gWarmupQueries, count); i++)
+		RunSuiteQuery(scene, kind, q, i);
+
+	PxU64 hits = 0;
+	double totalMs = 0.0;
+	PxU64 allocations = gCountingAllocator.allocations;
+	for(PxU32 i=0; i<count; i++)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		hits += RunSuiteQuery(scene, kind, q, i);
+		latencies[i] = QueryElapsedMs(start);
+		totalMs += latencies[i];
+	}
+	allocations = gCountingAllocator.allocations - allocations;
+
+	SuiteResult r;
+	sort(latencies.begin(), latencies.begin() + count);
+	r.queriesPerSecond = totalMs > 0.0 ? 1000.0*count/totalMs : 0.0;
+	r.meanUs		   = 1000.0*totalMs/count;
+	r.p50Us			   = 1000.0*latencies[count/2];
+	r.p99Us			   = 1000.0*latencies[PxMin(count - 1, PxU32(PxU64(count)*99/100))];
+	r.hitsPerQuery	   = double(hits)/count;
+	r.allocsPerQuery   = double(allocations)/count;
+	return r;
+}
+
+
+int main(int argc, char** argv)
+{
+	ParseDispatcherOptions(argc, argv);	//--workers N, --affinity, --priority P, --dispatcher D
+	PxU32 actors			 = PxU32(PxMax(1, GetIntArgument(argc, argv, "--actors", 20000)));
+	vector<PxReal> densities = ParseFloats(GetStringArgument(argc, argv, "--densities", "0.25,1,4"));
+	vector<PxReal> dynamics	 = ParseFloats(GetStringArgument(argc, argv, "--dynamic", "0,0.5"));
+	PxU32 queryCount		 = PxU32(PxMax(1, GetIntArgument(argc, argv, "--queries", 20000)));
+	PxReal distance			 = GetFloatArgument(argc, argv, "--distance", 20.0f);
+	const char* csvPath		 = GetStringArgument(argc, argv, "--csv", NULL);
+
+	vector<QueryShapeMix> mixes;
+	if(!ParseShapeMixes(GetStringArgument(argc, argv, "--shapes", "mixed"), mixes) || densities.empty() || dynamics.empty())
+	{
+		cerr<<"Expected --shapes boxes|spheres|capsules|mixed|all, --densities D,D,... and --dynamic F,F,..."<<endl;
+		return EXIT_FAILURE;
+	}
+
+	FILE* csv = csvPath ? fopen(csvPath, "a") : NULL;
+	if(csvPath && !csv)
+		cerr<<"Cannot open "<<csvPath<<endl;
+
+	gFoundation = PxCreateFoundation(PX_FOUNDATION_VERSION, gCountingAllocator, gDefaultErrorCallback);
+	gPhysicsSDK = PxCreatePhysics(PX_PHYSICS_VERSION, *gFoundation, PxTolerancesScale());
+	if(gPhysicsSDK == NULL)
+	{
+		cerr<<"Error creating PhysX3 device, Exiting..."<<endl;
+		exit(1);
+	}
+	PxCpuDispatcher* dispatcher = CreateCpuDispatcher();
+
+	printf("actors: %u  queries: %u per kind and scene  distance: %g\n", actors, queryCount, distance);
+	vector<double> latencies(queryCount);
+	SuiteQueries queries;
+	for(size_t d=0; d<densities.size(); d++)
+	for(size_t m=0; m<mixes.size(); m++)
+	for(size_t f=0; f<dynamics.size(); f++)
+	{
+		PxReal density	 = PxMax(densities[d], 1e-3f);
+		PxReal fraction	 = PxClamp(dynamics[f], 0.0f, 1.0f);
+
+		QuerySceneDesc desc;
+		desc.dynamics = PxU32(fraction*actors + 0.5f);
+		desc.statics  = actors - desc.dynamics;
+		desc.shapes	  = mixes[m];
+		desc.extent	  = QuerySceneExtent(actors, density);
+		desc.seed	  = 1;
+
+		PxScene* scene = CreateQueryScene(*gPhysicsSDK, dispatcher, desc);
+		scene->simulate(1.0f/60.0f);		//Builds the query trees of the new actors
+		scene->fetchResults(true);
+		GenerateSuiteQueries(desc.extent, queryCount, distance, queries);
+
+		printf("\ndensity %g  shapes %s  statics %u  dynamics %u  extent %.1f\n",
+			density, QueryShapeMixName(desc.shapes), desc.statics, desc.dynamics, desc.extent);
+		printf("%-18s %12s %10s %10s %10s %10s %12s\n", "query", "queries/s", "mean us", "p50 us", "p99 us", "hits", "allocs/query");
+		for(int k=0; k<eSUITE_QUERY_COUNT; k++)
+		{
+			SuiteResult r = MeasureSuiteQuery(*scene, SuiteQuery(k), queries, latencies);
+			printf("%-18s %12.0f %10.3f %10.3f %10.3f %10.2f %12.3f\n", gSuiteQueryNames[k],
+				r.queriesPerSecond, r.meanUs, r.p50Us, r.p99Us, r.hitsPerQuery, r.allocsPerQuery);
+			if(csv)
+				fprintf(csv, "%u,%g,%s,%g,%s,%.0f,%.4f,%.4f,%.4f,%.3f,%.4f\n", actors, density, QueryShapeMixName(desc.shapes), fraction,
+					gSuiteQueryNames[k], r.queriesPerSecond, r.meanUs, r.p50Us, r.p99Us, r.hitsPerQuery, r.allocsPerQuery);
+		}
+		scene->release();
+	}
+
+	if(csv)
+		fclose(csv);
+	gPhysicsSDK->release();
+	ReleaseCpuDispatcher();			//Worker threads outlive the scenes
+	gFoundation->release();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,258 @@
+/*
+=====================================================================
+
+File Name	  :	bench_RayPackets.cpp
+
+Description	  : Closest hit distances of coherent ray bundles against the static shapes of a
+				scene ('QueryScenes.h'), as in CH6 but with many rays per frame. One
+				'PxScene::raycast()' per ray is compared with the packet BVH of
+				'PacketBVH.h', traversing one ray at a time and whole packets. The BVH is
+				built 4-wide and, on CPUs with AVX2, also 8-wide; both are reported.
+
+				Two bundle kinds are cast. A pinhole camera outside the scene's cube
+				casts its pixel rays in tiles of 8x4. Sensor fans start at random points
+				inside the cube, each casting its rays in a 30 degree cone. Rays per
+				second, the speedup over the scene and the rays whose distance differs
+				from the scene's are printed for each.
+				No GL context is needed.
+
+				Command line options:
+				  --statics N    Static actors in the scene (default 10000)
+				  --shapes S     boxes, spheres, capsules or mixed (default mixed)
+				  --width W      Camera image width, a multiple of 8 (default 256)
+				  --height H     Camera image height, a multiple of 4 (default 256)
+				  --fans N       Sensor fans (default 2048)
+				  --fan-rays N   Rays per fan (default 32)
+				  --packet N     Rays per packet, at most 32 (default 32)
+				  --distance D   Ray length (default 1000)
+				  --repeat N     Runs per method, the best is reported (default 3)
+
+=====================================================================
+*/
+
+#define _DEBUG 1
+
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "CpuDispatcher.h"		//CreateCpuDispatcher()
+#include "QueryScenes.h"		//CreateQueryScene(), QueryRandom
+#include "PacketBVH.h"			//PacketBVHBuild(), PacketBVHRaycast()
+
+
+
+using namespace std;
+using namespace physx;
+
+
+static PxDefaultErrorCallback	gDefaultErrorCallback;		//Instance of default implementation of the error callback
+static PxDefaultAllocator		gDefaultAllocatorCallback;	//Instance of default implementation of the allocator interface required by the SDK
+
+PxFoundation*	gFoundation	= NULL;
+PxPhysics*		gPhysicsSDK	= NULL;
+
+
+//Rays in packet order, all of one length
+struct RayBundle
+{
+	vector<PxVec3>	origins;
+	vector<PxVec3>	directions;
+	PxReal			maxDistance;
+};
+
+
+//Pixel rays of a camera on the -z side looking at the cube, tile by tile of 8x4 pixels
+void GenerateCameraRays(PxReal extent, PxU32 width, PxU32 height, PxReal maxDistance, RayBundle& rays)
+{
+	PxVec3 eye(0.0f, 0.0f, -2.5f*extent);
+	PxReal halfFov = PxTan(0.5f*PxPi/3.0f);	//60 degrees vertical
+	PxReal aspect  = PxReal(width)/PxReal(height);
+	rays.maxDistance = maxDistance;
+
+	for(PxU32 ty=0; ty<height; ty+=4)
+		for(PxU32 tx=0; tx<width; tx+=8)
+			for(PxU32 y=ty; y<ty+4; y++)
+				for(PxU32 x=tx; x<tx+8; x++)
+				{
+					PxReal u = (2.0f*(x + 0.5f)/width - 1.0f)*halfFov*aspect;
+					PxReal v = (1.0f - 2.0f*(y + 0.5f)/height)*halfFov;
+					rays.origins.push_back(eye);
+					rays.directions.push_back(PxVec3(u, v, 1.0f).getNormalized());
+				}
+}
+
+
+//'fans' cones of 'raysPerFan' rays from random points in the cube
+void GenerateSensorFans(PxReal extent, PxU32 fans, PxU32 raysPerFan, PxReal maxDistance, RayBundle& rays)
+{
+	QueryRandom random(4);
+	PxReal spread = PxTan(PxPi/12.0f);	//15 degrees off the axis
+	rays.maxDistance = maxDistance;
+
+	for(PxU32 f=0; f<fans; f++)
+	{
+		PxVec3 origin  = random.inCube(extent);		//Separate statements fix the order of the draws
+		PxVec3 forward = random.direction();
+		PxVec3 side	   = forward.cross(PxAbs(forward.y) < 0.9f ? PxVec3(0,1,0) : PxVec3(1,0,0)).getNormalized();
+		PxVec3 up	   = side.cross(forward);
+		for(PxU32 i=0; i<raysPerFan; i++)
+		{
+			PxReal angle  = 2.0f*PxPi*PxReal(i)/PxReal(raysPerFan);
+			PxReal radius = spread*PxReal(i % 4 + 1)/4.0f;	//Four rings
+			rays.origins.push_back(origin);
+			rays.directions.push_back((forward + side*(radius*PxCos(angle)) + up*(radius*PxSin(angle))).getNormalized());
+		}
+	}
+}
+
+
+//Best time of 'repeat' runs of one 'PxScene::raycast()' per ray
+double RunSceneRaycasts(PxScene& scene, const RayBundle& rays, int repeat, vector<PxReal>& distances)
+{
+	double bestMs = 1e30;
+	distances.resize(rays.origins.size());
+	for(int run=0; run<repeat; run++)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for(size_t i=0; i<rays.origins.size(); i++)
+		{
+			PxRaycastBuffer buffer;
+			scene.raycast(rays.origins[i], rays.directions[i], rays.maxDistance, buffer, PxHitFlag::eDISTANCE);
+			distances[i] = buffer.hasBlock ? buffer.block.distance : PX_MAX_F32;
+		}
+		bestMs = PxMin(bestMs, QueryElapsedMs(start));
+	}
+	return bestMs;
+}
+
+
+double RunPacketBVH(const PacketBVH& bvh, const RayBundle& rays, PxU32 packetSize, int repeat, vector<PxReal>& distances)
+{
+	double bestMs = 1e30;
+	PxU32 count = PxU32(rays.origins.size());
+	vector<PxShape*> shapes(count);
+	distances.resize(count);
+	gPacketBVHStats = PacketBVHStats();		//Traversal counters of this method only
+	for(int run=0; run<repeat; run++)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		PacketBVHRaycast(bvh, &rays.origins[0], &rays.directions[0], count, rays.maxDistance, packetSize, &distances[0], &shapes[0]);
+		bestMs = PxMin(bestMs, QueryElapsedMs(start));
+	}
+	return bestMs;
+}
+
+
+//Rays that hit in one result and not in the other, or at a different distance
+PxU32 CountMismatches(const vector<PxReal>& reference, const vector<PxReal>& distances)
+{
+	PxU32 mismatches = 0;
+	for(size_t i=0; i<reference.size(); i++)
+	{
+		bool hitA = reference[i] < PX_MAX_F32, hitB = distances[i] < PX_MAX_F32;
+		mismatches += hitA != hitB || (hitA && PxAbs(reference[i] - distances[i]) > 1e-3f*(1.0f + reference[i]));
+	}
+	return mismatches;
+}
+
+
+PxU32 CompareBundle(const char* name, PxScene& scene, const vector<PacketBVH*>& bvhs, const RayBundle& rays, PxU32 packetSize, int repeat)
+{
+	vector<PxReal> sceneDistances, singleDistances, packetDistances;
+	double sceneMs = RunSceneRaycasts(scene, rays, repeat, sceneDistances);
+	PxU32 count = PxU32(rays.origins.size());
+
+	PxU32 hits = 0;
+	for(PxU32 i=0; i<count; i++)
+		hits += sceneDistances[i] < PX_MAX_F32;
+
+	printf("\n%s: %u rays, %u hits\n", name, count, hits);
+	printf("%-16s %10s %12s %10s %12s\n", "method", "ms", "Mrays/s", "speedup", "mismatches");
+	printf("%-16s %10.3f %12.2f %9.2fx %12s\n", "scene raycast", sceneMs, count/(sceneMs*1000.0), 1.0, "-");
+
+	PxU32 mismatches = 0;
+	vector<PacketBVHStats> packetStats;
+	for(size_t b=0; b<bvhs.size(); b++)
+	{
+		const PacketBVH& bvh = *bvhs[b];
+		double singleMs = RunPacketBVH(bvh, rays, 1, repeat, singleDistances);
+		double packetMs = RunPacketBVH(bvh, rays, packetSize, repeat, packetDistances);
+		packetStats.push_back(gPacketBVHStats);
+
+		PxU32 singleMismatches = CountMismatches(sceneDistances, singleDistances);
+		PxU32 packetMismatches = CountMismatches(sceneDistances, packetDistances);
+		char single[32], packets[32];
+		sprintf(single, "bvh%u single ray", bvh.width);
+		sprintf(packets, "bvh%u packets", bvh.width);
+		printf("%-16s %10.3f %12.2f %9.2fx %12u\n", single, singleMs, count/(singleMs*1000.0), sceneMs/singleMs, singleMismatches);
+		printf("%-16s %10.3f %12.2f %9.2fx %12u\n", packets, packetMs, count/(packetMs*1000.0), sceneMs/packetMs, packetMismatches);
+		mismatches += singleMismatches + packetMismatches;
+	}
+
+	for(size_t b=0; b<bvhs.size(); b++)
+	{
+		gPacketBVHStats = packetStats[b];		//Of the packet run
+		PrintPacketBVHStats(*bvhs[b]);
+	}
+	return mismatches;
+}
+
+
+int main(int argc, char** argv)
+{
+	ParseDispatcherOptions(argc, argv);	//--workers N, --affinity, --priority P, --dispatcher D
+
+	QuerySceneDesc desc;
+	if(!ParseQuerySceneOptions(argc, argv, 10000, desc))	//--statics N, --shapes S
+		return EXIT_FAILURE;
+
+	PxU32 width		 = (PxU32(PxMax(8, GetIntArgument(argc, argv, "--width", 256))) + 7) & ~7u;
+	PxU32 height	 = (PxU32(PxMax(4, GetIntArgument(argc, argv, "--height", 256))) + 3) & ~3u;
+	PxU32 fans		 = PxU32(PxMax(1, GetIntArgument(argc, argv, "--fans", 2048)));
+	PxU32 fanRays	 = PxU32(PxMax(1, GetIntArgument(argc, argv, "--fan-rays", 32)));
+	PxU32 packetSize = PxU32(PxClamp(GetIntArgument(argc, argv, "--packet", int(PACKET_BVH_MAX_PACKET)), 1, int(PACKET_BVH_MAX_PACKET)));
+	PxReal distance	 = GetFloatArgument(argc, argv, "--distance", 1000.0f);
+	int repeat		 = PxMax(1, GetIntArgument(argc, argv, "--repeat", 3));
+
+	gFoundation = PxCreateFoundation(PX_FOUNDATION_VERSION, gDefaultAllocatorCallback, gDefaultErrorCallback);
+	gPhysicsSDK = PxCreatePhysics(PX_PHYSICS_VERSION, *gFoundation, PxTolerancesScale());
+	if(gPhysicsSDK == NULL)
+	{
+		cerr<<"Error creating PhysX3 device, Exiting..."<<endl;
+		exit(1);
+	}
+
+	PxScene* scene = CreateQueryScene(*gPhysicsSDK, CreateCpuDispatcher(), desc);
+	scene->simulate(1.0f/60.0f);		//Builds the query trees of the new actors
+	scene->fetchResults(true);
+
+	PacketBVH bvh4, bvh8;
+	vector<PacketBVH*> bvhs;
+	PacketBVHBuild(*scene, bvh4, 4);
+	bvhs.push_back(&bvh4);
+	if(PacketBVHMaxWidth() >= 8)
+	{
+		PacketBVHBuild(*scene, bvh8, 8);
+		bvhs.push_back(&bvh8);
+	}
+
+	RayBundle camera, sensors;
+	GenerateCameraRays(desc.extent, width, height, distance, camera);
+	GenerateSensorFans(desc.extent, fans, fanRays, distance, sensors);
+
+	printf("statics: %u (%s)  camera: %ux%u  sensor fans: %u of %u rays  packet: %u  best of %d runs\n",
+		desc.statics, QueryShapeMixName(desc.shapes), width, height, fans, fanRays, packetSize, repeat);
+	if(bvhs.size() == 1)
+		printf("8-wide BVH skipped, the CPU has no AVX2\n");
+
+	PxU32 mismatches = CompareBundle("camera", *scene, bvhs, camera, packetSize, repeat);
+	mismatches += CompareBundle("sensor fans", *scene, bvhs, sensors, packetSize, repeat);
+
+	scene->release();
+	gPhysicsSDK->release();
+	ReleaseCpuDispatcher();			//Worker threads outlive the scene
+	gFoundation->release();
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+/*
+=====================================================================
+
+File Name	  :	bench_RenderBuffer.cpp
+
+Description	  : Compares the two debug render paths of 'RenderData()' on synthetic line and
+				triangle buffers of 10k, 100k and 1M primitives.
+
+				eRENDER_CONVERTED : float position + float RGBA expansion, streamed through GL buffers
+				eRENDER_DIRECT    : vertex arrays pointing straight at PxDebugLine/PxDebugTriangle
+
+				Each measurement ends with glFinish(), so the reported time includes the
+				driver copy and the GPU draw, not only the CPU side of the call.
+
+=====================================================================
+*/
+
+#define _DEBUG 1
+
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <PxPhysicsAPI.h> //Single header file to include all features of PhysX API
+#include <GL/freeglut.h>  //OpenGL window tool kit
+#include "RenderBuffer.h" //Used for rendering PhysX objetcs
+
+
+
+using namespace std;
+using namespace physx;
+
+
+const int gIterations = 20;	//Frames rendered per measurement
+
+
+//Fills 'buffer' with 'numLines' lines and 'numTriangles' triangles spread over a cube
+void FillBuffer(DebugRenderBuffer& buffer, PxU32 numLines, PxU32 numTriangles)
+{
+	buffer.clear();
+	buffer.mLines.reserve(numLines);
+	buffer.mTriangles.reserve(numTriangles);
+
+	PxU32 seed = 12345;
+	for(PxU32 i=0; i<numLines; i++)
+	{
+		seed = seed*1664525u + 1013904223u;
+		PxVec3 p((seed&0xff)/10.0f, ((seed>>8)&0xff)/10.0f, ((seed>>16)&0xff)/10.0f);
+		buffer.mLines.push_back(PxDebugLine(p, p + PxVec3(1,0,0), PxDebugColor::eARGB_GREEN | seed));
+	}
+
+	for(PxU32 i=0; i<numTriangles; i++)
+	{
+		seed = seed*1664525u + 1013904223u;
+		PxVec3 p((seed&0xff)/10.0f, ((seed>>8)&0xff)/10.0f, ((seed>>16)&0xff)/10.0f);
+		buffer.mTriangles.push_back(PxDebugTriangle(p, p + PxVec3(1,0,0), p + PxVec3(0,1,0), PxDebugColor::eARGB_RED | seed));
+	}
+}
+
+
+//Returns average milliseconds per frame of 'RenderData()' in the given mode
+double Measure(const PxRenderBuffer& buffer, RenderMode mode)
+{
+	gRenderMode = mode;
+
+	RenderData(buffer); //Warm up: buffer growth and driver allocations are not measured
+	glFinish();
+
+	chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+	for(int i=0; i<gIterations; i++)
+	{
+		glClear(GL_COLOR_BUFFER_BIT);
+		RenderData(buffer);
+	}
+	glFinish();
+	chrono::high_resolution_clock::time_point end = chrono::high_resolution_clock::now();
+
+	return chrono::duration<double, milli>(end - start).count() / gIterations;
+}
+
+
+int main(int argc, char** argv)
+{
+	glutInit(&argc, argv);							//Initialize GLUT
+	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);	//Enable double buffering
+	glutInitWindowSize(256, 256);
+	glutCreateWindow("RenderBuffer benchmark");		//A GL context is needed even though nothing is shown
+	glutHideWindow();
+
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	glOrtho(0, 26, 0, 26, -100, 100);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+
+	const PxU32 sizes[] = { 10000, 100000, 1000000 };
+	DebugRenderBuffer buffer;
+
+	printf("%-10s %-10s %14s %14s %10s\n", "primitive", "count", "converted ms", "direct ms", "speedup");
+
+	for(int s=0; s<3; s++)
+	{
+		FillBuffer(buffer, sizes[s], 0);
+		double converted = Measure(buffer, eRENDER_CONVERTED);
+		double direct	 = Measure(buffer, eRENDER_DIRECT);
+		printf("%-10s %-10u %14.3f %14.3f %9.2fx\n", "lines", sizes[s], converted, direct, converted/direct);
+	}
+
+	for(int s=0; s<3; s++)
+	{
+		FillBuffer(buffer, 0, sizes[s]);
+		double converted = Measure(buffer, eRENDER_CONVERTED);
+		double direct	 = Measure(buffer, eRENDER_DIRECT);
+		printf("%-10s %-10u %14.3f %14.3f %9.2fx\n", "triangles", sizes[s], converted, direct, converted/direct);
+	}
+
+	return EXIT_SUCCESS;
+}
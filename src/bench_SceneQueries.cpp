@@ -0,0 +1,235 @@
+/*
+=====================================================================
+
+File Name	  :	bench_SceneQueries.cpp
+
+Description	  : Raycast throughput of one 'PxScene::raycast()' per ray against the batched
+				ray service of 'RayService.h', on a scene of scattered static shapes
+				('QueryScenes.h'). Both methods cast the same rays for the closest hit;
+				the rays per second of each and the agreement of their hits are printed.
+
+				A second run measures the raycast cache of 'RaycastCache.h'. For several
+				frames, some of the dynamic actors drift through the scene, and the same
+				rays are cast every frame, once with 'PxScene::raycast()' and once through
+				the cache. The cache's hit rate and the query time it saved are printed,
+				and its hits are checked against the uncached ones.
+				No GL context is needed.
+
+				Command line options:
+				  --statics N    Static actors in the scene (default 10000)
+				  --shapes S     boxes, spheres, capsules or mixed (default mixed)
+				  --rays N       Rays per run (default 100000)
+				  --distance D   Ray length (default 100)
+				  --batch N      Rays per 'PxBatchQuery::execute()' (default 4096)
+				  --repeat N     Runs per method, the best is reported (default 3)
+				  --dynamics N   Sleeping dynamic actors in the scene (default 1000)
+				  --moving N     Dynamic actors set moving for the cache run (default 100)
+				  --frames N     Frames of the cache run, 0 skips it (default 60)
+				  --cache-rays N Rays cast per frame in the cache run (default 10000)
+
+=====================================================================
+*/
+
+#define _DEBUG 1
+
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "CpuDispatcher.h"		//CreateCpuDispatcher()
+#include "QueryScenes.h"		//CreateQueryScene(), GenerateQueryRays()
+#include "RayService.h"			//RayServiceExecute()
+#include "RaycastCache.h"		//RaycastCacheRaycast()
+
+
+
+using namespace std;
+using namespace physx;
+
+
+static PxDefaultErrorCallback	gDefaultErrorCallback;		//Instance of default implementation of the error callback
+static PxDefaultAllocator		gDefaultAllocatorCallback;	//Instance of default implementation of the allocator interface required by the SDK
+
+PxFoundation*	gFoundation	= NULL;
+PxPhysics*		gPhysicsSDK	= NULL;
+
+
+struct MethodResult
+{
+	double	bestMs;
+	PxU32	hits;
+};
+
+
+//One blocking 'PxScene::raycast()' per ray; 'hitActors' gets the closest actor hit by each
+MethodResult RunSceneRaycasts(PxScene& scene, const QueryRays& rays, int repeat, vector<PxRigidActor*>& hitActors)
+{
+	MethodResult result = { 1e30, 0 };
+	hitActors.assign(rays.origins.size(), NULL);
+
+	for(int run=0; run<repeat; run++)
+	{
+		PxU32 hits = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for(size_t i=0; i<rays.origins.size(); i++)
+		{
+			PxRaycastBuffer buffer;
+			if(scene.raycast(rays.origins[i], rays.directions[i], rays.maxDistance, buffer))
+			{
+				hitActors[i] = buffer.block.actor;
+				hits++;
+			}
+		}
+		result.bestMs = PxMin(result.bestMs, QueryElapsedMs(start));
+		result.hits	  = hits;
+	}
+	return result;
+}
+
+
+MethodResult RunRayService(const QueryRays& rays, int repeat)
+{
+	MethodResult result = { 1e30, 0 };
+
+	for(int run=0; run<repeat; run++)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		RayServiceClear();
+		for(size_t i=0; i<rays.origins.size(); i++)
+			RayServiceAdd(rays.origins[i], rays.directions[i], rays.maxDistance);
+		RayServiceExecute();
+		result.bestMs = PxMin(result.bestMs, QueryElapsedMs(start));
+
+		result.hits = 0;
+		for(size_t i=0; i<rays.origins.size(); i++)
+			result.hits += gRayService.results.hit[i];
+	}
+	return result;
+}
+
+
+//Same rays every frame while 'moving' dynamics drift; returns the cached hits that differ from fresh raycasts
+PxU32 RunRaycastCache(PxScene& scene, const QueryRays& rays, PxU32 count, PxU32 frames, PxU32 moving)
+{
+	vector<PxActor*> dynamics(scene.getNbActors(PxActorTypeFlag::eRIGID_DYNAMIC));
+	if(!dynamics.empty())
+		scene.getActors(PxActorTypeFlag::eRIGID_DYNAMIC, &dynamics[0], PxU32(dynamics.size()));
+	moving = PxMin(moving, PxU32(dynamics.size()));
+
+	QueryRandom random(3);
+	for(PxU32 i=0; i<moving; i++)
+	{
+		PxRigidDynamic* body = dynamics[i]->is<PxRigidDynamic>();
+		body->wakeUp();
+		body->setLinearVelocity(random.direction()*2.0f);
+	}
+
+	RaycastCacheInit();
+	vector<PxRigidActor*> cachedActors(count);
+	double freshMs = 0.0, cachedMs = 0.0;
+	PxU32 mismatches = 0;
+	for(PxU32 frame=0; frame<frames; frame++)
+	{
+		scene.simulate(1.0f/60.0f);
+		scene.fetchResults(true);
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		RaycastCacheUpdate(scene);
+		RaycastCacheHit hit;
+		for(PxU32 i=0; i<count; i++)
+		{
+			RaycastCacheRaycast(scene, rays.origins[i], rays.directions[i], rays.maxDistance, hit);
+			cachedActors[i] = hit.actor;
+		}
+		cachedMs += QueryElapsedMs(start);
+
+		start = chrono::steady_clock::now();
+		for(PxU32 i=0; i<count; i++)
+		{
+			PxRaycastBuffer buffer;
+			scene.raycast(rays.origins[i], rays.directions[i], rays.maxDistance, buffer);
+			mismatches += cachedActors[i] != (buffer.hasBlock ? buffer.block.actor : NULL);
+		}
+		freshMs += QueryElapsedMs(start);
+	}
+
+	const RaycastCacheStats& s = gRaycastCacheStats;
+	printf("\nraycast cache: %u frames of %u rays, %u of %u dynamics moving\n\n", frames, count, moving, PxU32(dynamics.size()));
+	printf("%-16s %10s %10s %10s\n", "method", "ms/frame", "hit rate", "speedup");
+	printf("%-16s %10.3f %10s %9.2fx\n", "scene raycast", freshMs/frames, "-", 1.0);
+	printf("%-16s %10.3f %9.1f%% %9.2fx\n", "cached raycast", cachedMs/frames, s.lookups ? 100.0*s.hits/s.lookups : 0.0,
+		cachedMs > 0.0 ? freshMs/cachedMs : 0.0);
+	printf("\nsaved query time: %.3f ms/frame  invalidation: %.3f ms/frame\n", (freshMs - cachedMs)/frames, s.updateMs/frames);
+	PrintRaycastCacheStats();
+	printf("mismatched cached hits: %u\n", mismatches);
+	return mismatches;
+}
+
+
+void PrintMethod(const char* name, const MethodResult& r, PxU32 rays, double baselineMs)
+{
+	printf("%-16s %10.3f %12.2f %10u %9.2fx\n", name, r.bestMs, r.bestMs > 0.0 ? rays/(r.bestMs*1000.0) : 0.0,
+		r.hits, r.bestMs > 0.0 ? baselineMs/r.bestMs : 0.0);
+}
+
+
+int main(int argc, char** argv)
+{
+	ParseDispatcherOptions(argc, argv);	//--workers N, --affinity, --priority P, --dispatcher D
+
+	QuerySceneDesc desc;
+	if(!ParseQuerySceneOptions(argc, argv, 10000, desc))	//--statics N, --shapes S
+		return EXIT_FAILURE;
+	desc.dynamics = PxU32(PxMax(0, GetIntArgument(argc, argv, "--dynamics", 1000)));
+
+	PxU32 rayCount	 = PxU32(PxMax(1, GetIntArgument(argc, argv, "--rays", 100000)));
+	PxReal distance	 = GetFloatArgument(argc, argv, "--distance", 100.0f);
+	PxU32 batchSize	 = PxU32(PxMax(1, GetIntArgument(argc, argv, "--batch", RAY_SERVICE_DEFAULT_BATCH)));
+	int repeat		 = PxMax(1, GetIntArgument(argc, argv, "--repeat", 3));
+	PxU32 moving	 = PxU32(PxMax(0, GetIntArgument(argc, argv, "--moving", 100)));
+	PxU32 frames	 = PxU32(PxMax(0, GetIntArgument(argc, argv, "--frames", 60)));
+	PxU32 cacheRays	 = PxU32(PxClamp(GetIntArgument(argc, argv, "--cache-rays", 10000), 1, int(rayCount)));
+
+	gFoundation = PxCreateFoundation(PX_FOUNDATION_VERSION, gDefaultAllocatorCallback, gDefaultErrorCallback);
+	gPhysicsSDK = PxCreatePhysics(PX_PHYSICS_VERSION, *gFoundation, PxTolerancesScale());
+	if(gPhysicsSDK == NULL)
+	{
+		cerr<<"Error creating PhysX3 device, Exiting..."<<endl;
+		exit(1);
+	}
+
+	PxScene* scene = CreateQueryScene(*gPhysicsSDK, CreateCpuDispatcher(), desc);
+	scene->simulate(1.0f/60.0f);		//Builds the query trees of the new actors
+	scene->fetchResults(true);
+
+	QueryRays rays;
+	GenerateQueryRays(desc, rayCount, distance, 2, rays);
+	RayServiceInit(*scene, batchSize, rayCount);
+
+	printf("statics: %u  dynamics: %u (%s)  rays: %u of length %g  batch: %u  best of %d runs\n\n",
+		desc.statics, desc.dynamics, QueryShapeMixName(desc.shapes), rayCount, distance, batchSize, repeat);
+	printf("%-16s %10s %12s %10s %10s\n", "method", "ms", "Mrays/s", "hits", "speedup");
+
+	vector<PxRigidActor*> sceneHits;
+	MethodResult single = RunSceneRaycasts(*scene, rays, repeat, sceneHits);
+	MethodResult batched = RunRayService(rays, repeat);
+	PrintMethod("scene raycast", single, rayCount, single.bestMs);
+	PrintMethod("batch query", batched, rayCount, single.bestMs);
+
+	//Both must find the same closest actor for every ray
+	PxU32 mismatches = 0;
+	for(PxU32 i=0; i<rayCount; i++)
+		mismatches += sceneHits[i] != gRayService.results.actor[i];
+	printf("\nmismatched closest hits: %u\n", mismatches);
+
+	if(frames)
+		mismatches += RunRaycastCache(*scene, rays, cacheRays, frames, moving);
+
+	RayServiceRelease();
+	scene->release();
+	gPhysicsSDK->release();
+	ReleaseCpuDispatcher();			//Worker threads outlive the scene
+	gFoundation->release();
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,351 @@
+/*
+=====================================================================
+
+File Name	  :	bench_SpatialIndex.cpp
+
+Description	  : Throughput of the gameplay spatial database of 'GameplaySpatialIndex.h'.
+				Random boxes of three categories are scattered through a cube and bulk
+				inserted. A set of queries then runs on the freshly rebuilt tree: closest,
+				any and all raycasts, closest box sweeps, and box and sphere overlaps.
+				Some entries then move every frame, a few are removed and inserted again,
+				and the index takes its per frame rebuild steps. After the frames the same
+				queries run again on the updated tree.
+
+				Insert, update and rebuild times and queries per second are printed.
+				The first '--check' queries of each kind are compared with a brute force
+				test of every entry.
+				No PhysX scene or GL context is needed.
+
+				Command line options:
+				  --entries N    Boxes in the index (default 100000)
+				  --moving N     Entries moved per frame (default 10000)
+				  --churn N      Entries removed and inserted again per frame (default 1000)
+				  --frames N     Frames of updates (default 120)
+				  --steps N      Rebuild steps per frame, 0 never rebuilds (default 1)
+				  --rate N       Rebuild steps per full tree rebuild (default 100)
+				  --rays N       Raycasts per kind (default 20000)
+				  --sweeps N     Box sweeps (default 5000)
+				  --overlaps N   Overlaps per kind (default 20000)
+				  --check N      Queries per kind checked by brute force (default 200)
+
+=====================================================================
+*/
+
+#define _DEBUG 1
+
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <PxPhysicsAPI.h>			//Single header file to include all features of PhysX API
+#include "CommandLine.h"			//GetIntArgument()
+#include "QueryScenes.h"			//QueryRandom, QuerySceneExtent()
+#include "GameplaySpatialIndex.h"	//GameplayInsert(), GameplayRaycast()
+
+
+
+using namespace std;
+using namespace physx;
+
+
+static PxDefaultErrorCallback	gDefaultErrorCallback;		//Instance of default implementation of the error callback
+static PxDefaultAllocator		gDefaultAllocatorCallback;	//Instance of default implementation of the allocator interface required by the SDK
+
+PxFoundation*	gFoundation	= NULL;
+PxPhysics*		gPhysicsSDK	= NULL;
+
+const PxU32		gCategories		= 3;		//Pickups, spawn points, audio emitters
+const PxReal	gQueryLength	= 20.0f;
+
+
+//Queries drawn up front so both passes run the same ones
+struct GameplayQuerySet
+{
+	vector<PxVec3>		rayOrigins;
+	vector<PxVec3>		rayDirections;
+	vector<PxU32>		rayCategories;
+	vector<PxBounds3>	sweepBoxes;
+	vector<PxVec3>		sweepDirections;
+	vector<PxBounds3>	overlapBoxes;
+	vector<PxVec3>		sphereCenters;
+	vector<PxReal>		sphereRadii;
+};
+
+
+PxBounds3 RandomEntryBounds(QueryRandom& random, PxReal extent)
+{
+	PxVec3 center = random.inCube(extent);		//Separate statements fix the order of the draws
+	PxReal x = 0.2f + 1.3f*random.unit(), y = 0.2f + 1.3f*random.unit(), z = 0.2f + 1.3f*random.unit();
+	return PxBounds3::centerExtents(center, PxVec3(x, y, z));
+}
+
+
+void GenerateQueries(QueryRandom& random, PxReal extent, PxU32 rays, PxU32 sweeps, PxU32 overlaps, GameplayQuerySet& q)
+{
+	for(PxU32 i=0; i<rays; i++)
+	{
+		q.rayOrigins.push_back(random.inCube(extent));
+		q.rayDirections.push_back(random.direction());
+		q.rayCategories.push_back(i % 4 == 0 ? GAMEPLAY_ALL_CATEGORIES : 1u << (random.next() % gCategories));
+	}
+	for(PxU32 i=0; i<sweeps; i++)
+	{
+		PxVec3 center = random.inCube(extent);
+		q.sweepBoxes.push_back(PxBounds3::centerExtents(center, PxVec3(0.5f)));
+		q.sweepDirections.push_back(random.direction());
+	}
+	for(PxU32 i=0; i<overlaps; i++)
+	{
+		PxVec3 center = random.inCube(extent);
+		PxReal size = 1.0f + 3.0f*random.unit();
+		q.overlapBoxes.push_back(PxBounds3::centerExtents(center, PxVec3(size)));
+		q.sphereCenters.push_back(random.inCube(extent));
+		q.sphereRadii.push_back(1.0f + 3.0f*random.unit());
+	}
+}
+
+
+//Closest hit distance and number of hits of one ray by testing every entry; PX_MAX_F32 for misses
+PxReal BruteForceRay(const PxVec3& origin, const PxVec3& unitDir, const PxVec3& inflate, PxU32 categories, PxU32& hitCount)
+{
+	PxReal closest = PX_MAX_F32;
+	hitCount = 0;
+	const deque<GameplayItem>& items = gGameplayIndex.items;
+	for(size_t i=0; i<items.size(); i++)
+	{
+		PxReal distance;
+		if(items[i].id == PX_SPATIAL_INDEX_INVALID_ITEM_ID || !(items[i].categories & categories))
+			continue;
+		PxBounds3 bounds(items[i].bounds.minimum - inflate, items[i].bounds.maximum + inflate);
+		if(GameplayRayBoxDistance(origin, unitDir, bounds, gQueryLength, distance))
+		{
+			closest = PxMin(closest, distance);
+			hitCount++;
+		}
+	}
+	return closest;
+}
+
+
+PxU32 BruteForceOverlap(const PxBounds3& box, bool sphere, const PxVec3& center, PxReal radius)
+{
+	PxU32 count = 0;
+	const deque<GameplayItem>& items = gGameplayIndex.items;
+	for(size_t i=0; i<items.size(); i++)
+	{
+		if(items[i].id == PX_SPATIAL_INDEX_INVALID_ITEM_ID)
+			continue;
+		if(sphere)
+			count += GameplayPointBoxDistanceSquared(center, items[i].bounds) <= radius*radius;
+		else
+			count += items[i].bounds.intersects(box);
+	}
+	return count;
+}
+
+
+bool SameDistance(PxReal a, PxReal b)
+{
+	return PxAbs(a - b) <= 1e-4f*(1.0f + a);
+}
+
+
+void PrintQueryRow(const char* name, PxU32 count, double ms, PxU64 hits, PxU32 mismatches)
+{
+	printf("%-18s %10u %10.3f %12.2f %10.2f %12u\n", name, count, ms, count/(ms*1000.0), count ? double(hits)/count : 0.0, mismatches);
+}
+
+
+//Runs every query kind once and prints its throughput; returns the mismatches with brute force
+PxU32 RunQueries(const char* title, const GameplayQuerySet& q, PxU32 check)
+{
+	vector<GameplayHit> hits;
+	vector<GameplayHandle> handles;
+	PxU32 total = 0;
+	const GameplayHitMode modes[] = { eGAMEPLAY_CLOSEST, eGAMEPLAY_ANY, eGAMEPLAY_ALL };
+	const char* modeNames[] = { "raycast closest", "raycast any", "raycast all" };
+
+	printf("\n%s\n", title);
+	printf("%-18s %10s %10s %12s %10s %12s\n", "query", "count", "ms", "Mqueries/s", "hits/query", "mismatches");
+
+	for(PxU32 m=0; m<3; m++)
+	{
+		PxU32 count = PxU32(q.rayOrigins.size());
+		PxU64 hitTotal = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for(PxU32 i=0; i<count; i++)
+		{
+			GameplayRaycast(q.rayOrigins[i], q.rayDirections[i], gQueryLength, modes[m], hits, q.rayCategories[i]);
+			hitTotal += hits.size();
+		}
+		double ms = QueryElapsedMs(start);
+
+		PxU32 mismatches = 0;
+		for(PxU32 i=0; i<PxMin(check, count); i++)
+		{
+			PxU32 expectedHits;
+			PxReal expected = BruteForceRay(q.rayOrigins[i], q.rayDirections[i], PxVec3(0.0f), q.rayCategories[i], expectedHits);
+			GameplayRaycast(q.rayOrigins[i], q.rayDirections[i], gQueryLength, modes[m], hits, q.rayCategories[i]);
+			if(modes[m] == eGAMEPLAY_CLOSEST)
+				mismatches += hits.empty() ? expected < PX_MAX_F32 : !SameDistance(expected, hits[0].distance);
+			else if(modes[m] == eGAMEPLAY_ANY)
+				mismatches += hits.empty() != (expected == PX_MAX_F32);
+			else
+				mismatches += hits.size() != expectedHits;
+		}
+		PrintQueryRow(modeNames[m], count, ms, hitTotal, mismatches);
+		total += mismatches;
+	}
+
+	{
+		PxU32 count = PxU32(q.sweepBoxes.size());
+		PxU64 hitTotal = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for(PxU32 i=0; i<count; i++)
+		{
+			GameplaySweep(q.sweepBoxes[i], q.sweepDirections[i], gQueryLength, eGAMEPLAY_CLOSEST, hits);
+			hitTotal += hits.size();
+		}
+		double ms = QueryElapsedMs(start);
+
+		PxU32 mismatches = 0;
+		for(PxU32 i=0; i<PxMin(check, count); i++)
+		{
+			PxU32 expectedHits;
+			PxReal expected = BruteForceRay(q.sweepBoxes[i].getCenter(), q.sweepDirections[i], q.sweepBoxes[i].getExtents(),
+				GAMEPLAY_ALL_CATEGORIES, expectedHits);
+			GameplaySweep(q.sweepBoxes[i], q.sweepDirections[i], gQueryLength, eGAMEPLAY_CLOSEST, hits);
+			mismatches += hits.empty() ? expected < PX_MAX_F32 : !SameDistance(expected, hits[0].distance);
+		}
+		PrintQueryRow("box sweep closest", count, ms, hitTotal, mismatches);
+		total += mismatches;
+	}
+
+	for(PxU32 sphere=0; sphere<2; sphere++)
+	{
+		PxU32 count = PxU32(q.overlapBoxes.size());
+		PxU64 hitTotal = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for(PxU32 i=0; i<count; i++)
+			hitTotal += sphere ? GameplayOverlapSphere(q.sphereCenters[i], q.sphereRadii[i], handles) : GameplayOverlap(q.overlapBoxes[i], handles);
+		double ms = QueryElapsedMs(start);
+
+		PxU32 mismatches = 0;
+		for(PxU32 i=0; i<PxMin(check, count); i++)
+		{
+			PxU32 found = sphere ? GameplayOverlapSphere(q.sphereCenters[i], q.sphereRadii[i], handles) : GameplayOverlap(q.overlapBoxes[i], handles);
+			mismatches += found != BruteForceOverlap(q.overlapBoxes[i], sphere != 0, q.sphereCenters[i], q.sphereRadii[i]);
+		}
+		PrintQueryRow(sphere ? "sphere overlap" : "box overlap", count, ms, hitTotal, mismatches);
+		total += mismatches;
+	}
+	return total;
+}
+
+
+int main(int argc, char** argv)
+{
+	PxU32 entries  = PxU32(PxMax(1, GetIntArgument(argc, argv, "--entries", 100000)));
+	PxU32 moving   = PxU32(PxMax(0, GetIntArgument(argc, argv, "--moving", 10000)));
+	PxU32 churn	   = PxU32(PxMax(0, GetIntArgument(argc, argv, "--churn", 1000)));
+	PxU32 frames   = PxU32(PxMax(0, GetIntArgument(argc, argv, "--frames", 120)));
+	PxU32 steps	   = PxU32(PxMax(0, GetIntArgument(argc, argv, "--steps", 1)));
+	PxU32 rate	   = PxU32(PxMax(4, GetIntArgument(argc, argv, "--rate", int(GAMEPLAY_DEFAULT_REBUILD_RATE))));
+	PxU32 rays	   = PxU32(PxMax(0, GetIntArgument(argc, argv, "--rays", 20000)));
+	PxU32 sweeps   = PxU32(PxMax(0, GetIntArgument(argc, argv, "--sweeps", 5000)));
+	PxU32 overlaps = PxU32(PxMax(0, GetIntArgument(argc, argv, "--overlaps", 20000)));
+	PxU32 check	   = PxU32(PxMax(0, GetIntArgument(argc, argv, "--check", 200)));
+	moving = PxMin(moving, entries);
+	churn  = PxMin(churn, entries);
+	PxReal extent = QuerySceneExtent(entries, 1.0f);	//One entry per 8 cubic units
+
+	gFoundation = PxCreateFoundation(PX_FOUNDATION_VERSION, gDefaultAllocatorCallback, gDefaultErrorCallback);
+	gPhysicsSDK = PxCreatePhysics(PX_PHYSICS_VERSION, *gFoundation, PxTolerancesScale());
+	if(gPhysicsSDK == NULL)
+	{
+		cerr<<"Error creating PhysX3 device, Exiting..."<<endl;
+		exit(1);
+	}
+
+	QueryRandom random(1);
+	vector<PxBounds3> bounds(entries);
+	vector<PxU32> categories(entries);
+	vector<GameplayHandle> handles(entries);
+	for(PxU32 i=0; i<entries; i++)
+	{
+		bounds[i]	  = RandomEntryBounds(random, extent);
+		categories[i] = 1u << (i % gCategories);
+	}
+
+	GameplayQuerySet queries;
+	GenerateQueries(random, extent, rays, sweeps, overlaps, queries);
+
+	printf("entries: %u  extent: %.1f  moving: %u  churn: %u per frame  frames: %u  rebuild: %u steps/frame, rate %u\n",
+		entries, extent, moving, churn, frames, steps, rate);
+
+	GameplaySpatialIndexInit(rate, steps);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	GameplayInsert(&bounds[0], &categories[0], NULL, entries, &handles[0]);
+	double insertMs = QueryElapsedMs(start);
+	start = chrono::steady_clock::now();
+	GameplaySpatialIndexRebuildFull();
+	double rebuildMs = QueryElapsedMs(start);
+	printf("bulk insert: %.3f ms (%.2f Minserts/s)  full rebuild: %.3f ms\n", insertMs, entries/(insertMs*1000.0), rebuildMs);
+
+	PxU32 mismatches = RunQueries("fresh tree:", queries, check);
+
+	//Moved entries drift a little each frame; churned entries reappear elsewhere under a reused handle
+	vector<GameplayHandle> moved(moving), churned(churn);
+	vector<PxBounds3> movedBounds(moving), churnedBounds(churn);
+	vector<PxU32> churnedCategories(churn);
+	double updateMs = 0.0, churnMs = 0.0, frameMs = 0.0;
+	for(PxU32 frame=0; frame<frames; frame++)
+	{
+		for(PxU32 i=0; i<moving; i++)
+		{
+			GameplayHandle handle = random.next() % entries;
+			PxVec3 offset = random.inCube(0.25f);
+			moved[i]	   = handle;
+			movedBounds[i] = PxBounds3(gGameplayIndex.items[handle].bounds.minimum + offset, gGameplayIndex.items[handle].bounds.maximum + offset);
+		}
+		for(PxU32 i=0; i<churn; i++)
+		{
+			churned[i]			 = random.next() % entries;
+			churnedBounds[i]	 = RandomEntryBounds(random, extent);
+			churnedCategories[i] = gGameplayIndex.items[churned[i]].categories;
+		}
+
+		start = chrono::steady_clock::now();
+		if(moving)		//--moving 0 leaves the vectors empty
+			GameplayUpdate(&moved[0], &movedBounds[0], moving);
+		updateMs += QueryElapsedMs(start);
+
+		start = chrono::steady_clock::now();
+		if(churn)
+		{
+			GameplayRemove(&churned[0], churn);
+			GameplayInsert(&churnedBounds[0], &churnedCategories[0], NULL, PxU32(gGameplayIndex.freeHandles.size()), &churned[0]);
+		}
+		churnMs += QueryElapsedMs(start);
+
+		start = chrono::steady_clock::now();
+		GameplaySpatialIndexFrame();
+		frameMs += QueryElapsedMs(start);
+	}
+
+	if(frames)
+	{
+		printf("\n%u frames: update %.3f ms/frame (%.2f Mupdates/s)  churn %.3f ms/frame  rebuild steps + flush %.3f ms/frame\n",
+			frames, updateMs/frames, moving ? moving*frames/(updateMs*1000.0) : 0.0, churnMs/frames, frameMs/frames);
+		mismatches += RunQueries("after the updates:", queries, check);
+	}
+
+	printf("\n");
+	PrintGameplaySpatialIndexStats();
+	printf("mismatched results: %u\n", mismatches);
+
+	GameplaySpatialIndexRelease();
+	gPhysicsSDK->release();
+	gFoundation->release();
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+/*
+=====================================================================
+
+File Name	  :	bench_StressScaling.cpp
+
+Description	  : Step time versus body count for the stress scenes of 'StressScenes.h'.
+				For every size of the sweep a fresh scene is built, settled for a few
+				steps and stepped; the average step time, the time per body and a bar
+				plot on a log-log scale are printed, with the bodies still awake at the
+				end from the awake set of 'SimulationEvents.h'. '--csv' also writes the points for
+				an external plotting tool. No GL context is needed.
+
+				Command line options:
+				  --scene S      pyramids, spheres, chains, ragdolls, particles, cloth or all
+				                 (default pyramids)
+				  --sizes LIST   Comma separated body counts (default 1000,2000,5000,10000,
+				                 20000,50000,100000)
+				  --steps N      Measured steps per size (default 100)
+				  --csv FILE     Append "scene,requested,bodies,awake,ms_per_step" lines to FILE
+				  --workers N, --affinity, --priority P, --dispatcher D   As for the demos
+
+=====================================================================
+*/
+
+#define _DEBUG 1
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <chrono>
+#include <vector>
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "CpuDispatcher.h"		//CreateCpuDispatcher()
+#include "StressScenes.h"		//gStressScenes
+#include "SimulationEvents.h"	//AwakeSetTrack()
+
+
+
+using namespace std;
+using namespace physx;
+
+
+static PxDefaultErrorCallback	gDefaultErrorCallback;		//Instance of default implementation of the error callback
+static PxDefaultAllocator		gDefaultAllocatorCallback;	//Instance of default implementation of the allocator interface required by the SDK
+
+PxFoundation*	gFoundation	= NULL;
+PxPhysics*		gPhysicsSDK	= NULL;
+PxReal			gTimeStep	= 1.0f/60.0f;
+
+static SimulationEvents gSimulationEventCallback;	//onWake() and onSleep() keep the awake set
+
+const int		gWarmupSteps = 20;		//Let the bodies come into contact before measuring
+const int		gPlotWidth	 = 50;
+
+
+struct ScalingPoint
+{
+	PxU32	requested;
+	PxU32	bodies;
+	PxU32	awake;		//Tracked rigid bodies awake after the last step
+	double	msPerStep;
+};
+
+
+vector<PxU32> ParseSizes(const char* list)
+{
+	vector<PxU32> sizes;
+	while(list && *list)
+	{
+		char* end;
+		long size = strtol(list, &end, 10);
+		if(end == list)
+			break;
+		if(size > 0)
+			sizes.push_back(PxU32(size));
+		list = *end == ',' ? end + 1 : end;
+	}
+	return sizes;
+}
+
+
+//Returns average milliseconds per step
+double MeasureSteps(PxScene* scene, int steps)
+{
+	for(int i=0; i<gWarmupSteps; i++)
+	{
+		scene->simulate(gTimeStep);
+		scene->fetchResults(true);
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(int i=0; i<steps; i++)
+	{
+		scene->simulate(gTimeStep);
+		scene->fetchResults(true);
+	}
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / steps;
+}
+
+
+//Bars proportional to log(ms/step) between the fastest and slowest size, sizes on a log scale by construction
+void PrintPlot(const StressScene& stress, const vector<ScalingPoint>& points)
+{
+	double lo = 1e30, hi = 0.0;
+	for(size_t i=0; i<points.size(); i++)
+	{
+		lo = PxMin(lo, points[i].msPerStep);
+		hi = PxMax(hi, points[i].msPerStep);
+	}
+	if(points.empty() || hi <= 0.0)
+		return;
+
+	double logLo = log10(PxMax(lo, 1e-3)), logHi = log10(hi);
+	printf("\n%s: ms/step (log) vs %s\n", stress.name, stress.unit);
+	for(size_t i=0; i<points.size(); i++)
+	{
+		double t = logHi > logLo ? (log10(PxMax(points[i].msPerStep, 1e-3)) - logLo)/(logHi - logLo) : 1.0;
+		int width = 1 + int(t*(gPlotWidth - 1) + 0.5);
+		printf("%9u |%s %.3f\n", points[i].bodies, string(width, '#').c_str(), points[i].msPerStep);
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	ParseDispatcherOptions(argc, argv);	//--workers N, --affinity, --priority P, --dispatcher D
+	const char* sceneName = GetStringArgument(argc, argv, "--scene", "pyramids");
+	vector<PxU32> sizes	  = ParseSizes(GetStringArgument(argc, argv, "--sizes", "1000,2000,5000,10000,20000,50000,100000"));
+	int steps			  = PxMax(1, GetIntArgument(argc, argv, "--steps", 100));
+	const char* csvPath	  = GetStringArgument(argc, argv, "--csv", NULL);
+
+	vector<const StressScene*> scenes;
+	for(PxU32 i=0; i<gStressSceneCount; i++)
+		if(!strcmp(sceneName, "all") || !strcmp(sceneName, gStressScenes[i].name))
+			scenes.push_back(&gStressScenes[i]);
+	if(scenes.empty() || sizes.empty())
+	{
+		cerr<<"Expected --scene pyramids|spheres|chains|ragdolls|particles|cloth|all and --sizes N,N,..."<<endl;
+		return EXIT_FAILURE;
+	}
+
+	FILE* csv = csvPath ? fopen(csvPath, "a") : NULL;
+	if(csvPath && !csv)
+		cerr<<"Cannot open "<<csvPath<<endl;
+
+	gFoundation = PxCreateFoundation(PX_FOUNDATION_VERSION, gDefaultAllocatorCallback, gDefaultErrorCallback);
+	gPhysicsSDK = PxCreatePhysics(PX_PHYSICS_VERSION, *gFoundation, PxTolerancesScale());
+	if(gPhysicsSDK == NULL)
+	{
+		cerr<<"Error creating PhysX3 device, Exiting..."<<endl;
+		exit(1);
+	}
+
+	PxCpuDispatcher* dispatcher = CreateCpuDispatcher();
+	printf("workers: %u  steps per size: %d\n", gDispatcherOptions.workers, steps);
+
+	for(size_t s=0; s<scenes.size(); s++)
+	{
+		const StressScene& stress = *scenes[s];
+		vector<ScalingPoint> points;
+
+		printf("\n%-10s %10s %10s %10s %12s %12s\n", "scene", "requested", stress.unit, "awake", "ms/step", "us/body");
+		for(size_t i=0; i<sizes.size(); i++)
+		{
+			ScalingPoint point;
+			point.requested = sizes[i];
+
+			PxScene* scene	= CreateStressScene(*gPhysicsSDK, dispatcher, stress, sizes[i], point.bodies);
+			scene->setSimulationEventCallback(&gSimulationEventCallback);
+			AwakeSetTrack(*scene);
+			point.msPerStep = MeasureSteps(scene, steps);
+			point.awake		= gAwakeSet.awakeCount;
+			scene->release();
+
+			points.push_back(point);
+			printf("%-10s %10u %10u %10u %12.3f %12.3f\n", stress.name, point.requested, point.bodies, point.awake,
+				point.msPerStep, point.bodies ? 1000.0*point.msPerStep/point.bodies : 0.0);
+			if(csv)
+				fprintf(csv, "%s,%u,%u,%u,%.4f\n", stress.name, point.requested, point.bodies, point.awake, point.msPerStep);
+		}
+
+		PrintPlot(stress, points);
+	}
+
+	if(csv)
+		fclose(csv);
+
+	gPhysicsSDK->release();
+	ReleaseCpuDispatcher();			//Worker threads outlive the scenes
+	gFoundation->release();
+	return EXIT_SUCCESS;
+}
@@ -40,6 +40,8 @@ Reference Chapter	: Chapter-2: Basic Concepts
 
 #include <iostream> 
 #include <PxPhysicsAPI.h> //Single header file to include all features of PhysX API
+#include "CpuDispatcher.h" //Worker threads of the scene
+#include "ChapterScenes.h"  //Scenes of all chapters, without rendering 
 
 
 using namespace std;
@@ -65,8 +67,9 @@ void ShutdownPhysX();	//Shutdown PhysX SDK
 
 
 
-int main()
+int main(int argc, char** argv)
 {
+	ParseDispatcherOptions(argc, argv);	//--workers N, --affinity, --priority P
 	
 	InitPhysX();  //Initialize PhysX then create scene and actors
 	//ConnectPVD(); //Uncomment this function to visualize  the simulation in PVD
@@ -110,38 +113,11 @@ void InitPhysX()
 	}
 
 
-	//Creating scene
-	PxSceneDesc sceneDesc(gPhysicsSDK->getTolerancesScale());	//Descriptor class for scenes 
-
-	sceneDesc.gravity		= PxVec3(0.0f, -9.8f, 0.0f);		//Setting gravity
-	sceneDesc.cpuDispatcher = PxDefaultCpuDispatcherCreate(1);	//Creates default CPU dispatcher for the scene
-	sceneDesc.filterShader  = PxDefaultSimulationFilterShader;	//Creates default collision filter shader for the scene
-	
-	gScene = gPhysicsSDK->createScene(sceneDesc);				//Creates a scene 
-	
-	
-	//Creating PhysX material
-	PxMaterial* material = gPhysicsSDK->createMaterial(0.5,0.5,0.5); //Creating a PhysX material
-
-	
-	
-	//---------Creating actors-----------]
-	
-	//1-Creating static plane	 
-	PxTransform planePos =	PxTransform(PxVec3(0.0f),PxQuat(PxHalfPi, PxVec3(0.0f, 0.0f, 1.0f)));	//Position and orientation(transform) for plane actor  
-	PxRigidStatic* plane =  gPhysicsSDK->createRigidStatic(planePos);								//Creating rigid static actor	
-	plane->createShape(PxPlaneGeometry(), *material);												//Defining geometry for plane actor
-	gScene->addActor(*plane);																		//Adding plane actor to PhysX scene
-
-
-	//2-Creating dynamic cube																		 
-	PxTransform		boxPos(PxVec3(0.0f, 10.0f, 0.0f));												//Position and orientation(transform) for box actor 
-	PxBoxGeometry	boxGeometry(PxVec3(2,2,2));											//Defining geometry for box actor
-					gBox = PxCreateDynamic(*gPhysicsSDK, boxPos, boxGeometry, *material, 1.0f);		//Creating rigid static actor
-					gScene->addActor(*gBox);														//Adding box actor to PhysX scene
-
-
 
+	//Creating scene and actors, shared with 'physx_bench', see 'ChapterScenes.h'
+	ChapterActors actors;
+	gScene = CreateHelloPhysxScene(*gPhysicsSDK, CreateCpuDispatcher(), actors);	//CPU dispatcher with --workers threads
+	gBox = actors.box;
 }
 
 
@@ -155,6 +131,7 @@ void StepPhysX()					//Stepping PhysX
 void ShutdownPhysX()				//Shutdown PhysX
 {
 	gPhysicsSDK->release();			//Removes any actors,  particle systems, and constraint shaders from this scene
+	ReleaseCpuDispatcher();			//Worker threads outlive the scene
 	gFoundation->release();			//Destroys the instance of foundation SDK
 }
 
@@ -34,6 +34,14 @@ Reference Chapter	: Chapter-3: Rigid Body Dynamics
 #include <PxPhysicsAPI.h> //Single header file to include all features of PhysX API 
 #include <GL/freeglut.h>  //OpenGL window tool kit 
 #include "RenderBuffer.h" //Used for rendering PhysX objetcs 
+#include "ShapeRenderer.h"  //Used for rendering PhysX actors as shaded meshes 
+#include "RenderContext.h"  //Window or headless context creation 
+#include "CpuDispatcher.h"   //Worker threads of the scene 
+#include "ChapterScenes.h"  //Scenes of all chapters, without rendering 
+#include "SceneSnapshot.h"  //Simulation thread and render snapshots 
+#include "PhysXStepper.h"   //Blocking or pipelined stepping 
+#include "InputRecorder.h"  //--record and --replay of the steps 
+#include "SimulationEvents.h" //onWake() and onSleep() keep the awake set 
 
 
 
@@ -54,6 +62,8 @@ PxReal							gTimeStep = 1.0f/60.0f;		//Time-step value for PhysX simulation
 PxRigidDynamic*		gBox = NULL;				//Instance of box actor 
 PxRigidDynamic*		gConnectedBox = NULL;
 
+static SimulationEvents gSimulationEventCallback;	//Keeps the awake set of 'SimulationEvents.h'
+
 
 float gCamRoateX = 15; 
 float gCamRoateY = 0;
@@ -62,10 +72,13 @@ float gCamDistance	= -50;
 int gWindowWidth  = 800;
 int gWindowHeight = 600;
 
+bool gThreadedSimulation = false; //--threaded: simulate on a separate thread, see 'SceneSnapshot.h'
+
 //-----------PhysX function prototypes------------//
 void InitPhysX();		//Initialize the PhysX SDK and create actors. 
 void StepPhysX();		//Step PhysX simulation
 void ShutdownPhysX();	//Shutdown PhysX SDK
+void UpdateGameLogic(PxReal);	//Applies per-step forces and velocities
 
 
 
@@ -74,6 +87,7 @@ void OnRender();			//Display callback for the current glut window
 void OnIdle();				//Called whenever the application is idle
 void OnReshape(int, int);	//Called whenever the application window is resized
 void OnShutdown();			//Called on application exit
+void OnKeyboard(unsigned char,int,int);	//Called when any ascii key is pressed
 
 
 
@@ -82,18 +96,36 @@ int main(int argc, char** argv)
 {
 
 
-	glutInit(&argc, argv);							// Initialize GLUT
-	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);	//Enable double buffering
-	glutSetOption(GLUT_MULTISAMPLE, 16);
-	glutInitWindowSize(gWindowWidth, gWindowHeight);	//Set window's initial width & height
-	
-	glutCreateWindow("PhysX and openGL"); // Create a window with the given title
+	ParseRenderOptions(argc, argv);	//--headless, --frames N, --capture
+	ParseDispatcherOptions(argc, argv);	//--workers N, --affinity, --priority P
+	ParseInputRecordOptions(argc, argv);	//--record FILE, --replay FILE
+	gThreadedSimulation = HasArgument(argc, argv, "--threaded");
+	CreateRenderContext(&argc, argv, "PhysX and openGL", gWindowWidth, gWindowHeight); //GLUT window or offscreen context
 
 	InitPhysX();
+	ShapeRendererInit(*gScene);	//Collect the actors drawn as shaded meshes
+	SetDebugVisualization(*gScene, false);	//Press 'v' to show PhysX debug visualization
+	StepperInit(gScene, ParseSteppingMode(argc, argv), UpdateGameLogic);	//--pipelined overlaps simulate() with rendering
+
+	if(gThreadedSimulation)
+		StartSimulationThread(gScene, gTimeStep, UpdateGameLogic);
+	else
+		InputRecorderOpen("ch3");	//Step sizes and state hashes, see 'InputRecorder.h'
+
+	if(gRenderOptions.frames)
+	{
+		RunFrames(OnRender, OnReshape);	//Fixed number of offscreen frames, then exit
+		PrintStepperStats();				//Simulation time hidden behind rendering
+		if(gThreadedSimulation)
+			PrintSnapshotStats();		//Snapshot age and dropped steps
+		ShutdownPhysX();
+		return InputRecorderClose();	//Failure if a replay diverged
+	}
 
 	glutDisplayFunc(OnRender);	//Display callback for the current glut window
 	glutIdleFunc(OnIdle);		//Called whenever the application is idle
 	glutReshapeFunc(OnReshape); //Called whenever the app window is resized
+	glutKeyboardFunc(OnKeyboard);	//Called on ascii key event
 
 	//glutMouseFunc(Mouse);		//Called on mouse button event
 	//glutMotionFunc(Motion);	//Called on mouse motion event 
@@ -123,14 +155,16 @@ void InitPhysX()
 	}
 
 
-	//Creating scene
-	PxSceneDesc sceneDesc(gPhysicsSDK->getTolerancesScale());	//Descriptor class for scenes 
 
-	sceneDesc.gravity		= PxVec3(0.0f, -9.8f, 0.0f);		//Setting gravity
-	sceneDesc.cpuDispatcher = PxDefaultCpuDispatcherCreate(1);	//Creates default CPU dispatcher for the scene
-	sceneDesc.filterShader  = PxDefaultSimulationFilterShader;	//Creates default collision filter shader for the scene
-	
-	gScene = gPhysicsSDK->createScene(sceneDesc);				//Creates a scene 
+	//Creating scene and actors, shared with 'physx_bench', see 'ChapterScenes.h'
+	ChapterActors actors;
+	gScene = CreateRigidbodyScene(*gPhysicsSDK, CreateCpuDispatcher(), actors);	//CPU dispatcher with --workers threads
+	gBox = actors.box;
+	gConnectedBox = actors.connectedBox;
+
+	gScene->setSimulationEventCallback(&gSimulationEventCallback);	//onWake() and onSleep() keep the awake set
+	AwakeSetTrack(*gScene);		//Game logic and rendering skip sleeping bodies
+
 
 	//This will enable basic visualization of PhysX objects like- actors collision shapes and it's axis. 
 	//The function PxScene::getRenderBuffer() is used to render any active visualization for scene.
@@ -140,103 +174,76 @@ void InitPhysX()
 	
 	gScene->setVisualizationParameter(PxVisualizationParameter::eJOINT_LIMITS,		1.0f);
 	gScene->setVisualizationParameter(PxVisualizationParameter::eJOINT_LOCAL_FRAMES,1.0f);
-	
-
-	//Creating PhysX material (staticFriction, dynamicFriction, restitution)
-	PxMaterial* material = gPhysicsSDK->createMaterial(0.5f,0.5f,0.5f);
-
-	
-	
-	//---------Creating actors-----------]
-	
-	//1-Creating static plane	 
-	PxTransform planePos =	PxTransform(PxVec3(0.0f),PxQuat(PxHalfPi, PxVec3(0.0f, 0.0f, 1.0f)));	//Position and orientation(transform) for plane actor  
-	PxRigidStatic* plane =  gPhysicsSDK->createRigidStatic(planePos);								//Creating rigid static actor	
-	plane->createShape(PxPlaneGeometry(), *material);												//Defining geometry for plane actor
-	gScene->addActor(*plane);																		//Adding plane actor to PhysX scene
+}
 
 
-	
-	//2-Creating dynamic cube
-	//We will apply a force on this created actor in 'OnRender()' function
-	{
-		PxMaterial* mat = gPhysicsSDK->createMaterial(0.2f,0.2f,0.2f);
-		PxTransform		boxPos(PxVec3(0.0f, 10.0f, 30.0f));												
-		PxBoxGeometry	boxGeometry(PxVec3(1.5f,1.5f,1.5f));											
-						gBox = PxCreateDynamic(*gPhysicsSDK, boxPos, boxGeometry, *mat, 1.0f);		
-						gScene->addActor(*gBox);														
-	
-	}
-
-	//3-Creating dynamic cube 
-	//We will apply initial linear velocity on the actor that will push actor upward for a while
-	{																					 
-		PxTransform		boxPos(PxVec3(5.0f, 0.1f, 0.0f));											
-		PxBoxGeometry	boxGeometry(PxVec3(1.5f,1.5f,1.5f));										
-		PxRigidDynamic* box2 = PxCreateDynamic(*gPhysicsSDK, boxPos, boxGeometry, *material, 1.0f);		
-						
-						box2->setMass(1);							//Setting mass of the actor
-						box2->setLinearVelocity(PxVec3(0,25,0));	//Setting initial linear velocity on the actor (This will push actor upward for a while)
-						gScene->addActor(*box2);
-	}
+void StepPhysX()					//Stepping PhysX
+{ 
+	StepperFinish();			//The state hash needs the previous step's results
 
-	//4-Creating a box actor attached with a static actor that is free to rotate around y axis.
-	//The box actor will keep rotating around y axis because we are applying angular velocity on it in 'OnRender()' function 
+	InputFrame input = { gTimeStep, gTimeStep, PxVec3(0.0f), 0 };
+	if(!InputRecorderFrame(*gScene, input))
 	{
-		PxVec3 pos = PxVec3(10,15,25); 
-		PxVec3 offset = PxVec3(0,1.5,0);
-
-		PxRigidActor* staticActor = PxCreateStatic(*gPhysicsSDK, PxTransform(pos), PxSphereGeometry(0.5f), *material);
-		 gConnectedBox = PxCreateDynamic(*gPhysicsSDK, PxTransform(PxVec3(0),PxQuat(PxHalfPi,PxVec3(0,0,1))), PxBoxGeometry(0.5,0.5,4), *material, 1.0f);
-	
-		PxD6Joint* d6Joint = PxD6JointCreate(*gPhysicsSDK, staticActor, PxTransform(-offset), gConnectedBox, PxTransform(offset));
-				   d6Joint->setConstraintFlag(PxConstraintFlag::eVISUALIZATION, true);
-				   d6Joint->setMotion(PxD6Axis::eSWING1, PxD6Motion::eFREE);
-
-		gScene->addActor(*staticActor);
-		gScene->addActor(*gConnectedBox);
-
+		ShutdownPhysX();			//End of the replay
+		exit(InputRecorderClose());
 	}
 
-}
-
-
-void StepPhysX()					//Stepping PhysX
-{ 
-	
-	gScene->simulate(gTimeStep);	//Advances the simulation by 'gTimeStep' time
-	gScene->fetchResults(true);		//Block until the simulation run is completed
+	StepperStep(input.stepSize);	//simulate() and fetchResults(), see 'PhysXStepper.h'
 } 
 
 
 void ShutdownPhysX()				//Shutdown PhysX
 {
+	StopSimulationThread();			//No-op unless started with --threaded
+	StepperFinish();				//The scene must not be simulating when released
 	gPhysicsSDK->release();			//Removes any actors,  particle systems, and constraint shaders from this scene
+	ReleaseCpuDispatcher();			//Worker threads outlive the scene
 	gFoundation->release();			//Destroys the instance of foundation SDK
 }
 
 
 
 
-void OnRender() 
+void UpdateGameLogic(PxReal dt)
 {
-	//Update PhysX	
-	if(gScene) 
-		StepPhysX(); 
+	//Sleeping bodies are left alone; both calls would wake them
+	if(IsAwake(gConnectedBox))
+		gConnectedBox->setAngularVelocity(PxVec3(0,1,0)); //Applying angular velocity to the actor
+	if(IsAwake(gBox))
+		gBox->addForce(PxVec3(0,0,-180));				  //Applying force to the actor		
+}
+
 
-	glClear(GL_COLOR_BUFFER_BIT);
+void OnRender() 
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glLoadIdentity();
 	
 	glTranslatef(0,0,gCamDistance);
 	glRotatef(gCamRoateX,1,0,0);
 	glRotatef(gCamRoateY,0,1,0);
 
-	RenderData(gScene->getRenderBuffer());
+	if(gThreadedSimulation)
+	{
+		//Only the latest published snapshot is read, the scene is never touched here
+		const SceneSnapshot& snapshot = AcquireLatestSnapshot();
+		ShapeRendererDraw(snapshot.shapePoses.empty() ? NULL : &snapshot.shapePoses[0]);
+		if(gDebugVisualization)
+			RenderData(snapshot.debug);
+
+		PresentFrame();
+		return;
+	}
 
-	gConnectedBox->setAngularVelocity(PxVec3(0,1,0)); //Applying angular velocity to the actor
-	gBox->addForce(PxVec3(0,0,-180));				  //Applying force to the actor		
+	//Update PhysX	
+	if(gScene) 
+		StepPhysX(); 
 
-	glutSwapBuffers();
+	ShapeRendererDraw();
+	if(gDebugVisualization)
+		RenderData(StepperRenderBuffer());
+
+	PresentFrame();
 	
 }
 
@@ -252,6 +259,7 @@ void OnReshape(int w, int h)
 
 void OnIdle() 
 {
+	StepperPoll();		//Collect a finished pipelined step early
 	glutPostRedisplay();
 }
 
@@ -260,5 +268,16 @@ void OnShutdown()
 	ShutdownPhysX();
 }
 
+void OnKeyboard(unsigned char key, int x, int y)
+{
+	if(key == 'v' && gThreadedSimulation)
+		RequestDebugVisualization(!gDebugVisualization); //The scene belongs to the simulation thread
+	else if(key == 'v')
+	{
+		StepperFinish();	//Scene parameters cannot change during simulate()
+		SetDebugVisualization(*gScene, !gDebugVisualization); //Toggle PhysX debug visualization
+	}
+}
+
 
 
@@ -41,6 +41,12 @@ Reference Chapter	: Chapter-4: Collision Detection
 #include <GL/freeglut.h>  //OpenGL window tool kit 
 
 #include "RenderBuffer.h"	  //Used for rendering PhysX objetcs 
+#include "ShapeRenderer.h"  //Used for rendering PhysX actors as shaded meshes 
+#include "RenderContext.h"  //Window or headless context creation 
+#include "CpuDispatcher.h"   //Worker threads of the scene 
+#include "ChapterScenes.h"  //Scenes of all chapters, without rendering 
+#include "SceneSnapshot.h"  //Simulation thread and render snapshots 
+#include "PhysXStepper.h"   //Blocking or pipelined stepping 
 #include "SimulationEvents.h" //Used for receiving simulation events
 
 
@@ -53,6 +59,8 @@ using namespace physx;
 int gWindowWidth  = 800; //Screen width
 int gWindowHeight = 600; //Screen height
 
+bool gThreadedSimulation = false; //--threaded: simulate on a separate thread, see 'SceneSnapshot.h'
+
 
 //---Scene navigation----
 int gOldMouseX = 0;
@@ -92,43 +100,41 @@ void OnRender();					//Display callback for the current glut window
 void OnIdle();						//Called whenever the application is idle
 void OnReshape(int, int);			//Called whenever the application window is resized
 void OnShutdown();					//Called on application exit
+void OnKeyboard(unsigned char,int,int);	//Called when any ascii key is pressed
 void OnMouseMotion(int,int);		//Called when the mouse is moving
 void OnMousePress(int,int,int,int); //Called when any mouse button is pressed
 
 
-//Defining a custome filter shader 
-PxFilterFlags customFilterShader(PxFilterObjectAttributes attributes0, PxFilterData filterData0, 
-										PxFilterObjectAttributes attributes1, PxFilterData filterData1,
-										PxPairFlags& pairFlags, const void* constantBlock, PxU32 constantBlockSize)
-{
-	// all initial and persisting reports for everything, with per-point data
-	pairFlags = PxPairFlag::eCONTACT_DEFAULT
-			  |	PxPairFlag::eTRIGGER_DEFAULT 
-			  | PxPairFlag::eNOTIFY_CONTACT_POINTS
-//			  | PxPairFlag::eCCD_LINEAR; //Set flag to enable CCD (Continuous Collision Detection)
-			  | PxPairFlag::eDETECT_CCD_CONTACT; //Set flag to enable CCD (Continuous Collision Detection)
-
-
-	return PxFilterFlag::eDEFAULT;		
-}
-
-
-
 int main(int argc, char** argv)
 {
 
-	glutInit(&argc, argv);								//Initialize GLUT
-	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);		//Enable double buffering
-	glutSetOption(GLUT_MULTISAMPLE, 16);
-	glutInitWindowSize(gWindowWidth, gWindowHeight);	//Set window's initial width & height
-	
-	glutCreateWindow("PhysX and openGL"); // Create a window with the given title
+	ParseRenderOptions(argc, argv);	//--headless, --frames N, --capture
+	ParseDispatcherOptions(argc, argv);	//--workers N, --affinity, --priority P
+	gThreadedSimulation = HasArgument(argc, argv, "--threaded");
+	CreateRenderContext(&argc, argv, "PhysX and openGL", gWindowWidth, gWindowHeight); //GLUT window or offscreen context
 
 	InitPhysX();
+	ShapeRendererInit(*gScene);	//Collect the actors drawn as shaded meshes
+	SetDebugVisualization(*gScene, false);	//Press 'v' to show PhysX debug visualization
+	StepperInit(gScene, ParseSteppingMode(argc, argv));	//--pipelined overlaps simulate() with rendering
+
+	if(gThreadedSimulation)
+		StartSimulationThread(gScene, gTimeStep, NULL);
+
+	if(gRenderOptions.frames)
+	{
+		RunFrames(OnRender, OnReshape);	//Fixed number of offscreen frames, then exit
+		PrintStepperStats();				//Simulation time hidden behind rendering
+		if(gThreadedSimulation)
+			PrintSnapshotStats();		//Snapshot age and dropped steps
+		ShutdownPhysX();
+		return EXIT_SUCCESS;
+	}
 
 	glutDisplayFunc(OnRender);	//Display callback for the current glut window
 	glutIdleFunc(OnIdle);		//Called whenever the application is idle
 	glutReshapeFunc(OnReshape); //Called whenever the app window is resized
+	glutKeyboardFunc(OnKeyboard);	//Called on ascii key event
 
 	glutMouseFunc(OnMousePress);	//Called on mouse button event
 	glutMotionFunc(OnMouseMotion);	//Called on mouse motion event 
@@ -159,97 +165,33 @@ void InitPhysX()
 
 
 
-	//Creating scene
-	PxSceneDesc sceneDesc(gPhysicsSDK->getTolerancesScale());		//Descriptor class for scenes 
+	//Creating scene and actors, shared with 'physx_bench', see 'ChapterScenes.h'
+	ChapterActors actors;
+	gScene = CreateCollisionDetectionScene(*gPhysicsSDK, CreateCpuDispatcher(), actors);	//CPU dispatcher with --workers threads
+	gScene->setSimulationEventCallback(&gSimulationEventCallback);  //Resgistering for receiving simulation events
+	AwakeSetTrack(*gScene);		//onWake() and onSleep() keep the awake set, see 'SimulationEvents.h'
 
-	sceneDesc.gravity		= PxVec3(0.0f, -9.8f, 0.0f);			//Setting gravity
-	sceneDesc.cpuDispatcher = PxDefaultCpuDispatcherCreate(1);		//Creates default CPU dispatcher for the scene
-	
-	sceneDesc.filterShader  = customFilterShader;					//Creates custom user collision filter shader for the scene
-	sceneDesc.simulationEventCallback = &gSimulationEventCallback;  //Resgistering for receiving simulation events
-	
-	sceneDesc.flags |= PxSceneFlag::eENABLE_CCD;					//Set flag to enable CCD (Continuous Collision Detection) 
-	
-	gScene = gPhysicsSDK->createScene(sceneDesc);					//Creates a scene 
 
-	
-	
 	//This will enable basic visualization of PhysX objects like- actors collision shapes and their axes. 
 	//The function PxScene::getRenderBuffer() is used to render any active visualization for scene.
 	gScene->setVisualizationParameter(PxVisualizationParameter::eSCALE,				1.0);	//Global visualization scale which gets multiplied with the individual scales
 	gScene->setVisualizationParameter(PxVisualizationParameter::eCOLLISION_SHAPES,	1.0f);	//Enable visualization of actor's shape
 	gScene->setVisualizationParameter(PxVisualizationParameter::eACTOR_AXES,		1.0f);	//Enable visualization of actor's axis
-	
-	
-	//Creating PhysX material (staticFriction, dynamicFriction, restitution)
-	PxMaterial* material = gPhysicsSDK->createMaterial(0.5f,0.5f,0.5f);
-
-	
-	
-	//---------Creating actors-----------]
-	
-	//1-Creating static plane that will act as ground	 
-	PxTransform planePos =	PxTransform(PxVec3(0.0f),PxQuat(PxHalfPi, PxVec3(0.0f, 0.0f, 1.0f)));	//Position and orientation(transform) for plane actor  
-	PxRigidStatic* plane =  gPhysicsSDK->createRigidStatic(planePos);								//Creating rigid static actor	
-							plane->createShape(PxPlaneGeometry(), *material);						//Defining geometry for plane actor
-							gScene->addActor(*plane);												//Adding plane actor to PhysX scene
-
-
-		
-	{	
-		//Creating a dynamic sphere (It will fall on to trigger shape which will invoke 'onTrigger()' function)
-		PxTransform			spherePos(PxVec3(-10.0f, 10.0f, 0.0f));											
-		PxSphereGeometry	sphereGeometry(2);										
-		PxRigidDynamic*		sphere = PxCreateDynamic(*gPhysicsSDK, spherePos, sphereGeometry, *material, 1.0f);		
-							gScene->addActor(*sphere);
-	
-		//Creating a trigger shape(trigger shape can't collide against any abject, 
-		//thus it is made static otherwise it will fall under the effect of gravity) 
-		PxTransform		boxPos(PxVec3(-10.0f, 2.10f, 0.0f));												
-		PxShape*		boxShape =	gPhysicsSDK->createShape(PxBoxGeometry(PxVec3(3.0f,2.0f,3.0f)),*material);
-						
-						boxShape->setFlag(PxShapeFlag::eSIMULATION_SHAPE, false);	//flagged to disable shape collision
-						boxShape->setFlag(PxShapeFlag::eTRIGGER_SHAPE, true);		//flagged as trigger shape
-
-		PxRigidStatic*	gBox = PxCreateStatic(*gPhysicsSDK, boxPos, *boxShape);
-						gScene->addActor(*gBox);														
-	}
-
-
-		
-	{	
-		//Creating a rigid dynamic sphere (It will fall on to the other rigid dynamic body which will invoke 'onContact()' function)																			 
-		PxTransform			spherePos(PxVec3(10.0f, 10.0f, 0.0f));											
-		PxSphereGeometry	sphereGeometry(2);										
-		PxRigidDynamic*		sphere = PxCreateDynamic(*gPhysicsSDK, spherePos, sphereGeometry, *material, 1.0f);
-							
-							sphere->setRigidBodyFlag(PxRigidBodyFlag::eENABLE_CCD, true); //Set flag to enable CCD (Continuous Collision Detection) for the actor
-							
-							gScene->addActor(*sphere);
-	
-		//Creating a rigid dynamic box resting on static plane 																 
-		PxTransform		boxPos(PxVec3(10.0f, 2.0f, 0.0f));											
-		PxBoxGeometry	boxGeometry(PxVec3(3.0f,2.0f,3.0f));										
-		PxRigidDynamic* box2 = PxCreateDynamic(*gPhysicsSDK, boxPos, boxGeometry, *material, 1.0f);		
-						gScene->addActor(*box2);
-	}
-
-	
-
 }
 
 
 void StepPhysX()					//Stepping PhysX
 { 
-
-	gScene->simulate(gTimeStep);	//Advances the simulation by 'gTimeStep' time
-	gScene->fetchResults(true);		//Block until the simulation run is completed
+	StepperStep(gTimeStep);		//simulate() and fetchResults(), see 'PhysXStepper.h'
 } 
 
 
 void ShutdownPhysX()				//Shutdown PhysX
 {
+	StopSimulationThread();			//No-op unless started with --threaded
+	StepperFinish();				//The scene must not be simulating when released
 	gPhysicsSDK->release();			//Removes any actors,  particle systems, and constraint shaders from this scene
+	ReleaseCpuDispatcher();			//Worker threads outlive the scene
 	gFoundation->release();			//Destroys the instance of foundation SDK
 }
 
@@ -258,20 +200,34 @@ void ShutdownPhysX()				//Shutdown PhysX
 
 void OnRender() 
 {
-	//Update PhysX	
-	if(gScene) 
-		StepPhysX(); 
-
-	glClear(GL_COLOR_BUFFER_BIT);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glLoadIdentity();
 	
 	glTranslatef(0,0,gCamDistance);
 	glRotatef(gCamRoateX,1,0,0);
 	glRotatef(gCamRoateY,0,1,0);
 	
-	RenderData(gScene->getRenderBuffer());
+	if(gThreadedSimulation)
+	{
+		//Only the latest published snapshot is read, the scene is never touched here
+		const SceneSnapshot& snapshot = AcquireLatestSnapshot();
+		ShapeRendererDraw(snapshot.shapePoses.empty() ? NULL : &snapshot.shapePoses[0]);
+		if(gDebugVisualization)
+			RenderData(snapshot.debug);
+
+		PresentFrame();
+		return;
+	}
+
+	//Update PhysX	
+	if(gScene) 
+		StepPhysX(); 
 
-	glutSwapBuffers();
+	ShapeRendererDraw();
+	if(gDebugVisualization)
+		RenderData(StepperRenderBuffer());
+
+	PresentFrame();
 }
 
 
@@ -286,6 +242,7 @@ void OnReshape(int w, int h)
 
 void OnIdle() 
 {
+	StepperPoll();		//Collect a finished pipelined step early
 	glutPostRedisplay();
 }
 
@@ -294,6 +251,17 @@ void OnShutdown()
 	ShutdownPhysX();
 }
 
+void OnKeyboard(unsigned char key, int x, int y)
+{
+	if(key == 'v' && gThreadedSimulation)
+		RequestDebugVisualization(!gDebugVisualization); //The scene belongs to the simulation thread
+	else if(key == 'v')
+	{
+		StepperFinish();	//Scene parameters cannot change during simulate()
+		SetDebugVisualization(*gScene, !gDebugVisualization); //Toggle PhysX debug visualization
+	}
+}
+
 
 
 void OnMouseMotion(int curMouseX, int curMouseY) 
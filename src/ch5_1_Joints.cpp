@@ -39,6 +39,13 @@ Reference Chapter	: Chapter-5: Joints
 #include <GL/freeglut.h>  //OpenGL window tool kit 
 
 #include "RenderBuffer.h"	  //Used for rendering PhysX objetcs 
+#include "ShapeRenderer.h"  //Used for rendering PhysX actors as shaded meshes 
+#include "RenderContext.h"  //Window or headless context creation 
+#include "CpuDispatcher.h"   //Worker threads of the scene 
+#include "ChapterScenes.h"  //Scenes of all chapters, without rendering 
+#include "SceneSnapshot.h"  //Simulation thread and render snapshots 
+#include "PhysXStepper.h"   //Blocking or pipelined stepping 
+#include "FixedTimestep.h"  //Capped fixed steps with interpolation 
 
 
 
@@ -51,6 +58,8 @@ using namespace physx;
 int gWindowWidth  = 800; //Screen width
 int gWindowHeight = 600; //Screen height
 
+bool gThreadedSimulation = false; //--threaded: simulate on a separate thread, see 'SceneSnapshot.h'
+
 
 //---Scene navigation----
 int gOldMouseX = 0;
@@ -65,7 +74,6 @@ float gCamDistance	= -50;
 //------------------------
 
 int oldTimeSinceStart = 0;
-float mAccumulator = 0.0f;
 
 
 static PxPhysics*				gPhysicsSDK = NULL;			//Instance of PhysX SDK
@@ -76,6 +84,8 @@ PxScene*						gScene = NULL;				//Instance of PhysX Scene
 PxReal							gTimeStep = 1.0f/60.0f;		//Time-step value for PhysX simulation 
 
 PxRigidDynamic* gConnectedBox = NULL;
+vector<PxJoint*> gChainJoints;		//Spherical joints of the chain
+PxReal gMaxChainStretch = 0.0f;		//Largest anchor separation seen in the chain, the solver's joint error
 
 
 
@@ -83,8 +93,9 @@ PxRigidDynamic* gConnectedBox = NULL;
 //========== PhysX function prototypes ===========//
 
 void InitPhysX();		//Initialize the PhysX SDK and create actors. 
-void StepPhysX();		//Step PhysX simulation
 void ShutdownPhysX();	//Shutdown PhysX SDK
+void UpdateGameLogic(PxReal);	//Applies per-step forces and velocities
+PxReal ChainStretch();			//Largest anchor separation of the chain's joints
 
 
 
@@ -93,6 +104,7 @@ void OnRender();					//Display callback for the current glut window
 void OnIdle();						//Called whenever the application is idle
 void OnReshape(int, int);			//Called whenever the application window is resized
 void OnShutdown();					//Called on application exit
+void OnKeyboard(unsigned char,int,int);	//Called when any ascii key is pressed
 void OnMouseMotion(int,int);		//Called when the mouse is moving
 void OnMousePress(int,int,int,int); //Called when any mouse button is pressed
 
@@ -103,19 +115,37 @@ void OnMousePress(int,int,int,int); //Called when any mouse button is pressed
 int main(int argc, char** argv)
 {
 
-	glutInit(&argc, argv);								//Initialize GLUT
-	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);		//Enable double buffering
-	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);		//Enable double buffering
-	glutSetOption(GLUT_MULTISAMPLE, 16);
-	glutInitWindowSize(gWindowWidth, gWindowHeight);	//Set window's initial width & height
-	
-	glutCreateWindow("PhysX and openGL"); // Create a window with the given title
+	ParseRenderOptions(argc, argv);	//--headless, --frames N, --capture
+	ParseDispatcherOptions(argc, argv);	//--workers N, --affinity, --priority P
+	ParseFixedTimestepOptions(argc, argv);	//--max-steps N, --sim-budget MS, --no-interpolate
+	gThreadedSimulation = HasArgument(argc, argv, "--threaded");
+	CreateRenderContext(&argc, argv, "PhysX and openGL", gWindowWidth, gWindowHeight); //GLUT window or offscreen context
 
 	InitPhysX();
+	ShapeRendererInit(*gScene);	//Collect the actors drawn as shaded meshes
+	StepperInit(gScene, ParseSteppingMode(argc, argv), UpdateGameLogic);	//--pipelined overlaps simulate() with rendering
+	StepperSetSubstepping(argc, argv);	//--substeps N stiffens the chain, --split times the phases
+	FixedTimestepInit(gTimeStep);	//Steps of 'gTimeStep', at most --max-steps per frame
+
+	if(gThreadedSimulation)
+		StartSimulationThread(gScene, gTimeStep, UpdateGameLogic);
+
+	if(gRenderOptions.frames)
+	{
+		RunFrames(OnRender, OnReshape);	//Fixed number of offscreen frames, then exit
+		PrintStepperStats();				//Simulation time hidden behind rendering
+		PrintFixedTimestepStats();		//Steps taken and dropped
+		printf("chain stretch: %.4f max\n", gMaxChainStretch);	//Falls with more substeps
+		if(gThreadedSimulation)
+			PrintSnapshotStats();		//Snapshot age and dropped steps
+		ShutdownPhysX();
+		return EXIT_SUCCESS;
+	}
 
 	glutDisplayFunc(OnRender);	//Display callback for the current glut window
 	glutIdleFunc(OnIdle);		//Called whenever the application is idle
 	glutReshapeFunc(OnReshape); //Called whenever the app window is resized
+	glutKeyboardFunc(OnKeyboard);	//Called on ascii key event
 
 	glutMouseFunc(OnMousePress);	//Called on mouse button event
 	glutMotionFunc(OnMouseMotion);	//Called on mouse motion event 
@@ -146,17 +176,13 @@ void InitPhysX()
 
 
 
-	//Creating scene
-	PxSceneDesc sceneDesc(gPhysicsSDK->getTolerancesScale());		//Descriptor class for scenes 
+	//Creating scene and actors, shared with 'physx_bench', see 'ChapterScenes.h'
+	ChapterActors actors;
+	gScene = CreateJointsScene(*gPhysicsSDK, CreateCpuDispatcher(), actors);	//CPU dispatcher with --workers threads
+	gConnectedBox = actors.connectedBox;
+	gChainJoints  = actors.chainJoints;
 
-	sceneDesc.gravity		= PxVec3(0.0f, -9.8f, 0.0f);			//Setting gravity
-	sceneDesc.cpuDispatcher = PxDefaultCpuDispatcherCreate(1);		//Creating default CPU dispatcher for the scene
-	sceneDesc.filterShader  = PxDefaultSimulationFilterShader;		//Creating default collision filter shader for the scene
-	
-	gScene = gPhysicsSDK->createScene(sceneDesc);					//Creating a scene 
 
-	
-	
 	//This will enable basic visualization of PhysX objects like- actors collision shapes and their axes. 
 	//The function PxScene::getRenderBuffer() is used to render any active visualization for scene.
 	gScene->setVisualizationParameter(PxVisualizationParameter::eSCALE,				1.0);	//Global visualization scale which gets multiplied with the individual scales
@@ -165,136 +191,79 @@ void InitPhysX()
 
 	gScene->setVisualizationParameter(PxVisualizationParameter::eJOINT_LIMITS,		1.0f);
 	gScene->setVisualizationParameter(PxVisualizationParameter::eJOINT_LOCAL_FRAMES,1.0f);
-	
-	
-	//Creating PhysX material (staticFriction, dynamicFriction, restitution)
-	PxMaterial* material = gPhysicsSDK->createMaterial(0.5f,0.5f,0.5f);
-
-	
-	
-	//---------Creating actors-----------]
-	
-	//1-Creating static plane that will act as ground	 
-	PxTransform planePos =	PxTransform(PxVec3(0.0f),PxQuat(PxHalfPi, PxVec3(0.0f, 0.0f, 1.0f)));	//Position and orientation(transform) for plane actor  
-	PxRigidStatic* plane =  gPhysicsSDK->createRigidStatic(planePos);								//Creating rigid static actor	
-							plane->createShape(PxPlaneGeometry(), *material);						//Defining geometry for plane actor
-							gScene->addActor(*plane);												//Adding plane actor to PhysX scene
-
-
-	
-
-
-//--------Fixed Joint---------//
-//Creating fixed joint between two spheres							
-{
-	PxVec3 pos = PxVec3(5,50,10); 
-	PxVec3 offset = PxVec3(0,3,0);
-
-	PxRigidDynamic* actor = PxCreateDynamic(*gPhysicsSDK, PxTransform(pos), PxSphereGeometry(3.0f), *material, 1.0f);
-	PxRigidDynamic* otherActor = PxCreateDynamic(*gPhysicsSDK, PxTransform(pos+PxVec3(0,0,0)), PxSphereGeometry(3.0f), *material, 1.0f);
-		
-	PxFixedJoint* fixedJoint = PxFixedJointCreate(*gPhysicsSDK, actor, PxTransform(-offset), otherActor, PxTransform(offset));
-				  fixedJoint->setConstraintFlag(PxConstraintFlag::eVISUALIZATION, true); //setting joint debug-visualization true 
-				
-	gScene->addActor(*actor);
-	gScene->addActor(*otherActor);
-}
-
-
-//--------D6 Joint---------//
-//Creating D6 joint between two actors, connected actor(box) is made free to rotate around y axis.
-//We are also applying angular velocity on the connected body on each update of 'OnRender()' function.
-//This will make connected actor keep rotating around y axis.
-{
-	PxVec3 pos = PxVec3(10,10,3); 
-	PxVec3 offset = PxVec3(0,1.5,0);
-
-	PxRigidActor* staticActor = PxCreateStatic(*gPhysicsSDK, PxTransform(pos), PxSphereGeometry(0.5f), *material);
-	gConnectedBox = PxCreateDynamic(*gPhysicsSDK, PxTransform(PxVec3(0),PxQuat(PxHalfPi,PxVec3(0,0,1))), PxBoxGeometry(2,2,15), *material, 1.0f);
-		
-	
-	PxD6Joint* d6Joint = PxD6JointCreate(*gPhysicsSDK, staticActor, PxTransform(-offset), gConnectedBox, PxTransform(offset));
-				d6Joint->setConstraintFlag(PxConstraintFlag::eVISUALIZATION, true);
-				d6Joint->setMotion(PxD6Axis::eSWING1, PxD6Motion::eFREE); //free to rotate around y axis
-
-	gScene->addActor(*staticActor);
-	gScene->addActor(*gConnectedBox);
-}
-
-
-//--------Spherical Joint---------//
-//Creating a series of spheres, inter-connected using spherical joint. 
-{	
-	PxVec3 pos = PxVec3(0,25,0); 
-	PxReal radius =1;
-	PxVec3 offset(0,2,0);
-	
-	PxRigidActor* prevActor = PxCreateStatic(*gPhysicsSDK, PxTransform(pos), PxSphereGeometry(radius), *material);
-	gScene->addActor(*prevActor);
-	
-	for(PxU32 i=1; i<6;i++)
-	{
-		PxTransform transform = PxTransform(PxVec3(0, PxReal(i*radius*1.5), 0));	
-		PxRigidDynamic* dynamic = PxCreateDynamic(*gPhysicsSDK, transform, PxSphereGeometry(radius), *material, 1.0f);
-	
-		gScene->addActor(*dynamic);
-
-		PxSphericalJoint* joint = PxSphericalJointCreate(*gPhysicsSDK, prevActor, PxTransform(-offset), dynamic, PxTransform(offset));
-		joint->setConstraintFlag(PxConstraintFlag::eVISUALIZATION, true);
-		//joint->setLimitCone(PxJointLimitCone(PxPi/2, PxPi/6, 0.01f)); //Used for limiting the movement of spherical joint. 
-
-		prevActor = dynamic;
-	}
-}
-	
-
 }
 
 
-void StepPhysX()					//Stepping PhysX
-{ 
-	gScene->simulate(gTimeStep);	//Advances the simulation by 'gTimeStep' time
-	gScene->fetchResults(true);		//Block until the simulation run is completed
-} 
-
-
 void ShutdownPhysX()				//Shutdown PhysX
 {
+	StopSimulationThread();			//No-op unless started with --threaded
+	StepperFinish();				//The scene must not be simulating when released
 	gPhysicsSDK->release();			//Removes any actors,  particle systems, and constraint shaders from this scene
+	ReleaseCpuDispatcher();			//Worker threads outlive the scene
 	gFoundation->release();			//Destroys the instance of foundation SDK
 }
 
 
 
 
-void OnRender() 
+void UpdateGameLogic(PxReal dt)
 {
-	//Calculating 'deltaTime' for each frame
-	int timeSinceStart = glutGet(GLUT_ELAPSED_TIME); 
-    float deltaTime = (timeSinceStart - oldTimeSinceStart)/1000.0f;
-    oldTimeSinceStart = timeSinceStart;
-	
-	mAccumulator  += deltaTime;
+	gConnectedBox->setAngularVelocity(PxVec3(0,1,0)); //Applying angular velocity on the body
+}
 
 
-	while(mAccumulator > gTimeStep) //Simulate at not more than 'gTimeStep' time-interval 
+PxReal ChainStretch()
+{
+	PxReal stretch = 0.0f;
+	for(size_t i=0; i<gChainJoints.size(); i++)
 	{
-		mAccumulator -= gTimeStep;
-		StepPhysX(); 
+		PxRigidActor* actor0;
+		PxRigidActor* actor1;
+		gChainJoints[i]->getActors(actor0, actor1);
+
+		//Both anchors coincide in world space when the joint is satisfied
+		PxVec3 anchor0 = actor0->getGlobalPose().transform(gChainJoints[i]->getLocalPose(PxJointActorIndex::eACTOR0).p);
+		PxVec3 anchor1 = actor1->getGlobalPose().transform(gChainJoints[i]->getLocalPose(PxJointActorIndex::eACTOR1).p);
+		stretch = PxMax(stretch, (anchor1 - anchor0).magnitude());
 	}
+	return stretch;
+}
+
 
-	glClear(GL_COLOR_BUFFER_BIT);
+void OnRender() 
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glLoadIdentity();
 	
 	glTranslatef(0,0,gCamDistance);
 	glRotatef(gCamRoateX,1,0,0);
 	glRotatef(gCamRoateY,0,1,0);
 	
-	gConnectedBox->setAngularVelocity(PxVec3(0,1,0)); //Applying angular velocity on the body
+	if(gThreadedSimulation)
+	{
+		//Only the latest published snapshot is read, the scene is never touched here
+		const SceneSnapshot& snapshot = AcquireLatestSnapshot();
+		ShapeRendererDraw(snapshot.shapePoses.empty() ? NULL : &snapshot.shapePoses[0]);
+		if(gDebugVisualization)
+			RenderData(snapshot.debug);
+
+		PresentFrame();
+		return;
+	}
+
+	//Calculating 'deltaTime' for each frame
+	int timeSinceStart = GetElapsedTimeMs(); 
+    float deltaTime = (timeSinceStart - oldTimeSinceStart)/1000.0f;
+    oldTimeSinceStart = timeSinceStart;
 	
-	RenderData(gScene->getRenderBuffer()); 
+	AdvanceFixedTimestep(deltaTime);	//Whole steps of 'gTimeStep', see 'FixedTimestep.h'
+	gMaxChainStretch = PxMax(gMaxChainStretch, ChainStretch());
 
-	glutSwapBuffers();
+	ShapeRendererDraw(InterpolatedShapePoses());	//Blended between the last two steps
+	if(gDebugVisualization)
+		RenderData(StepperRenderBuffer());
+
+	PresentFrame();
 }
 
 
@@ -309,6 +278,7 @@ void OnReshape(int w, int h)
 
 void OnIdle() 
 {
+	StepperPoll();		//Collect a finished pipelined step early
 	glutPostRedisplay();
 }
 
@@ -317,6 +287,17 @@ void OnShutdown()
 	ShutdownPhysX();
 }
 
+void OnKeyboard(unsigned char key, int x, int y)
+{
+	if(key == 'v' && gThreadedSimulation)
+		RequestDebugVisualization(!gDebugVisualization); //The scene belongs to the simulation thread
+	else if(key == 'v')
+	{
+		StepperFinish();	//Scene parameters cannot change during simulate()
+		SetDebugVisualization(*gScene, !gDebugVisualization); //Toggle PhysX debug visualization
+	}
+}
+
 
 
 void OnMouseMotion(int curMouseX, int curMouseY) 
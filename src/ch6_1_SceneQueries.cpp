@@ -38,6 +38,14 @@ Reference Chapter	: Chapter-6: Scene Queries
 #include <GL/freeglut.h>  //OpenGL window tool kit 
 
 #include "RenderBuffer.h"	  //Used for rendering PhysX objetcs 
+#include "ShapeRenderer.h"  //Used for rendering PhysX actors as shaded meshes 
+#include "RenderContext.h"  //Window or headless context creation 
+#include "CpuDispatcher.h"   //Worker threads of the scene 
+#include "ChapterScenes.h"  //Scenes of all chapters, without rendering 
+#include "PhysXStepper.h"   //Blocking or pipelined stepping 
+#include "FixedTimestep.h"  //Capped fixed steps with interpolation 
+#include "RayService.h"     //Batched raycasts through PxBatchQuery 
+#include "RaycastCache.h"   //Raycast results reused while nothing near the ray moves 
 
 
 
@@ -64,7 +72,6 @@ float gCamDistance	= -50;
 //------------------------
 
 int oldTimeSinceStart = 0;
-float mAccumulator = 0.0f;
 
 static PxPhysics*				gPhysicsSDK = NULL;			//Instance of PhysX SDK
 static PxFoundation*			gFoundation = NULL;			//Instance of singleton foundation SDK class
@@ -78,11 +85,11 @@ PxRigidDynamic* gSphere = NULL;
 
 PxReal rotateFactor = 0;
 PxRaycastBuffer gRaycastBuffer; //Buffer to store raycast hit information
+PxU32 gSensorRays = 0;			//--sensor-rays N: extra rays fanned around the main one each frame
 
 //========== PhysX function prototypes ===========//
 
 void InitPhysX();		//Initialize the PhysX SDK and create actors. 
-void StepPhysX();		//Step PhysX simulation
 void ShutdownPhysX();	//Shutdown PhysX SDK
 
 
@@ -92,6 +99,7 @@ void OnRender();					//Display callback for the current glut window
 void OnIdle();						//Called whenever the application is idle
 void OnReshape(int, int);			//Called whenever the application window is resized
 void OnShutdown();					//Called on application exit
+void OnKeyboard(unsigned char,int,int);	//Called when any ascii key is pressed
 void OnMouseMotion(int,int);		//Called when the mouse is moving
 void OnMousePress(int,int,int,int); //Called when any mouse button is pressed
 
@@ -120,19 +128,37 @@ void OnMousePress(int,int,int,int); //Called when any mouse button is pressed
 int main(int argc, char** argv)
 {
 
-    glutInit(&argc, argv);								//Initialize GLUT
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);		//Enable double buffering
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);		//Enable double buffering
-    glutSetOption(GLUT_MULTISAMPLE, 16);
-    glutInitWindowSize(gWindowWidth, gWindowHeight);	//Set window's initial width & height
-
-    glutCreateWindow("PhysX and openGL"); // Create a window with the given title
+    ParseRenderOptions(argc, argv);	//--headless, --frames N, --capture
+    ParseDispatcherOptions(argc, argv);	//--workers N, --affinity, --priority P
+    ParseFixedTimestepOptions(argc, argv);	//--max-steps N, --sim-budget MS, --no-interpolate
+    gSensorRays = PxU32(PxMax(0, GetIntArgument(argc, argv, "--sensor-rays", 0)));
+    bool rayCache = HasArgument(argc, argv, "--ray-cache");	//Reuse the rays' hits across frames
+    CreateRenderContext(&argc, argv, "PhysX and openGL", gWindowWidth, gWindowHeight); //GLUT window or offscreen context
 
     InitPhysX();
+    ShapeRendererInit(*gScene);	//Collect the actors drawn as shaded meshes
+    SetDebugVisualization(*gScene, false);	//Press 'v' to show PhysX debug visualization
+    StepperInit(gScene, ParseSteppingMode(argc, argv));	//--pipelined overlaps simulate() with rendering
+    FixedTimestepInit(gTimeStep);	//Steps of 'gTimeStep', at most --max-steps per frame
+    RayServiceInit(*gScene, RAY_SERVICE_DEFAULT_BATCH, 1 + gSensorRays);	//Rays of a frame go through one PxBatchQuery
+    if(rayCache)
+        RaycastCacheInit();	//Consulted by 'RayServiceExecute()', updated after every step
+
+    if(gRenderOptions.frames)
+    {
+        RunFrames(OnRender, OnReshape);	//Fixed number of offscreen frames, then exit
+        PrintStepperStats();				//Simulation time hidden behind rendering
+        PrintFixedTimestepStats();		//Steps taken and dropped
+        PrintRayServiceStats();			//Rays per second of the batched queries
+        PrintRaycastCacheStats();		//Hit rate and saved query time
+        ShutdownPhysX();
+        return EXIT_SUCCESS;
+    }
 
     glutDisplayFunc(OnRender);	//Display callback for the current glut window
     glutIdleFunc(OnIdle);		//Called whenever the application is idle
     glutReshapeFunc(OnReshape); //Called whenever the app window is resized
+    glutKeyboardFunc(OnKeyboard);	//Called on ascii key event
 
     glutMouseFunc(OnMousePress);	//Called on mouse button event
     glutMotionFunc(OnMouseMotion);	//Called on mouse motion event
@@ -163,66 +189,27 @@ void InitPhysX()
 
 
 
-	//Creating scene
-	PxSceneDesc sceneDesc(gPhysicsSDK->getTolerancesScale());		//Descriptor class for scenes 
+	//Creating scene and actors, shared with 'physx_bench', see 'ChapterScenes.h'
+	ChapterActors actors;
+	gScene = CreateSceneQueriesScene(*gPhysicsSDK, CreateCpuDispatcher(), actors);	//CPU dispatcher with --workers threads
+	gBox	= actors.box;		//Box rotated around z axis
+	gSphere = actors.sphere;	//Marks the raycast hit position
 
-	sceneDesc.gravity		= PxVec3(0.0f, -9.8f, 0.0f);			//Setting gravity
-	sceneDesc.cpuDispatcher = PxDefaultCpuDispatcherCreate(1);		//Creating default CPU dispatcher for the scene
-	sceneDesc.filterShader  = PxDefaultSimulationFilterShader;		//Creating default collision filter shader for the scene
-	
-	gScene = gPhysicsSDK->createScene(sceneDesc);					//Creating a scene 
 
-	
-	
 	//This will enable basic visualization of PhysX objects like- actors collision shapes and their axes. 
 	//The function PxScene::getRenderBuffer() is used to render any active visualization for scene.
 	gScene->setVisualizationParameter(PxVisualizationParameter::eSCALE,				1.0);	//Global visualization scale which gets multiplied with the individual scales
 	gScene->setVisualizationParameter(PxVisualizationParameter::eCOLLISION_SHAPES,	1.0f);	//Enable visualization of actor's shape
 	gScene->setVisualizationParameter(PxVisualizationParameter::eACTOR_AXES,		1.0f);	//Enable visualization of actor's axis
-
-
-	//Creating PhysX material (staticFriction, dynamicFriction, restitution)
-	PxMaterial* material = gPhysicsSDK->createMaterial(0.1f,0.1f,0.1f);
-
-	
-	
-	//---------Creating actors-----------]
-	
-	//1-Creating static plane that will act as ground	 
-	PxTransform planePos =	PxTransform(PxVec3(0.0f),PxQuat(PxHalfPi, PxVec3(0.0f, 0.0f, 1.0f)));	//Position and orientation(transform) for plane actor  
-	PxRigidStatic* plane =  gPhysicsSDK->createRigidStatic(planePos);								//Creating rigid static actor	
-							plane->createShape(PxPlaneGeometry(), *material);						//Defining geometry for plane actor
-							gScene->addActor(*plane);												//Adding plane actor to PhysX scene
-
-	
-	//Creating a kinematic box actor that will keep rotating around z axis.
-	gBox = PxCreateDynamic(*gPhysicsSDK, PxTransform(PxVec3(0,8,0)), PxBoxGeometry(2,5,2), *material,1);
-//	gBox->setRigidDynamicFlag(PxRigidDynamicFlag::eKINEMATIC, true);
-	gScene->addActor(*gBox);
-
-	//Creating a kinematic sphere actor to represent raycast hit position.
-	PxShape* sphereShape = gPhysicsSDK->createShape(PxSphereGeometry(1), *material);
-	sphereShape->setFlag(PxShapeFlag::eSCENE_QUERY_SHAPE, false); //Don't consider this shape for hit queries
-
-	gSphere = PxCreateDynamic(*gPhysicsSDK, PxTransform(PxVec3(0)),*sphereShape,1);
-//	gSphere->setRigidDynamicFlag(PxRigidDynamicFlag::eKINEMATIC, true);
-	
-	gScene->addActor(*gSphere);
-
-
 }
 
 
-void StepPhysX()					//Stepping PhysX
-{ 
-	gScene->simulate(gTimeStep);	//Advances the simulation by 'gTimeStep' time
-	gScene->fetchResults(true);		//Block until the simulation run is completed
-} 
-
-
 void ShutdownPhysX()				//Shutdown PhysX
 {
+	StepperFinish();				//The scene must not be simulating when released
+	RayServiceRelease();
 	gPhysicsSDK->release();			//Removes any actors,  particle systems, and constraint shaders from this scene
+	ReleaseCpuDispatcher();			//Worker threads outlive the scene
 	gFoundation->release();			//Destroys the instance of foundation SDK
 }
 
@@ -232,30 +219,19 @@ void ShutdownPhysX()				//Shutdown PhysX
 void OnRender() 
 {
 	//Calculating 'deltaTime' for each frame
-	int timeSinceStart = glutGet(GLUT_ELAPSED_TIME); 
+	int timeSinceStart = GetElapsedTimeMs(); 
     float deltaTime = (timeSinceStart - oldTimeSinceStart)/1000.0f;
     oldTimeSinceStart = timeSinceStart;
 	
-	mAccumulator  += deltaTime;
-
 
-	while(mAccumulator > gTimeStep) //Simulate at not more than 'gTimeStep' time-interval 
-	{
-		mAccumulator -= gTimeStep;
-		StepPhysX();
-	}
 
-	glClear(GL_COLOR_BUFFER_BIT);
-	glLoadIdentity();
-	
-	glTranslatef(0,0,gCamDistance);
-	glRotatef(gCamRoateX,1,0,0);
-	glRotatef(gCamRoateY,0,1,0);
-	
-	RenderData(gScene->getRenderBuffer());
-	
+	StepperFinish();	//Collect the pipelined step before moving actors and casting rays
 
+	if(gRaycastCache.enabled)
+		RaycastCacheInvalidateActor(*gBox);	//Rays crossing the box where it was
 	gBox->setGlobalPose(PxTransform(0,5,0,PxQuat(rotateFactor,PxVec3(0,0,1)))); //Rotate box around z axis
+	if(gRaycastCache.enabled)
+		RaycastCacheInvalidateActor(*gBox);	//and where it is now
 	rotateFactor+= deltaTime*1.2f;
 	
 	
@@ -264,18 +240,40 @@ void OnRender()
 	PxVec3 origin = PxVec3(0,15,0);  //[in] Ray origin
 	PxVec3 unitDir = PxVec3(0,-1,0); //[in] Normalized ray direction
 	PxReal maxDistance = 1000.0f;    //[in] Raycast max distance
-	PxRaycastBuffer gRaycastBuffer;  //[out] Raycast results
 
-	bool status = gScene->raycast(origin, unitDir, maxDistance, gRaycastBuffer); //cast a ray
+	RayServiceClear();
+	PxU32 ray = RayServiceAdd(origin, unitDir, maxDistance);	//queue the ray
+
+	//Sensor rays in a cone around it, all cast with the same batch query
+	for(PxU32 i=0; i<gSensorRays; i++)
+	{
+		PxReal angle = 2.0f*PxPi*PxReal(i)/PxReal(gSensorRays);
+		RayServiceAdd(origin, PxVec3(0.5f*PxCos(angle), -1.0f, 0.5f*PxSin(angle)).getNormalized(), maxDistance);
+	}
+	RayServiceExecute();	//cast the rays
 
-	if(status)
+	const RayResults& results = gRayService.results;	//[out] Raycast results
+	if(results.hit[ray])
 	{	//On raycast hit, position the sphere actor at current hit position  
-		PxVec3 hitPos = gRaycastBuffer.getAnyHit(0).position;
-		gSphere->setGlobalPose(PxTransform(hitPos.x,hitPos.y,hitPos.z));
+		gSphere->setGlobalPose(PxTransform(results.px[ray],results.py[ray],results.pz[ray]));
 	}
 
-		
-	glutSwapBuffers();
+
+	AdvanceFixedTimestep(deltaTime);	//Whole steps of 'gTimeStep', see 'FixedTimestep.h'
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glLoadIdentity();
+	
+	glTranslatef(0,0,gCamDistance);
+	glRotatef(gCamRoateX,1,0,0);
+	glRotatef(gCamRoateY,0,1,0);
+	
+	ShapeRendererDraw(InterpolatedShapePoses());	//Blended between the last two steps
+	if(gDebugVisualization)
+		RenderData(StepperRenderBuffer());
+	
+
+	PresentFrame();
 }
 
 
@@ -290,6 +288,7 @@ void OnReshape(int w, int h)
 
 void OnIdle() 
 {
+	StepperPoll();		//Collect a finished pipelined step early
 	glutPostRedisplay();
 }
 
@@ -298,6 +297,15 @@ void OnShutdown()
 	ShutdownPhysX();
 }
 
+void OnKeyboard(unsigned char key, int x, int y)
+{
+	if(key == 'v')
+	{
+		StepperFinish();	//Scene parameters cannot change during simulate()
+		SetDebugVisualization(*gScene, !gDebugVisualization); //Toggle PhysX debug visualization
+	}
+}
+
 
 
 void OnMouseMotion(int curMouseX, int curMouseY) 
@@ -43,6 +43,14 @@ Reference Chapter	: Chapter-7: Character Controller
 #include <GL/freeglut.h>  //OpenGL window tool kit 
 
 #include "RenderBuffer.h"	  //Used for rendering PhysX objetcs 
+#include "ShapeRenderer.h"  //Used for rendering PhysX actors as shaded meshes 
+#include "RenderContext.h"  //Window or headless context creation 
+#include "CpuDispatcher.h"   //Worker threads of the scene 
+#include "ChapterScenes.h"  //Scenes of all chapters, without rendering 
+#include "PhysXStepper.h"   //Blocking or pipelined stepping 
+#include "FixedTimestep.h"  //Capped fixed steps with interpolation 
+#include "InputRecorder.h"  //--record and --replay of the inputs 
+#include "AgentQuery.h"     //Queries around the character through a volume cache 
 
 
 
@@ -78,7 +86,6 @@ PxReal							gTimeStep = 1.0f/60.0f;		//Time-step value for PhysX simulation
 
 //---for calculating elasped frame time--
 int oldTimeSinceStart = 0;
-float mAccumulator = 0.0f;
 
 //---Character controller related----
 PxControllerManager* gControllerMgr = NULL;			
@@ -91,12 +98,13 @@ float gSpeed 			= 0.5f;			 //Move speed of character controller
 float gJumpSpeed 		= 8.0;			 //Jump value of character controller	
 float gGravity  		= 10.0;			 //Gravity value of character controller 
 PxVec3 gMoveDirection 	= PxVec3(0,0,0); //Move direction of character controller
+PxU32 gAgentProbes		= 0;			 //--agent-probes N: obstacle probe rays around the character each frame
+PxReal gProbeReach		= 3.0f;			 //Length of the probe rays
 
 
 //========== PhysX function prototypes ===========//
 
 void InitPhysX();		//Initialize the PhysX SDK and create actors. 
-void StepPhysX();		//Step PhysX simulation
 void ShutdownPhysX();	//Shutdown PhysX SDK
 
 
@@ -106,6 +114,7 @@ void OnRender();					//Display callback for the current glut window
 void OnIdle();						//Called whenever the application is idle
 void OnReshape(int, int);			//Called whenever the application window is resized
 void OnShutdown();					//Called on application exit
+void OnKeyboard(unsigned char,int,int);	//Called when any ascii key is pressed
 void OnMouseMotion(int,int);		//Called when the mouse is moving
 void OnMousePress(int,int,int,int); //Called when any mouse button is pressed
 void OnKeyPressed(int,int,int);		//Called when any keyboard button is pressed
@@ -118,19 +127,36 @@ void OnKeyReleased(int,int,int);	//Called when any keyboard button is released
 int main(int argc, char** argv)
 {
 
-	glutInit(&argc, argv);								//Initialize GLUT
-	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);		//Enable double buffering
-	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);		//Enable double buffering
-	glutSetOption(GLUT_MULTISAMPLE, 16);
-	glutInitWindowSize(gWindowWidth, gWindowHeight);	//Set window's initial width & height
-
-	glutCreateWindow("PhysX and openGL"); // Create a window with the given title
+	ParseRenderOptions(argc, argv);	//--headless, --frames N, --capture
+	ParseDispatcherOptions(argc, argv);	//--workers N, --affinity, --priority P
+	ParseFixedTimestepOptions(argc, argv);	//--max-steps N, --sim-budget MS, --no-interpolate
+	ParseInputRecordOptions(argc, argv);	//--record FILE, --replay FILE
+	gAgentProbes = PxU32(PxMax(0, GetIntArgument(argc, argv, "--agent-probes", 0)));
+	CreateRenderContext(&argc, argv, "PhysX and openGL", gWindowWidth, gWindowHeight); //GLUT window or offscreen context
 
 	InitPhysX();
+	ShapeRendererInit(*gScene);	//Collect the actors drawn as shaded meshes
+	SetDebugVisualization(*gScene, false);	//Press 'v' to show PhysX debug visualization
+	StepperInit(gScene, ParseSteppingMode(argc, argv));	//--pipelined overlaps simulate() with rendering
+	FixedTimestepInit(gTimeStep);	//Steps of 'gTimeStep', at most --max-steps per frame
+	InputRecorderOpen("ch7");		//Frame inputs and state hashes, see 'InputRecorder.h'
+	if(gAgentProbes)
+		AgentQueryInit(*gScene, 1, gProbeReach, 1.0f);	//One agent, the character
+
+	if(gRenderOptions.frames)
+	{
+		RunFrames(OnRender, OnReshape);	//Fixed number of offscreen frames, then exit
+		PrintStepperStats();				//Simulation time hidden behind rendering
+		PrintFixedTimestepStats();		//Steps taken and dropped
+		PrintAgentQueryStats();			//Volume cache refills of the probes
+		ShutdownPhysX();
+		return InputRecorderClose();	//Failure if a replay diverged
+	}
 
 	glutDisplayFunc(OnRender);	//Display callback for the current glut window
 	glutIdleFunc(OnIdle);		//Called whenever the application is idle
 	glutReshapeFunc(OnReshape); //Called whenever the app window is resized
+	glutKeyboardFunc(OnKeyboard);	//Called on ascii key event
 
 	glutMouseFunc(OnMousePress);	//Called on mouse button event
 	glutMotionFunc(OnMouseMotion);	//Called on mouse motion event
@@ -164,97 +190,27 @@ void InitPhysX()
 
 
 
-	//Creating scene
-	PxSceneDesc sceneDesc(gPhysicsSDK->getTolerancesScale());		//Descriptor class for scenes 
+	//Creating scene and actors, shared with 'physx_bench', see 'ChapterScenes.h'
+	ChapterActors actors;
+	gScene = CreateCharControllerScene(*gPhysicsSDK, CreateCpuDispatcher(), actors);	//CPU dispatcher with --workers threads
+	gControllerMgr		= actors.controllerManager;
+	gCapsuleController	= actors.capsuleController;
 
-	sceneDesc.gravity		= PxVec3(0.0f, -9.8f, 0.0f);			//Setting gravity
-	sceneDesc.cpuDispatcher = PxDefaultCpuDispatcherCreate(1);		//Creating default CPU dispatcher for the scene
-	sceneDesc.filterShader  = PxDefaultSimulationFilterShader;		//Creating default collision filter shader for the scene
-	
-	gScene = gPhysicsSDK->createScene(sceneDesc);					//Creating a scene 
 
-	
 	//This will enable basic visualization of PhysX objects like- actors collision shapes and their axes. 
 	//The function PxScene::getRenderBuffer() is used to render any active visualization for scene.
 	gScene->setVisualizationParameter(PxVisualizationParameter::eSCALE,				1.0);	//Global visualization scale which gets multiplied with the individual scales
 	gScene->setVisualizationParameter(PxVisualizationParameter::eCOLLISION_SHAPES,	1.0f);	//Enable visualization of actor's shape
 	gScene->setVisualizationParameter(PxVisualizationParameter::eACTOR_AXES,		1.0f);	//Enable visualization of actor's axis
-
-	
-	//Creating PhysX material (staticFriction, dynamicFriction, restitution)
-	PxMaterial* material = gPhysicsSDK->createMaterial(0.1f,0.1f,0.1f);
-
-
-
-	//1)-create static plane	 
-	PxTransform planePos =	PxTransform(PxVec3(0.0f, 0, 0.0f),PxQuat(PxHalfPi, PxVec3(0.0f, 0.0f, 1.0f)));
-	PxRigidStatic* plane =  gPhysicsSDK->createRigidStatic(planePos);	
-
-	plane->createShape(PxPlaneGeometry(), *material);
-	gScene->addActor(*plane);
-
-	//Creating an inclined flat box for testing the movement of character controller.
-	 PxRigidStatic* staticBox  = PxCreateStatic(*gPhysicsSDK, PxTransform(PxVec3(0.0f, 0, 0.0f),PxQuat(PxPi/10, PxVec3(1,0,0))),PxBoxGeometry(15,1,40),*material);
-	 gScene->addActor(*staticBox);
-
-
-
-	//2)Creating Character controller
-	gControllerMgr = PxCreateControllerManager(*gScene);
-	
-	if(gControllerMgr == NULL)
-		cout<<" gControllerMgr failed \n";
-
-
-	
-	//PxBoxControllerDesc playerBoxDesc;
-
-	//playerBoxDesc.position			= PxExtendedVec3(0,10,0);
-	//playerBoxDesc.material			= mDynamicMaterial;
-	//playerBoxDesc.density 			= 100.0f;
-	//playerBoxDesc.halfHeight 			= 5.0f;
-	//playerBoxDesc.halfSideExtent		= 1.75f;
-	//playerBoxDesc.halfForwardExtent 	= 1.5f;
-	//playerBoxDesc.contactOffset 		= 0.05f;
-	//playerBoxDesc.slopeLimit 			= 0.2f;
-	//playerBoxDesc.stepOffset 			= 0.75f;
-
-
-	//Defining the propeties of Capsule Controller descriptor class
-	PxCapsuleControllerDesc capsuleDesc;
-	capsuleDesc.height		= 4; //Height of capsule
-	capsuleDesc.radius		= 2; //Radius of casule
-	capsuleDesc.position	= PxExtendedVec3(0,20,0); //Initial position of capsule
-	capsuleDesc.material	= gPhysicsSDK->createMaterial(0.5f, 0.5f, 0.3f); //Material for capsule shape
-	capsuleDesc.density		= 100.0f; //Desity of capsule shape
-	capsuleDesc.contactOffset = 0.05f;	
-	capsuleDesc.slopeLimit	= 0.2f;
-	capsuleDesc.stepOffset	= 0.75f;
-
-	
-	if(!capsuleDesc.isValid())
-		cout<<"Descriptor is not valid!\n\n";
-
-	gCapsuleController = static_cast<PxCapsuleController*>(gControllerMgr->createController(capsuleDesc));
-
-
-	if(gCapsuleController == NULL)
-		cout<<"gController failed \n";
-
-	//=====================
 }
 
 
-void StepPhysX()					//Stepping PhysX
-{ 
-	gScene->simulate(gTimeStep);	//Advances the simulation by 'gTimeStep' time
-	gScene->fetchResults(true);		//Block until the simulation run is completed
-} 
-
-
 void ShutdownPhysX()				//Shutdown PhysX
 {
+	StepperFinish();				//The scene must not be simulating when released
+	AgentQueryRelease();
 	gPhysicsSDK->release();			//Removes any actors,  particle systems, and constraint shaders from this scene
+	ReleaseCpuDispatcher();			//Worker threads outlive the scene
 	gFoundation->release();			//Destroys the instance of foundation SDK
 }
 
@@ -264,34 +220,60 @@ void ShutdownPhysX()				//Shutdown PhysX
 void OnRender() 
 {
 	
-	int timeSinceStart = glutGet(GLUT_ELAPSED_TIME);
+	int timeSinceStart = GetElapsedTimeMs();
     float deltaTime = (timeSinceStart - oldTimeSinceStart)/1000.0f;
     oldTimeSinceStart = timeSinceStart;
 	
-	mAccumulator  += deltaTime;
-	
-	while(mAccumulator > gTimeStep) 
+	StepperFinish();	//The controller must not move while the scene is simulating
+
+	//Everything that makes two runs differ goes through the recorder, --replay substitutes the recorded values
+	InputFrame input = { deltaTime, gFixedTimestep.stepSize, gMoveDirection, gQuality.pending };
+	if(!InputRecorderFrame(*gScene, input))
 	{
-		mAccumulator -= gTimeStep;
-		StepPhysX(); 
+		ShutdownPhysX();				//End of the replay
+		exit(InputRecorderClose());
 	}
+	deltaTime				= input.dt;
+	gFixedTimestep.stepSize = input.stepSize;
+	gMoveDirection			= input.direction;
+	gQuality.pending		= input.quality;
 
 	gMoveDirection *= gSpeed;				  //Speed of character controller
 	gMoveDirection.y -= gGravity * deltaTime; //Programmatically applying gravity on character controller
 
 	gCapsuleController->move(gMoveDirection,0.001,deltaTime,gCharacterControllerFilters); //moving the character controller
+
+	//Probe rays fanned around the character, against the static shapes cached near it
+	if(gAgentProbes)
+	{
+		PxExtendedVec3 position = gCapsuleController->getPosition();
+		PxVec3 center(PxReal(position.x), PxReal(position.y), PxReal(position.z));
+		AgentQueryMove(0, center);
+
+		PxQueryFilterData staticsOnly(PxQueryFlag::eSTATIC);	//Not the character's own kinematic actor
+		for(PxU32 i=0; i<gAgentProbes; i++)
+		{
+			PxReal angle = 2.0f*PxPi*PxReal(i)/PxReal(gAgentProbes);
+			PxRaycastBuffer probe;
+			AgentRaycast(0, center, PxVec3(PxCos(angle), 0.0f, PxSin(angle)), gProbeReach, probe, staticsOnly);
+		}
+	}
+
+	AdvanceFixedTimestep(deltaTime);	//Whole steps of 'gTimeStep', see 'FixedTimestep.h'
 	
 	
-	glClear(GL_COLOR_BUFFER_BIT);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glLoadIdentity();
 	
 	glTranslatef(0,0,gCamDistance);
 	glRotatef(gCamRoateX,1,0,0);
 	glRotatef(gCamRoateY,0,1,0);
 	
-	RenderData(gScene->getRenderBuffer());
+	ShapeRendererDraw(InterpolatedShapePoses());	//Blended between the last two steps
+	if(gDebugVisualization)
+		RenderData(StepperRenderBuffer());
 	
-	glutSwapBuffers();
+	PresentFrame();
 }
 
 
@@ -306,6 +288,7 @@ void OnReshape(int w, int h)
 
 void OnIdle() 
 {
+	StepperPoll();		//Collect a finished pipelined step early
 	glutPostRedisplay();
 }
 
@@ -314,6 +297,15 @@ void OnShutdown()
 	ShutdownPhysX();
 }
 
+void OnKeyboard(unsigned char key, int x, int y)
+{
+	if(key == 'v')
+	{
+		StepperFinish();	//Scene parameters cannot change during simulate()
+		SetDebugVisualization(*gScene, !gDebugVisualization); //Toggle PhysX debug visualization
+	}
+}
+
 
 
 void OnMouseMotion(int curMouseX, int curMouseY) 
@@ -36,6 +36,12 @@ Reference Chapter	: Chapter-8: Particles
 #include <PxPhysicsAPI.h> //Single header file to include all features of PhysX API 
 #include <GL/freeglut.h>  //OpenGL window tool kit 
 #include "RenderBuffer.h"	  //Used for rendering PhysX objetcs 
+#include "ShapeRenderer.h"  //Used for rendering PhysX actors as shaded meshes 
+#include "RenderContext.h"  //Window or headless context creation 
+#include "CpuDispatcher.h"   //Worker threads of the scene 
+#include "ChapterScenes.h"  //Scenes of all chapters, without rendering 
+#include "PhysXStepper.h"   //Blocking or pipelined stepping 
+#include "FixedTimestep.h"  //Capped fixed steps with interpolation 
 #include <vector>
 
 
@@ -63,7 +69,6 @@ float gCamDistance	= -50;
 //------------------------
 
 int oldTimeSinceStart = 0;
-float mAccumulator = 0.0f;
 
 
 static PxPhysics*				gPhysicsSDK = NULL;			//Instance of PhysX SDK
@@ -79,7 +84,6 @@ PxReal							gTimeStep = 1.0f/60;		//Time-step value for PhysX simulation
 //========== PhysX function prototypes ===========//
 
 void InitPhysX();		//Initialize the PhysX SDK and create actors. 
-void StepPhysX();		//Step PhysX simulation
 void ShutdownPhysX();	//Shutdown PhysX SDK
 
 
@@ -89,6 +93,7 @@ void OnRender();					//Display callback for the current glut window
 void OnIdle();						//Called whenever the application is idle
 void OnReshape(int, int);			//Called whenever the application window is resized
 void OnShutdown();					//Called on application exit
+void OnKeyboard(unsigned char,int,int);	//Called when any ascii key is pressed
 void OnMouseMotion(int,int);		//Called when the mouse is moving
 void OnMousePress(int,int,int,int); //Called when any mouse button is pressed
 
@@ -98,19 +103,29 @@ void OnMousePress(int,int,int,int); //Called when any mouse button is pressed
 int main(int argc, char** argv)
 {
 
-	glutInit(&argc, argv);								//Initialize GLUT
-	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);		//Enable double buffering
-	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);		//Enable double buffering
-	glutSetOption(GLUT_MULTISAMPLE, 16);
-	glutInitWindowSize(gWindowWidth, gWindowHeight);	//Set window's initial width & height
-
-	glutCreateWindow("PhysX and openGL"); // Create a window with the given title
+	ParseRenderOptions(argc, argv);	//--headless, --frames N, --capture
+	ParseDispatcherOptions(argc, argv);	//--workers N, --affinity, --priority P
+	ParseFixedTimestepOptions(argc, argv);	//--max-steps N, --sim-budget MS, --no-interpolate
+	CreateRenderContext(&argc, argv, "PhysX and openGL", gWindowWidth, gWindowHeight); //GLUT window or offscreen context
 
 	InitPhysX();
+	ShapeRendererInit(*gScene);	//Collect the actors drawn as shaded meshes
+	StepperInit(gScene, ParseSteppingMode(argc, argv));	//--pipelined overlaps simulate() with rendering
+	FixedTimestepInit(gTimeStep);	//Steps of 'gTimeStep', at most --max-steps per frame
+
+	if(gRenderOptions.frames)
+	{
+		RunFrames(OnRender, OnReshape);	//Fixed number of offscreen frames, then exit
+		PrintStepperStats();				//Simulation time hidden behind rendering
+		PrintFixedTimestepStats();		//Steps taken and dropped
+		ShutdownPhysX();
+		return EXIT_SUCCESS;
+	}
 
 	glutDisplayFunc(OnRender);	//Display callback for the current glut window
 	glutIdleFunc(OnIdle);		//Called whenever the application is idle
 	glutReshapeFunc(OnReshape); //Called whenever the app window is resized
+	glutKeyboardFunc(OnKeyboard);	//Called on ascii key event
 
 	glutMouseFunc(OnMousePress);	//Called on mouse button event
 	glutMotionFunc(OnMouseMotion);	//Called on mouse motion event
@@ -140,17 +155,13 @@ void InitPhysX()
 
 
 
-	//Creating scene
-	PxSceneDesc sceneDesc(gPhysicsSDK->getTolerancesScale());		//Descriptor class for scenes 
+	//Creating scene and actors, shared with 'physx_bench', see 'ChapterScenes.h'
+	ChapterActors actors;
+	gScene = CreateParticlesScene(*gPhysicsSDK, CreateCpuDispatcher(), actors);	//CPU dispatcher with --workers threads
+	if(actors.particleSystem)
+		cout << "\nParticles created....!\n";
 
-	sceneDesc.gravity		= PxVec3(0.0f, -9.8f, 0.0f);			//Setting gravity
-	sceneDesc.cpuDispatcher = PxDefaultCpuDispatcherCreate(1);		//Creating default CPU dispatcher for the scene
-	sceneDesc.filterShader  = PxDefaultSimulationFilterShader;		//Creating default collision filter shader for the scene
-	
-	gScene = gPhysicsSDK->createScene(sceneDesc);					//Creating a scene 
 
-	
-	
 	//This will enable basic visualization of PhysX objects like- actors collision shapes and their axes. 
 	//The function PxScene::getRenderBuffer() is used to render any active visualization for scene.
 	gScene->setVisualizationParameter(PxVisualizationParameter::eSCALE,				1.0);	//Global visualization scale which gets multiplied with the individual scales
@@ -158,84 +169,15 @@ void InitPhysX()
 	gScene->setVisualizationParameter(PxVisualizationParameter::eACTOR_AXES,		1.0f);	//Enable visualization of actor's axis
 
 	gScene->setVisualizationParameter(PxVisualizationParameter::ePARTICLE_SYSTEM_POSITION,		1.0f);
-
-	
-	
-	//Creating PhysX material (staticFriction, dynamicFriction, restitution)
-	PxMaterial* material = gPhysicsSDK->createMaterial(0.5f,0.5f,0.5f);
-
-
-	//1)-create static plane	 
-	PxTransform planePos =	PxTransform(PxVec3(0,0,0),PxQuat(PxHalfPi, PxVec3(0.0f, 0.0f, 1.0f)));
-	PxRigidStatic* plane =  gPhysicsSDK->createRigidStatic(planePos);	
-	
-	plane->createShape(PxPlaneGeometry(), *material);
-	gScene->addActor(*plane);
-
-
-	PxRigidDynamic* actor=  PxCreateDynamic(*gPhysicsSDK,PxTransform(PxVec3(0,70,0)),PxSphereGeometry(5),*material,1);
-	gScene->addActor(*actor);
-	
-	
-	//^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
-
-	// create particle system in PhysX SDK
-	PxParticleSystem* ps = gPhysicsSDK->createParticleSystem(1000);
-			
-	// add particle system to scene, in case creation was successful
-	if(ps)
-		gScene->addActor(*ps);
-		//printf("\nParticles system created....!\n");
-	
-	
-	vector<const PxVec3>  posBuff; 	//Buffer to store positions of all particles
-	vector<PxU32>  indexBuff; //Buffer to store indices of all particles
-	unsigned sideNum 	= 8;		
-	int distance		= 1;		//Distance betwwen each particles
-	PxU32 particleCount 	= 0;		//keeps tatal count of the particles
-	
-	
-	//Creating stack of particles
-	for(unsigned i=0; i<sideNum; i++)
-		for(unsigned j=0; j<sideNum; j++)
-			for(unsigned k=0; k<sideNum; k++)
-			{
-				PxVec3 p = PxVec3(i*distance,j*distance,k*distance); //Calculating position for each particle
-			
-				posBuff.push_back(p+PxVec3(0,30,0));
-				indexBuff.push_back(particleCount);
-
-				particleCount++;
-			}
-
-
-		//Define particle descriptor class for creating new particles
-		PxParticleCreationData particleCreationData;
-		
-		particleCreationData.numParticles	= particleCount;
-		particleCreationData.indexBuffer	= PxStrideIterator<const PxU32>(&indexBuff[0]);;
-		particleCreationData.positionBuffer = PxStrideIterator<const PxVec3>(&posBuff[0]);
-
-	
-	// create particles in *PxParticleSystem* ps
-	bool success = ps->createParticles(particleCreationData);
-	if(success)
-		cout << "\nParticles created....!\n";
-	//^^^^^^^^^^^^^^^^^^^^^
 }
 
 
-void StepPhysX()					//Stepping PhysX
-{ 
-	gScene->simulate(gTimeStep);	//Advances the simulation by 'gTimeStep' time
-	gScene->fetchResults(true);		//Block until the simulation run is completed
-} 
-
-
 void ShutdownPhysX()				//Shutdown PhysX
 {
+	StepperFinish();				//The scene must not be simulating when released
 	gScene->release();				//Removes any actors,  particle systems, and constraint shaders from this scene
 	gPhysicsSDK->release();			
+	ReleaseCpuDispatcher();			//Worker threads outlive the scene
 	gFoundation->release();			//Destroys the instance of foundation SDK
 }
 
@@ -244,23 +186,13 @@ void ShutdownPhysX()				//Shutdown PhysX
 
 void OnRender() 
 {
-	 int timeSinceStart = glutGet(GLUT_ELAPSED_TIME);
+	 int timeSinceStart = GetElapsedTimeMs();
      float deltaTime = (timeSinceStart - oldTimeSinceStart)/1000.0f;
      oldTimeSinceStart = timeSinceStart;
 	
-	mAccumulator  += deltaTime;
-	
-	while(mAccumulator > gTimeStep) 
-	{
-		mAccumulator -= gTimeStep;
-		StepPhysX(); 
-	}
-	
-	//Update PhysX	
-	if(gScene) 
-		StepPhysX(); 
+	AdvanceFixedTimestep(deltaTime);	//Whole steps of 'gTimeStep', see 'FixedTimestep.h'
 
-	glClear(GL_COLOR_BUFFER_BIT);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glLoadIdentity();
 	
 	glTranslatef(0,0,gCamDistance);
@@ -268,9 +200,11 @@ void OnRender()
 	glRotatef(gCamRoateY,0,1,0);
 	//CreatParticles();
 
-	RenderData(gScene->getRenderBuffer());
+	ShapeRendererDraw(InterpolatedShapePoses());	//Blended between the last two steps
+	if(gDebugVisualization)
+		RenderData(StepperRenderBuffer());
 	
-	glutSwapBuffers();
+	PresentFrame();
 }
 
 
@@ -285,6 +219,7 @@ void OnReshape(int w, int h)
 
 void OnIdle() 
 {
+	StepperPoll();		//Collect a finished pipelined step early
 	glutPostRedisplay();
 }
 
@@ -293,6 +228,15 @@ void OnShutdown()
 	ShutdownPhysX();
 }
 
+void OnKeyboard(unsigned char key, int x, int y)
+{
+	if(key == 'v')
+	{
+		StepperFinish();	//Scene parameters cannot change during simulate()
+		SetDebugVisualization(*gScene, !gDebugVisualization); //Toggle PhysX debug visualization
+	}
+}
+
 
 
 void OnMouseMotion(int curMouseX, int curMouseY) 
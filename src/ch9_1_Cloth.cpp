@@ -38,6 +38,12 @@ Reference Chapter	: Chapter-9: Cloth
 #include <PxPhysicsAPI.h> //Single header file to include all features of PhysX API 
 #include <GL/freeglut.h>  //OpenGL window tool kit 
 #include "RenderBuffer.h"	  //Used for rendering PhysX objetcs 
+#include "ShapeRenderer.h"  //Used for rendering PhysX actors as shaded meshes 
+#include "RenderContext.h"  //Window or headless context creation 
+#include "CpuDispatcher.h"   //Worker threads of the scene 
+#include "ChapterScenes.h"  //Scenes of all chapters, without rendering 
+#include "PhysXStepper.h"   //Blocking or pipelined stepping 
+#include "FixedTimestep.h"  //Capped fixed steps with interpolation 
 
 
 
@@ -64,7 +70,6 @@ float gCamDistance	= -50;
 //------------------------
 
 int oldTimeSinceStart = 0;
-float mAccumulator = 0.0f;
 
 
 static PxPhysics*				gPhysicsSDK = NULL;			//Instance of PhysX SDK
@@ -80,7 +85,6 @@ PxCloth* gCloth = NULL;										//Intance of cloth
 //========== PhysX function prototypes ===========//
 
 void InitPhysX();		//Initialize the PhysX SDK and create actors. 
-void StepPhysX();		//Step PhysX simulation
 void ShutdownPhysX();	//Shutdown PhysX SDK
 
 
@@ -90,6 +94,7 @@ void OnRender();					//Display callback for the current glut window
 void OnIdle();						//Called whenever the application is idle
 void OnReshape(int, int);			//Called whenever the application window is resized
 void OnShutdown();					//Called on application exit
+void OnKeyboard(unsigned char,int,int);	//Called when any ascii key is pressed
 void OnMouseMotion(int,int);		//Called when the mouse is moving
 void OnMousePress(int,int,int,int); //Called when any mouse button is pressed
 
@@ -99,19 +104,29 @@ void OnMousePress(int,int,int,int); //Called when any mouse button is pressed
 int main(int argc, char** argv)
 {
 
-    glutInit(&argc, argv);								//Initialize GLUT
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);		//Enable double buffering
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA);		//Enable double buffering
-    glutSetOption(GLUT_MULTISAMPLE, 16);
-    glutInitWindowSize(gWindowWidth, gWindowHeight);	//Set window's initial width & height
-
-    glutCreateWindow("PhysX and openGL"); // Create a window with the given title
+    ParseRenderOptions(argc, argv);	//--headless, --frames N, --capture
+    ParseDispatcherOptions(argc, argv);	//--workers N, --affinity, --priority P
+    ParseFixedTimestepOptions(argc, argv);	//--max-steps N, --sim-budget MS, --no-interpolate
+    CreateRenderContext(&argc, argv, "PhysX and openGL", gWindowWidth, gWindowHeight); //GLUT window or offscreen context
 
     InitPhysX();
+    ShapeRendererInit(*gScene);	//Collect the actors drawn as shaded meshes
+    StepperInit(gScene, ParseSteppingMode(argc, argv));	//--pipelined overlaps simulate() with rendering
+    FixedTimestepInit(gTimeStep);	//Steps of 'gTimeStep', at most --max-steps per frame
+
+    if(gRenderOptions.frames)
+    {
+        RunFrames(OnRender, OnReshape);	//Fixed number of offscreen frames, then exit
+        PrintStepperStats();				//Simulation time hidden behind rendering
+        PrintFixedTimestepStats();		//Steps taken and dropped
+        ShutdownPhysX();
+        return EXIT_SUCCESS;
+    }
 
     glutDisplayFunc(OnRender);	//Display callback for the current glut window
     glutIdleFunc(OnIdle);		//Called whenever the application is idle
     glutReshapeFunc(OnReshape); //Called whenever the app window is resized
+    glutKeyboardFunc(OnKeyboard);	//Called on ascii key event
 
     glutMouseFunc(OnMousePress);	//Called on mouse button event
     glutMotionFunc(OnMouseMotion);	//Called on mouse motion event
@@ -123,84 +138,6 @@ int main(int argc, char** argv)
 }
 
 
-void CreateCloth()
-{
-	
-	PxTransform gPose = PxTransform(PxVec3(0,1,0));
-	
-	// create regular mesh
-	PxU32 resolution = 20;
-	PxU32 numParticles = resolution*resolution;
-	PxU32 numTriangles = 2*(resolution-1)*(resolution-1);
-
-	// create cloth particles
-	PxClothParticle* particles = new PxClothParticle[numParticles];
-	PxVec3 center(0.5f, 0.3f, 0.0f);
-	PxVec3 delta = 1.0f/(resolution-1) * PxVec3(15.0f, 15.0f, 15.0f);
-	PxClothParticle* pIt = particles;
-	for(PxU32 i=0; i<resolution; ++i)
-	{
-		for(PxU32 j=0; j<resolution; ++j, ++pIt)
-		{
-			pIt->invWeight = j+1<resolution ? 1.0f : 0.0f;
-			pIt->pos = delta.multiply(PxVec3(PxReal(i), 
-				PxReal(j), -PxReal(j))) - center;
-		}
-	}
-
-	// create triangles
-	PxU32* triangles = new PxU32[3*numTriangles];
-	PxU32* iIt = triangles;
-	for(PxU32 i=0; i<resolution-1; ++i)
-	{
-		for(PxU32 j=0; j<resolution-1; ++j)
-		{
-			PxU32 odd = j&1u, even = 1-odd;
-			*iIt++ = i*resolution + (j+odd);
-			*iIt++ = (i+odd)*resolution + (j+1);
-			*iIt++ = (i+1)*resolution + (j+even);
-			*iIt++ = (i+1)*resolution + (j+even);
-			*iIt++ = (i+even)*resolution + j;
-			*iIt++ = i*resolution + (j+odd);
-		}
-	}
-
-	// create fabric from mesh
-	PxClothMeshDesc meshDesc;
-	meshDesc.points.count = numParticles;
-	meshDesc.points.stride = sizeof(PxClothParticle);
-	meshDesc.points.data = particles;
-
-	meshDesc.invMasses.count = numParticles;
-	meshDesc.invMasses.stride = sizeof(PxClothParticle);
-	meshDesc.invMasses.data = &particles->invWeight;
-	
-	meshDesc.triangles.count = numTriangles;
-	meshDesc.triangles.stride = 3*sizeof(PxU32);
-	meshDesc.triangles.data = triangles;
-
-
-	// cook fabric
-	PxClothFabric* fabric = PxClothFabricCreate(*gPhysicsSDK, meshDesc, PxVec3(0, 1, 0));
-
-	delete[] triangles;
-
-	// create cloth
-	gCloth = gPhysicsSDK->createCloth(gPose, *fabric, particles, PxClothFlags(0));
-
-	fabric->release();
-	delete[] particles;
-
-	// 240 iterations per/second (4 per-60hz frame)
-	gCloth->setSolverFrequency(240.0f);
-
-	gScene->addActor(*gCloth);
-		
-
-}
-
-
-
 void InitPhysX() 
 {
 	//Creating foundation for PhysX
@@ -217,17 +154,12 @@ void InitPhysX()
 
 
 
-	//Creating scene
-	PxSceneDesc sceneDesc(gPhysicsSDK->getTolerancesScale());		//Descriptor class for scenes 
+	//Creating scene and actors, shared with 'physx_bench', see 'ChapterScenes.h'
+	ChapterActors actors;
+	gScene = CreateClothScene(*gPhysicsSDK, CreateCpuDispatcher(), actors);	//CPU dispatcher with --workers threads
+	gCloth = actors.cloth;
 
-	sceneDesc.gravity		= PxVec3(0.0f, -9.8f, 0.0f);			//Setting gravity
-	sceneDesc.cpuDispatcher = PxDefaultCpuDispatcherCreate(1);		//Creating default CPU dispatcher for the scene
-	sceneDesc.filterShader  = PxDefaultSimulationFilterShader;		//Creating default collision filter shader for the scene
-	
-	gScene = gPhysicsSDK->createScene(sceneDesc);					//Creating a scene 
 
-	
-	
 	//This will enable basic visualization of PhysX objects like- actors collision shapes and their axes. 
 	//The function PxScene::getRenderBuffer() is used to render any active visualization for scene.
 	gScene->setVisualizationParameter(PxVisualizationParameter::eSCALE,				1.0);	//Global visualization scale which gets multiplied with the individual scales
@@ -237,38 +169,14 @@ void InitPhysX()
 	gScene->setVisualizationParameter(PxVisualizationParameter::eCLOTH_HORIZONTAL,		1.0f);
 	gScene->setVisualizationParameter(PxVisualizationParameter::eCLOTH_VERTICAL,1.0f);
 	gScene->setVisualizationParameter(PxVisualizationParameter::eCLOTH_BENDING,1.0f);
-	
-	
-	//Creating PhysX material (staticFriction, dynamicFriction, restitution)
-	PxMaterial* material = gPhysicsSDK->createMaterial(0.5f,0.5f,0.5f);
-
-
-	//1)-create static plane	 
-	PxTransform planePos =	PxTransform(PxVec3(0, 0, 0),PxQuat(PxHalfPi, PxVec3(0.0f, 0.0f, 1.0f)));
-	PxRigidStatic* plane =  gPhysicsSDK->createRigidStatic(planePos);	
-	
-	plane->createShape(PxPlaneGeometry(), *material);
-	gScene->addActor(*plane);
-
-	CreateCloth();
-
-	gCloth->addCollisionPlane(PxClothCollisionPlane(PxVec3(0, 1, 0), 0.0f));
-	gCloth->addCollisionConvex(1 << 0); // Convex references the first plane
-
 }
 
 
-void StepPhysX()					//Stepping PhysX
-{ 
-	
-	gScene->simulate(gTimeStep);	//Advances the simulation by 'gTimeStep' time
-	gScene->fetchResults(true);		//Block until the simulation run is completed
-} 
-
-
 void ShutdownPhysX()				//Shutdown PhysX
 {
+	StepperFinish();				//The scene must not be simulating when released
 	gPhysicsSDK->release();			//Removes any actors,  particle systems, and constraint shaders from this scene
+	ReleaseCpuDispatcher();			//Worker threads outlive the scene
 	gFoundation->release();			//Destroys the instance of foundation SDK
 }
 
@@ -277,24 +185,13 @@ void ShutdownPhysX()				//Shutdown PhysX
 
 void OnRender() 
 {
-	 int timeSinceStart = glutGet(GLUT_ELAPSED_TIME); 
+	 int timeSinceStart = GetElapsedTimeMs(); 
      float deltaTime = (timeSinceStart - oldTimeSinceStart)/1000.0f;
      oldTimeSinceStart = timeSinceStart;
 	
-	 mAccumulator  += deltaTime;
-
-
-	while(mAccumulator > gTimeStep) 
-	{
-		mAccumulator -= gTimeStep;
-		StepPhysX(); 
-	}
-	
-	//Update PhysX	
-	if(gScene) 
-		StepPhysX(); 
+	AdvanceFixedTimestep(deltaTime);	//Whole steps of 'gTimeStep', see 'FixedTimestep.h'
 
-	glClear(GL_COLOR_BUFFER_BIT);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glLoadIdentity();
 	
 	glTranslatef(0,0,gCamDistance);
@@ -302,9 +199,11 @@ void OnRender()
 	glRotatef(gCamRoateY,0,1,0);
 	
 
-	RenderData(gScene->getRenderBuffer());
+	ShapeRendererDraw(InterpolatedShapePoses());	//Blended between the last two steps
+	if(gDebugVisualization)
+		RenderData(StepperRenderBuffer());
 	
-	glutSwapBuffers();
+	PresentFrame();
 }
 
 
@@ -319,6 +218,7 @@ void OnReshape(int w, int h)
 
 void OnIdle() 
 {
+	StepperPoll();		//Collect a finished pipelined step early
 	glutPostRedisplay();
 }
 
@@ -327,6 +227,15 @@ void OnShutdown()
 	ShutdownPhysX();
 }
 
+void OnKeyboard(unsigned char key, int x, int y)
+{
+	if(key == 'v')
+	{
+		StepperFinish();	//Scene parameters cannot change during simulate()
+		SetDebugVisualization(*gScene, !gDebugVisualization); //Toggle PhysX debug visualization
+	}
+}
+
 
 
 void OnMouseMotion(int curMouseX, int curMouseY) 
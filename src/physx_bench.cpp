@@ -0,0 +1,208 @@
+/*
+=====================================================================
+
+File Name	  :	physx_bench.cpp
+
+Description	  : Headless batch runner for the chapter scenes ('ChapterScenes.h'), for
+				automated performance runs. No window, GL or GLUT code is involved.
+
+				The scene is stepped with blocking 'simulate()' + 'fetchResults(true)'
+				calls, running the chapter's per-step game logic before each one. Every
+				step is timed, and a single JSON object is printed to stdout:
+
+				  wall time of the measured steps, per-step mean/p50/p95/p99/max,
+				  and the 'PxSimulationStatistics' of the last step
+
+				'state_hash' is the 'SceneStateHash()' of 'InputRecorder.h' after the
+				last step; runs with equal hashes simulated exactly the same thing.
+
+				With '--scene all' every chapter runs in turn and a JSON array is printed.
+				Errors, PhysX warnings included, go to stderr so stdout stays parsable.
+
+				Command line options:
+				  --scene S      ch2 .. ch9, or all (default ch5)
+				  --steps N      Measured steps (default 1000)
+				  --warmup N     Steps before measuring (default 60)
+				  --workers N, --affinity, --priority P, --dispatcher D   As for the demos
+
+				Example:
+				  physx_bench --scene ch5 --steps 10000 --workers 8
+
+=====================================================================
+*/
+
+#define _DEBUG 1
+
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <PxPhysicsAPI.h>		//Single header file to include all features of PhysX API
+#include "CpuDispatcher.h"		//CreateCpuDispatcher()
+#include "ChapterScenes.h"		//gChapterScenes
+#include "InputRecorder.h"		//SceneStateHash()
+
+
+
+using namespace std;
+using namespace physx;
+
+
+//PhysX messages on stderr; 'PxDefaultErrorCallback' prints them to stdout, inside the JSON
+class StderrErrorCallback : public PxErrorCallback
+{
+public:
+	virtual void reportError(PxErrorCode::Enum code, const char* message, const char* file, int line)
+	{
+		fprintf(stderr, "%d %s:%d %s\n", int(code), file, line, message);
+	}
+};
+
+
+static StderrErrorCallback		gErrorCallback;				//Reports PhysX errors and warnings to stderr
+static PxDefaultAllocator		gDefaultAllocatorCallback;	//Instance of default implementation of the allocator interface required by the SDK
+
+PxFoundation*	gFoundation	= NULL;
+PxPhysics*		gPhysicsSDK	= NULL;
+PxReal			gTimeStep	= 1.0f/60.0f;
+
+
+struct BenchResult
+{
+	double					wallMs;		//All measured steps
+	vector<double>			stepMs;		//Sorted
+	PxSimulationStatistics	stats;		//Of the last step
+	PxU64					stateHash;	//After the last step, equal between runs that simulated the same
+};
+
+
+//Nearest-rank percentile of sorted values
+double Percentile(const vector<double>& sorted, double p)
+{
+	if(sorted.empty())
+		return 0.0;
+	size_t rank = size_t(p/100.0*sorted.size() + 0.5);
+	return sorted[PxMin(rank > 0 ? rank - 1 : 0, sorted.size() - 1)];
+}
+
+
+BenchResult RunScene(const ChapterScene& chapter, PxCpuDispatcher* dispatcher, int warmupSteps, int steps)
+{
+	ChapterActors actors;
+	PxScene* scene = chapter.create(*gPhysicsSDK, dispatcher, actors);
+
+	for(int i=0; i<warmupSteps; i++)
+	{
+		if(chapter.update)
+			chapter.update(actors, gTimeStep);
+		scene->simulate(gTimeStep);
+		scene->fetchResults(true);
+	}
+
+	BenchResult result;
+	result.stepMs.reserve(steps);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(int i=0; i<steps; i++)
+	{
+		chrono::steady_clock::time_point stepStart = chrono::steady_clock::now();
+		if(chapter.update)
+			chapter.update(actors, gTimeStep);
+		scene->simulate(gTimeStep);
+		scene->fetchResults(true);
+		result.stepMs.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - stepStart).count());
+	}
+	result.wallMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+	scene->getSimulationStatistics(result.stats);
+	result.stateHash = SceneStateHash(*scene);
+	sort(result.stepMs.begin(), result.stepMs.end());
+
+	if(actors.controllerManager)
+		actors.controllerManager->release();	//Controllers hold actors of the scene
+	scene->release();
+	return result;
+}
+
+
+void PrintResult(const ChapterScene& chapter, const BenchResult& r, int steps)
+{
+	const PxSimulationStatistics& s = r.stats;
+	PxU32 shapes = 0;
+	for(int g=0; g<PxGeometryType::eGEOMETRY_COUNT; g++)
+		shapes += s.nbShapes[g];
+
+	double meanMs = steps ? r.wallMs/steps : 0.0;
+	printf("{\"scene\": \"%s\", \"steps\": %d, \"time_step\": %.6f, \"workers\": %u, \"dispatcher\": \"%s\",\n",
+		chapter.name, steps, gTimeStep, gDispatcherOptions.workers,
+		gDispatcherOptions.type == eDISPATCHER_WORK_STEALING ? "stealing" : "default");
+	printf(" \"wall_ms\": %.3f, \"state_hash\": \"%016llx\",\n", r.wallMs, (unsigned long long)r.stateHash);
+	printf(" \"step_ms\": {\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n",
+		meanMs, Percentile(r.stepMs, 50.0), Percentile(r.stepMs, 95.0), Percentile(r.stepMs, 99.0),
+		r.stepMs.empty() ? 0.0 : r.stepMs.back());
+	printf(" \"statistics\": {\"active_constraints\": %u, \"active_dynamic_bodies\": %u, \"active_kinematic_bodies\": %u,"
+		" \"static_bodies\": %u, \"dynamic_bodies\": %u, \"shapes\": %u, \"aggregates\": %u, \"articulations\": %u,"
+		" \"axis_solver_constraints\": %u, \"compressed_contact_size\": %u, \"required_contact_constraint_memory\": %u,"
+		" \"peak_constraint_memory\": %u, \"discrete_contact_pairs\": %u, \"discrete_contact_pairs_cache_hits\": %u,"
+		" \"discrete_contact_pairs_with_contacts\": %u, \"new_pairs\": %u, \"lost_pairs\": %u, \"new_touches\": %u,"
+		" \"lost_touches\": %u, \"partitions\": %u, \"broadphase_adds\": %u, \"broadphase_removes\": %u}}",
+		s.nbActiveConstraints, s.nbActiveDynamicBodies, s.nbActiveKinematicBodies,
+		s.nbStaticBodies, s.nbDynamicBodies, shapes, s.nbAggregates, s.nbArticulations,
+		s.nbAxisSolverConstraints, s.compressedContactSize, s.requiredContactConstraintMemory,
+		s.peakConstraintMemory, s.nbDiscreteContactPairsTotal, s.nbDiscreteContactPairsWithCacheHits,
+		s.nbDiscreteContactPairsWithContacts, s.nbNewPairs, s.nbLostPairs, s.nbNewTouches,
+		s.nbLostTouches, s.nbPartitions,
+		s.getNbBroadPhaseAdds(PxSimulationStatistics::eRIGID_BODY), s.getNbBroadPhaseRemoves(PxSimulationStatistics::eRIGID_BODY));
+}
+
+
+int main(int argc, char** argv)
+{
+	ParseDispatcherOptions(argc, argv);	//--workers N, --affinity, --priority P, --dispatcher D
+	const char* sceneName = GetStringArgument(argc, argv, "--scene", "ch5");
+	int steps			  = PxMax(1, GetIntArgument(argc, argv, "--steps", 1000));
+	int warmupSteps		  = PxMax(0, GetIntArgument(argc, argv, "--warmup", 60));
+
+	vector<const ChapterScene*> chapters;
+	if(!strcmp(sceneName, "all"))
+	{
+		for(PxU32 i=0; i<gChapterSceneCount; i++)
+			chapters.push_back(&gChapterScenes[i]);
+	}
+	else if(const ChapterScene* chapter = FindChapterScene(sceneName))
+	{
+		chapters.push_back(chapter);
+	}
+	else
+	{
+		cerr<<"Unknown scene '"<<sceneName<<"', expected ch2 .. ch9 or all"<<endl;
+		return EXIT_FAILURE;
+	}
+
+	gFoundation = PxCreateFoundation(PX_FOUNDATION_VERSION, gDefaultAllocatorCallback, gErrorCallback);
+	gPhysicsSDK = PxCreatePhysics(PX_PHYSICS_VERSION, *gFoundation, PxTolerancesScale());
+	if(gPhysicsSDK == NULL)
+	{
+		cerr<<"Error creating PhysX3 device, Exiting..."<<endl;
+		exit(1);
+	}
+
+	PxCpuDispatcher* dispatcher = CreateCpuDispatcher();
+
+	if(chapters.size() > 1)
+		printf("[\n");
+	for(size_t i=0; i<chapters.size(); i++)
+	{
+		BenchResult result = RunScene(*chapters[i], dispatcher, warmupSteps, steps);
+		PrintResult(*chapters[i], result, steps);
+		printf(i+1 < chapters.size() ? ",\n" : "\n");
+	}
+	if(chapters.size() > 1)
+		printf("]\n");
+
+	gPhysicsSDK->release();
+	ReleaseCpuDispatcher();			//Worker threads outlive the scenes
+	gFoundation->release();
+	return EXIT_SUCCESS;
+}